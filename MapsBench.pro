@@ -0,0 +1,13 @@
+TEMPLATE = app
+CONFIG  += console
+CONFIG  -= app_bundle
+CONFIG  -= qt
+TARGET   = maps_bench
+
+LIBS    += -lpthread -lm
+
+SOURCES += \
+            maps_bench_tool.c \
+            maps_proto.c \
+            maps_corpus.c \
+            maps_reparse.c
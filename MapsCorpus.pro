@@ -0,0 +1,10 @@
+TEMPLATE = app
+CONFIG  += console
+CONFIG  -= app_bundle
+CONFIG  -= qt
+TARGET   = maps_corpus
+
+SOURCES += \
+            maps_corpus_tool.c \
+            maps_proto.c \
+            maps_corpus.c
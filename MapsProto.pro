@@ -2,7 +2,30 @@ TEMPLATE = app
 CONFIG  += console
 CONFIG  -= app_bundle
 CONFIG  -= qt
+CONFIG  += c++2a
+
+LIBS    += -lpthread
+
+DEFINES += MAPS_PROTO_STATS
 
 SOURCES += \
             main.c \
-            maps_proto.c
+            maps_proto.c \
+            maps_sched.c \
+            maps_config.c \
+            maps_record.c \
+            maps_bus.c \
+            maps_serial.c \
+            maps_store.c \
+            maps_reparse.c \
+            maps_view.c \
+            maps_stats.c \
+            maps_latency.c \
+            maps_corpus.c \
+            maps_metrics.c \
+            maps_shard.c \
+            maps_stamp.c \
+            maps_speed.c \
+            maps_dedup.c \
+            maps_shed.c \
+            maps_cpp_tests.cpp
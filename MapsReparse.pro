@@ -0,0 +1,13 @@
+TEMPLATE = app
+CONFIG  += console
+CONFIG  -= app_bundle
+CONFIG  -= qt
+TARGET   = maps_reparse
+
+LIBS    += -lpthread
+
+SOURCES += \
+            maps_reparse_tool.c \
+            maps_proto.c \
+            maps_serial.c \
+            maps_reparse.c
@@ -0,0 +1,18 @@
+TEMPLATE = app
+CONFIG  += console
+CONFIG  -= app_bundle
+CONFIG  -= qt
+TARGET   = maps_shard
+
+LIBS    += -lpthread
+
+SOURCES += \
+            maps_shard_tool.c \
+            maps_proto.c \
+            maps_corpus.c \
+            maps_reparse.c \
+            maps_store.c \
+            maps_shard.c \
+            maps_stamp.c \
+            maps_dedup.c \
+            maps_shed.c
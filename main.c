@@ -1,9 +1,41 @@
 #include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include "maps_proto.h"
+#include "maps_sched.h"
+#include "maps_config.h"
+#include "maps_record.h"
+#include "maps_bus.h"
+#include "maps_serial.h"
+#include "maps_store.h"
+#include "maps_reparse.h"
+#include "maps_view.h"
+#include "maps_stats.h"
+#include "maps_latency.h"
+#include "maps_corpus.h"
+#include "maps_metrics.h"
+#include "maps_shard.h"
+#include "maps_stamp.h"
+#include "maps_speed.h"
+#include "maps_dedup.h"
+#include "maps_shed.h"
+//-----------------------------------------------------------------------------
+
+void CppTests(void);       // maps_cpp_tests.cpp
+void CppBuildTests(void);  // maps_cpp_tests.cpp
+void CppClientTests(void); // maps_cpp_tests.cpp
 //-----------------------------------------------------------------------------
 
 #define K_ERROR_REQ_FRAMES 3
@@ -163,6 +195,412 @@ void CreateAndParseErrors()
 }
 //-----------------------------------------------------------------------------
 
+void SchedulerTests()
+{
+    int lane;
+    tMAPS_PROTO_SCHED_POLL  poll;
+    tMAPS_PROTO_SCHED_USAGE usage;
+    tMAPS_PROTO_PARSED_FRAME rs = { .num = 0, .type = 1, .cmd = "TT", };
+    tMAPS_PROTO_PARSED_FRAME ip = { .num = 0, .type = 0, .cmd = "IP", };
+    tMAPS_PROTO_SCHED *sched = MapsProtoSchedCreate(1,2,1000,50);
+
+    printf("\n#### SCHEDULER TESTS ####\n");
+
+    if (MapsProtoGetWireTime(35,1) == 36459 && MapsProtoGetWireTime(35,5) == 3039)
+        printf("SCHED WIRE TIME test PASSED\n");
+    else
+        printf("SCHED WIRE TIME test FAILED\n");
+
+    if (!sched || (lane = MapsProtoSchedAddLane(sched,0,1,K_MAPS_PROTO_BARRIER_CF24P)) < 0)
+    {
+        printf("SCHED CREATE test FAILED. Error: %s\n",strerror(errno));
+        MapsProtoSchedFree(sched);
+        return;
+    }
+
+    if (MapsProtoSchedAddPoll(sched,lane,"TT",100) == 0 && MapsProtoSchedAddPoll(sched,lane,"SR",100) == -1 && errno == EPERM)
+        printf("SCHED ADD POLL test PASSED\n");
+    else
+        printf("SCHED ADD POLL test FAILED\n");
+
+    if (MapsProtoSchedNext(sched,0,1000,&poll) == 1 && !strcmp(poll.cmd,"TT") && poll.wire_time == 43751 &&
+        MapsProtoSchedNext(sched,0,1010,&poll) == 0)
+        printf("SCHED NEXT test PASSED\n");
+    else
+        printf("SCHED NEXT test FAILED\n");
+
+    MapsProtoSchedOnFrame(sched,lane,&rs,35,1044);
+    MapsProtoSchedOnFrame(sched,lane,&ip,7,1050);
+
+    if (MapsProtoSchedNext(sched,0,1200,&poll) == 0)
+        printf("SCHED PRESENCE test PASSED\n");
+    else
+        printf("SCHED PRESENCE test FAILED\n");
+
+    ip.cmd[0] = 'F';
+    MapsProtoSchedOnFrame(sched,lane,&ip,7,1210);
+
+    if (MapsProtoSchedNext(sched,0,1220,&poll) == 1 && poll.num == 1)
+        printf("SCHED PRESENCE END test PASSED\n");
+    else
+        printf("SCHED PRESENCE END test FAILED\n");
+
+    if (!MapsProtoSchedGetUsage(sched,0,2000,&usage) && usage.sent == 2 && usage.load == 6)
+        printf("SCHED USAGE test PASSED\n");
+    else
+        printf("SCHED USAGE test FAILED\n");
+
+    MapsProtoSchedFree(sched);
+}
+//-----------------------------------------------------------------------------
+
+void ConfigTests()
+{
+    uint8_t nums[2];
+    tMAPS_PROTO_RAW_FRAME     *frame, *response;
+    tMAPS_PROTO_PARSED_FRAME  *parsed;
+    tMAPS_PROTO_CONFIG_STATUS  status;
+    tMAPS_PROTO_CONFIG_ENGINE *engine;
+    tMAPS_PROTO_DE_DATA de = { .work_mode = 2, .axis_ispeed = 5, .axis_height = 2, .tow_detection = 'T', .hw_failure = 1,
+                               .se_cleaning = 1, .firmware_ver = 30, .rcvr_direction = 'P', .barrier_model = 4, };
+    tMAPS_PROTO_CONFIG config = { .fields = K_MAPS_PROTO_CONFIG_SM | K_MAPS_PROTO_CONFIG_PR | K_MAPS_PROTO_CONFIG_SR | K_MAPS_PROTO_CONFIG_RH,
+                                  .sm = { .work_mode = 2, .axis_ispeed = 5, .axis_height = 2, .tow_detection = 'T', .rcvr_direction = 'P', },
+                                  .pr_delay = 20, .sr_sensors = 4, };
+
+    printf("\n#### CONFIG TESTS ####\n");
+
+    if ((engine = MapsProtoConfigCreate(K_MAPS_PROTO_BARRIER_CF220,&config,2,100)) == NULL)
+    {
+        printf("CONFIG CREATE test FAILED. Error: %s\n",strerror(errno));
+        return;
+    }
+
+    // The DE request is the first one and the config commands waits for its response.
+    if (MapsProtoConfigNext(engine,0,&frame) == 1 && frame->data[2] == 'D' && MapsProtoConfigNext(engine,0,&response) == 0)
+        printf("CONFIG READ test PASSED\n");
+    else
+        printf("CONFIG READ test FAILED\n");
+
+    response = MapsProtoCreateDEResponse(frame->data[1] - 48,&de);
+    parsed   = MapsProtoParseFrame(response->data,response->size);
+    MapsProtoConfigOnFrame(engine,parsed);
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(response);
+    MapsProtoFreeRawFrame(frame);
+
+    // The SM is equal to the DE status so only PR & SR are sent.
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        if (MapsProtoConfigNext(engine,10,&frame) != 1)
+            break;
+
+        nums[i] = frame->data[1] - 48;
+        MapsProtoFreeRawFrame(frame);
+    }
+
+    if (MapsProtoConfigNext(engine,10,&frame) == 0)
+        printf("CONFIG PIPELINE test PASSED\n");
+    else
+        printf("CONFIG PIPELINE test FAILED\n");
+
+    response = MapsProtoCreateEmptyResponse(nums[0],"PR");
+    parsed   = MapsProtoParseFrame(response->data,response->size);
+    MapsProtoConfigOnFrame(engine,parsed);
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(response);
+
+    response = MapsProtoCreateUnknownResponse(nums[1],"SR");
+    parsed   = MapsProtoParseFrame(response->data,response->size);
+    MapsProtoConfigOnFrame(engine,parsed);
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(response);
+
+    MapsProtoConfigGetStatus(engine,&status);
+
+    if (status.done && status.unchanged == K_MAPS_PROTO_CONFIG_SM && status.changed == K_MAPS_PROTO_CONFIG_PR &&
+        status.failed == K_MAPS_PROTO_CONFIG_SR && status.unsupported == K_MAPS_PROTO_CONFIG_RH)
+        printf("CONFIG RESULT test PASSED\n");
+    else
+        printf("CONFIG RESULT test FAILED\n");
+
+    MapsProtoConfigFree(engine);
+}
+//-----------------------------------------------------------------------------
+
+void RecordTests()
+{
+    tMAPS_PROTO_RECORD record;
+    tMAPS_PROTO_PARSED_FRAME *parsed, *decoded = NULL;
+    tMAPS_PROTO_RAW_FRAME *frame = MapsProtoCreateDEResponse(2,(tMAPS_PROTO_DE_DATA*)"\x00\x00\x02\x00\x01\x02\x0B\x50\x03");
+
+    printf("\n#### RECORD TESTS ####\n");
+
+    if (MapsProtoGetCmdId("FAS") == K_MAPS_PROTO_CMD_FAS && !strcmp(MapsProtoGetCmdName(K_MAPS_PROTO_CMD_RM),"RM") &&
+        MapsProtoGetCmdId("XX") == K_MAPS_PROTO_CMD_UNKNOWN)
+        printf("RECORD CMD ID test PASSED\n");
+    else
+        printf("RECORD CMD ID test FAILED\n");
+
+    parsed = MapsProtoParseFrame(frame->data,frame->size);
+
+    if (parsed && !MapsProtoRecordEncode(parsed,7,123456789,&record) && record.cmd_id == K_MAPS_PROTO_CMD_DE &&
+        record.lane == 7 && record.payload.de.axis_height == 2 && (decoded = MapsProtoRecordDecode(&record)) &&
+        decoded->size == parsed->size && !memcmp(decoded->data,parsed->data,parsed->size) && !strcmp(decoded->cmd,"DE"))
+        printf("RECORD ENCODE/DECODE test PASSED\n");
+    else
+        printf("RECORD ENCODE/DECODE test FAILED\n");
+
+    record.version = 0;
+
+    if (MapsProtoRecordDecode(&record) == NULL && errno == ENOEXEC)
+        printf("RECORD VERSION test PASSED\n");
+    else
+        printf("RECORD VERSION test FAILED\n");
+
+    MapsProtoFreeParsedFrame(decoded);
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+void BusTests()
+{
+    int i, rc;
+    uint64_t lost = 0;
+    tMAPS_PROTO_RECORD record;
+    tMAPS_PROTO_BUS *producer, *consumer = NULL;
+
+    printf("\n#### BUS TESTS ####\n");
+
+    if (MapsProtoBusCreate(NULL,3) == NULL && errno == EINVAL)
+        printf("BUS CAPACITY test PASSED\n");
+    else
+        printf("BUS CAPACITY test FAILED\n");
+
+    if ((producer = MapsProtoBusCreate(NULL,4)) == NULL || (consumer = MapsProtoBusOpenFd(MapsProtoBusGetFd(producer))) == NULL)
+    {
+        printf("BUS CREATE test FAILED. Error: %s\n",strerror(errno));
+        MapsProtoBusClose(producer);
+        return;
+    }
+
+    memset(&record,0,sizeof(tMAPS_PROTO_RECORD));
+
+    for (i = 0, rc = 0; i < 2; i++)
+    {
+        record.timestamp = i;
+        rc += MapsProtoBusPublish(producer,&record);
+    }
+
+    for (i = 0; i < 2 && !rc; i++)
+        if (MapsProtoBusRead(consumer,&record,&lost) != 1 || record.timestamp != (uint64_t) i || lost)
+            rc = -1;
+
+    if (!rc && MapsProtoBusRead(consumer,&record,&lost) == 0)
+        printf("BUS PUBLISH/READ test PASSED\n");
+    else
+        printf("BUS PUBLISH/READ test FAILED\n");
+
+    for (i = 2; i < 8; i++)
+    {
+        record.timestamp = i;
+        MapsProtoBusPublish(producer,&record);
+    }
+
+    if (MapsProtoBusRead(consumer,&record,&lost) == 1 && lost == 2 && record.timestamp == 4)
+        printf("BUS OVERRUN test PASSED\n");
+    else
+        printf("BUS OVERRUN test FAILED\n");
+
+    if (MapsProtoBusPublish(consumer,&record) == -1 && errno == EPERM)
+        printf("BUS CONSUMER PUBLISH test PASSED\n");
+    else
+        printf("BUS CONSUMER PUBLISH test FAILED\n");
+
+    MapsProtoBusClose(consumer);
+    MapsProtoBusClose(producer);
+}
+//-----------------------------------------------------------------------------
+
+void SerialTests()
+{
+    char line[256];
+    tMAPS_PROTO_PARSED_FRAME *parsed;
+    tMAPS_PROTO_RAW_FRAME *frame = MapsProtoCreateDEResponse(2,(tMAPS_PROTO_DE_DATA*)"\x00\x00\x02\x00\x01\x02\x0B\x50\x03");
+
+    printf("\n#### SERIAL TESTS ####\n");
+
+    parsed = MapsProtoParseFrame(frame->data,frame->size);
+
+    if (parsed && MapsProtoSerialJson(parsed,line,sizeof(line)) > 0 &&
+        !strcmp(line,"{\"num\":2,\"type\":1,\"cmd\":\"DE\",\"work_mode\":0,\"axis_ispeed\":0,\"axis_height\":2,"
+                     "\"tow_detection\":\"0\",\"hw_failure\":1,\"se_cleaning\":2,\"firmware_ver\":11,"
+                     "\"rcvr_direction\":\"P\",\"barrier_model\":\"3\"}\n"))
+        printf("SERIAL JSON test PASSED\n");
+    else
+        printf("SERIAL JSON test FAILED. %s",line);
+
+    if (parsed && MapsProtoSerialCsvHeader(parsed,line,sizeof(line)) > 0 &&
+        !strcmp(line,"num,type,cmd,work_mode,axis_ispeed,axis_height,tow_detection,hw_failure,se_cleaning,firmware_ver,rcvr_direction,barrier_model\n") &&
+        MapsProtoSerialCsv(parsed,line,sizeof(line)) > 0 && !strcmp(line,"2,1,DE,0,0,2,0,1,2,11,P,3\n"))
+        printf("SERIAL CSV test PASSED\n");
+    else
+        printf("SERIAL CSV test FAILED. %s",line);
+
+    if (parsed && MapsProtoSerialJson(parsed,line,20) == -1 && errno == ENOSPC)
+        printf("SERIAL NO SPACE test PASSED\n");
+    else
+        printf("SERIAL NO SPACE test FAILED\n");
+
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+void StoreTests()
+{
+    uint8_t i;
+    int rc = 0, complete = 0;
+    const char *path = "maps_store_test.mps";
+    tMAPS_PROTO_STORE_SCAN scan;
+    tMAPS_PROTO_STORE_WRITER *writer;
+    tMAPS_PROTO_STORE_READER *reader;
+    tMAPS_PROTO_VEHICLE vehicle = { 0 };
+    tMAPS_PROTO_EJ_DATA ej = { 2, 0, 45 };
+    tMAPS_PROTO_END_VEHICLE end = { .smb = 1, .vclass = 'A', .paxes = 2, .naxes = 0 };
+    tMAPS_PROTO_RAW_FRAME *frames[4] = { MapsProtoCreateIARequest(1,40), MapsProtoCreateEJRequest(2,&ej),
+                                         MapsProtoCreateEmptyResponse(3,"MV"), MapsProtoCreateEndVehicleRequest(4,0,&end) };
+
+    printf("\n#### STORE TESTS ####\n");
+
+    for (i = 0; i < 4; i++)
+    {
+        tMAPS_PROTO_PARSED_FRAME *parsed = (frames[i]) ? MapsProtoParseFrame(frames[i]->data,frames[i]->size) : NULL;
+
+        complete = (parsed) ? MapsProtoStoreAssemble(&vehicle,parsed,3,100 + i) : -1;
+        MapsProtoFreeParsedFrame(parsed);
+        MapsProtoFreeRawFrame(frames[i]);
+    }
+
+    if (complete == 1 && vehicle.start == 100 && vehicle.end == 103 && vehicle.lane == 3 && vehicle.paxes == 2 &&
+        vehicle.vclass == 'A' && vehicle.speed == 45)
+        printf("STORE ASSEMBLE test PASSED\n");
+    else
+        printf("STORE ASSEMBLE test FAILED\n");
+
+    unlink(path);
+
+    if ((writer = MapsProtoStoreCreate(path,4)) == NULL)
+    {
+        printf("STORE CREATE test FAILED. Error: %s\n",strerror(errno));
+        return;
+    }
+
+    for (i = 0; i < 10; i++)  // Blocks: lanes 0-0-0-0, 1-1-1-1, 2-2
+    {
+        vehicle.start = 1000 + i;
+        vehicle.lane  = i / 4;
+        rc |= MapsProtoStoreAppend(writer,&vehicle);
+    }
+
+    rc |= MapsProtoStoreClose(writer);
+
+    if (!rc && (reader = MapsProtoStoreOpen(path)) != NULL)
+    {
+        uint8_t rows = 0;
+
+        MapsProtoStoreFilter(reader,K_MAPS_PROTO_STORE_COL_LANE,1,1);
+        MapsProtoStoreFilter(reader,K_MAPS_PROTO_STORE_COL_START,1005,2000);
+
+        while (MapsProtoStoreNext(reader,&vehicle) == 1)
+            rows += (vehicle.lane == 1 && vehicle.start >= 1005 && vehicle.paxes == 2);
+
+        MapsProtoStoreGetScan(reader,&scan);
+
+        if (rows == 3 && scan.matches == 3 && scan.blocks == 3 && scan.skipped == 2 && scan.rows == 4)
+            printf("STORE SCAN test PASSED\n");
+        else
+            printf("STORE SCAN test FAILED\n");
+
+        MapsProtoStoreFree(reader);
+    }
+    else
+        printf("STORE SCAN test FAILED. Error: %s\n",strerror(errno));
+
+    if (MapsProtoStoreCreate(path,8) == NULL && errno == ENOEXEC)
+        printf("STORE BLOCK ROWS test PASSED\n");
+    else
+        printf("STORE BLOCK ROWS test FAILED\n");
+
+    unlink(path);
+}
+//-----------------------------------------------------------------------------
+
+int reparse_collect(const tMAPS_PROTO_REPARSE_FRAME *frame, void *user)
+{
+    uint64_t *offsets = (uint64_t *) user;
+
+    if (offsets[0] < 15)
+        offsets[++offsets[0]] = frame->offset;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+void ReparseTests()
+{
+    uint16_t i, length;
+    size_t pos = 0, size = 0, junk;
+    uint8_t capture[256];
+    uint64_t expected[16] = { 0 }, offsets[16] = { 0 };
+    tMAPS_PROTO_REPARSE_STATS stats;
+    tMAPS_PROTO_EJ_DATA ej = { 1, 0, 50 };
+    tMAPS_PROTO_RAW_FRAME *frames[3] = { MapsProtoCreateEmptyRequest(2,"DE"), MapsProtoCreateEJRequest(3,&ej),
+                                         MapsProtoCreateDEResponse(2,(tMAPS_PROTO_DE_DATA*)"\x00\x00\x02\x00\x01\x02\x0B\x50\x03") };
+
+    printf("\n#### REPARSE TESTS ####\n");
+
+    // DE, junk, SC SPECIAL H, EJ with bad LRC, EJ, half DE, DE RS, SC SPECIAL D
+    for (i = 0; i < 3; i++)
+    {
+        if (!frames[i])
+        {
+            printf("REPARSE test FAILED. Error creating frames\n");
+            return;
+        }
+    }
+
+    memcpy(&capture[size],frames[0]->data,frames[0]->size);  size += frames[0]->size;
+    memcpy(&capture[size],"noise\r",6);                       size += 6;
+    memcpy(&capture[size],"0123456789AB\r\n",14);           size += 14;
+    memcpy(&capture[size],frames[1]->data,frames[1]->size);  capture[size+3] ^= 1; size += frames[1]->size;
+    memcpy(&capture[size],frames[1]->data,frames[1]->size);  size += frames[1]->size;
+    memcpy(&capture[size],frames[2]->data,8);                size += 8;
+    memcpy(&capture[size],frames[2]->data,frames[2]->size);  size += frames[2]->size;
+    memcpy(&capture[size],"FFFFFFFFFFFF\r",13);              size += 13;
+
+    while (MapsProtoReparseNext(capture,size,&pos,&length,&junk) == 1 && expected[0] < 15)
+    {
+        expected[++expected[0]] = pos;
+        pos += length;
+    }
+
+    if (expected[0] == 5 && expected[1] == 0 && expected[2] == 13 && capture[expected[3]] == 0x01 && capture[expected[5]] == 'F')
+        printf("REPARSE NEXT test PASSED\n");
+    else
+        printf("REPARSE NEXT test FAILED\n");
+
+    if (!MapsProtoReparseBuffer(capture,size,4,8,reparse_collect,offsets,&stats) && !memcmp(offsets,expected,sizeof(expected)) &&
+        stats.frames == 5 && stats.errors == 0 && stats.junk == 6u + frames[1]->size + 8u && stats.resyncs == 3 && stats.chunks > 4)
+        printf("REPARSE PARALLEL ORDER test PASSED\n");
+    else
+        printf("REPARSE PARALLEL ORDER test FAILED\n");
+
+    for (i = 0; i < 3; i++)
+        MapsProtoFreeRawFrame(frames[i]);
+}
+//-----------------------------------------------------------------------------
+
 tMAPS_PROTO_RAW_FRAME * CreateRequest(char type)
 {
     switch (type)
@@ -227,6 +665,1119 @@ tMAPS_PROTO_RAW_FRAME * CreateRequest(char type)
 }
 //-----------------------------------------------------------------------------
 
+void ValidateTests()
+{
+    uint8_t pas[K_MAPS_PROTO_RECEIVE_GROUP8+K_MAPS_PROTO_RECEIVE_GROUP3+1];
+    uint8_t same = 1;
+    uint64_t data[K_MAPS_PROTO_MAX_DATA_SIZE / 8];
+    tMAPS_PROTO_RAW_FRAME *frame;
+    tMAPS_PROTO_PARSED_FRAME *parsed;
+    tMAPS_PROTO_FRAME_HEADER header;
+
+    printf("\n#### VALIDATE TESTS ####\n");
+
+    // The validation must give the same result that the parse
+    for (char type = 'a'; type <= 'r'; type++)
+    {
+        if ((frame = CreateRequest(type)) == NULL)
+        {
+            same = 0;
+            continue;
+        }
+
+        parsed = MapsProtoParseFrame(frame->data,frame->size);
+
+        if (!parsed || MapsProtoValidateFrame(frame->data,frame->size,&header) || header.num != parsed->num ||
+            header.type != parsed->type || strcmp(header.cmd,parsed->cmd) || header.cmd_id != MapsProtoGetCmdId(parsed->cmd))
+            same = 0;
+
+        MapsProtoFreeParsedFrame(parsed);
+        MapsProtoFreeRawFrame(frame);
+    }
+
+    if (same)
+        printf("VALIDATE SAME AS PARSE test PASSED\n");
+    else
+        printf("VALIDATE SAME AS PARSE test FAILED\n");
+
+    frame = MapsProtoCreateEMRequest(2,(tMAPS_PROTO_EM_DATA *)"\x03\x08\x02\x4D\x01\x02\x1F\x50\x00");
+
+    if (frame && !MapsProtoValidateFrame(frame->data,frame->size,&header) && header.cmd_id == K_MAPS_PROTO_CMD_EM &&
+        header.data_pos == 4 && header.data_size == 10 && frame->data[header.data_pos] == '3')
+        printf("VALIDATE HEADER test PASSED\n");
+    else
+        printf("VALIDATE HEADER test FAILED\n");
+
+    // The same data as the parse but in a buffer of the caller
+    parsed = (frame) ? MapsProtoParseFrame(frame->data,frame->size) : NULL;
+
+    if (parsed && MapsProtoParseFrameTo(frame->data,frame->size,&header,data,sizeof(data)) == parsed->size && !memcmp(data,parsed->data,parsed->size) &&
+        MapsProtoParseFrameTo(frame->data,frame->size,&header,data,8) == -1 && errno == ENOSPC)
+        printf("VALIDATE PARSE TO BUFFER test PASSED\n");
+    else
+        printf("VALIDATE PARSE TO BUFFER test FAILED\n");
+
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(frame);
+
+    memset(pas,'F',sizeof(pas)-1);
+    pas[sizeof(pas)-1] = 0x0D;
+    frame = MapsProtoCreateUnknownResponse(3,"XX");
+
+    if (!MapsProtoValidateFrame(pas,sizeof(pas),&header) && header.cmd_id == K_MAPS_PROTO_CMD_PAS && header.data_size == 88 &&
+        !MapsProtoValidateFrame((uint8_t *)"0123456789AB\r\n",14,&header) && header.cmd_id == K_MAPS_PROTO_CMD_SCS &&
+        frame && !MapsProtoValidateFrame(frame->data,frame->size,&header) && header.type == 2 && header.cmd_id == K_MAPS_PROTO_CMD_UNKNOWN)
+        printf("VALIDATE SPECIAL & NE test PASSED\n");
+    else
+        printf("VALIDATE SPECIAL & NE test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+
+    // The data bytes changed by pairs with the same bits keep the LRC valid
+    frame = MapsProtoCreateEJRequest(1,(tMAPS_PROTO_EJ_DATA *)"\x09\x03\x88");
+
+    if (MapsProtoValidateFrame(NULL,9,NULL) == -1 && errno == EINVAL && frame &&
+        (frame->data[4] ^= 0x40, frame->data[5] ^= 0x40, MapsProtoValidateFrame(frame->data,frame->size,NULL) == -1) && errno == ENOEXEC &&
+        (frame->data[4] ^= 0x01, MapsProtoValidateFrame(frame->data,frame->size,NULL) == -1) && errno == ERANGE)
+        printf("VALIDATE ERRORS test PASSED\n");
+    else
+        printf("VALIDATE ERRORS test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+void ViewTests()
+{
+    uint8_t *map;
+    uint16_t size;
+    tMAPS_PROTO_VIEW view;
+    tMAPS_PROTO_RAW_FRAME *frame;
+    tMAPS_PROTO_TT_DATA ttdata = { .mvar = 'M', .rvar = 'R', };
+
+    printf("\n#### VIEW TESTS ####\n");
+    memset(ttdata.e_map,0x37,K_MAPS_PROTO_EMITTERS_MAP_SIZE);
+    memset(ttdata.r_map,0x41,K_MAPS_PROTO_RECEIVERS_MAP_SIZE);
+
+    // The frame is in a read only page. The view must not write it
+    frame = MapsProtoCreateEndVehicleRequest(5,1,(tMAPS_PROTO_END_VEHICLE *)"\x02\x43\x09\x09\x00\x00\x00\x00\x00\x00");
+    map   = (uint8_t *)mmap(NULL,4096,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+
+    if (frame && map != MAP_FAILED && (memcpy(map,frame->data,frame->size), !mprotect(map,4096,PROT_READ)) &&
+        !MapsProtoViewInit(&view,map,frame->size) && MapsProtoViewEndVehiclePaxes(&view) == 9 &&
+        MapsProtoViewEndVehicleNaxes(&view) == 9 && MapsProtoViewEndVehicleClass(&view) == 'C' &&
+        MapsProtoViewEJPaxes(&view) == -1 && errno == EPERM)
+        printf("VIEW END VEHICLE test PASSED\n");
+    else
+        printf("VIEW END VEHICLE test FAILED\n");
+
+    if (map != MAP_FAILED)
+        munmap(map,4096);
+
+    MapsProtoFreeRawFrame(frame);
+    frame = MapsProtoCreateTTResponse(5,&ttdata);
+
+    if (frame && !MapsProtoViewInit(&view,frame->data,frame->size) &&
+        !memcmp(MapsProtoViewTTEmitterMap(&view),ttdata.e_map,K_MAPS_PROTO_EMITTERS_MAP_SIZE) &&
+        !memcmp(MapsProtoViewTTReceiverMap(&view),ttdata.r_map,K_MAPS_PROTO_RECEIVERS_MAP_SIZE) &&
+        MapsProtoViewData(&view,&size) == &frame->data[6] && size == 26)
+        printf("VIEW TT MAPS test PASSED\n");
+    else
+        printf("VIEW TT MAPS test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+    frame = MapsProtoCreateDEResponse(2,(tMAPS_PROTO_DE_DATA*)"\x02\x0B\x01\x00\x01\x02\x0B\x50\x03");
+
+    if (frame && !MapsProtoViewInit(&view,frame->data,frame->size) && MapsProtoViewDEWorkMode(&view) == 2 &&
+        MapsProtoViewDEAxisSpeed(&view) == 11 && MapsProtoViewDEAxisHeight(&view) == 1 && MapsProtoViewValue(&view) == -1)
+        printf("VIEW DE STATUS test PASSED\n");
+    else
+        printf("VIEW DE STATUS test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+    frame = MapsProtoCreateIARequest(8,9);
+
+    if (frame && !MapsProtoViewInit(&view,frame->data,frame->size) && MapsProtoViewValue(&view) == 9 &&
+        MapsProtoViewInit(NULL,frame->data,frame->size) == -1 && errno == EINVAL &&
+        (frame->data[4] ^= 1, MapsProtoViewInit(&view,frame->data,frame->size) == -1) && errno == ERANGE)
+        printf("VIEW VALUE & ERRORS test PASSED\n");
+    else
+        printf("VIEW VALUE & ERRORS test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+// Parse a created frame and compare the data with the data used to create it
+int spec_same_data(tMAPS_PROTO_RAW_FRAME *frame, const void *data, uint16_t size)
+{
+    int same = 0;
+    tMAPS_PROTO_PARSED_FRAME *parsed = (frame) ? MapsProtoParseFrame(frame->data,frame->size) : NULL;
+
+    if (parsed && parsed->size == size && !memcmp(parsed->data,data,size))
+        same = 1;
+
+    MapsProtoFreeParsedFrame(parsed);
+    MapsProtoFreeRawFrame(frame);
+
+    return same;
+}
+//-----------------------------------------------------------------------------
+
+void SpecTests()
+{
+    int rc = 1;
+    tMAPS_PROTO_EJ_DATA ej = { 12, 3, 87 };
+    tMAPS_PROTO_EA_DATA ea = { 14, 15, 9, 40 };
+    tMAPS_PROTO_AP_DATA ap9 = { .smbyte = 0, .vheight = 14 };
+    tMAPS_PROTO_AP_DATA ap17 = { .smbyte = 2, .vaxis = 'N', .axis_height = 15, .vmax_height = 31, .hmin_height = 7, .lmax_height = 62 };
+    tMAPS_PROTO_EM_DATA em16 = { .work_mode = 2, .axis_ispeed = 11, .axis_height = 1, .hw_failure = 3, .se_cleaning = 1, .firmware_ver = 42 };
+    tMAPS_PROTO_EM_DATA em17 = { .work_mode = 3, .axis_ispeed = 15, .axis_height = 2, .tow_detection = 'T', .hw_failure = 1,
+                                 .se_cleaning = 2, .firmware_ver = 7, .rcvr_direction = 'P' };
+    tMAPS_PROTO_FAILURE_DATA fail = { 'E', 8, 4 };
+    tMAPS_PROTO_END_VEHICLE fa11 = { .smb = 3, .paxes = 5, .naxes = 1 };
+    tMAPS_PROTO_END_VEHICLE fa12 = { .smb = 1, .vclass = 'M', .paxes = 2, .naxes = 0 };
+    tMAPS_PROTO_END_VEHICLE fa24 = { 2, 'F', 6, 1, 5, 0, 4, 0, 3, 0 };
+
+    printf("\n#### SPEC TESTS ####\n");
+
+    rc &= spec_same_data(MapsProtoCreateEJRequest(1,&ej),&ej,sizeof(ej));
+    rc &= spec_same_data(MapsProtoCreateEAResponse(2,&ea),&ea,sizeof(ea));
+    rc &= spec_same_data(MapsProtoCreateAPRequest(3,&ap9),&ap9,sizeof(ap9));
+    rc &= spec_same_data(MapsProtoCreateAPRequest(4,&ap17),&ap17,sizeof(ap17));
+    rc &= spec_same_data(MapsProtoCreateEMRequest(5,&em16),&em16,sizeof(em16));
+    rc &= spec_same_data(MapsProtoCreateEMRequest(6,&em17),&em17,sizeof(em17));
+    rc &= spec_same_data(MapsProtoCreateFailureRequest(7,1,&fail),&fail,sizeof(fail));
+    rc &= spec_same_data(MapsProtoCreateEndVehicleRequest(8,0,&fa11),&fa11,sizeof(fa11));
+    rc &= spec_same_data(MapsProtoCreateEndVehicleRequest(9,1,&fa12),&fa12,sizeof(fa12));
+    rc &= spec_same_data(MapsProtoCreateEndVehicleRequest(0,0,&fa24),&fa24,sizeof(fa24));
+
+    if (rc)
+        printf("SPEC ROUND TRIP test PASSED\n");
+    else
+        printf("SPEC ROUND TRIP test FAILED\n");
+
+    em16.hw_failure = 0;
+    fail.ngroup     = 9;
+    fa12.vclass     = 'Z';
+    fa24.smb        = 4;
+    em17.rcvr_direction = 'X';
+    em17.firmware_ver   = 100;
+
+    if (!MapsProtoCreateEMRequest(0,&em16) && errno == EINVAL && !MapsProtoCreateEMRequest(0,&em17) && errno == EINVAL &&
+        !MapsProtoCreateFailureRequest(0,0,&fail) && errno == EINVAL && !MapsProtoCreateEndVehicleRequest(0,0,&fa12) && errno == EINVAL &&
+        !MapsProtoCreateEndVehicleRequest(0,0,&fa24) && errno == EINVAL && !MapsProtoCreateEJRequest(0,NULL) && errno == EINVAL)
+        printf("SPEC ENCODE ERRORS test PASSED\n");
+    else
+        printf("SPEC ENCODE ERRORS test FAILED\n");
+
+    // Out of range firmware and tow detection of a CF-150/CF-24P EM are rejected, not rounded or ignored
+    em16.hw_failure     = 3;
+    em16.firmware_ver   = 100;
+    em17.rcvr_direction = 'P';
+    rc = !MapsProtoCreateEMRequest(0,&em16) && errno == EINVAL && !MapsProtoCreateEMRequest(0,&em17) && errno == EINVAL;
+
+    em16.firmware_ver  = 42;
+    em16.tow_detection = 'X';
+
+    if (rc && !MapsProtoCreateEMRequest(0,&em16) && errno == EINVAL)
+        printf("SPEC EM CHECKS test PASSED\n");
+    else
+        printf("SPEC EM CHECKS test FAILED\n");
+}
+//-----------------------------------------------------------------------------
+
+void StatusTests()
+{
+    uint16_t len;
+    uint8_t frame[32], data[K_MAPS_PROTO_MAX_DATA_SIZE];
+    tMAPS_PROTO_STATUS_INFO info;
+    tMAPS_PROTO_EJ_DATA ej = { 12, 3, 87 };
+    tMAPS_PROTO_FAILURE_DATA fail = { 'R', 9, 1 };
+    tMAPS_PROTO_RAW_FRAME *raw = MapsProtoCreateEJRequest(1,&ej);
+
+    printf("\n#### STATUS TESTS ####\n");
+
+    if (raw && !MapsProtoStatusCreateData(K_MAPS_PROTO_CMD_EJ,1,&ej,frame,sizeof(frame),&len,&info) && len == raw->size &&
+        !memcmp(frame,raw->data,len) && !MapsProtoStatusParse(frame,len,NULL,data,sizeof(data),&len,NULL) && len == sizeof(ej) &&
+        MapsProtoStatusCreateData(K_MAPS_PROTO_CMD_FX,1,&fail,frame,sizeof(frame),&len,&info) == K_MAPS_PROTO_STATUS_PARAM &&
+        info.cmd_id == K_MAPS_PROTO_CMD_FX && info.field && !strcmp(info.field,"ngroup") && info.offset == 5 &&
+        MapsProtoStatusCreateData(K_MAPS_PROTO_CMD_DE,1,&ej,frame,sizeof(frame),&len,&info) == K_MAPS_PROTO_STATUS_COMMAND)
+        printf("STATUS CREATE DATA test PASSED\n");
+    else
+        printf("STATUS CREATE DATA test FAILED\n");
+
+    MapsProtoFreeRawFrame(raw);
+
+    if (MapsProtoStatusCreate(0,1,"EJ",(uint8_t *)"120387",6,frame,8,&len,&info) == K_MAPS_PROTO_STATUS_NOSPACE &&
+        info.expected == 13 && info.actual == 8 && info.cmd_id == K_MAPS_PROTO_CMD_EJ &&
+        !MapsProtoStatusCreate(0,1,"EJ",(uint8_t *)"12X387",6,frame,sizeof(frame),&len,NULL) &&
+        MapsProtoStatusParse(frame,len,NULL,data,sizeof(data),NULL,&info) == K_MAPS_PROTO_STATUS_DATA &&
+        info.field && !strcmp(info.field,"naxes") && info.offset == 6 && info.cmd_id == K_MAPS_PROTO_CMD_EJ)
+        printf("STATUS FIELD & SPACE test PASSED\n");
+    else
+        printf("STATUS FIELD & SPACE test FAILED\n");
+
+    frame[6] = '2';  // The LRC is of "12X387"
+
+    if (MapsProtoStatusValidate(frame,len,NULL,&info) == K_MAPS_PROTO_STATUS_LRC && info.offset == len - 3 &&
+        (info.expected ^ info.actual) == ('X' ^ '2') && MapsProtoStatusValidate(frame,5,NULL,&info) == K_MAPS_PROTO_STATUS_FRAMING &&
+        info.expected == 7 && info.actual == 5 && MapsProtoValidateFrame(frame,len,NULL) == -1 && errno == ERANGE)
+        printf("STATUS FRAME ERRORS test PASSED\n");
+    else
+        printf("STATUS FRAME ERRORS test FAILED\n");
+
+    if (!strcmp(MapsProtoStatusName(K_MAPS_PROTO_STATUS_LRC),"LRC") && !strcmp(MapsProtoStatusName(K_MAPS_PROTO_STATUS_COUNT),"UNKNOWN") &&
+        MapsProtoStatusErrno(K_MAPS_PROTO_STATUS_OK) == 0 && MapsProtoStatusErrno(K_MAPS_PROTO_STATUS_DATA) == ENOEXEC &&
+        MapsProtoStatusErrno(K_MAPS_PROTO_STATUS_NOSPACE) == ENOSPC)
+        printf("STATUS NAMES test PASSED\n");
+    else
+        printf("STATUS NAMES test FAILED\n");
+}
+//-----------------------------------------------------------------------------
+
+// Frames parsed and created in another thread. Its counters are retired when ends
+void * stats_thread(void *arg)
+{
+    tMAPS_PROTO_EJ_DATA ej = { 12, 3, 87 };
+    tMAPS_PROTO_RAW_FRAME *frames[2] = { MapsProtoCreateEJRequest(1,&ej), MapsProtoCreateUnknownResponse(2,"TT") };
+
+    (void) arg;
+
+    if (frames[0] && frames[1])
+    {
+        MapsProtoFreeParsedFrame(MapsProtoParseFrame(frames[0]->data,frames[0]->size));
+        MapsProtoValidateFrame(frames[0]->data,frames[0]->size,NULL);
+        MapsProtoValidateFrame(frames[1]->data,frames[1]->size,NULL);
+        frames[0]->data[5] ^= 0x01;
+        MapsProtoValidateFrame(frames[0]->data,frames[0]->size,NULL);
+    }
+
+    MapsProtoFreeRawFrame(frames[0]);
+    MapsProtoFreeRawFrame(frames[1]);
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+void StatsTests()
+{
+    pthread_t thread;
+    tMAPS_PROTO_STATS before, after;
+
+    printf("\n#### STATS TESTS ####\n");
+
+    MapsProtoStatsSnapshot(&before);
+
+    if (pthread_create(&thread,NULL,stats_thread,NULL) || pthread_join(thread,NULL))
+    {
+        printf("STATS THREAD test FAILED\n");
+        return;
+    }
+
+    MapsProtoFreeRawFrame(MapsProtoCreateEmptyRequest(0,"DE"));
+    MapsProtoStatsSnapshot(&after);
+    MapsProtoStatsDiff(&after,&before,&after);
+
+#ifdef MAPS_PROTO_STATS
+    if (after.parsed[K_MAPS_PROTO_CMD_EJ] == 2 && after.parsed[K_MAPS_PROTO_CMD_TT] == 1 && after.not_executed[K_MAPS_PROTO_CMD_TT] == 1 &&
+        after.errors[K_MAPS_PROTO_STATUS_LRC] == 1 && after.errors[K_MAPS_PROTO_STATUS_DATA] == 0 && after.bytes_parsed == 3 * 13 + 9 &&
+        after.created[K_MAPS_PROTO_CMD_EJ] == 1 && after.created[K_MAPS_PROTO_CMD_DE] == 1 && after.bytes_created == 13 + 9 + 7 &&
+        after.allocs == 8)
+#else
+    if (after.parsed[K_MAPS_PROTO_CMD_EJ] == 0 && after.allocs == 0)
+#endif
+        printf("STATS COUNTERS test PASSED\n");
+    else
+        printf("STATS COUNTERS test FAILED\n");
+}
+//-----------------------------------------------------------------------------
+
+// Record in several threads while the main thread takes intervals with reset
+void * latency_thread(void *arg)
+{
+    for (uint32_t i = 0; i < 100000; i++)
+         MapsProtoLatencyRecord((tMAPS_PROTO_LATENCY *) arg,1,K_MAPS_PROTO_CMD_TT,i % 5000);
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+void LatencyTests()
+{
+    int rc;
+    uint64_t total = 0;
+    pthread_t threads[4];
+    tMAPS_PROTO_FRAME_HEADER header;
+    tMAPS_PROTO_LATENCY_HISTOGRAM hist, all;
+    tMAPS_PROTO_RAW_FRAME *frame = MapsProtoCreateDEResponse(3,(tMAPS_PROTO_DE_DATA*)"\x02\x0B\x01\x00\x01\x02\x0B\x50\x03");
+    tMAPS_PROTO_LATENCY *latency = MapsProtoLatencyCreate(2);
+
+    printf("\n#### LATENCY TESTS ####\n");
+
+    if (!latency || !frame || MapsProtoValidateFrame(frame->data,frame->size,&header))
+    {
+        printf("LATENCY CREATE test FAILED\n");
+        MapsProtoFreeRawFrame(frame);
+        MapsProtoLatencyFree(latency);
+        return;
+    }
+
+    rc  = !MapsProtoLatencySent(latency,0,3,K_MAPS_PROTO_CMD_DE,1000) && MapsProtoLatencyReceived(latency,0,&header,1350) == 1;
+    rc &= MapsProtoLatencyReceived(latency,0,&header,1400) == 0 && MapsProtoLatencyReceived(latency,1,&header,1400) == 0;
+    rc &= !MapsProtoLatencySent(latency,0,3,K_MAPS_PROTO_CMD_EA,2000) && MapsProtoLatencyReceived(latency,0,&header,2100) == 0;
+    rc &= !MapsProtoLatencySnapshot(latency,0,K_MAPS_PROTO_CMD_DE,0,&hist) && hist.count == 1 && hist.min_us == 350 && hist.max_us == 350;
+    rc &= MapsProtoLatencySent(latency,2,0,K_MAPS_PROTO_CMD_DE,0) == -1 && errno == EINVAL;
+
+    if (rc)
+        printf("LATENCY ROUND TRIP test PASSED\n");
+    else
+        printf("LATENCY ROUND TRIP test FAILED\n");
+
+    for (uint32_t i = 1; i <= 1000; i++)
+         MapsProtoLatencyRecord(latency,1,K_MAPS_PROTO_CMD_EA,i);
+
+    MapsProtoLatencySnapshot(latency,1,K_MAPS_PROTO_CMD_EA,1,&hist);
+    rc = hist.count == 1000 && hist.sum_us == 500500 && hist.min_us == 1 && hist.max_us == 1000 &&
+         MapsProtoLatencyPercentile(&hist,50) >= 500 && MapsProtoLatencyPercentile(&hist,50) < 500 * 1.125 &&
+         MapsProtoLatencyPercentile(&hist,99) >= 990 && MapsProtoLatencyPercentile(&hist,100) == 1000 &&
+         MapsProtoLatencyPercentile(&hist,0) == 1;
+
+    MapsProtoLatencySnapshot(latency,1,K_MAPS_PROTO_CMD_EA,1,&all);
+    rc &= all.count == 0 && all.min_us == 0 && MapsProtoLatencyPercentile(&all,50) == 0;
+
+    MapsProtoLatencyRecord(latency,1,K_MAPS_PROTO_CMD_EA,K_MAPS_PROTO_LATENCY_MAX_US + 10);
+    MapsProtoLatencySnapshot(latency,1,K_MAPS_PROTO_CMD_EA,0,&all);
+    MapsProtoLatencyMerge(&all,&hist);
+    rc &= all.count == 1001 && all.min_us == 1 && all.max_us == K_MAPS_PROTO_LATENCY_MAX_US &&
+          MapsProtoLatencyBucketLimit(K_MAPS_PROTO_LATENCY_BUCKETS - 1) == K_MAPS_PROTO_LATENCY_MAX_US;
+
+    if (rc)
+        printf("LATENCY PERCENTILES test PASSED\n");
+    else
+        printf("LATENCY PERCENTILES test FAILED\n");
+
+    for (int i = 0; i < 4; i++)
+         pthread_create(&threads[i],NULL,latency_thread,latency);
+
+    for (int i = 0; i < 20; i++)
+    {
+        MapsProtoLatencySnapshot(latency,1,K_MAPS_PROTO_CMD_TT,1,&hist);
+        total += hist.count;
+    }
+
+    for (int i = 0; i < 4; i++)
+         pthread_join(threads[i],NULL);
+
+    MapsProtoLatencySnapshot(latency,1,K_MAPS_PROTO_CMD_TT,1,&hist);
+    total += hist.count;
+
+    if (total == 400000)
+        printf("LATENCY CONCURRENT RESET test PASSED\n");
+    else
+        printf("LATENCY CONCURRENT RESET test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+    MapsProtoLatencyFree(latency);
+}
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint64_t bad;         ///< Frames with a result of the validation different of the expected.
+    uint64_t corrupted;
+}tCORPUS_CHECK;
+
+int corpus_check(const uint8_t *frame, uint16_t size, uint8_t kind, uint8_t corrupted, void *user)
+{
+    tCORPUS_CHECK *check = (tCORPUS_CHECK *) user;
+
+    (void) kind;
+
+    check->corrupted += corrupted;
+
+    // The corrupted frames must be rejected and the others accepted
+    if ((MapsProtoValidateFrame(frame,size,NULL) == 0) == corrupted)
+        check->bad++;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+void CorpusTests()
+{
+    int rc;
+    size_t size1 = 0, size2 = 0, size3 = 0;
+    uint8_t *corpus1, *corpus2, *corpus3;
+    tCORPUS_CHECK check = { 0, 0 };
+    tMAPS_PROTO_CORPUS_CONFIG config;
+    tMAPS_PROTO_CORPUS_STATS stats;
+    tMAPS_PROTO_REPARSE_STATS reparse;
+    uint64_t offsets[16] = { 0 };
+
+    printf("\n#### CORPUS TESTS ####\n");
+
+    MapsProtoCorpusDefaults(&config,42);
+    corpus1 = MapsProtoCorpusBuffer(&config,20000,&size1,&stats);
+    corpus2 = MapsProtoCorpusBuffer(&config,20000,&size2,NULL);
+    config.seed = 43;
+    corpus3 = MapsProtoCorpusBuffer(&config,20000,&size3,NULL);
+
+    rc = corpus1 && corpus2 && corpus3 && size1 == size2 && !memcmp(corpus1,corpus2,size1) &&
+         (size1 != size3 || memcmp(corpus1,corpus3,size1)) && size1 == stats.bytes;
+
+    if (rc)
+        printf("CORPUS SAME SEED test PASSED\n");
+    else
+        printf("CORPUS SAME SEED test FAILED\n");
+
+    rc = stats.frames[K_MAPS_PROTO_CORPUS_POLL] + stats.frames[K_MAPS_PROTO_CORPUS_VEHICLE] + stats.frames[K_MAPS_PROTO_CORPUS_SCANNER] +
+         stats.frames[K_MAPS_PROTO_CORPUS_FAILURE] + stats.frames[K_MAPS_PROTO_CORPUS_NE] == 20000;
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CORPUS_KINDS; i++)
+         rc &= stats.events[i] > 0;
+
+    if (rc && stats.corrupted > 100 && stats.corrupted < 300)
+        printf("CORPUS MIX test PASSED\n");
+    else
+        printf("CORPUS MIX test FAILED\n");
+
+    // Without corrupted frames all the frames are found and parsed
+    config.corrupt_permille = 0;
+    free(corpus3);
+    corpus3 = MapsProtoCorpusBuffer(&config,20000,&size3,NULL);
+
+    if (corpus3 && !MapsProtoReparseBuffer(corpus3,size3,2,4096,reparse_collect,offsets,&reparse) &&
+        reparse.frames == 20000 && reparse.errors == 0 && reparse.junk == 0)
+        printf("CORPUS REPARSE test PASSED\n");
+    else
+        printf("CORPUS REPARSE test FAILED\n");
+
+    config.corrupt_permille = 200;
+    rc = !MapsProtoCorpusGenerate(&config,20000,corpus_check,&check,&stats);
+
+    if (rc && check.bad == 0 && check.corrupted == stats.corrupted && stats.corrupted > 3600 && stats.corrupted < 4400)
+        printf("CORPUS CORRUPTED test PASSED\n");
+    else
+        printf("CORPUS CORRUPTED test FAILED\n");
+
+    config.max_axes = 1;
+
+    if (MapsProtoCorpusGenerate(&config,10,corpus_check,&check,NULL) == -1 && errno == EINVAL)
+        printf("CORPUS CONFIG test PASSED\n");
+    else
+        printf("CORPUS CONFIG test FAILED\n");
+
+    free(corpus1);
+    free(corpus2);
+    free(corpus3);
+}
+//-----------------------------------------------------------------------------
+
+void MetricsTests()
+{
+    int fd, rc;
+    ssize_t n;
+    size_t used = 0;
+    char text[8192];
+    char path[64];
+    struct sockaddr_un addr = { .sun_family = AF_UNIX, };
+    tMAPS_PROTO_LATENCY *latency = MapsProtoLatencyCreate(2);
+    tMAPS_PROTO_METRICS *metrics = MapsProtoMetricsCreate(2,latency);
+
+    printf("\n#### METRICS TESTS ####\n");
+
+    if (!latency || !metrics)
+    {
+        printf("METRICS CREATE test FAILED\n");
+        MapsProtoMetricsFree(metrics);
+        MapsProtoLatencyFree(latency);
+        return;
+    }
+
+    MapsProtoMetricsLaneFrame(metrics,1,K_MAPS_PROTO_STATUS_OK,1);
+    MapsProtoMetricsLaneFrame(metrics,1,K_MAPS_PROTO_STATUS_OK,2);
+    MapsProtoMetricsLaneFrame(metrics,1,K_MAPS_PROTO_STATUS_LRC,0);
+    MapsProtoMetricsLaneResync(metrics,1,4);
+    MapsProtoMetricsLaneQueue(metrics,0,7);
+    MapsProtoLatencyRecord(latency,1,K_MAPS_PROTO_CMD_DE,350);
+
+    rc = MapsProtoMetricsRender(metrics,text,sizeof(text)) > 0 &&
+         strstr(text,"maps_proto_lane_frames_total{lane=\"1\"} 3\n") && strstr(text,"maps_proto_lane_errors_total{lane=\"1\"} 1\n") &&
+         strstr(text,"maps_proto_lane_not_executed_total{lane=\"1\"} 1\n") && strstr(text,"maps_proto_lane_resyncs_total{lane=\"1\"} 4\n") &&
+         strstr(text,"maps_proto_lane_queue_depth{lane=\"0\"} 7\n") && strstr(text,"# TYPE maps_proto_parse_errors_total counter\n") &&
+         strstr(text,"maps_proto_parse_errors_total{class=\"lrc\"} ") &&
+         strstr(text,"maps_proto_rtt_microseconds{lane=\"1\",cmd=\"DE\",quantile=\"0.99\"} 350\n") &&
+         strstr(text,"maps_proto_rtt_microseconds_count{lane=\"1\",cmd=\"DE\"} 1\n");
+
+    rc &= MapsProtoMetricsLaneFrame(metrics,2,0,0) == -1 && errno == EINVAL &&
+          MapsProtoMetricsRender(metrics,text,64) == -1 && errno == ENOSPC;
+
+    if (rc)
+        printf("METRICS RENDER test PASSED\n");
+    else
+        printf("METRICS RENDER test FAILED\n");
+
+    snprintf(path,sizeof(path),"/tmp/maps_metrics_%d.sock",(int) getpid());
+    snprintf(text,sizeof(text),"unix:%s",path);
+    strcpy(addr.sun_path,path);
+
+    rc = !MapsProtoMetricsListen(metrics,text) && MapsProtoMetricsListen(metrics,text) == -1 && errno == EALREADY;
+
+    if (rc && (fd = socket(AF_UNIX,SOCK_STREAM,0)) >= 0)
+    {
+        if (!connect(fd,(struct sockaddr *) &addr,sizeof(addr)) && write(fd,"GET /metrics HTTP/1.0\r\n\r\n",25) == 25)
+        {
+            while (used < sizeof(text) - 1 && (n = read(fd,&text[used],sizeof(text) - 1 - used)) > 0)
+                   used += n;
+        }
+
+        text[used] = 0;
+        close(fd);
+    }
+
+    rc &= !strncmp(text,"HTTP/1.0 200 OK\r\n",17) && strstr(text,"\r\n\r\n# HELP ") && strstr(text,"maps_proto_lane_resyncs_total{lane=\"1\"} 4\n");
+
+    MapsProtoMetricsFree(metrics);
+
+    if (rc && access(path,F_OK) == -1)
+        printf("METRICS UNIX SOCKET test PASSED\n");
+    else
+        printf("METRICS UNIX SOCKET test FAILED\n");
+
+    // A scraper that closes the connection in the middle of a big render. The exporter gets EPIPE, not SIGPIPE
+    metrics = MapsProtoMetricsCreate(30000,NULL);
+    snprintf(path,sizeof(path),"/tmp/maps_metrics_big_%d.sock",(int) getpid());
+    snprintf(text,sizeof(text),"unix:%s",path);
+    strcpy(addr.sun_path,path);
+
+    rc = metrics && !MapsProtoMetricsListen(metrics,text);
+
+    if (rc && (fd = socket(AF_UNIX,SOCK_STREAM,0)) >= 0)
+    {
+        rc = !connect(fd,(struct sockaddr *) &addr,sizeof(addr)) && write(fd,"GET /metrics HTTP/1.0\r\n\r\n",25) == 25 &&
+             read(fd,text,64) > 0;
+        close(fd);
+    }
+
+    // The exporter is alive and serves all the render to the next scraper
+    used = 0;
+
+    if (rc && (fd = socket(AF_UNIX,SOCK_STREAM,0)) >= 0)
+    {
+        if (!connect(fd,(struct sockaddr *) &addr,sizeof(addr)) && write(fd,"GET /metrics HTTP/1.0\r\n\r\n",25) == 25)
+        {
+            while ((n = read(fd,(used) ? &text[64] : text,(used) ? sizeof(text) - 64 : 64)) > 0)
+                   used += n;
+        }
+
+        close(fd);
+    }
+
+    if (rc && !strncmp(text,"HTTP/1.0 200 OK\r\n",17) && used > 1000000)
+        printf("METRICS DISCONNECT test PASSED\n");
+    else
+        printf("METRICS DISCONNECT test FAILED\n");
+
+    MapsProtoMetricsFree(metrics);
+    MapsProtoLatencyFree(latency);
+}
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+    _Atomic uint64_t frames;
+    _Atomic uint64_t vehicles;
+    _Atomic uint8_t wrong;
+}tSHARD_CHECK;
+
+void shard_check(uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_VEHICLE *vehicle, void *user)
+{
+    tSHARD_CHECK *check = (tSHARD_CHECK *) user;
+
+    atomic_fetch_add(&check->frames,1);
+
+    if (vehicle)
+        atomic_fetch_add(&check->vehicles,1);
+    if (!parsed || !parsed->timestamp || (vehicle && vehicle->lane != lane))
+        atomic_store(&check->wrong,1);
+}
+//-----------------------------------------------------------------------------
+
+void ShardTests()
+{
+    int rc, n;
+    uint8_t moved = 0;
+    size_t size, pos;
+    uint64_t frames = 0, errors = 0, vehicles = 0, offsets[16] = { 0 };
+    uint8_t *corpus;
+    tSHARD_CHECK check = { 0 };
+    tMAPS_PROTO_CORPUS_CONFIG config;
+    tMAPS_PROTO_REPARSE_STATS reparse;
+    tMAPS_PROTO_SHARD_LANE_STATS lane;
+    tMAPS_PROTO_STATS before, after;
+    tMAPS_PROTO_SHARD *shard;
+
+    printf("\n#### SHARD TESTS ####\n");
+
+    MapsProtoCorpusDefaults(&config,7);
+    corpus = MapsProtoCorpusBuffer(&config,3000,&size,NULL);
+    shard  = MapsProtoShardCreate(8,3,NULL,shard_check,&check);
+
+    if (!corpus || !shard || MapsProtoReparseBuffer(corpus,size,1,0,reparse_collect,offsets,&reparse))
+    {
+        printf("SHARD CREATE test FAILED\n");
+        MapsProtoShardFree(shard);
+        free(corpus);
+        return;
+    }
+
+    // The corpus in pieces of 1 to 200 bytes in each lane. The lanes 0 to 3 are moved to the worker 2 in the middle
+    rc = 1;
+
+    for (uint16_t l = 0; l < 8 && rc; l++)
+    {
+        for (pos = 0; pos < size && rc; pos += n)
+        {
+            if (l == 7 && pos > size / 2 && !moved)
+            {
+                for (uint16_t m = 0; m < 4; m++)
+                     MapsProtoShardMove(shard,m,2);
+
+                moved = 1;
+            }
+
+            if ((n = MapsProtoShardPush(shard,l,&corpus[pos],(size - pos < 1 + pos % 200) ? size - pos : 1 + pos % 200)) == -1)
+            {
+                n  = 0;
+                rc = (errno == EAGAIN);
+                usleep(100);
+            }
+        }
+    }
+
+    rc &= !MapsProtoShardDrain(shard,10000);
+
+    // The moves are done by the workers
+    for (int i = 0; i < 1000 && rc && (MapsProtoShardGetLane(shard,0,&lane) || lane.worker != 2 || MapsProtoShardGetLane(shard,3,&lane) ||
+                                       lane.worker != 2 || MapsProtoShardGetLane(shard,1,&lane) || lane.worker != 2); i++)
+        usleep(1000);
+
+    for (uint16_t l = 0; l < 8 && rc; l++)
+    {
+        rc = !MapsProtoShardGetLane(shard,l,&lane) && lane.bytes == size && lane.frames == reparse.frames && lane.errors == reparse.errors &&
+             ((l < 4) ? lane.worker == 2 && lane.moves == (l % 3 != 2) : lane.moves == 0);
+
+        frames   += lane.frames;
+        errors   += lane.errors;
+        vehicles += lane.vehicles;
+    }
+
+    if (rc && atomic_load(&check.frames) == frames - errors && atomic_load(&check.vehicles) == vehicles && vehicles > 0 && !atomic_load(&check.wrong))
+        printf("SHARD DECODE test PASSED\n");
+    else
+        printf("SHARD DECODE test FAILED\n");
+
+    MapsProtoShardFree(shard);
+
+    // Lanes 0 and 2 in the worker 0 and lanes 1 and 3 in the worker 1. The lane 0 has the double of bytes
+    shard = MapsProtoShardCreate(4,2,NULL,shard_check,&check);
+
+    rc = shard != NULL;
+
+    for (uint8_t r = 0; r < 3 && rc; r++)
+        for (pos = 0; pos < 4000 && rc; pos += n)
+        {
+            if ((n = MapsProtoShardPush(shard,(r < 2) ? 0 : 2,&corpus[pos],4000 - pos)) == -1)
+            {
+                n  = 0;
+                rc = MapsProtoShardDrain(shard,10000) == 0;
+            }
+        }
+
+    rc &= !MapsProtoShardDrain(shard,10000) && MapsProtoShardBalance(shard) == 0 &&
+          MapsProtoShardBalance(shard) == -1 && errno == EAGAIN && !MapsProtoShardDrain(shard,10000);
+
+    for (int i = 0; i < 1000 && rc && (MapsProtoShardGetLane(shard,0,&lane) || lane.worker != 1); i++)
+        usleep(1000);
+
+    rc &= lane.worker == 1 && lane.moves == 1;
+
+    if (rc && MapsProtoShardMove(shard,4,0) == -1 && errno == EINVAL && MapsProtoShardMove(shard,0,2) == -1 && errno == EINVAL &&
+        MapsProtoShardPush(shard,4,corpus,1) == -1 && errno == EINVAL && !MapsProtoShardCreate(0,1,NULL,shard_check,NULL) && errno == EINVAL)
+        printf("SHARD BALANCE test PASSED\n");
+    else
+        printf("SHARD BALANCE test FAILED\n");
+
+    MapsProtoShardFree(shard);
+
+    // Real time workers without SCHED_FIFO. The frames are decoded without allocations
+    memset(&check,0,sizeof(check));
+    shard = MapsProtoShardCreateRealtime(2,1,NULL,0,shard_check,&check);
+    MapsProtoStatsSnapshot(&before);
+
+    rc = shard != NULL;
+
+    for (pos = 0; pos < size && rc; pos += n)
+    {
+        if ((n = MapsProtoShardPush(shard,1,&corpus[pos],size - pos)) == -1)
+        {
+            n  = 0;
+            rc = MapsProtoShardDrain(shard,10000) == 0;
+        }
+    }
+
+    rc &= !MapsProtoShardDrain(shard,10000) && !MapsProtoShardGetLane(shard,1,&lane) && lane.frames == reparse.frames;
+    MapsProtoStatsSnapshot(&after);
+
+    if (rc && atomic_load(&check.frames) == reparse.frames - reparse.errors && after.allocs == before.allocs &&
+        after.bytes_parsed > before.bytes_parsed && !MapsProtoShardCreateRealtime(2,1,NULL,100,shard_check,NULL) && errno == EINVAL)
+        printf("SHARD REALTIME test PASSED\n");
+    else
+        printf("SHARD REALTIME test FAILED\n");
+
+    MapsProtoShardFree(shard);
+    free(corpus);
+}
+//-----------------------------------------------------------------------------
+
+void stamp_collect(uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_VEHICLE *vehicle, void *user)
+{
+    uint64_t *stamps = (uint64_t *) user;
+
+    (void) lane;
+    (void) vehicle;
+
+    if (stamps[0] < 3)
+        stamps[++stamps[0]] = parsed->timestamp;
+}
+//-----------------------------------------------------------------------------
+
+void StampTests()
+{
+    int server, client = -1, peer = -1, rc = 0;
+    uint8_t buffer[64];
+    uint64_t before, after, timestamp = 0, stamps[4] = { 0 };
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t length = sizeof(addr);
+    tMAPS_PROTO_RAW_FRAME *frame = MapsProtoCreateEmptyRequest(3,"IP");
+    tMAPS_PROTO_SHARD *shard;
+
+    printf("\n#### STAMP TESTS ####\n");
+
+    // A TCP gateway on the loopback
+    if ((server = socket(AF_INET,SOCK_STREAM,0)) >= 0 && !bind(server,(struct sockaddr *)&addr,sizeof(addr)) && !listen(server,1) &&
+        !getsockname(server,(struct sockaddr *)&addr,&length) && (client = socket(AF_INET,SOCK_STREAM,0)) >= 0 &&
+        !connect(client,(struct sockaddr *)&addr,sizeof(addr)) && (peer = accept(server,NULL,NULL)) >= 0 && frame)
+    {
+        before = MapsProtoStampNow();
+        rc = !MapsProtoStampEnable(peer) && write(client,frame->data,frame->size) == frame->size &&
+             MapsProtoStampRecv(peer,buffer,sizeof(buffer),&timestamp) == frame->size;
+        after = MapsProtoStampNow();
+
+        // The kernel time is converted from CLOCK_REALTIME. Allow 1 ms of error
+        rc &= !memcmp(buffer,frame->data,frame->size) && timestamp + 1000000 >= before && timestamp <= after + 1000000;
+    }
+
+    if (rc && MapsProtoStampRecv(peer,NULL,0,&timestamp) == -1 && errno == EINVAL)
+        printf("STAMP RECV test PASSED\n");
+    else
+        printf("STAMP RECV test FAILED\n");
+
+    close(peer);
+    close(client);
+    close(server);
+
+    // Each frame has the time of the push with its first byte. The second frame starts in the first push
+    shard = MapsProtoShardCreate(1,1,NULL,stamp_collect,stamps);
+    rc    = shard && frame;
+
+    if (rc)
+    {
+        memcpy(buffer,frame->data,frame->size);
+        memcpy(&buffer[frame->size],frame->data,frame->size);
+        memcpy(&buffer[frame->size * 2],frame->data,frame->size);
+
+        rc = MapsProtoShardPushAt(shard,0,buffer,frame->size + 1,1000) == frame->size + 1 &&
+             MapsProtoShardPushAt(shard,0,&buffer[frame->size + 1],frame->size - 1,2000) == frame->size - 1 &&
+             MapsProtoShardPushAt(shard,0,&buffer[frame->size * 2],frame->size,3000) == frame->size && !MapsProtoShardDrain(shard,10000);
+    }
+
+    if (rc && stamps[0] == 3 && stamps[1] == 1000 && stamps[2] == 1000 && stamps[3] == 3000)
+        printf("STAMP SHARD test PASSED\n");
+    else
+        printf("STAMP SHARD test FAILED\n");
+
+    MapsProtoShardFree(shard);
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+void SpeedTests()
+{
+    int rc = 1;
+    char ispeed = 40;
+    tMAPS_PROTO_EJ_DATA ej = { 0 };
+    tMAPS_PROTO_END_VEHICLE end = { .smb = 0, .vclass = '1', .paxes = 2 };
+    tMAPS_PROTO_SPEED speed = { 0 };
+    tMAPS_PROTO_PARSED_FRAME ia  = { .type = 0, .cmd = "IA", .size = 1, .data = &ispeed };
+    tMAPS_PROTO_PARSED_FRAME axle = { .type = 0, .cmd = "EJ", .size = sizeof(ej), .data = (char *) &ej };
+    tMAPS_PROTO_PARSED_FRAME fas = { .type = 0, .cmd = "FAS", .size = sizeof(end), .data = (char *) &end };
+    tMAPS_PROTO_PARSED_FRAME ip  = { .type = 0, .cmd = "IP" };
+    tMAPS_PROTO_PARSED_FRAME fp  = { .type = 0, .cmd = "FP" };
+
+    printf("\n#### SPEED TESTS ####\n");
+
+    // CF-220. A vehicle without end (lost FAS) is dropped by the next IA
+    ia.timestamp = 1000000000ULL;
+    ej = (tMAPS_PROTO_EJ_DATA) { .paxes = 1, .ispeed = 90 };
+    axle.timestamp = 1100000000ULL;
+    rc &= MapsProtoSpeedUpdate(&speed,&ia) == 0 && MapsProtoSpeedUpdate(&speed,&axle) == 0;
+
+    // IA at 40 Km/h, the axles at 41 and 42 Km/h each 0.36 s (0.77 m/s^2) and FAS 1 s after IA
+    ia.timestamp = 5000000000ULL;
+    rc &= MapsProtoSpeedUpdate(&speed,&ia) == 0 && speed.readings == 1 && speed.axles == 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        ej = (tMAPS_PROTO_EJ_DATA) { .paxes = i + 1, .ispeed = 41 + i };
+        axle.timestamp = ia.timestamp + 360000000ULL * (i + 1);
+        rc &= MapsProtoSpeedUpdate(&speed,&axle) == 0;
+    }
+
+    fas.timestamp = ia.timestamp + 1000000000ULL;
+    rc &= MapsProtoSpeedUpdate(&speed,&fas) == 1;
+
+    if (rc && speed.completed && speed.axles == 2 && speed.readings == 3 && fabs(speed.speed - 42) < 1e-6 && fabs(speed.mean_speed - 41) < 1e-6 &&
+        fabs(speed.acceleration - 1 / 0.36 / 3.6) < 1e-6 && fabs(speed.duration - 1) < 1e-9 && fabs(speed.length - 41 / 3.6) < 1e-6 &&
+        fabs(speed.span - (81 + 83) / 7.2 * 0.36) < 1e-6)
+        printf("SPEED CF-220 test PASSED\n");
+    else
+        printf("SPEED CF-220 test FAILED\n");
+
+    // CF-24P. IP and FP, without speed readings
+    ip.timestamp = 9000000000ULL;
+    fp.timestamp = ip.timestamp + 900000000ULL;
+
+    if (MapsProtoSpeedUpdate(&speed,&ip) == 0 && !speed.completed && speed.start == ip.timestamp && MapsProtoSpeedUpdate(&speed,&fp) == 1 &&
+        speed.completed && speed.axles == 0 && speed.readings == 0 && speed.speed == 0 && fabs(speed.duration - 0.9) < 1e-9 && speed.length == 0)
+        printf("SPEED CF-24P test PASSED\n");
+    else
+        printf("SPEED CF-24P test FAILED\n");
+
+    // A new vehicle after FP. Without timestamps
+    axle.timestamp = 0;
+
+    if (MapsProtoSpeedUpdate(&speed,&axle) == -1 && errno == EINVAL && MapsProtoSpeedUpdate(NULL,&ip) == -1 && errno == EINVAL &&
+        MapsProtoSpeedUpdate(&speed,&ip) == 0 && speed.readings == 0 && !speed.completed && speed.start == ip.timestamp)
+        printf("SPEED ERRORS test PASSED\n");
+    else
+        printf("SPEED ERRORS test FAILED\n");
+}
+//-----------------------------------------------------------------------------
+
+void DedupTests()
+{
+    int rc;
+    uint8_t buffer[64], scs[] = "P123456789\r";
+    size_t size;
+    tMAPS_PROTO_DEDUP dedup = { 0 };
+    tMAPS_PROTO_RAW_FRAME *ip = MapsProtoCreateEmptyRequest(1,"IP");
+    tMAPS_PROTO_RAW_FRAME *fp = MapsProtoCreateEmptyRequest(2,"FP");
+    tMAPS_PROTO_RAW_FRAME *other = MapsProtoCreateEmptyRequest(3,"IP");
+    tMAPS_PROTO_SHARD_LANE_STATS lane;
+    tSHARD_CHECK check = { 0 };
+    tMAPS_PROTO_SHARD *shard;
+
+    printf("\n#### DEDUP TESTS ####\n");
+
+    if (!ip || !fp || !other)
+    {
+        printf("DEDUP CREATE test FAILED\n");
+        MapsProtoFreeRawFrame(ip);
+        MapsProtoFreeRawFrame(fp);
+        MapsProtoFreeRawFrame(other);
+        return;
+    }
+
+    // Repeated in the window, expired, other number, unframed and disabled
+    rc = MapsProtoDedupCheck(&dedup,ip->data,ip->size,1000000,1000) == 0 && MapsProtoDedupCheck(&dedup,ip->data,ip->size,100000000,1000) == 1 &&
+         MapsProtoDedupCheck(&dedup,other->data,other->size,100000000,1000) == 0 && MapsProtoDedupCheck(&dedup,ip->data,ip->size,2000000000,1000) == 0 &&
+         MapsProtoDedupCheck(&dedup,scs,sizeof(scs) - 1,2000000000,1000) == 0 && MapsProtoDedupCheck(&dedup,scs,sizeof(scs) - 1,2000000000,1000) == 0 &&
+         MapsProtoDedupCheck(&dedup,ip->data,ip->size,2000000000,0) == 0;
+
+    if (rc && dedup.frames == 7 && dedup.suppressed == 1 && MapsProtoDedupCheck(NULL,ip->data,ip->size,0,1000) == -1 && errno == EINVAL)
+        printf("DEDUP CHECK test PASSED\n");
+    else
+        printf("DEDUP CHECK test FAILED\n");
+
+    // A gateway replays the last 16 frames (the deepest replay). Every replayed frame is dropped
+    memset(&dedup,0,sizeof(dedup));
+    rc = 1;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            tMAPS_PROTO_RAW_FRAME *frame = MapsProtoCreateEmptyRequest(i % 10,(i < 10) ? "DE" : "TT");
+
+            rc &= frame && MapsProtoDedupCheck(&dedup,frame->data,frame->size,(1000 + pass * 500 + i) * 1000000ULL,5000) == pass;
+            MapsProtoFreeRawFrame(frame);
+        }
+    }
+
+    if (rc && dedup.frames == 32 && dedup.suppressed == 16)
+        printf("DEDUP DEPTH test PASSED\n");
+    else
+        printf("DEDUP DEPTH test FAILED\n");
+
+    // A gateway replays IP and FP after a reconnect. The vehicle is completed once
+    memcpy(buffer,ip->data,ip->size);
+    memcpy(&buffer[ip->size],fp->data,fp->size);
+    size = ip->size + fp->size;
+
+    shard = MapsProtoShardCreate(1,1,NULL,shard_check,&check);
+    rc    = shard && !MapsProtoShardDedup(shard,5000) && MapsProtoShardPush(shard,0,buffer,size) == (int) size &&
+            MapsProtoShardPush(shard,0,buffer,size) == (int) size && !MapsProtoShardDrain(shard,10000) && !MapsProtoShardGetLane(shard,0,&lane);
+
+    if (rc && lane.frames == 4 && lane.duplicates == 2 && lane.vehicles == 1 && atomic_load(&check.frames) == 2 &&
+        MapsProtoShardDedup(NULL,0) == -1 && errno == EINVAL)
+        printf("DEDUP SHARD test PASSED\n");
+    else
+        printf("DEDUP SHARD test FAILED\n");
+
+    MapsProtoShardFree(shard);
+    MapsProtoFreeRawFrame(ip);
+    MapsProtoFreeRawFrame(fp);
+    MapsProtoFreeRawFrame(other);
+}
+//-----------------------------------------------------------------------------
+
+void shed_count(uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_VEHICLE *vehicle, void *user)
+{
+    uint64_t *counts = (uint64_t *) user;
+    uint8_t id = MapsProtoGetCmdId(parsed->cmd);
+
+    (void) lane;
+    (void) vehicle;
+
+    if (id < K_MAPS_PROTO_CMD_COUNT)
+        counts[id]++;
+}
+//-----------------------------------------------------------------------------
+
+int shed_check_rs(const char *cmd, uint8_t expected, tMAPS_PROTO_SHED *shed)
+{
+    int rc;
+    tMAPS_PROTO_FRAME_HEADER header;
+    tMAPS_PROTO_RAW_FRAME *rs = MapsProtoCreateEmptyResponse(3,cmd);
+
+    rc = rs && !MapsProtoValidateFrame(rs->data,rs->size,&header) && MapsProtoShedClass(&header) == expected &&
+         MapsProtoShedHold(shed,rs->data,rs->size,1) == (expected != K_MAPS_PROTO_SHED_KEEP);
+
+    memset(shed,0,sizeof(tMAPS_PROTO_SHED));
+    MapsProtoFreeRawFrame(rs);
+    return rc;
+}
+//-----------------------------------------------------------------------------
+
+void ShedTests()
+{
+    int rc, config;
+    const char *configs[] = { "SM", "SC", "BR", "PR" };
+    uint8_t *buffer;
+    const uint8_t *held;
+    uint16_t size;
+    uint64_t timestamp, pairs = 0, scanners = 0, counts[K_MAPS_PROTO_CMD_COUNT] = { 0 };
+    size_t length = 0;
+    tMAPS_PROTO_FRAME_HEADER header[3];
+    tMAPS_PROTO_SHED *shed = (tMAPS_PROTO_SHED *)calloc(1,sizeof(tMAPS_PROTO_SHED));
+    tMAPS_PROTO_SHARD_LANE_STATS lane;
+    tMAPS_PROTO_SHARD *shard;
+    tMAPS_PROTO_RAW_FRAME *ip = MapsProtoCreateEmptyRequest(1,"IP");
+    tMAPS_PROTO_RAW_FRAME *fp = MapsProtoCreateEmptyRequest(2,"FP");
+    tMAPS_PROTO_RAW_FRAME *de = MapsProtoCreateDEResponse(2,(tMAPS_PROTO_DE_DATA*)"\x00\x00\x02\x00\x01\x02\x0B\x50\x03");
+    tMAPS_PROTO_RAW_FRAME *sc[2] = { MapsProtoCreateSCSpecialRequest(0,(tMAPS_PROTO_SC_SPECIAL*)"\x44\x46\x46\x46\x46\x46\x46\x46\x45\x45\x45\x45\x45"),
+                                     MapsProtoCreateSCSpecialRequest(1,(tMAPS_PROTO_SC_SPECIAL*)"\x48\x46\x46\x46\x46\x46\x46\x46\x45\x45\x45\x45\x45") };
+
+    printf("\n#### SHED TESTS ####\n");
+
+    if (!shed || !ip || !fp || !de || !sc[0] || !sc[1] || MapsProtoValidateFrame(ip->data,ip->size,&header[0]) ||
+        MapsProtoValidateFrame(sc[0]->data,sc[0]->size,&header[1]) || MapsProtoValidateFrame(de->data,de->size,&header[2]))
+    {
+        printf("SHED CREATE test FAILED\n");
+        rc = -1;
+    }
+    else
+    {
+        // The vehicle frames are delivered. The scanner frames and the responses are held and the older is dropped
+        rc = MapsProtoShedClass(&header[0]) == K_MAPS_PROTO_SHED_KEEP && MapsProtoShedClass(&header[1]) == K_MAPS_PROTO_SHED_SCANNER &&
+             MapsProtoShedClass(&header[2]) == K_MAPS_PROTO_SHED_POLLING && MapsProtoShedHold(shed,ip->data,ip->size,1) == 0 &&
+             MapsProtoShedHold(shed,fp->data,fp->size,2) == 0 && MapsProtoShedHold(shed,sc[0]->data,sc[0]->size,3) == 1 &&
+             MapsProtoShedHold(shed,de->data,de->size,4) == 1 && MapsProtoShedHold(shed,sc[1]->data,sc[1]->size,5) == 2 &&
+             MapsProtoShedNext(shed,&held,&size,&timestamp) == 1 && size == de->size && timestamp == 4 &&
+             MapsProtoShedNext(shed,&held,&size,&timestamp) == 1 && size == sc[1]->size && !memcmp(held,sc[1]->data,size) && timestamp == 5 &&
+             MapsProtoShedNext(shed,&held,&size,&timestamp) == 0;
+
+        if (rc && shed->drops == 1 && shed->dropped[K_MAPS_PROTO_CMD_SCS] == 1 && MapsProtoShedHold(NULL,ip->data,ip->size,0) == -1 && errno == EINVAL)
+            printf("SHED HOLD test PASSED\n");
+        else
+            printf("SHED HOLD test FAILED\n");
+    }
+
+    // The RS of the configuration commands are never held: the host waits for the RS of its num. The RS of a poll is held
+    config = shed && shed_check_rs("MV",K_MAPS_PROTO_SHED_POLLING,shed);
+
+    for (int i = 0; i < 4 && config; i++)
+         config &= shed_check_rs(configs[i],K_MAPS_PROTO_SHED_KEEP,shed);
+
+    if (config)
+        printf("SHED CONFIG test PASSED\n");
+    else
+        printf("SHED CONFIG test FAILED\n");
+
+    // A scanner burst between the vehicles pushed at once. The first decoder buffer is decoded behind
+    if (rc >= 0 && (buffer = (uint8_t *)malloc(K_MAPS_PROTO_SHARD_RING)) != NULL)
+    {
+        while (length + ip->size + fp->size + 20 * sc[0]->size <= 8000)
+        {
+            memcpy(&buffer[length],ip->data,ip->size);
+            length += ip->size;
+
+            for (int i = 0; i < 20; i++, scanners++)
+            {
+                memcpy(&buffer[length],sc[i & 1]->data,sc[i & 1]->size);
+                length += sc[i & 1]->size;
+            }
+
+            memcpy(&buffer[length],fp->data,fp->size);
+            length += fp->size;
+            pairs++;
+        }
+
+        shard = MapsProtoShardCreate(1,1,NULL,shed_count,counts);
+        rc    = shard && !MapsProtoShardShed(shard,1) && MapsProtoShardPush(shard,0,buffer,length) == (int) length &&
+                !MapsProtoShardDrain(shard,10000) && !MapsProtoShardGetLane(shard,0,&lane);
+
+        if (rc && lane.shed > 0 && counts[K_MAPS_PROTO_CMD_SCS] + lane.shed == scanners && counts[K_MAPS_PROTO_CMD_IP] == pairs &&
+            counts[K_MAPS_PROTO_CMD_FP] == pairs && lane.vehicles == pairs && lane.frames == scanners + 2 * pairs &&
+            MapsProtoShardShed(shard,K_MAPS_PROTO_SHARD_RING + 1) == -1 && errno == EINVAL)
+            printf("SHED SHARD test PASSED\n");
+        else
+            printf("SHED SHARD test FAILED\n");
+
+        MapsProtoShardFree(shard);
+        free(buffer);
+    }
+
+    MapsProtoFreeRawFrame(ip);
+    MapsProtoFreeRawFrame(fp);
+    MapsProtoFreeRawFrame(de);
+    MapsProtoFreeRawFrame(sc[0]);
+    MapsProtoFreeRawFrame(sc[1]);
+    free(shed);
+}
+//-----------------------------------------------------------------------------
+
 int main()
 {
     //uint8_t data[] = {0x01,0x30,0x52,0x45,0x2f,0x33,0x32,0x43,0x46,0x2d,0x32,0x32,0x30,0x4d,0x2f,0x56,0x2d,0x33,0x30,0x2f,0x52,0x2d,0x30,0x31,0x2f,0x44,0x2d,0x30,0x33,0x2d,0x30,0x32,0x2d,0x32,0x31,0x2f,0x33,0x31,0x0d};
@@ -243,6 +1794,29 @@ int main()
     CreateAndParseErrors();
     CreateAndParseRequest();
     CreateAndParseResponse();
+    SchedulerTests();
+    ConfigTests();
+    RecordTests();
+    BusTests();
+    SerialTests();
+    StoreTests();
+    ReparseTests();
+    ValidateTests();
+    ViewTests();
+    SpecTests();
+    StatusTests();
+    StatsTests();
+    LatencyTests();
+    CorpusTests();
+    MetricsTests();
+    ShardTests();
+    StampTests();
+    SpeedTests();
+    DedupTests();
+    ShedTests();
+    CppTests();
+    CppBuildTests();
+    CppClientTests();
 
     return 0;
 }
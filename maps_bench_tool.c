@@ -0,0 +1,364 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "maps_corpus.h"
+#include "maps_reparse.h"
+//-----------------------------------------------------------------------------
+
+/** @file maps_bench_tool.c
+ *  @brief Run the benchmarks of the library several times and compare them
+ *         with a baseline. For check that a new maps_proto.c is not slower.
+ *
+ *  Usage: maps_bench [-r runs] [-n frames] [-s seed] [-t threshold_pct] [-b baseline.json] [-w output.json]
+ *
+ *      -r: Runs of each benchmark. By default 20.
+ *      -n: Frames of the corpus (see maps_corpus.h). By default 200000.
+ *      -s: The seed of the corpus. By default 1.
+ *      -t: The allowed slowdown in percent. By default 5.
+ *      -b: The baseline to compare. By default maps_bench_baseline.json. "-" for not compare.
+ *      -w: Write the results as a new baseline.
+ *
+ *  The benchmarks are (nanoseconds by frame of the corpus):
+ *
+ *      parse:    MapsProtoParseFrame and MapsProtoFreeParsedFrame.
+ *      create:   The MapsProtoCreate* functions of the frames of the corpus.
+ *      lrc:      MapsProtoValidateFrame. The checks of the framing and the LRC without allocations.
+ *      e2e:      MapsProtoReparseBuffer with one thread. Find, parse and callback.
+ *
+ *  Each result is the mean of the runs with its 95% confidence interval.
+ *  A benchmark is a regression when the lower limit of its interval is
+ *  slower than the upper limit of the baseline plus the threshold, so the
+ *  noise of the host doesn't fail the check. The exit code is 0 when all
+ *  are ok, 2 when there is a regression or 1 on error.
+ *
+ *  The times depend on the host. Write the baseline with the current
+ *  release in the same host (-w) before compare a new one.
+ */
+//-----------------------------------------------------------------------------
+
+#define BENCHMARKS   4
+#define MAX_RUNS     100
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint8_t *data;        ///< The corpus.
+    size_t size;
+    size_t count;         ///< Frames found in the corpus.
+    size_t *offsets;      ///< The offset of each frame.
+    uint16_t *lengths;    ///< The size of each frame.
+    tMAPS_PROTO_CORPUS_CONFIG config;
+    uint64_t frames;
+}tBENCH_CORPUS;
+
+typedef struct
+{
+    const char *name;
+    double (*run)(const tBENCH_CORPUS *corpus);
+    double mean;          ///< ns by frame.
+    double ci;            ///< Half width of the 95% confidence interval.
+    double baseline;      ///< The mean of the baseline or 0.
+    double baseline_ci;   ///< The confidence interval of the baseline.
+}tBENCH_RESULT;
+//-----------------------------------------------------------------------------
+
+// Student t (two tails 95%) for 1 to 30 degrees of freedom
+static const double t95[31] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+static volatile uint64_t sink;  // The results are used, so the compiler can't remove the loops
+//-----------------------------------------------------------------------------
+
+uint64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+//-----------------------------------------------------------------------------
+
+double bench_parse(const tBENCH_CORPUS *corpus)
+{
+    uint64_t start = now_ns();
+    tMAPS_PROTO_PARSED_FRAME *parsed;
+
+    for (size_t i = 0; i < corpus->count; i++)
+    {
+        if ((parsed = MapsProtoParseFrame(&corpus->data[corpus->offsets[i]],corpus->lengths[i])) != NULL)
+            sink += parsed->size;
+
+        MapsProtoFreeParsedFrame(parsed);
+    }
+
+    return (double)(now_ns() - start) / corpus->count;
+}
+//-----------------------------------------------------------------------------
+
+int count_frame(const uint8_t *frame, uint16_t size, uint8_t kind, uint8_t corrupted, void *user)
+{
+    (void) frame;
+    (void) kind;
+    (void) corrupted;
+
+    *(uint64_t *) user += size;
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+double bench_create(const tBENCH_CORPUS *corpus)
+{
+    uint64_t bytes = 0;
+    uint64_t start = now_ns();
+
+    // The generator calls the same MapsProtoCreate* functions of the frames of the corpus
+    MapsProtoCorpusGenerate(&corpus->config,corpus->frames,count_frame,&bytes,NULL);
+    sink += bytes;
+
+    return (double)(now_ns() - start) / corpus->frames;
+}
+//-----------------------------------------------------------------------------
+
+double bench_lrc(const tBENCH_CORPUS *corpus)
+{
+    uint64_t start = now_ns();
+    tMAPS_PROTO_FRAME_HEADER header;
+
+    for (size_t i = 0; i < corpus->count; i++)
+         sink += MapsProtoValidateFrame(&corpus->data[corpus->offsets[i]],corpus->lengths[i],&header);
+
+    return (double)(now_ns() - start) / corpus->count;
+}
+//-----------------------------------------------------------------------------
+
+int count_parsed(const tMAPS_PROTO_REPARSE_FRAME *frame, void *user)
+{
+    (void) user;
+
+    sink += frame->size;
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+double bench_e2e(const tBENCH_CORPUS *corpus)
+{
+    uint64_t start = now_ns();
+    tMAPS_PROTO_REPARSE_STATS stats;
+
+    MapsProtoReparseBuffer(corpus->data,corpus->size,1,0,count_parsed,NULL,&stats);
+
+    return (double)(now_ns() - start) / stats.frames;
+}
+//-----------------------------------------------------------------------------
+
+int load_corpus(tBENCH_CORPUS *corpus)
+{
+    size_t offset = 0, capacity = corpus->frames + 16;
+    uint16_t length;
+
+    if ((corpus->data = MapsProtoCorpusBuffer(&corpus->config,corpus->frames,&corpus->size,NULL)) == NULL)
+        return -1;
+
+    corpus->offsets = (size_t *)malloc(capacity * sizeof(size_t));
+    corpus->lengths = (uint16_t *)malloc(capacity * sizeof(uint16_t));
+
+    if (!corpus->offsets || !corpus->lengths)
+        return -1;
+
+    // The frames of the corpus as the decoder of a lane finds them
+    while (corpus->count < capacity && MapsProtoReparseNext(corpus->data,corpus->size,&offset,&length,NULL) == 1)
+    {
+        corpus->offsets[corpus->count] = offset;
+        corpus->lengths[corpus->count++] = length;
+        offset += length;
+    }
+
+    return (corpus->count) ? 0 : -1;
+}
+//-----------------------------------------------------------------------------
+
+void load_baseline(const char *path, const tBENCH_CORPUS *corpus, tBENCH_RESULT *results)
+{
+    char text[4096], key[64];
+    const char *p;
+    size_t size;
+    FILE *file = fopen(path,"r");
+
+    if (file == NULL)
+    {
+        fprintf(stderr,"Baseline %s not found. Nothing to compare\n",path);
+        return;
+    }
+
+    size = fread(text,1,sizeof(text) - 1,file);
+    text[size] = 0;
+    fclose(file);
+
+    // A baseline of other corpus is not comparable
+    if (!(p = strstr(text,"\"seed\":")) || strtoull(p + 7,NULL,10) != corpus->config.seed ||
+        !(p = strstr(text,"\"frames\":")) || strtoull(p + 9,NULL,10) != corpus->frames)
+    {
+        fprintf(stderr,"Baseline %s is of other seed or frames. Nothing to compare\n",path);
+        return;
+    }
+
+    for (int i = 0; i < BENCHMARKS; i++)
+    {
+        snprintf(key,sizeof(key),"\"%s\"",results[i].name);
+
+        if ((p = strstr(text,key)) && (p = strstr(p,"\"mean_ns\"")) && (p = strchr(p,':')))
+            results[i].baseline = strtod(p + 1,NULL);
+        if (p && (p = strstr(p,"\"ci95_ns\"")) && (p = strchr(p,':')))
+            results[i].baseline_ci = strtod(p + 1,NULL);
+    }
+}
+//-----------------------------------------------------------------------------
+
+int write_results(FILE *file, const tBENCH_CORPUS *corpus, uint16_t runs, const tBENCH_RESULT *results)
+{
+    fprintf(file,"{\n  \"seed\": %llu,\n  \"frames\": %llu,\n  \"runs\": %u,\n",
+            (unsigned long long) corpus->config.seed,(unsigned long long) corpus->frames,runs);
+
+    for (int i = 0; i < BENCHMARKS; i++)
+         fprintf(file,"  \"%s\": { \"mean_ns\": %.2f, \"ci95_ns\": %.2f }%s\n",results[i].name,results[i].mean,results[i].ci,(i < BENCHMARKS - 1) ? "," : "");
+
+    fprintf(file,"}\n");
+
+    return ferror(file) ? -1 : 0;
+}
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int opt, rc = 0;
+    uint16_t runs = 20;
+    unsigned long value;
+    char *end;
+    double threshold = 5;
+    double samples[BENCHMARKS][MAX_RUNS];
+    const char *baseline = "maps_bench_baseline.json";
+    const char *output = NULL;
+    tBENCH_CORPUS corpus;
+    tBENCH_RESULT results[BENCHMARKS] = { { "parse",  bench_parse,  0, 0, 0, 0 }, { "create", bench_create, 0, 0, 0, 0 },
+                                          { "lrc",    bench_lrc,    0, 0, 0, 0 }, { "e2e",    bench_e2e,    0, 0, 0, 0 } };
+
+    memset(&corpus,0,sizeof(corpus));
+    MapsProtoCorpusDefaults(&corpus.config,1);
+    corpus.frames = 200000;
+
+    while ((opt = getopt(argc,argv,"r:n:s:t:b:w:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                    value = strtoul(optarg,&end,0);
+
+                    // Checked before narrow it to runs. i.e. 65538 is not 2
+                    if (end == optarg || *end || *optarg == '-' || value < 2 || value > MAX_RUNS)
+                    {
+                        fprintf(stderr,"The runs must be between 2 and %d\n",MAX_RUNS);
+                        return 1;
+                    }
+                    runs = value;
+            break;
+            case 'n':
+                    corpus.frames = strtoull(optarg,NULL,0);
+            break;
+            case 's':
+                    corpus.config.seed = strtoull(optarg,NULL,0);
+            break;
+            case 't':
+                    threshold = atof(optarg);
+            break;
+            case 'b':
+                    baseline = (strcmp(optarg,"-")) ? optarg : NULL;
+            break;
+            case 'w':
+                    output = optarg;
+            break;
+            default:
+                    fprintf(stderr,"Usage: %s [-r runs] [-n frames] [-s seed] [-t threshold_pct] [-b baseline.json] [-w output.json]\n",argv[0]);
+            return 1;
+        }
+    }
+
+    if (runs < 2 || runs > MAX_RUNS || !corpus.frames)
+    {
+        fprintf(stderr,"The runs must be between 2 and %d and the frames greater than 0\n",MAX_RUNS);
+        return 1;
+    }
+
+    if (load_corpus(&corpus))
+    {
+        fprintf(stderr,"Error generating the corpus: %s\n",strerror(errno));
+        return 1;
+    }
+
+    if (baseline)
+        load_baseline(baseline,&corpus,results);
+
+    // Warm up the caches and the allocator
+    for (int i = 0; i < BENCHMARKS; i++)
+         results[i].run(&corpus);
+
+    // The runs of the benchmarks are interleaved, so a noisy interval of the host is shared by all
+    for (uint16_t r = 0; r < runs; r++)
+         for (int i = 0; i < BENCHMARKS; i++)
+              samples[i][r] = results[i].run(&corpus);
+
+    for (int i = 0; i < BENCHMARKS; i++)
+    {
+        double sum = 0, var = 0;
+
+        for (uint16_t r = 0; r < runs; r++)
+             sum += samples[i][r];
+
+        results[i].mean = sum / runs;
+
+        for (uint16_t r = 0; r < runs; r++)
+             var += (samples[i][r] - results[i].mean) * (samples[i][r] - results[i].mean);
+
+        results[i].ci = ((runs - 1 <= 30) ? t95[runs - 1] : 1.96) * sqrt(var / (runs - 1)) / sqrt(runs);
+
+        if (results[i].baseline > 0 && results[i].mean - results[i].ci > (results[i].baseline + results[i].baseline_ci) * (1 + threshold / 100))
+        {
+            fprintf(stderr,"%-7s %10.2f ns +/- %.2f  baseline %.2f ns +/- %.2f  REGRESSION (%+.1f%%)\n",results[i].name,results[i].mean,results[i].ci,
+                    results[i].baseline,results[i].baseline_ci,(results[i].mean / results[i].baseline - 1) * 100);
+            rc = 2;
+        }
+        else if (results[i].baseline > 0)
+            fprintf(stderr,"%-7s %10.2f ns +/- %.2f  baseline %.2f ns +/- %.2f  ok (%+.1f%%)\n",results[i].name,results[i].mean,results[i].ci,
+                    results[i].baseline,results[i].baseline_ci,(results[i].mean / results[i].baseline - 1) * 100);
+        else
+            fprintf(stderr,"%-7s %10.2f ns +/- %.2f\n",results[i].name,results[i].mean,results[i].ci);
+    }
+
+    write_results(stdout,&corpus,runs,results);
+
+    if (output)
+    {
+        FILE *file = fopen(output,"w");
+        int error = (file) ? write_results(file,&corpus,runs,results) : -1;
+
+        if (file && fclose(file))
+            error = -1;
+
+        if (error)
+        {
+            fprintf(stderr,"Error writing %s: %s\n",output,strerror(errno));
+            rc = (rc) ? rc : 1;
+        }
+    }
+
+    free(corpus.data);
+    free(corpus.offsets);
+    free(corpus.lengths);
+
+    return rc;
+}
+//-----------------------------------------------------------------------------
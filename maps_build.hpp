@@ -0,0 +1,328 @@
+#ifndef MAPS_BUILD_HPP
+#define MAPS_BUILD_HPP
+//-----------------------------------------------------------------------------
+
+/** @file maps_build.hpp
+ *  @brief C++20 MAPS frames built at compile time (header only).
+ *
+ *  The frames have the same layout that MapsProtoCreateFrame (SOH, num,
+ *  RS or NE, cmd, data, LRC and CR) and the same LRC. The parameters are
+ *  template arguments, so an invalid range is a compile error instead of
+ *  an EINVAL at run time. A frame in a constexpr variable is in .rodata:
+ *
+ *      static constexpr auto de = maps::empty_request<3,"DE">();
+ *
+ *      write(fd,de.data(),de.size());
+ *
+ *  The builders that have a C function use the same ranges, except that
+ *  the C functions round some values (i.e. PR time > 99) and here they are
+ *  rejected.
+ */
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "maps_proto.hpp"
+//-----------------------------------------------------------------------------
+
+namespace maps
+{
+
+/**
+ *
+ * @struct fixed_frame
+ * @brief  A complete MAPS frame of N bytes.
+ *
+ */
+template <std::size_t N>
+struct fixed_frame
+{
+    std::array<uint8_t,N> bytes;  ///< The frame. SOH to CR.
+
+    constexpr const uint8_t * data() const { return bytes.data(); }
+    static constexpr uint16_t size()       { return N; }
+};
+
+/**
+ *
+ * @struct fixed_string
+ * @brief  A string literal as template argument. i.e. The command.
+ *
+ */
+template <std::size_t N>
+struct fixed_string
+{
+    char str[N];
+
+    constexpr fixed_string(const char (&s)[N])
+    {
+        for (std::size_t i = 0; i < N; i++)
+            str[i] = s[i];
+    }
+
+    constexpr std::string_view view() const { return std::string_view(str,N-1); }
+};
+
+namespace detail
+{
+
+/// The data of a frame. Only the first size bytes are used.
+struct frame_data
+{
+    uint8_t bytes[8] = {};
+    std::size_t size = 0;
+
+    constexpr frame_data & add(uint8_t c) { bytes[size++] = c; return *this; }
+    constexpr frame_data & add(unsigned value, unsigned digits)
+    {
+        for (unsigned i = digits; i > 0; i--, value /= 10)
+            bytes[size+i-1] = 48 + (value % 10);
+
+        size += digits;
+        return *this;
+    }
+};
+
+// The same as MapsProtoCalculateLRC
+constexpr std::array<uint8_t,2> lrc(const uint8_t *data, std::size_t size)
+{
+    uint8_t xsum = 0;
+
+    for (std::size_t i = 0; i < size; i++)
+        xsum ^= data[i];
+
+    return {{ static_cast<uint8_t>(48 + (xsum >> 4)), static_cast<uint8_t>(48 + (xsum & 0x0F)) }};
+}
+
+// The same layout as MapsProtoCreateFrame
+template <uint8_t Type, std::size_t D>
+constexpr fixed_frame<(Type ? 9 : 7) + D> build(uint8_t num, std::string_view cmd, const frame_data &data)
+{
+    constexpr const char *types[3] = { "", "RS", "NE" };
+    fixed_frame<(Type ? 9 : 7) + D> frame {};
+    std::size_t pos = 2, size = frame.size();
+
+    frame.bytes[0] = 0x01;
+    frame.bytes[1] = num + 48;
+
+    if (Type)
+    {
+        frame.bytes[pos++] = types[Type][0];
+        frame.bytes[pos++] = types[Type][1];
+    }
+
+    frame.bytes[pos++] = cmd[0];
+    frame.bytes[pos++] = cmd[1];
+
+    for (std::size_t i = 0; i < D; i++)
+        frame.bytes[pos++] = data.bytes[i];
+
+    std::array<uint8_t,2> sum = lrc(&frame.bytes[1],size-4);
+
+    frame.bytes[pos++] = sum[0];
+    frame.bytes[pos++] = sum[1];
+    frame.bytes[pos]   = 0x0D;
+
+    return frame;
+}
+
+template <uint8_t Num>
+constexpr void check_num()
+{
+    static_assert(Num <= 9,"The frame number must be between 0 and 9");
+}
+
+} // namespace detail
+
+// Empty frames
+//-----------------------------------------------------------------------------
+
+/// A request without data. The command must support empty requests.
+template <uint8_t Num, fixed_string Cmd>
+constexpr auto empty_request()
+{
+    constexpr uint8_t id = find_cmd(Cmd.view());
+
+    detail::check_num<Num>();
+    static_assert(id != K_MAPS_PROTO_CMD_UNKNOWN,"Unknown MAPS command");
+    static_assert(id == K_MAPS_PROTO_CMD_UNKNOWN || (commands[id].suppdata & 2),"The command not support empty requests");
+
+    return detail::build<0,0>(Num,Cmd.view(),{});
+}
+
+/// A response without data. The command must support empty responses.
+template <uint8_t Num, fixed_string Cmd>
+constexpr auto empty_response()
+{
+    constexpr uint8_t id = find_cmd(Cmd.view());
+
+    detail::check_num<Num>();
+    static_assert(id != K_MAPS_PROTO_CMD_UNKNOWN,"Unknown MAPS command");
+    static_assert(id == K_MAPS_PROTO_CMD_UNKNOWN || (commands[id].suppdata & 1),"The command not support empty responses");
+
+    return detail::build<1,0>(Num,Cmd.view(),{});
+}
+
+/// An unknown or not executed (NE) response. The command can be any 2 chars.
+template <uint8_t Num, fixed_string Cmd>
+constexpr auto unknown_response()
+{
+    detail::check_num<Num>();
+    static_assert(Cmd.view().size() == 2,"The command must have 2 chars");
+
+    return detail::build<2,0>(Num,Cmd.view(),{});
+}
+
+// Requests
+//-----------------------------------------------------------------------------
+
+/// BR request. Baud rate 0 to 5 (see MapsProtoCreateBRRequest).
+template <uint8_t Num, uint8_t BaudRate>
+constexpr auto br_request()
+{
+    detail::check_num<Num>();
+    static_assert(BaudRate <= 5,"The baud rate must be between 0 and 5");
+
+    return detail::build<0,1>(Num,"BR",detail::frame_data().add(BaudRate + 48));
+}
+
+/// CA request. Sensors down 0 to 99.
+template <uint8_t Num, uint8_t NcsDown, uint8_t NdsDown>
+constexpr auto ca_request()
+{
+    detail::check_num<Num>();
+    static_assert(NcsDown <= 99 && NdsDown <= 99,"The sensors must be between 0 and 99");
+
+    return detail::build<0,4>(Num,"CA",detail::frame_data().add(NcsDown,2).add(NdsDown,2));
+}
+
+/// ER request. Photocell 1 to 24.
+template <uint8_t Num, uint8_t Cell>
+constexpr auto er_request()
+{
+    detail::check_num<Num>();
+    static_assert(Cell >= 1 && Cell <= 24,"The photocell must be between 1 and 24");
+
+    return detail::build<0,2>(Num,"ER",detail::frame_data().add(Cell,2));
+}
+
+/// PR request. Time 0 to 99 ms.
+template <uint8_t Num, uint8_t MsecTime>
+constexpr auto pr_request()
+{
+    detail::check_num<Num>();
+    static_assert(MsecTime <= 99,"The time must be between 0 and 99");
+
+    return detail::build<0,2>(Num,"PR",detail::frame_data().add(MsecTime,2));
+}
+
+/// SC request. Mode A, B, C, D, E, H or I and time 0 to 999 ms.
+template <uint8_t Num, char Mode, uint16_t MsecTime>
+constexpr auto sc_request()
+{
+    detail::check_num<Num>();
+    static_assert(std::string_view("ABCDEHI").find(Mode) != std::string_view::npos,"The mode must be A, B, C, D, E, H or I");
+    static_assert(MsecTime <= 999,"The time must be between 0 and 999");
+
+    return detail::build<0,4>(Num,"SC",detail::frame_data().add(Mode).add(MsecTime,3));
+}
+
+/// SM request. Tow and Dir are optional (0). Tow 0, R, M, N, E or T and Dir P or N.
+template <uint8_t Num, uint8_t Mode, uint8_t Axes, uint8_t Heights, char Tow = 0, char Dir = 0>
+constexpr auto sm_request()
+{
+    constexpr std::size_t elements = (Dir) ? 5 : (Tow) ? 4 : 3;
+    detail::frame_data data;
+
+    detail::check_num<Num>();
+    static_assert(Mode <= 3,"The work mode must be between 0 and 3");
+    static_assert(Axes <= 15,"The axes sensor must be between 0 and 15");
+    static_assert(Heights <= 2,"The heights must be between 0 and 2");
+    static_assert(std::string_view("0RMNET").find((Tow) ? Tow : '0') != std::string_view::npos,"The tow must be 0, R, M, N, E or T");
+    static_assert(!Dir || Dir == 'P' || Dir == 'N',"The direction must be P or N");
+
+    data.add(Mode + 48).add((Axes < 10) ? (Axes + 48) : (Axes + 55)).add(Heights + 48);
+
+    if (elements > 3)
+        data.add((Tow) ? Tow : '0');
+    if (elements > 4)
+        data.add(Dir);
+
+    return detail::build<0,elements>(Num,"SM",data);
+}
+
+/// SR request. Sensors 3 to 10.
+template <uint8_t Num, uint8_t Sensors>
+constexpr auto sr_request()
+{
+    detail::check_num<Num>();
+    static_assert(Sensors >= 3 && Sensors <= 10,"The sensors must be between 3 and 10");
+
+    return detail::build<0,2>(Num,"SR",detail::frame_data().add(Sensors,2));
+}
+
+/// RH request. Mode 0 or 1 and receiver 1 to 24.
+template <uint8_t Num, uint8_t Mode, uint8_t Receiver>
+constexpr auto rh_request()
+{
+    detail::check_num<Num>();
+    static_assert(Mode <= 1,"The mode must be 0 or 1");
+    static_assert(Receiver >= 1 && Receiver <= 24,"The receiver must be between 1 and 24");
+
+    return detail::build<0,3>(Num,"RH",detail::frame_data().add(Mode + 48).add(Receiver,2));
+}
+
+/// IA request. Speed 0 to 99. With 0 the frame has no data.
+template <uint8_t Num, uint8_t Speed>
+constexpr auto ia_request()
+{
+    detail::check_num<Num>();
+    static_assert(Speed <= 99,"The speed must be between 0 and 99");
+
+    if constexpr (Speed == 0)
+        return detail::build<0,0>(Num,"IA",{});
+    else
+        return detail::build<0,2>(Num,"IA",detail::frame_data().add(Speed,2));
+}
+
+/// RM request. Axes 0 to 99. With 0 the frame has no data.
+template <uint8_t Num, uint8_t Naxes>
+constexpr auto rm_request()
+{
+    detail::check_num<Num>();
+    static_assert(Naxes <= 99,"The axes must be between 0 and 99");
+
+    if constexpr (Naxes == 0)
+        return detail::build<0,0>(Num,"RM",{});
+    else
+        return detail::build<0,2>(Num,"RM",detail::frame_data().add(Naxes,2));
+}
+
+// Responses
+//-----------------------------------------------------------------------------
+
+/// ER response. Status 0 or 1.
+template <uint8_t Num, uint8_t Status>
+constexpr auto er_response()
+{
+    detail::check_num<Num>();
+    static_assert(Status <= 1,"The status must be 0 or 1");
+
+    return detail::build<1,1>(Num,"ER",detail::frame_data().add(Status + 48));
+}
+
+/// CB response. Loop state 0 or 1.
+template <uint8_t Num, uint8_t LoopState>
+constexpr auto cb_response()
+{
+    detail::check_num<Num>();
+    static_assert(LoopState <= 1,"The loop state must be 0 or 1");
+
+    return detail::build<1,1>(Num,"CB",detail::frame_data().add(LoopState + 48));
+}
+
+} // namespace maps
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,312 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // memfd_create
+#endif
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "maps_bus.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_BUS_CACHE_LINE 64
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_BUS_SLOT
+ * @brief  A record in the ring.
+ *
+ *         The seq member is a sequence lock. For the record number N (from 0)
+ *         is 2N+1 while the producer writes the record and 2N+2 when it's
+ *         complete. The consumer checks it before and after copy the record.
+ *
+ */
+typedef struct
+{
+    _Alignas(K_MAPS_PROTO_BUS_CACHE_LINE) _Atomic uint64_t seq;
+    tMAPS_PROTO_RECORD record;
+}tMAPS_PROTO_BUS_SLOT;
+
+/**
+ *
+ * @struct tMAPS_PROTO_BUS_RING
+ * @brief  The header of the shared memory. The slots are after the header.
+ *
+ */
+typedef struct
+{
+    uint32_t magic;       ///< K_MAPS_PROTO_BUS_MAGIC.
+    uint16_t version;     ///< K_MAPS_PROTO_BUS_VERSION.
+    uint16_t record_size; ///< K_MAPS_PROTO_RECORD_SIZE.
+    uint32_t capacity;    ///< Number of slots. Power of two.
+    _Alignas(K_MAPS_PROTO_BUS_CACHE_LINE) _Atomic uint64_t head; ///< Number of records published.
+    _Alignas(K_MAPS_PROTO_BUS_CACHE_LINE) tMAPS_PROTO_BUS_SLOT slots[];
+}tMAPS_PROTO_BUS_RING;
+
+struct sMAPS_PROTO_BUS
+{
+    int fd;               ///< The shared memory file descriptor.
+    uint8_t owner;        ///< 1 when the fd must be closed with the handle.
+    uint8_t producer;     ///< 1 for the producer handle.
+    size_t size;          ///< The size of the mapping.
+    uint64_t cursor;      ///< The next record to read.
+    tMAPS_PROTO_BUS_RING *ring;
+};
+//-----------------------------------------------------------------------------
+
+static tMAPS_PROTO_BUS * MapsProtoBusMap(int fd, uint8_t owner);
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_BUS * MapsProtoBusMap(int fd, uint8_t owner)
+{
+    int error;
+    struct stat st;
+    tMAPS_PROTO_BUS *bus;
+    tMAPS_PROTO_BUS_RING *ring;
+
+    if (fstat(fd,&st))
+        return NULL;
+
+    if ((size_t) st.st_size < sizeof(tMAPS_PROTO_BUS_RING))
+    {
+        errno = ENOEXEC;
+        return NULL;
+    }
+
+    if ((ring = (tMAPS_PROTO_BUS_RING *)mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED)
+        return NULL;
+
+    if (ring->magic != K_MAPS_PROTO_BUS_MAGIC || ring->version != K_MAPS_PROTO_BUS_VERSION ||
+        ring->record_size != K_MAPS_PROTO_RECORD_SIZE || !ring->capacity || (ring->capacity & (ring->capacity - 1)) ||
+        (size_t) st.st_size < sizeof(tMAPS_PROTO_BUS_RING) + (size_t) ring->capacity * sizeof(tMAPS_PROTO_BUS_SLOT))
+        error = ENOEXEC;
+    else if ((bus = (tMAPS_PROTO_BUS *)calloc(1,sizeof(tMAPS_PROTO_BUS))) == NULL)
+        error = ENOMEM;
+    else
+    {
+        bus->fd     = fd;
+        bus->owner  = owner;
+        bus->size   = st.st_size;
+        bus->ring   = ring;
+        bus->cursor = atomic_load_explicit(&ring->head,memory_order_acquire);
+
+        return bus;
+    }
+
+    munmap(ring,st.st_size);
+    errno = error;
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_BUS * MapsProtoBusCreate(const char *name, uint32_t capacity)
+{
+    int fd, error;
+    tMAPS_PROTO_BUS *bus;
+    size_t size = sizeof(tMAPS_PROTO_BUS_RING) + (size_t) capacity * sizeof(tMAPS_PROTO_BUS_SLOT);
+
+    if (capacity < 2 || (capacity & (capacity - 1)))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (name)
+        fd = shm_open(name,O_CREAT | O_EXCL | O_RDWR,0644);
+    else
+        fd = memfd_create("maps_proto_bus",MFD_CLOEXEC);
+
+    if (fd < 0)
+        return NULL;
+
+    if (ftruncate(fd,size))
+        goto BUS_ERROR_EXEC;
+
+    if ((bus = (tMAPS_PROTO_BUS *)calloc(1,sizeof(tMAPS_PROTO_BUS))) == NULL)
+    {
+        errno = ENOMEM;
+        goto BUS_ERROR_EXEC;
+    }
+
+    if ((bus->ring = (tMAPS_PROTO_BUS_RING *)mmap(NULL,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0)) == MAP_FAILED)
+    {
+        free(bus);
+        goto BUS_ERROR_EXEC;
+    }
+
+    bus->fd       = fd;
+    bus->owner    = 1;
+    bus->producer = 1;
+    bus->size     = size;
+
+    bus->ring->version     = K_MAPS_PROTO_BUS_VERSION;
+    bus->ring->record_size = K_MAPS_PROTO_RECORD_SIZE;
+    bus->ring->capacity    = capacity;
+    atomic_store_explicit(&bus->ring->head,0,memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    bus->ring->magic       = K_MAPS_PROTO_BUS_MAGIC;  // The last one. The ring is valid from here.
+
+    return bus;
+
+    BUS_ERROR_EXEC:
+
+    error = errno;
+    close(fd);
+
+    if (name)
+        shm_unlink(name);
+
+    errno = error;
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_BUS * MapsProtoBusOpen(const char *name)
+{
+    int fd, error;
+    tMAPS_PROTO_BUS *bus;
+
+    if (!name)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((fd = shm_open(name,O_RDONLY,0)) < 0)
+        return NULL;
+
+    if ((bus = MapsProtoBusMap(fd,1)) == NULL)
+    {
+        error = errno;
+        close(fd);
+        errno = error;
+    }
+
+    return bus;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_BUS * MapsProtoBusOpenFd(int fd)
+{
+    return MapsProtoBusMap(fd,0);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoBusGetFd(tMAPS_PROTO_BUS *bus)
+{
+    return (bus) ? bus->fd : -1;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoBusClose(tMAPS_PROTO_BUS *bus)
+{
+    if (bus)
+    {
+        munmap(bus->ring,bus->size);
+
+        if (bus->owner)
+            close(bus->fd);
+
+        free(bus);
+    }
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoBusUnlink(const char *name)
+{
+    return shm_unlink(name);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoBusPublish(tMAPS_PROTO_BUS *bus, const tMAPS_PROTO_RECORD *record)
+{
+    uint64_t head;
+    tMAPS_PROTO_BUS_SLOT *slot;
+
+    if (!bus || !record)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!bus->producer)
+    {
+        errno = EPERM;
+        return -1;
+    }
+
+    head = atomic_load_explicit(&bus->ring->head,memory_order_relaxed);
+    slot = &bus->ring->slots[head & (bus->ring->capacity - 1)];
+
+    atomic_store_explicit(&slot->seq,2 * head + 1,memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->record,record,sizeof(tMAPS_PROTO_RECORD));
+    atomic_store_explicit(&slot->seq,2 * head + 2,memory_order_release);
+    atomic_store_explicit(&bus->ring->head,head + 1,memory_order_release);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoBusRead(tMAPS_PROTO_BUS *bus, tMAPS_PROTO_RECORD *record, uint64_t *lost)
+{
+    uint64_t head, seq, skipped = 0;
+    tMAPS_PROTO_BUS_SLOT *slot;
+
+    if (!bus || !record)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (;;)
+    {
+        head = atomic_load_explicit(&bus->ring->head,memory_order_acquire);
+
+        if (bus->cursor == head)
+        {
+            if (lost)
+                *lost = skipped;
+
+            return 0;
+        }
+
+        if (head - bus->cursor > bus->ring->capacity)  // Overrun. Skip to the oldest record available.
+        {
+            skipped    += head - bus->ring->capacity - bus->cursor;
+            bus->cursor = head - bus->ring->capacity;
+        }
+
+        slot = &bus->ring->slots[bus->cursor & (bus->ring->capacity - 1)];
+        seq  = atomic_load_explicit(&slot->seq,memory_order_acquire);
+
+        if (seq == 2 * bus->cursor + 2)
+        {
+            memcpy(record,&slot->record,sizeof(tMAPS_PROTO_RECORD));
+            atomic_thread_fence(memory_order_acquire);
+
+            if (atomic_load_explicit(&slot->seq,memory_order_relaxed) == seq)
+                break;
+        }
+
+        // The producer is overwriting the slot. The record was lost.
+        skipped++;
+        bus->cursor++;
+    }
+
+    bus->cursor++;
+
+    if (lost)
+        *lost = skipped;
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,130 @@
+#ifndef MAPS_BUS_H
+#define MAPS_BUS_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_bus.h
+ *  @brief Function prototypes for share the parsed frames between local
+ *         processes with a ring of records in shared memory.
+ *
+ *  One producer publishes tMAPS_PROTO_RECORD records and many consumers
+ *  read them. Each consumer have its own read position in its bus handle,
+ *  so the producer never waits for the consumers and the cost of publish a
+ *  record not depends on the number of consumers. When a consumer is slow
+ *  and the producer overwrites records not yet read, the consumer detects
+ *  it, skips to the oldest record available and reports the lost records.
+ *
+ *  The ring can be a POSIX shared memory object (/dev/shm) opened by name
+ *  or an anonymous memfd that is passed to the consumers as a file
+ *  descriptor (fork or SCM_RIGHTS).
+ *
+ *  The consumers not block. When there are no records MapsProtoBusRead
+ *  returns 0 and the consumer must try later.
+ *
+ *  +++ ONLY AVAILABLE ON LINUX +++
+ */
+
+#include "maps_record.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_BUS_MAGIC    0x5350414D  ///< "MAPS" in little endian.
+#define K_MAPS_PROTO_BUS_VERSION  1           ///< The current version of the ring format.
+//-----------------------------------------------------------------------------
+
+typedef struct sMAPS_PROTO_BUS tMAPS_PROTO_BUS;
+
+/** @brief Creates a new ring for publish records.
+ *
+ *  When name is NULL an anonymous memfd is created. Use MapsProtoBusGetFd
+ *  for get the file descriptor to pass to the consumers.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The capacity is not a power of two or is less than 2.
+ *
+ *  Or any errno value of shm_open, memfd_create, ftruncate or mmap.
+ *
+ * @param  name     The name of the shared memory object (i.e. "/maps_lane1") or NULL.
+ * @param  capacity The number of records in the ring. Must be a power of two.
+ * @return NULL on error and Errno is set or on sucess the producer handle.
+ */
+tMAPS_PROTO_BUS * MapsProtoBusCreate(const char *name, uint32_t capacity);
+
+/** @brief Opens a ring created by other process for read the records.
+ *
+ *  The consumer starts reading the records published after the open.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The name param is NULL.
+ *      ENOEXEC: The shared memory not have a valid ring or have other version.
+ *
+ *  Or any errno value of shm_open, fstat or mmap.
+ *
+ * @param  name The name of the shared memory object.
+ * @return NULL on error and Errno is set or on sucess the consumer handle.
+ */
+tMAPS_PROTO_BUS * MapsProtoBusOpen(const char *name);
+
+/** @brief Opens a ring from a file descriptor for read the records.
+ *
+ *  The fd is not closed by the function.
+ *
+ *  The errno values are the same as MapsProtoBusOpen.
+ *
+ * @param  fd The file descriptor of the ring. See MapsProtoBusGetFd.
+ * @return NULL on error and Errno is set or on sucess the consumer handle.
+ */
+tMAPS_PROTO_BUS * MapsProtoBusOpenFd(int fd);
+
+/** @brief Get the file descriptor of a ring.
+ *
+ * @param  bus The bus handle.
+ * @return The file descriptor or -1 if bus is NULL.
+ */
+int MapsProtoBusGetFd(tMAPS_PROTO_BUS *bus);
+
+/** @brief Close a bus handle. The shared memory object is not removed.
+ *
+ * @param  bus The bus handle to close.
+ */
+void MapsProtoBusClose(tMAPS_PROTO_BUS *bus);
+
+/** @brief Remove a shared memory object created with MapsProtoBusCreate.
+ *
+ *  The processes that have the ring opened can continue using it.
+ *
+ * @param  name The name of the shared memory object.
+ * @return 0 on success or -1 on error and errno is set by shm_unlink.
+ */
+int MapsProtoBusUnlink(const char *name);
+
+/** @brief Publish a record. Only the handle returned by MapsProtoBusCreate can publish.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The bus or record params are NULL.
+ *       EPERM: The handle is a consumer.
+ *
+ * @param  bus    The producer handle.
+ * @param  record The record to publish.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoBusPublish(tMAPS_PROTO_BUS *bus, const tMAPS_PROTO_RECORD *record);
+
+/** @brief Read the next record.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The bus or record params are NULL.
+ *
+ * @param  bus    The consumer handle.
+ * @param  record The structure where the record is stored.
+ * @param  lost   If is not NULL, the number of records lost by overrun before this record is stored.
+ * @return 1 when a record is read, 0 if there are no new records or -1 on error and errno is set.
+ */
+int MapsProtoBusRead(tMAPS_PROTO_BUS *bus, tMAPS_PROTO_RECORD *record, uint64_t *lost);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,627 @@
+#ifndef MAPS_CLIENT_HPP
+#define MAPS_CLIENT_HPP
+//-----------------------------------------------------------------------------
+
+/** @file maps_client.hpp
+ *  @brief C++20 coroutine client of MAPS barriers (header only).
+ *
+ *  A maps::executor runs the coroutines of many barriers in one thread.
+ *  Each barrier is a maps::client over a non blocking descriptor (serial
+ *  line or socket). A coroutine suspends in a request until the RS or NE
+ *  frame with the same number and command arrives or the timeout fires,
+ *  and in next_vehicle until the spontaneous frames of the barrier complete
+ *  a vehicle (MapsProtoStoreAssemble):
+ *
+ *      maps::task<void> lane(maps::client &barrier)
+ *      {
+ *          maps::reply de = co_await barrier.request_de(500);
+ *
+ *          if (de.error == 0)
+ *              while (auto vehicle = co_await barrier.next_vehicle())
+ *                  use(*vehicle);
+ *      }
+ *
+ *      maps::executor ex;
+ *      maps::client barrier(ex,fd,lane_number);
+ *
+ *      ex.spawn(lane(barrier));
+ *      ex.run();
+ *
+ *  The frames are found with MapsProtoReparseNext and decoded with
+ *  MapsProtoParseFrameTo, so the receive path not uses the heap. A client
+ *  closed (end of file or error) is not polled anymore and the sockets are
+ *  written with MSG_NOSIGNAL, so a peer closed never raises SIGPIPE. The
+ *  executor is not thread safe. Use one executor per thread.
+ */
+
+#include <deque>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <exception>
+#include <coroutine>
+
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "maps_proto.hpp"
+
+extern "C" {
+#include "maps_store.h"
+#include "maps_reparse.h"
+}
+//-----------------------------------------------------------------------------
+
+namespace maps
+{
+
+class executor;
+class client;
+
+/**
+ *
+ * @struct task
+ * @brief  A lazy coroutine. Starts when is awaited or spawned in an executor.
+ *
+ */
+template <class T>
+class task
+{
+public:
+    struct promise_type;
+    using handle = std::coroutine_handle<promise_type>;
+
+    struct final_awaiter
+    {
+        bool await_ready() noexcept { return false; }
+        void await_resume() noexcept { }
+
+        std::coroutine_handle<> await_suspend(handle h) noexcept
+        {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return (next) ? next : std::noop_coroutine();
+        }
+    };
+
+    struct promise_base
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        final_awaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    struct value_promise : promise_base
+    {
+        std::optional<T> value;
+
+        void return_value(T v) { value.emplace(std::move(v)); }
+    };
+
+    struct void_promise : promise_base
+    {
+        void return_void() { }
+    };
+
+    struct promise_type : std::conditional_t<std::is_void_v<T>,void_promise,value_promise>
+    {
+        task get_return_object() { return task(handle::from_promise(*this)); }
+    };
+
+    task(task &&other) noexcept : h(std::exchange(other.h,nullptr)) { }
+    task(const task &) = delete;
+    ~task() { if (h) h.destroy(); }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        h.promise().continuation = caller;
+        return h;
+    }
+
+    T await_resume()
+    {
+        if (h.promise().error)
+            std::rethrow_exception(h.promise().error);
+        if constexpr (!std::is_void_v<T>)
+            return std::move(*h.promise().value);
+    }
+
+private:
+    friend class executor;
+    explicit task(handle coro) : h(coro) { }
+
+    handle h;
+};
+
+/**
+ *
+ * @struct reply
+ * @brief  The result of a request.
+ *
+ */
+struct reply
+{
+    int error = 0;  ///< 0 when the response arrived, ETIMEDOUT, ECONNRESET or the errno value of write.
+    message msg;    ///< The response. A not_executed message when the barrier sent NE.
+};
+
+/**
+ *
+ * @class executor
+ * @brief Runs the coroutines and waits the descriptors of its clients in one thread.
+ *
+ */
+class executor
+{
+public:
+    executor() = default;
+    executor(const executor &) = delete;
+    executor & operator=(const executor &) = delete;
+
+    ~executor()
+    {
+        for (auto &coro : spawned)
+            coro.destroy();
+    }
+
+    /// The monotonic time in milliseconds. The timestamp of the frames.
+    static uint64_t now()
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    /// Start a coroutine. Is owned by the executor until it ends.
+    void spawn(task<void> &&coro)
+    {
+        spawned.push_back(std::exchange(coro.h,nullptr));
+        schedule(spawned.back());
+    }
+
+    /// Resume a suspended coroutine in the next iteration.
+    void schedule(std::coroutine_handle<> coro) { ready.push_back(coro); }
+
+    /// The number of spawned coroutines not ended.
+    std::size_t pending() const { return spawned.size(); }
+
+    /** @brief Resume the ready coroutines and wait the descriptors once.
+     *
+     * @param  max_wait_ms The maximum wait in milliseconds. -1 waits until a frame or timeout.
+     * @return 0 on success or -1 when poll fails and errno is set.
+     */
+    int run_once(int max_wait_ms = -1);
+
+    /** @brief Run until all the spawned coroutines end.
+     *
+     * @return 0 on success or -1 when poll fails and errno is set.
+     */
+    int run()
+    {
+        while (!spawned.empty())
+            if (run_once() < 0)
+                return -1;
+
+        return 0;
+    }
+
+private:
+    friend class client;
+
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<task<void>::handle> spawned;
+    std::vector<client *> clients;
+    std::vector<struct pollfd> fds;
+};
+
+/**
+ *
+ * @class client
+ * @brief A barrier. Sends the requests and receives the frames of one descriptor.
+ *
+ */
+class client
+{
+public:
+    static constexpr std::size_t buffer_size = 4096;
+
+    /** @brief Attach a descriptor to an executor. The descriptor is set as non blocking.
+     *
+     * @param  ex   The executor.
+     * @param  fd   The descriptor of the barrier. Is not closed by the client.
+     * @param  lane The lane of the vehicles.
+     */
+    client(executor &ex, int fd, uint16_t lane) : ex(ex), fd(fd), lane(lane)
+    {
+        struct stat st;
+        int flags = fcntl(fd,F_GETFL);
+
+        if (flags >= 0)
+            fcntl(fd,F_SETFL,flags | O_NONBLOCK);
+        if (fstat(fd,&st) == 0 && S_ISSOCK(st.st_mode))
+            is_socket = 1;
+
+        ex.clients.push_back(this);
+    }
+
+    client(const client &) = delete;
+    client & operator=(const client &) = delete;
+
+    ~client()
+    {
+        std::erase(ex.clients,this);
+        cancel(ECONNRESET);
+    }
+
+    /// The awaiter of a request. Resumes with the reply.
+    struct request_awaiter
+    {
+        client &owner;
+        tMAPS_PROTO_RAW_FRAME *frame;
+        int timeout_ms;
+        reply result;
+        uint8_t num = 0;
+        char cmd[K_MAPS_PROTO_CMD_LENGTH+1] = {};
+        uint64_t deadline = 0;
+        std::coroutine_handle<> coro;
+
+        request_awaiter(client &owner, tMAPS_PROTO_RAW_FRAME *frame, int timeout_ms) : owner(owner), frame(frame), timeout_ms(timeout_ms) { }
+        request_awaiter(const request_awaiter &) = delete;
+        ~request_awaiter() { MapsProtoFreeRawFrame(frame); }
+
+        bool await_ready()
+        {
+            if (!frame)
+                result.error = (errno) ? errno : EINVAL;
+            else if (owner.closed)
+                result.error = ECONNRESET;
+            else
+                return false;
+
+            return true;
+        }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            tMAPS_PROTO_FRAME_HEADER header;
+
+            if (MapsProtoValidateFrame(frame->data,frame->size,&header))
+            {
+                result.error = errno;
+                return false;
+            }
+            if (header.type != 0)  // Only requests have a response
+            {
+                result.error = EINVAL;
+                return false;
+            }
+
+            num  = header.num;
+            coro = h;
+            memcpy(cmd,header.cmd,sizeof(cmd));
+            deadline = (timeout_ms < 0) ? 0 : executor::now() + timeout_ms;
+
+            owner.tx.insert(owner.tx.end(),frame->data,frame->data + frame->size);
+            owner.requests.push_back(this);
+            return true;
+        }
+
+        reply await_resume() { return std::move(result); }
+    };
+
+    /// The awaiter of a vehicle. Resumes with the vehicle or std::nullopt on timeout or when the descriptor is closed.
+    struct vehicle_awaiter
+    {
+        client &owner;
+        int timeout_ms;
+        uint64_t deadline = 0;
+        std::coroutine_handle<> coro;
+        std::optional<tMAPS_PROTO_VEHICLE> result;
+
+        vehicle_awaiter(client &owner, int timeout_ms) : owner(owner), timeout_ms(timeout_ms) { }
+
+        bool await_ready()
+        {
+            if (!owner.vehicles.empty())
+            {
+                result = owner.vehicles.front();
+                owner.vehicles.pop_front();
+                return true;
+            }
+
+            return owner.closed;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            coro = h;
+            deadline = (timeout_ms < 0) ? 0 : executor::now() + timeout_ms;
+            owner.waiters.push_back(this);
+        }
+
+        std::optional<tMAPS_PROTO_VEHICLE> await_resume() { return result; }
+    };
+
+    /// The next frame number. The same sequence as the scheduler (0 to 9).
+    uint8_t next_num()
+    {
+        uint8_t n = num;
+
+        num = (num + 1) % 10;
+        return n;
+    }
+
+    /** @brief Send a request frame and wait the response with the same number and command.
+     *
+     *  The frame is released by the awaiter. When frame is NULL the reply has
+     *  the errno value of the function that created it.
+     *
+     * @param  frame      The request. i.e. MapsProtoCreateERRequest(barrier.next_num(),3)
+     * @param  timeout_ms The timeout in milliseconds. -1 waits forever.
+     */
+    request_awaiter request(tMAPS_PROTO_RAW_FRAME *frame, int timeout_ms)
+    {
+        return request_awaiter(*this,frame,timeout_ms);
+    }
+
+    /// Send a request without data (MapsProtoCreateEmptyRequest) and wait the response.
+    request_awaiter request(const char *cmd, int timeout_ms)
+    {
+        return request(MapsProtoCreateEmptyRequest(next_num(),cmd),timeout_ms);
+    }
+
+    /// Get the status of the barrier. The reply is a response<K_MAPS_PROTO_CMD_DE> or not_executed.
+    request_awaiter request_de(int timeout_ms) { return request("DE",timeout_ms); }
+
+    /** @brief Wait the next vehicle completed by the spontaneous frames of the barrier.
+     *
+     * @param  timeout_ms The timeout in milliseconds. -1 waits forever.
+     */
+    vehicle_awaiter next_vehicle(int timeout_ms = -1) { return vehicle_awaiter(*this,timeout_ms); }
+
+    /// The frames received and the bytes skipped between frames.
+    uint64_t frames() const { return rx_frames; }
+    uint64_t junk()   const { return rx_junk; }
+
+private:
+    friend class executor;
+
+    // Resume all the awaiters with an error
+    void cancel(int error)
+    {
+        closed = 1;
+
+        for (request_awaiter *req : requests)
+        {
+            req->result.error = error;
+            ex.schedule(req->coro);
+        }
+
+        for (vehicle_awaiter *waiter : waiters)
+            ex.schedule(waiter->coro);
+
+        requests.clear();
+        waiters.clear();
+    }
+
+    // The nearest deadline or 0 when there is not
+    uint64_t deadline() const
+    {
+        uint64_t next = 0;
+
+        for (const request_awaiter *req : requests)
+            if (req->deadline && (!next || req->deadline < next))
+                next = req->deadline;
+        for (const vehicle_awaiter *waiter : waiters)
+            if (waiter->deadline && (!next || waiter->deadline < next))
+                next = waiter->deadline;
+
+        return next;
+    }
+
+    void expire(uint64_t now)
+    {
+        std::erase_if(requests,[&](request_awaiter *req) {
+            if (!req->deadline || req->deadline > now)
+                return false;
+
+            req->result.error = ETIMEDOUT;
+            ex.schedule(req->coro);
+            return true;
+        });
+
+        std::erase_if(waiters,[&](vehicle_awaiter *waiter) {
+            if (!waiter->deadline || waiter->deadline > now)
+                return false;
+
+            ex.schedule(waiter->coro);
+            return true;
+        });
+    }
+
+    void on_writable()
+    {
+        // send fails with EPIPE instead of raise SIGPIPE when the peer is closed. A serial line is not a socket
+        ssize_t bytes = (is_socket) ? send(fd,tx.data(),tx.size(),MSG_NOSIGNAL) : write(fd,tx.data(),tx.size());
+
+        if (bytes > 0)
+            tx.erase(tx.begin(),tx.begin() + bytes);
+        else if (bytes < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            tx.clear();
+            cancel(errno);
+        }
+    }
+
+    void on_readable(uint64_t now)
+    {
+        size_t offset = 0, skipped;
+        uint16_t length;
+        ssize_t bytes = read(fd,&rx[rx_size],buffer_size - rx_size);
+
+        if (bytes <= 0)
+        {
+            if (bytes == 0 || (errno != EAGAIN && errno != EINTR))
+                cancel((bytes == 0) ? ECONNRESET : errno);
+            return;
+        }
+
+        rx_size += bytes;
+
+        while (MapsProtoReparseNext(rx,rx_size,&offset,&length,&skipped) == 1)
+        {
+            rx_junk += skipped;
+            on_frame(&rx[offset],length,now);
+            offset += length;
+        }
+
+        rx_junk += skipped;
+
+        if (offset == 0 && rx_size == buffer_size)  // A full buffer without frames. Discard it
+        {
+            rx_junk += rx_size;
+            offset = rx_size;
+        }
+
+        memmove(rx,&rx[offset],rx_size - offset);
+        rx_size -= offset;
+    }
+
+    void on_frame(const uint8_t *frame, uint16_t size, uint64_t now)
+    {
+        int length;
+        tMAPS_PROTO_FRAME_HEADER header;
+        tMAPS_PROTO_PARSED_FRAME parsed;
+        alignas(8) uint8_t data[K_MAPS_PROTO_MAX_DATA_SIZE];
+
+        if ((length = MapsProtoParseFrameTo(frame,size,&header,data,sizeof(data))) < 0)
+            return;
+
+        rx_frames++;
+
+        if (header.type != 0)  // RS or NE. Resume the request with the same number and command
+        {
+            for (auto it = requests.begin(); it != requests.end(); ++it)
+                if ((*it)->num == header.num && !strncmp((*it)->cmd,header.cmd,K_MAPS_PROTO_CMD_LENGTH))
+                {
+                    detail::to_message((*it)->result.msg,header,data,length);
+                    ex.schedule((*it)->coro);
+                    requests.erase(it);
+                    break;
+                }
+        }
+
+        parsed.num  = header.num;
+        parsed.type = header.type;
+        parsed.size = length;
+        parsed.data = (length) ? (char *) data : NULL;
+        memcpy(parsed.cmd,header.cmd,sizeof(parsed.cmd));
+
+        if (MapsProtoStoreAssemble(&vehicle,&parsed,lane,now) == 1)
+        {
+            if (waiters.empty())
+                vehicles.push_back(vehicle);
+            else
+            {
+                waiters.front()->result = vehicle;
+                ex.schedule(waiters.front()->coro);
+                waiters.erase(waiters.begin());
+            }
+        }
+    }
+
+    executor &ex;
+    int fd;
+    uint16_t lane;
+    uint8_t num = 0;
+    uint8_t closed = 0;
+    uint8_t is_socket = 0;
+    uint64_t rx_frames = 0;
+    uint64_t rx_junk = 0;
+    size_t rx_size = 0;
+    uint8_t rx[buffer_size];
+    std::vector<uint8_t> tx;
+    tMAPS_PROTO_VEHICLE vehicle = {};
+    std::deque<tMAPS_PROTO_VEHICLE> vehicles;
+    std::vector<request_awaiter *> requests;
+    std::vector<vehicle_awaiter *> waiters;
+};
+
+inline int executor::run_once(int max_wait_ms)
+{
+    int wait = max_wait_ms;
+    uint64_t now;
+
+    while (!ready.empty())
+    {
+        std::coroutine_handle<> coro = ready.front();
+
+        ready.pop_front();
+        coro.resume();
+    }
+
+    std::erase_if(spawned,[](task<void>::handle coro) {
+        if (!coro.done())
+            return false;
+
+        coro.destroy();
+        return true;
+    });
+
+    if (spawned.empty())
+        return 0;
+
+    fds.clear();
+    now = executor::now();
+
+    if (!ready.empty())
+        wait = 0;
+
+    for (client *c : clients)
+    {
+        uint64_t deadline = c->deadline();
+
+        // A closed client is ignored by poll (negative fd). Its end of file would wake poll at once forever
+        fds.push_back({ (c->closed) ? -1 : c->fd, (short)(POLLIN | ((c->tx.empty()) ? 0 : POLLOUT)), 0 });
+
+        if (deadline)
+        {
+            int left = (deadline > now) ? (int)(deadline - now) : 0;
+            wait = (wait < 0 || left < wait) ? left : wait;
+        }
+    }
+
+    if (poll(fds.data(),fds.size(),wait) < 0 && errno != EINTR)
+        return -1;
+
+    now = executor::now();
+
+    for (std::size_t i = 0; i < fds.size(); i++)
+    {
+        client *c = clients[i];
+
+        if (fds[i].revents & POLLOUT)
+            c->on_writable();
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+            c->on_readable(now);
+
+        c->expire(now);
+    }
+
+    return 0;
+}
+
+} // namespace maps
+
+//-----------------------------------------------------------------------------
+#endif
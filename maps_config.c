@@ -0,0 +1,317 @@
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "maps_config.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_CONFIG_STEPS 7     // The DE request and the 6 config commands.
+
+#define K_MAPS_PROTO_STEP_IDLE    0
+#define K_MAPS_PROTO_STEP_SENT    1
+#define K_MAPS_PROTO_STEP_DONE    2
+
+#define config_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_CONFIG_STEP
+ * @brief  A command sent by the engine.
+ *
+ */
+typedef struct
+{
+    uint8_t field;        ///< The K_MAPS_PROTO_CONFIG_* bit. 0 for the DE request.
+    char cmd[K_MAPS_PROTO_CMD_LENGTH];   ///< The command. Not NULL terminate.
+    uint8_t state;        ///< K_MAPS_PROTO_STEP_* value.
+    uint8_t num;          ///< The message number used in the last send.
+    uint8_t attempts;     ///< Number of times sent.
+    uint64_t sent_ms;     ///< When was sent the last time.
+}tMAPS_PROTO_CONFIG_STEP;
+
+struct sMAPS_PROTO_CONFIG_ENGINE
+{
+    uint8_t barrier;      ///< The barrier model.
+    uint8_t window;       ///< Max commands without response.
+    uint8_t num;          ///< The next message number to use.
+    uint8_t diffed;       ///< 1 when the DE response was processed.
+    uint32_t timeout_ms;  ///< Response timeout.
+    tMAPS_PROTO_CONFIG config;        ///< The desired config.
+    tMAPS_PROTO_CONFIG_STATUS status; ///< The result.
+    tMAPS_PROTO_CONFIG_STEP steps[K_MAPS_PROTO_CONFIG_STEPS];
+};
+//-----------------------------------------------------------------------------
+
+static uint8_t MapsProtoConfigSMElements(uint8_t barrier);
+static void    MapsProtoConfigDiff      (tMAPS_PROTO_CONFIG_ENGINE *engine, const tMAPS_PROTO_DE_DATA *de);
+static void    MapsProtoConfigResult    (tMAPS_PROTO_CONFIG_ENGINE *engine, tMAPS_PROTO_CONFIG_STEP *step, uint8_t ok);
+static tMAPS_PROTO_RAW_FRAME * MapsProtoConfigFrame(tMAPS_PROTO_CONFIG_ENGINE *engine, tMAPS_PROTO_CONFIG_STEP *step, uint8_t num);
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoConfigSMElements(uint8_t barrier)
+{
+    switch (barrier)
+    {
+        case K_MAPS_PROTO_BARRIER_CF24P:
+                return 3;
+        break;
+        case K_MAPS_PROTO_BARRIER_CF150:
+                return 4;
+        break;
+    }
+
+    return 5;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoConfigDiff(tMAPS_PROTO_CONFIG_ENGINE *engine, const tMAPS_PROTO_DE_DATA *de)
+{
+    const tMAPS_PROTO_SM_DATA *sm = &engine->config.sm;
+    uint8_t elements = MapsProtoConfigSMElements(engine->barrier);
+    char tow = (sm->tow_detection == 0) ? 48 : sm->tow_detection;
+
+    engine->diffed = 1;
+
+    if (de == NULL || engine->steps[1].state != K_MAPS_PROTO_STEP_IDLE)
+        return;
+    if (de->work_mode != sm->work_mode || de->axis_ispeed != sm->axis_ispeed || de->axis_height != sm->axis_height)
+        return;
+    if (elements >= 4 && de->tow_detection != tow)
+        return;
+    if (elements == 5 && de->rcvr_direction != sm->rcvr_direction)
+        return;
+
+    engine->steps[1].state = K_MAPS_PROTO_STEP_DONE;
+    engine->status.unchanged |= K_MAPS_PROTO_CONFIG_SM;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoConfigResult(tMAPS_PROTO_CONFIG_ENGINE *engine, tMAPS_PROTO_CONFIG_STEP *step, uint8_t ok)
+{
+    step->state = K_MAPS_PROTO_STEP_DONE;
+
+    if (step->field == 0)   // DE request. Without status the engine sends all the commands.
+        return;
+
+    if (ok)
+        engine->status.changed |= step->field;
+    else
+        engine->status.failed  |= step->field;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_RAW_FRAME * MapsProtoConfigFrame(tMAPS_PROTO_CONFIG_ENGINE *engine, tMAPS_PROTO_CONFIG_STEP *step, uint8_t num)
+{
+    tMAPS_PROTO_CONFIG *config = &engine->config;
+
+    switch (step->field)
+    {
+        case K_MAPS_PROTO_CONFIG_SM:
+                return MapsProtoCreateSMRequest(num,MapsProtoConfigSMElements(engine->barrier),&config->sm);
+        break;
+        case K_MAPS_PROTO_CONFIG_CA:
+                if (config->ca.ca_sensors > 99 || config->ca.da_sensors > 99)
+                    break;
+
+                return MapsProtoCreateCARequest(num,config->ca.ca_sensors,config->ca.da_sensors);
+        break;
+        case K_MAPS_PROTO_CONFIG_PR:
+                return MapsProtoCreatePRRequest(num,config->pr_delay);
+        break;
+        case K_MAPS_PROTO_CONFIG_SR:
+                return MapsProtoCreateSRRequest(num,config->sr_sensors);
+        break;
+        case K_MAPS_PROTO_CONFIG_RH:
+                return MapsProtoCreateRHRequest(num,config->rh.wmode,config->rh.recvn);
+        break;
+        case K_MAPS_PROTO_CONFIG_SC:
+                return MapsProtoCreateSCRequest(num,config->sc.mode,config->sc.send_time);
+        break;
+        default:
+                return MapsProtoCreateEmptyRequest(num,"DE");
+        break;
+    }
+
+    errno = EINVAL;
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_CONFIG_ENGINE * MapsProtoConfigCreate(uint8_t barrier, const tMAPS_PROTO_CONFIG *config, uint8_t window, uint32_t timeout_ms)
+{
+    tMAPS_PROTO_CMD_SPEC spec;
+    tMAPS_PROTO_CONFIG_ENGINE *engine;
+    const char *cmds[K_MAPS_PROTO_CONFIG_STEPS] = {"DE","SM","CA","PR","SR","RH","SC"};
+
+    if (barrier != K_MAPS_PROTO_BARRIER_CF24P && barrier != K_MAPS_PROTO_BARRIER_CF150 && barrier != K_MAPS_PROTO_BARRIER_CF220)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!config || !window || window > 9 || !timeout_ms)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((engine = (tMAPS_PROTO_CONFIG_ENGINE *)calloc(1,sizeof(tMAPS_PROTO_CONFIG_ENGINE))) == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    engine->barrier    = barrier;
+    engine->window     = window;
+    engine->timeout_ms = timeout_ms;
+    engine->config     = *config;
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CONFIG_STEPS; i++)
+    {
+        tMAPS_PROTO_CONFIG_STEP *step = &engine->steps[i];
+
+        step->field = (i) ? (1 << (i - 1)) : 0;
+        memcpy(step->cmd,cmds[i],2);
+
+        if (i && !(config->fields & step->field))
+            step->state = K_MAPS_PROTO_STEP_DONE;
+        else if (i && (MapsProtoGetCmdSpec(cmds[i],&spec) || !(spec.barriers & barrier)))
+        {
+            step->state = K_MAPS_PROTO_STEP_DONE;
+            engine->status.unsupported |= step->field;
+        }
+    }
+
+    return engine;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoConfigFree(tMAPS_PROTO_CONFIG_ENGINE *engine)
+{
+    if (engine)
+        free(engine);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoConfigNext(tMAPS_PROTO_CONFIG_ENGINE *engine, uint64_t now_ms, tMAPS_PROTO_RAW_FRAME **frame)
+{
+    uint8_t sent = 0;
+    uint16_t used = 0;   // Bit map of the message numbers waiting a response.
+
+    if (!engine || !frame)
+        config_error(EINVAL);
+
+    *frame = NULL;
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CONFIG_STEPS; i++)
+    {
+        tMAPS_PROTO_CONFIG_STEP *step = &engine->steps[i];
+
+        if (step->state != K_MAPS_PROTO_STEP_SENT)
+            continue;
+
+        if (now_ms - step->sent_ms < engine->timeout_ms)
+        {
+            used |= 1 << step->num;
+            sent++;
+        }
+        else if (step->attempts > K_MAPS_PROTO_CONFIG_RETRIES)
+        {
+            MapsProtoConfigResult(engine,step,0);
+
+            if (i == 0)
+                MapsProtoConfigDiff(engine,NULL);
+        }
+        else
+            step->state = K_MAPS_PROTO_STEP_IDLE;  // Send again
+    }
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CONFIG_STEPS && sent < engine->window; i++)
+    {
+        uint8_t num;
+        tMAPS_PROTO_CONFIG_STEP *step = &engine->steps[i];
+
+        if (step->state != K_MAPS_PROTO_STEP_IDLE)
+            continue;
+        if (i && !engine->diffed)   // The commands are sent after the DE response.
+            break;
+
+        for (num = engine->num; used & (1 << num); num = (num + 1) % 10);
+
+        if ((*frame = MapsProtoConfigFrame(engine,step,num)) == NULL)
+        {
+            if (errno == ENOMEM)
+                return -1;
+
+            MapsProtoConfigResult(engine,step,0);   // Invalid values in the config
+            continue;
+        }
+
+        engine->num    = (num + 1) % 10;
+        step->num      = num;
+        step->state    = K_MAPS_PROTO_STEP_SENT;
+        step->sent_ms  = now_ms;
+        step->attempts++;
+
+        return 1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoConfigOnFrame(tMAPS_PROTO_CONFIG_ENGINE *engine, const tMAPS_PROTO_PARSED_FRAME *parsed)
+{
+    if (!engine || !parsed)
+        config_error(EINVAL);
+    if (parsed->type == 0)
+        return 0;
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CONFIG_STEPS; i++)
+    {
+        uint8_t ok = (parsed->type == 1);
+        tMAPS_PROTO_CONFIG_STEP *step = &engine->steps[i];
+
+        if (step->state != K_MAPS_PROTO_STEP_SENT || step->num != parsed->num || strncmp(step->cmd,parsed->cmd,2))
+            continue;
+
+        if (ok && step->field == K_MAPS_PROTO_CONFIG_SR && parsed->data)
+            ok = ((uint8_t) parsed->data[0] == engine->config.sr_sensors);
+        if (ok && step->field == K_MAPS_PROTO_CONFIG_RH && parsed->data)
+        {
+            const tMAPS_PROTO_RH_DATA *rh = (const tMAPS_PROTO_RH_DATA *) parsed->data;
+            ok = (rh->wmode == engine->config.rh.wmode && rh->recvn == engine->config.rh.recvn);
+        }
+
+        MapsProtoConfigResult(engine,step,ok);
+
+        if (i == 0)
+            MapsProtoConfigDiff(engine,(ok) ? (const tMAPS_PROTO_DE_DATA *) parsed->data : NULL);
+
+        return 1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoConfigGetStatus(tMAPS_PROTO_CONFIG_ENGINE *engine, tMAPS_PROTO_CONFIG_STATUS *status)
+{
+    if (!engine || !status)
+        config_error(EINVAL);
+
+    engine->status.done = 1;
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CONFIG_STEPS; i++)
+    {
+        if (engine->steps[i].state != K_MAPS_PROTO_STEP_DONE)
+            engine->status.done = 0;
+    }
+
+    *status = engine->status;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
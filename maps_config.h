@@ -0,0 +1,141 @@
+#ifndef MAPS_CONFIG_H
+#define MAPS_CONFIG_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_config.h
+ *  @brief Function prototypes for push a configuration to a barrier.
+ *
+ *  The config engine reads the barrier status with a DE request, compares
+ *  it with the desired configuration and only sends the commands that
+ *  differ. The commands not supported by the barrier model (barriers bits
+ *  of the command) are not sent.
+ *
+ *  The DE response only have the working mode (SM) values. The CA, PR, SR,
+ *  RH and SC values can't be read from the barrier (RH needs data in the
+ *  request) so they are always sent when are selected.
+ *
+ *  Each command is verified with its response: RS is accepted (the SR and
+ *  RH responses must have the same values) and NE is a failure. Up to window
+ *  commands are sent without wait the response, using a different message
+ *  number for each one. The engine not make any I/O, so one engine by
+ *  barrier can be used for configure all the barriers at the same time.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_CONFIG_SM       0x01   ///< Working mode (SM).
+#define K_MAPS_PROTO_CONFIG_CA       0x02   ///< Max anomalies (CA).
+#define K_MAPS_PROTO_CONFIG_PR       0x04   ///< Presence relay delay (PR).
+#define K_MAPS_PROTO_CONFIG_SR       0x08   ///< Sensors for tow detection (SR).
+#define K_MAPS_PROTO_CONFIG_RH       0x10   ///< Height relay (RH).
+#define K_MAPS_PROTO_CONFIG_SC       0x20   ///< Scanner mode (SC).
+#define K_MAPS_PROTO_CONFIG_RETRIES  2      ///< Times that a command is sent again when the response not arrives.
+//-----------------------------------------------------------------------------
+
+typedef struct sMAPS_PROTO_CONFIG_ENGINE tMAPS_PROTO_CONFIG_ENGINE;
+
+/**
+ *
+ * @struct tMAPS_PROTO_CONFIG
+ * @brief  The desired configuration of a barrier.
+ *
+ *         Only the members indicated in fields are used. The SM elements
+ *         are selected by the barrier model: 3 for CF-24P, 4 for CF-150
+ *         and 5 for CF-220. See MapsProtoCreateSMRequest.
+ *
+ */
+typedef struct
+{
+    uint8_t fields;             ///< The K_MAPS_PROTO_CONFIG_* bits of the members to set.
+    tMAPS_PROTO_SM_DATA sm;     ///< Working mode.
+    tMAPS_PROTO_CA_DATA ca;     ///< Max anomalies. Only CF-220.
+    uint8_t pr_delay;           ///< Presence relay delay in milliseconds. Range 0 to 99. Only CF-220.
+    uint8_t sr_sensors;         ///< Sensors for tow detection. Range 3 to 10. Only CF-220.
+    tMAPS_PROTO_RH_DATA rh;     ///< Height relay. Only CF-24P.
+    tMAPS_PROTO_SC_DATA sc;     ///< Scanner mode. Only CF-220 & CF-24P.
+}tMAPS_PROTO_CONFIG;
+
+/**
+ *
+ * @struct tMAPS_PROTO_CONFIG_STATUS
+ * @brief  The result of the configuration. Each member have K_MAPS_PROTO_CONFIG_* bits.
+ *
+ */
+typedef struct
+{
+    uint8_t done;         ///< 1 when all commands have a result.
+    uint8_t changed;      ///< Commands sent and verified.
+    uint8_t unchanged;    ///< Commands not sent because the barrier already have the values.
+    uint8_t unsupported;  ///< Commands not sent because the barrier model not support them.
+    uint8_t failed;       ///< Commands with NE response, without response or with different values.
+}tMAPS_PROTO_CONFIG_STATUS;
+
+/** @brief Creates a config engine for a barrier.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: Invalid barrier, config is NULL, window is out of range or timeout_ms is zero.
+ *
+ * @param  barrier    The barrier model. One of K_MAPS_PROTO_BARRIER_* values.
+ * @param  config     The desired configuration.
+ * @param  window     Max commands sent without response. Range 1 to 9.
+ * @param  timeout_ms The time to wait a response before send again the command.
+ * @return NULL on error and Errno is set or on sucess a new allocated engine.
+ */
+tMAPS_PROTO_CONFIG_ENGINE * MapsProtoConfigCreate(uint8_t barrier, const tMAPS_PROTO_CONFIG *config, uint8_t window, uint32_t timeout_ms);
+
+/** @brief Free a config engine created with MapsProtoConfigCreate.
+ *
+ * @param  engine The engine to free.
+ */
+void MapsProtoConfigFree(tMAPS_PROTO_CONFIG_ENGINE *engine);
+
+/** @brief Get the next frame to send to the barrier.
+ *
+ *  The first frame is the DE request. The config commands are returned
+ *  when the DE response arrives (or fails) and while the window is not full.
+ *  The commands that can't be created because the config have invalid values
+ *  are marked as failed.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The engine or frame params are NULL.
+ *
+ * @param  engine The config engine.
+ * @param  now_ms The current time in milliseconds from a monotonic clock.
+ * @param  frame  Where the new allocated frame is stored. Must be freed with MapsProtoFreeRawFrame.
+ * @return 1 when there is a frame to send, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoConfigNext(tMAPS_PROTO_CONFIG_ENGINE *engine, uint64_t now_ms, tMAPS_PROTO_RAW_FRAME **frame);
+
+/** @brief Notify a frame received from the barrier.
+ *
+ *  The frames that are not a response to the engine commands are ignored.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The engine or parsed params are NULL.
+ *
+ * @param  engine The config engine.
+ * @param  parsed The parsed frame.
+ * @return 1 if the frame was a response for the engine, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoConfigOnFrame(tMAPS_PROTO_CONFIG_ENGINE *engine, const tMAPS_PROTO_PARSED_FRAME *parsed);
+
+/** @brief Get the result of the configuration.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The engine or status params are NULL.
+ *
+ * @param  engine The config engine.
+ * @param  status The structure where the result is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoConfigGetStatus(tMAPS_PROTO_CONFIG_ENGINE *engine, tMAPS_PROTO_CONFIG_STATUS *status);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,530 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "maps_corpus.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_CORPUS_SOH           0x01
+#define K_MAPS_PROTO_CORPUS_MAX_FAILURES  64
+#define K_MAPS_PROTO_CORPUS_BUFFER_SIZE   0x10000
+
+#define corpus_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_CORPUS_STATE
+ * @brief  The state of a generation.
+ *
+ */
+typedef struct
+{
+    uint64_t random;      ///< The state of the pseudo random generator (xorshift64*).
+    uint64_t left;        ///< Frames to generate.
+    uint8_t num;          ///< The message number of the next frame.
+    const tMAPS_PROTO_CORPUS_CONFIG *config;
+    tMAPS_PROTO_CORPUS_FUNC callback;
+    void *user;
+    tMAPS_PROTO_CORPUS_STATS stats;
+}tMAPS_PROTO_CORPUS_STATE;
+
+/**
+ *
+ * @struct tMAPS_PROTO_CORPUS_OUTPUT
+ * @brief  The destination of MapsProtoCorpusBuffer and MapsProtoCorpusFile.
+ *
+ */
+typedef struct
+{
+    FILE *file;           ///< The capture file or NULL for the buffer.
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    int error;            ///< The errno value when the frame can't be written.
+}tMAPS_PROTO_CORPUS_OUTPUT;
+//-----------------------------------------------------------------------------
+
+static uint64_t MapsProtoCorpusRandom     (tMAPS_PROTO_CORPUS_STATE *state);
+static uint32_t MapsProtoCorpusRange      (tMAPS_PROTO_CORPUS_STATE *state, uint32_t min, uint32_t max);
+static void     MapsProtoCorpusHex        (tMAPS_PROTO_CORPUS_STATE *state, char *hex, uint8_t size, uint8_t good);
+static uint8_t  MapsProtoCorpusNum        (tMAPS_PROTO_CORPUS_STATE *state);
+static void     MapsProtoCorpusCorrupt    (tMAPS_PROTO_CORPUS_STATE *state, tMAPS_PROTO_RAW_FRAME *frame);
+static int      MapsProtoCorpusEmit       (tMAPS_PROTO_CORPUS_STATE *state, uint8_t kind, tMAPS_PROTO_RAW_FRAME *frame);
+static int      MapsProtoCorpusPoll       (tMAPS_PROTO_CORPUS_STATE *state);
+static int      MapsProtoCorpusVehicle    (tMAPS_PROTO_CORPUS_STATE *state);
+static int      MapsProtoCorpusScanner    (tMAPS_PROTO_CORPUS_STATE *state);
+static int      MapsProtoCorpusFailure    (tMAPS_PROTO_CORPUS_STATE *state);
+static int      MapsProtoCorpusNotExecuted(tMAPS_PROTO_CORPUS_STATE *state);
+static int      MapsProtoCorpusWrite      (const uint8_t *frame, uint16_t size, uint8_t kind, uint8_t corrupted, void *user);
+//-----------------------------------------------------------------------------
+
+static const char *corpus_hex      = "0123456789ABCDEF";
+static const char *corpus_tow      = "0RMNET";
+static const char *corpus_empty[3] = { "MV", "SM", "PR" };
+static const char *corpus_ne[9]    = { "DE", "EA", "TT", "SM", "SR", "PR", "ER", "RH", "XX" };
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+uint64_t MapsProtoCorpusRandom(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    state->random ^= state->random >> 12;
+    state->random ^= state->random << 25;
+    state->random ^= state->random >> 27;
+
+    return state->random * 0x2545F4914F6CDD1DULL;
+}
+//-----------------------------------------------------------------------------
+
+uint32_t MapsProtoCorpusRange(tMAPS_PROTO_CORPUS_STATE *state, uint32_t min, uint32_t max)
+{
+    uint64_t range = (uint64_t) max - min + 1;
+
+    return min + (uint32_t)(((MapsProtoCorpusRandom(state) >> 32) * range) >> 32);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoCorpusHex(tMAPS_PROTO_CORPUS_STATE *state, char *hex, uint8_t size, uint8_t good)
+{
+    for (uint8_t i = 0; i < size; i++)
+         hex[i] = (MapsProtoCorpusRange(state,0,99) < 90) ? corpus_hex[good] : corpus_hex[MapsProtoCorpusRange(state,0,15)];
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoCorpusNum(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    uint8_t num = state->num;
+
+    state->num = (num + 1) % 10;
+    return num;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoCorpusCorrupt(tMAPS_PROTO_CORPUS_STATE *state, tMAPS_PROTO_RAW_FRAME *frame)
+{
+    if (frame->size > 2 && MapsProtoCorpusRange(state,0,3))
+    {
+        // Any bit between the number and the LRC breaks the LRC
+        if (frame->data[0] == K_MAPS_PROTO_CORPUS_SOH)
+            frame->data[MapsProtoCorpusRange(state,1,frame->size-2)] ^= 1 << MapsProtoCorpusRange(state,0,7);
+        else // The only unframed message generated is the SC SPECIAL (D & H). Its digits are not validated
+            frame->data[K_MAPS_PROTO_DEHI_BUFFER] = 'G' + MapsProtoCorpusRange(state,0,19);
+    }
+    else // The <CR> is lost. Without it the SC SPECIAL H is a SC SPECIAL D
+        frame->size = MapsProtoCorpusRange(state,1,(frame->data[0] == K_MAPS_PROTO_CORPUS_SOH) ? frame->size-1 : K_MAPS_PROTO_DEHI_BUFFER);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusEmit(tMAPS_PROTO_CORPUS_STATE *state, uint8_t kind, tMAPS_PROTO_RAW_FRAME *frame)
+{
+    int rc = 0;
+    uint8_t corrupted = 0;
+
+    if (frame == NULL)
+        return -1;
+
+    if (state->left == 0)
+    {
+        MapsProtoFreeRawFrame(frame);
+        return 1;
+    }
+
+    if (state->config->corrupt_permille && MapsProtoCorpusRange(state,0,999) < state->config->corrupt_permille)
+    {
+        MapsProtoCorpusCorrupt(state,frame);
+        state->stats.corrupted++;
+        corrupted = 1;
+    }
+
+    state->left--;
+    state->stats.frames[kind]++;
+    state->stats.bytes += frame->size;
+
+    if (state->callback(frame->data,frame->size,kind,corrupted,state->user))
+    {
+        errno = ECANCELED;
+        rc = -1;
+    }
+
+    MapsProtoFreeRawFrame(frame);
+    return rc;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusPoll(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    uint32_t type = MapsProtoCorpusRange(state,0,99);
+    tMAPS_PROTO_RAW_FRAME *frame;
+
+    if (type < 40)
+    {
+        tMAPS_PROTO_DE_DATA de;
+
+        de.work_mode      = (MapsProtoCorpusRange(state,0,9) < 8) ? 2 : MapsProtoCorpusRange(state,0,3);
+        de.axis_ispeed    = MapsProtoCorpusRange(state,0,15);
+        de.axis_height    = MapsProtoCorpusRange(state,0,2);
+        de.tow_detection  = corpus_tow[MapsProtoCorpusRange(state,0,5)];
+        de.hw_failure     = (MapsProtoCorpusRange(state,0,9) < 8) ? 1 : MapsProtoCorpusRange(state,2,3);
+        de.se_cleaning    = MapsProtoCorpusRange(state,1,2);
+        de.firmware_ver   = MapsProtoCorpusRange(state,10,40);
+        de.rcvr_direction = (MapsProtoCorpusRange(state,0,1)) ? 'P' : 'N';
+        de.barrier_model  = 4;
+
+        frame = MapsProtoCreateDEResponse(MapsProtoCorpusNum(state),&de);
+    }
+    else if (type < 60)
+    {
+        tMAPS_PROTO_EA_DATA ea;
+
+        ea.imax_height = MapsProtoCorpusRange(state,0,45);
+        ea.umax_height = MapsProtoCorpusRange(state,10,45);
+        ea.umin_height = MapsProtoCorpusRange(state,5,ea.umax_height);
+        ea.lmax_height = MapsProtoCorpusRange(state,10,60);
+
+        frame = MapsProtoCreateEAResponse(MapsProtoCorpusNum(state),&ea);
+    }
+    else if (type < 70)
+    {
+        tMAPS_PROTO_TT_DATA tt = { .mvar = 'M', .rvar = 'R', };
+
+        MapsProtoCorpusHex(state,tt.e_map,K_MAPS_PROTO_EMITTERS_MAP_SIZE,15);
+        MapsProtoCorpusHex(state,tt.r_map,K_MAPS_PROTO_RECEIVERS_MAP_SIZE,15);
+
+        frame = MapsProtoCreateTTResponse(MapsProtoCorpusNum(state),&tt);
+    }
+    else
+        frame = MapsProtoCreateEmptyResponse(MapsProtoCorpusNum(state),corpus_empty[MapsProtoCorpusRange(state,0,2)]);
+
+    return MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_POLL,frame);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusVehicle(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    int rc;
+    uint8_t axes, speed;
+    tMAPS_PROTO_AP_DATA ap = { 0 };
+    tMAPS_PROTO_EJ_DATA ej = { 0 };
+    tMAPS_PROTO_END_VEHICLE fa = { 0 };
+
+    // Most of the vehicles have 2 axles
+    axes  = (MapsProtoCorpusRange(state,0,9) < 7) ? 2 : MapsProtoCorpusRange(state,2,state->config->max_axes);
+    speed = MapsProtoCorpusRange(state,5,60);
+    ap.vheight = MapsProtoCorpusRange(state,10,40);
+
+    if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_VEHICLE,MapsProtoCreateEmptyRequest(MapsProtoCorpusNum(state),"IP"))))
+        return rc;
+    if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_VEHICLE,MapsProtoCreateAPRequest(MapsProtoCorpusNum(state),&ap))))
+        return rc;
+
+    for (uint8_t i = 1; i <= axes; i++)
+    {
+        ej.paxes  = i;
+        ej.ispeed = speed + MapsProtoCorpusRange(state,0,6) - 3;
+
+        if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_VEHICLE,MapsProtoCreateEJRequest(MapsProtoCorpusNum(state),&ej))))
+            return rc;
+    }
+
+    fa.smb   = 1;
+    fa.paxes = axes;
+
+    if (axes == 2 && ap.vheight < 13 && MapsProtoCorpusRange(state,0,9) == 0)
+        fa.vclass = 'M';
+    else if (ap.vheight < 15)
+        fa.vclass = (axes == 2) ? 'A' : (MapsProtoCorpusRange(state,0,1)) ? 'B' : 'C';
+    else
+        fa.vclass = (axes == 2) ? 'D' : (axes == 3) ? 'E' : 'F';
+
+    if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_VEHICLE,MapsProtoCreateEndVehicleRequest(MapsProtoCorpusNum(state),0,&fa))))
+        return rc;
+
+    return MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_VEHICLE,MapsProtoCreateEmptyRequest(MapsProtoCorpusNum(state),"FP"));
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusScanner(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    int rc;
+    uint8_t height;
+    uint32_t frames = MapsProtoCorpusRange(state,1,state->config->max_scanner);
+    tMAPS_PROTO_SC_SPECIAL sc;
+
+    switch (MapsProtoCorpusRange(state,0,3))
+    {
+        case 0:
+                sc.mode = 'A';
+        break;
+        case 1:
+                sc.mode = 'H';
+        break;
+        default:
+                sc.mode = 'D';
+        break;
+    }
+
+    // The hidden sensors from the bottom follow the shape of a vehicle
+    height = MapsProtoCorpusRange(state,2,8);
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        if (MapsProtoCorpusRange(state,0,3) == 0)
+            height = (height > 1 && MapsProtoCorpusRange(state,0,1)) ? height - 1 : (height < 11) ? height + 1 : height;
+
+        if (sc.mode == 'A')
+        {
+            sc.MODES.ABCMODES.presence   = 1;
+            sc.MODES.ABCMODES.sweeps_num = MapsProtoCorpusRange(state,0,9);
+
+            for (uint8_t j = 0; j < K_MAPS_PROTO_SENSORS_MAP; j++)
+                 sc.MODES.ABCMODES.sensors[j] = (j * 2 < height) ? 'F' : '0';
+        }
+        else
+        {
+            for (uint8_t j = 0; j < K_MAPS_PROTO_DEHI_BUFFER; j++)
+                 sc.MODES.DEHI_MODES[j] = (K_MAPS_PROTO_DEHI_BUFFER - j <= height) ? 'F' : '0';
+
+            sc.MODES.DEHI_MODES[K_MAPS_PROTO_DEHI_BUFFER - height - 1] = corpus_hex[MapsProtoCorpusRange(state,0,15)];
+        }
+
+        if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_SCANNER,MapsProtoCreateSCSpecialRequest(MapsProtoCorpusNum(state),&sc))))
+            return rc;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusFailure(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    int rc;
+    uint8_t failures = MapsProtoCorpusRange(state,1,state->config->max_failures);
+    tMAPS_PROTO_EM_DATA em;
+    tMAPS_PROTO_FAILURE_DATA sensors[K_MAPS_PROTO_CORPUS_MAX_FAILURES];
+
+    em.work_mode      = 2;
+    em.axis_ispeed    = MapsProtoCorpusRange(state,0,15);
+    em.axis_height    = MapsProtoCorpusRange(state,0,2);
+    em.tow_detection  = '0';
+    em.hw_failure     = MapsProtoCorpusRange(state,2,3);
+    em.se_cleaning    = MapsProtoCorpusRange(state,1,2);
+    em.firmware_ver   = MapsProtoCorpusRange(state,10,40);
+    em.rcvr_direction = (MapsProtoCorpusRange(state,0,1)) ? 'P' : 0;
+    em.reserved       = 0;
+
+    if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_FAILURE,MapsProtoCreateEMRequest(MapsProtoCorpusNum(state),&em))))
+        return rc;
+
+    for (uint8_t i = 0; i < failures; i++)
+    {
+        sensors[i].type    = (MapsProtoCorpusRange(state,0,1)) ? 'R' : 'E';
+        sensors[i].ngroup  = MapsProtoCorpusRange(state,1,8);
+        sensors[i].nsensor = MapsProtoCorpusRange(state,1,(sensors[i].type == 'R') ? 4 : 8);
+
+        if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_FAILURE,MapsProtoCreateFailureRequest(MapsProtoCorpusNum(state),0,&sensors[i]))))
+            return rc;
+    }
+
+    for (uint8_t i = 0; i < failures; i++)
+         if ((rc = MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_FAILURE,MapsProtoCreateFailureRequest(MapsProtoCorpusNum(state),1,&sensors[i]))))
+             return rc;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusNotExecuted(tMAPS_PROTO_CORPUS_STATE *state)
+{
+    const char *cmd = corpus_ne[MapsProtoCorpusRange(state,0,8)];
+
+    return MapsProtoCorpusEmit(state,K_MAPS_PROTO_CORPUS_NE,MapsProtoCreateUnknownResponse(MapsProtoCorpusNum(state),cmd));
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusWrite(const uint8_t *frame, uint16_t size, uint8_t kind, uint8_t corrupted, void *user)
+{
+    tMAPS_PROTO_CORPUS_OUTPUT *output = (tMAPS_PROTO_CORPUS_OUTPUT *) user;
+
+    (void) kind;
+    (void) corrupted;
+
+    if (output->file)
+    {
+        if (fwrite(frame,1,size,output->file) != size)
+        {
+            output->error = errno;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (output->size + size > output->capacity)
+    {
+        size_t capacity = (output->capacity) ? output->capacity * 2 : K_MAPS_PROTO_CORPUS_BUFFER_SIZE;
+        uint8_t *data = (uint8_t *)realloc(output->data,capacity);
+
+        if (data == NULL)
+        {
+            output->error = ENOMEM;
+            return 1;
+        }
+
+        output->data = data;
+        output->capacity = capacity;
+    }
+
+    memcpy(&output->data[output->size],frame,size);
+    output->size += size;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+void MapsProtoCorpusDefaults(tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t seed)
+{
+    if (config == NULL)
+        return;
+
+    config->seed = seed;
+    config->weights[K_MAPS_PROTO_CORPUS_POLL]    = 50;
+    config->weights[K_MAPS_PROTO_CORPUS_VEHICLE] = 25;
+    config->weights[K_MAPS_PROTO_CORPUS_SCANNER] = 10;
+    config->weights[K_MAPS_PROTO_CORPUS_FAILURE] = 5;
+    config->weights[K_MAPS_PROTO_CORPUS_NE]      = 10;
+    config->corrupt_permille = 10;
+    config->max_axes     = 5;
+    config->max_scanner  = 40;
+    config->max_failures = 4;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusGenerate(const tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t frames,
+                            tMAPS_PROTO_CORPUS_FUNC callback, void *user, tMAPS_PROTO_CORPUS_STATS *stats)
+{
+    int rc = 0;
+    uint32_t total = 0, event;
+    uint64_t seed;
+    tMAPS_PROTO_CORPUS_STATE state;
+
+    if (!config || !callback)
+        corpus_error(EINVAL);
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CORPUS_KINDS; i++)
+         total += config->weights[i];
+
+    if (!total || config->corrupt_permille > 1000 || config->max_axes < 2 || config->max_axes > 99 ||
+        !config->max_scanner || !config->max_failures || config->max_failures > K_MAPS_PROTO_CORPUS_MAX_FAILURES)
+        corpus_error(EINVAL);
+
+    memset(&state,0,sizeof(tMAPS_PROTO_CORPUS_STATE));
+
+    // splitmix64 of the seed. xorshift can't start with 0
+    seed  = config->seed + 0x9E3779B97F4A7C15ULL;
+    seed  = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed  = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    seed ^= seed >> 31;
+
+    state.random   = (seed) ? seed : 0x9E3779B97F4A7C15ULL;
+    state.left     = frames;
+    state.config   = config;
+    state.callback = callback;
+    state.user     = user;
+
+    while (state.left && !rc)
+    {
+        uint8_t kind = 0;
+
+        event = MapsProtoCorpusRange(&state,0,total-1);
+
+        while (event >= config->weights[kind])
+               event -= config->weights[kind++];
+
+        state.stats.events[kind]++;
+
+        switch (kind)
+        {
+            case K_MAPS_PROTO_CORPUS_POLL:
+                    rc = MapsProtoCorpusPoll(&state);
+            break;
+            case K_MAPS_PROTO_CORPUS_VEHICLE:
+                    rc = MapsProtoCorpusVehicle(&state);
+            break;
+            case K_MAPS_PROTO_CORPUS_SCANNER:
+                    rc = MapsProtoCorpusScanner(&state);
+            break;
+            case K_MAPS_PROTO_CORPUS_FAILURE:
+                    rc = MapsProtoCorpusFailure(&state);
+            break;
+            default:
+                    rc = MapsProtoCorpusNotExecuted(&state);
+            break;
+        }
+    }
+
+    if (stats)
+        memcpy(stats,&state.stats,sizeof(tMAPS_PROTO_CORPUS_STATS));
+
+    return (rc < 0) ? -1 : 0;
+}
+//-----------------------------------------------------------------------------
+
+uint8_t * MapsProtoCorpusBuffer(const tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t frames, size_t *size, tMAPS_PROTO_CORPUS_STATS *stats)
+{
+    tMAPS_PROTO_CORPUS_OUTPUT output;
+
+    if (!size)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    memset(&output,0,sizeof(tMAPS_PROTO_CORPUS_OUTPUT));
+
+    if (MapsProtoCorpusGenerate(config,frames,MapsProtoCorpusWrite,&output,stats))
+    {
+        if (output.error)
+            errno = output.error;
+
+        free(output.data);
+        return NULL;
+    }
+
+    // An empty corpus is a valid buffer too
+    if (output.data == NULL && (output.data = (uint8_t *)malloc(1)) == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *size = output.size;
+    return output.data;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoCorpusFile(const char *path, const tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t frames, tMAPS_PROTO_CORPUS_STATS *stats)
+{
+    int rc;
+    tMAPS_PROTO_CORPUS_OUTPUT output;
+
+    if (!path)
+        corpus_error(EINVAL);
+
+    memset(&output,0,sizeof(tMAPS_PROTO_CORPUS_OUTPUT));
+
+    if ((output.file = fopen(path,"wb")) == NULL)
+        return -1;
+
+    rc = MapsProtoCorpusGenerate(config,frames,MapsProtoCorpusWrite,&output,stats);
+
+    if (rc && output.error)
+        errno = output.error;
+
+    if (fclose(output.file) && !rc)
+        rc = -1;
+
+    return rc;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,130 @@
+#ifndef MAPS_CORPUS_H
+#define MAPS_CORPUS_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_corpus.h
+ *  @brief Function prototypes for generate synthetic captures of a serial
+ *         line with the MapsProtoCreate* functions.
+ *
+ *  A corpus is a sequence of events. The kind of each event is selected
+ *  with the weights of the config and each event writes one or more frames:
+ *
+ *      POLL:     A response to a poll. DE, EA, TT or an empty RS (MV, SM, PR).
+ *      VEHICLE:  A vehicle. IP, AP, one EJ by axle, FA SPONTANEOUS and FP.
+ *      SCANNER:  A flood of SC SPECIAL frames. Modes D and H (unframed) or A.
+ *      FAILURE:  A failure burst. EM, FX of some sensors and PX of the same sensors.
+ *      NE:       A not executed response.
+ *
+ *  Each frame is corrupted with the probability of corrupt_permille: a bit
+ *  of a framed message is flipped (the LRC is not valid), the <CR> of an
+ *  unframed message is changed by a non hex char or the end of the frame
+ *  is truncated. The parse functions reject all the corrupted frames.
+ *
+ *  The generator only uses its own pseudo random generator, so the same
+ *  config (seed included) and number of frames always generates the same
+ *  bytes in any host. Use it for measure the parsers with the same
+ *  workload.
+ */
+
+#include <stddef.h>
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_CORPUS_POLL     0   ///< Poll responses.
+#define K_MAPS_PROTO_CORPUS_VEHICLE  1   ///< Vehicle sequences.
+#define K_MAPS_PROTO_CORPUS_SCANNER  2   ///< Scanner floods.
+#define K_MAPS_PROTO_CORPUS_FAILURE  3   ///< Failure bursts.
+#define K_MAPS_PROTO_CORPUS_NE       4   ///< Not executed responses.
+#define K_MAPS_PROTO_CORPUS_KINDS    5   ///< Number of kinds of events.
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_CORPUS_CONFIG
+ * @brief  The mix of a corpus. Use MapsProtoCorpusDefaults for the default values.
+ *
+ */
+typedef struct
+{
+    uint64_t seed;                                    ///< The seed. The same seed generates the same corpus.
+    uint16_t weights[K_MAPS_PROTO_CORPUS_KINDS];      ///< The weight of each kind of event. 0 disables the kind. By K_MAPS_PROTO_CORPUS_*.
+    uint16_t corrupt_permille;                        ///< Corrupted frames by each 1000 frames. Range 0 to 1000.
+    uint8_t max_axes;                                 ///< The biggest number of axles of a vehicle. Range 2 to 99.
+    uint8_t max_scanner;                              ///< The biggest number of frames of a scanner flood. Range 1 to 255.
+    uint8_t max_failures;                             ///< The biggest number of failed sensors of a failure burst. Range 1 to 64.
+}tMAPS_PROTO_CORPUS_CONFIG;
+
+/**
+ *
+ * @struct tMAPS_PROTO_CORPUS_STATS
+ * @brief  The content of a corpus.
+ *
+ */
+typedef struct
+{
+    uint64_t events[K_MAPS_PROTO_CORPUS_KINDS];       ///< Events by K_MAPS_PROTO_CORPUS_*.
+    uint64_t frames[K_MAPS_PROTO_CORPUS_KINDS];       ///< Frames by K_MAPS_PROTO_CORPUS_*. Includes the corrupted frames.
+    uint64_t corrupted;                               ///< Corrupted frames.
+    uint64_t bytes;                                   ///< The size of the corpus.
+}tMAPS_PROTO_CORPUS_STATS;
+
+/**
+ * The callback for each frame. Must return 0 to continue or other value to stop.
+ * The frame is freed after the callback.
+ */
+typedef int (*tMAPS_PROTO_CORPUS_FUNC)(const uint8_t *frame, uint16_t size, uint8_t kind, uint8_t corrupted, void *user);
+
+/** @brief Set the default mix of events. 50% poll, 25% vehicle, 10% scanner, 5% failure,
+ *         10% NE and 1% of corrupted frames.
+ *
+ * @param  config The config to set.
+ * @param  seed   The seed.
+ */
+void MapsProtoCorpusDefaults(tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t seed);
+
+/** @brief Generate the frames of a corpus.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The config or callback params are NULL, the config is out of range or all the weights are 0.
+ *      ENOMEM: Couldn't allocate memory
+ *      ECANCELED: The callback returned a value different of 0.
+ *
+ * @param  config   The mix of the corpus.
+ * @param  frames   The number of frames to generate. The last event can be incomplete.
+ * @param  callback The function called for each frame.
+ * @param  user     The user param of the callback.
+ * @param  stats    If is not NULL, the content of the corpus is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoCorpusGenerate(const tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t frames,
+                            tMAPS_PROTO_CORPUS_FUNC callback, void *user, tMAPS_PROTO_CORPUS_STATS *stats);
+
+/** @brief Generate a corpus in a new allocated buffer. The buffer must be freed with free.
+ *
+ *  The errno values are the same as MapsProtoCorpusGenerate.
+ *
+ * @param  config The mix of the corpus.
+ * @param  frames The number of frames to generate.
+ * @param  size   Where the size of the buffer is stored.
+ * @param  stats  If is not NULL, the content of the corpus is stored.
+ * @return NULL on error and errno is set or on success the buffer with the corpus.
+ */
+uint8_t * MapsProtoCorpusBuffer(const tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t frames, size_t *size, tMAPS_PROTO_CORPUS_STATS *stats);
+
+/** @brief Generate a corpus in a capture file. The file can be read with MapsProtoReparseFile.
+ *
+ *  The errno values are the same as MapsProtoCorpusGenerate or any errno
+ *  value of fopen or fwrite.
+ *
+ * @param  path   The path of the capture file. Is truncated if exists.
+ * @param  config The mix of the corpus.
+ * @param  frames The number of frames to generate.
+ * @param  stats  If is not NULL, the content of the corpus is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoCorpusFile(const char *path, const tMAPS_PROTO_CORPUS_CONFIG *config, uint64_t frames, tMAPS_PROTO_CORPUS_STATS *stats);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,149 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "maps_corpus.h"
+//-----------------------------------------------------------------------------
+
+/** @file maps_corpus_tool.c
+ *  @brief Generate a synthetic capture of a serial line (see maps_corpus.h).
+ *         The capture can be parsed with maps_reparse.
+ *
+ *  Usage: maps_corpus [-s seed] [-n frames] [-m poll,vehicle,scanner,failure,ne] [-c permille]
+ *                     [-a max_axes] [-f max_scanner] [-x max_failures] capture_file
+ *
+ *      -s: The seed. By default 1.
+ *      -n: Frames to generate. By default 1000000.
+ *      -m: The weights of the events. By default 50,25,10,5,10.
+ *      -c: Corrupted frames by each 1000 frames. Range 0 to 1000. By default 10.
+ *      -a: The biggest number of axles of a vehicle. Range 2 to 99. By default 5.
+ *      -f: The biggest number of frames of a scanner flood. Range 1 to 255. By default 40.
+ *      -x: The biggest number of failed sensors of a failure burst. Range 1 to 64. By default 4.
+ *
+ *  The statistics of the capture are written to the standard error. An option
+ *  out of its range is a usage error.
+ */
+//-----------------------------------------------------------------------------
+
+#define USAGE "Usage: %s [-s seed] [-n frames] [-m poll,vehicle,scanner,failure,ne] [-c permille]\n" \
+              "       [-a max_axes] [-f max_scanner] [-x max_failures] capture_file\n"
+//-----------------------------------------------------------------------------
+
+static int MapsCorpusToolRange(const char *arg, unsigned long min, unsigned long max, unsigned long *value);
+//-----------------------------------------------------------------------------
+
+/** @brief Parse a numeric option checking its range.
+ *
+ *  @param  arg   The option argument.
+ *  @param  min   The smallest accepted value.
+ *  @param  max   The biggest accepted value.
+ *  @param  value The parsed value.
+ *  @return 0 if the argument is a number between min and max, otherwise -1.
+ */
+static int MapsCorpusToolRange(const char *arg, unsigned long min, unsigned long max, unsigned long *value)
+{
+    char *end;
+
+    errno = 0;
+    *value = strtoul(arg,&end,0);
+
+    if (errno || end == arg || *end || *arg == '-' || *value < min || *value > max)
+        return -1;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    unsigned long value;
+    uint64_t frames = 1000000;
+    tMAPS_PROTO_CORPUS_CONFIG config;
+    tMAPS_PROTO_CORPUS_STATS stats;
+
+    MapsProtoCorpusDefaults(&config,1);
+
+    while ((opt = getopt(argc,argv,"s:n:m:c:a:f:x:")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                    config.seed = strtoull(optarg,NULL,0);
+            break;
+            case 'n':
+                    frames = strtoull(optarg,NULL,0);
+            break;
+            case 'm':
+                    if (sscanf(optarg,"%hu,%hu,%hu,%hu,%hu",&config.weights[K_MAPS_PROTO_CORPUS_POLL],&config.weights[K_MAPS_PROTO_CORPUS_VEHICLE],
+                               &config.weights[K_MAPS_PROTO_CORPUS_SCANNER],&config.weights[K_MAPS_PROTO_CORPUS_FAILURE],
+                               &config.weights[K_MAPS_PROTO_CORPUS_NE]) != K_MAPS_PROTO_CORPUS_KINDS)
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+            break;
+            case 'c':
+                    if (MapsCorpusToolRange(optarg,0,1000,&value))
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+                    config.corrupt_permille = value;
+            break;
+            case 'a':
+                    if (MapsCorpusToolRange(optarg,2,99,&value))
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+                    config.max_axes = value;
+            break;
+            case 'f':
+                    if (MapsCorpusToolRange(optarg,1,255,&value))
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+                    config.max_scanner = value;
+            break;
+            case 'x':
+                    if (MapsCorpusToolRange(optarg,1,64,&value))
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+                    config.max_failures = value;
+            break;
+            default:
+                    fprintf(stderr,USAGE,argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        fprintf(stderr,USAGE,argv[0]);
+        return 1;
+    }
+
+    if (MapsProtoCorpusFile(argv[optind],&config,frames,&stats))
+    {
+        fprintf(stderr,"Error generating %s: %s\n",argv[optind],strerror(errno));
+        return 1;
+    }
+
+    fprintf(stderr,"seed: %llu bytes: %llu corrupted: %llu\n",(unsigned long long) config.seed,
+            (unsigned long long) stats.bytes,(unsigned long long) stats.corrupted);
+    fprintf(stderr,"poll: %llu/%llu vehicle: %llu/%llu scanner: %llu/%llu failure: %llu/%llu ne: %llu/%llu (events/frames)\n",
+            (unsigned long long) stats.events[K_MAPS_PROTO_CORPUS_POLL],   (unsigned long long) stats.frames[K_MAPS_PROTO_CORPUS_POLL],
+            (unsigned long long) stats.events[K_MAPS_PROTO_CORPUS_VEHICLE],(unsigned long long) stats.frames[K_MAPS_PROTO_CORPUS_VEHICLE],
+            (unsigned long long) stats.events[K_MAPS_PROTO_CORPUS_SCANNER],(unsigned long long) stats.frames[K_MAPS_PROTO_CORPUS_SCANNER],
+            (unsigned long long) stats.events[K_MAPS_PROTO_CORPUS_FAILURE],(unsigned long long) stats.frames[K_MAPS_PROTO_CORPUS_FAILURE],
+            (unsigned long long) stats.events[K_MAPS_PROTO_CORPUS_NE],     (unsigned long long) stats.frames[K_MAPS_PROTO_CORPUS_NE]);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+
+#include "maps_proto.hpp"
+#include "maps_build.hpp"
+#include "maps_client.hpp"
+//-----------------------------------------------------------------------------
+
+extern "C" void CppTests()
+{
+    maps::message msg;
+    tMAPS_PROTO_RAW_FRAME *frame;
+
+    printf("\n#### C++ MESSAGE TESTS ####\n");
+
+    if (maps::commands_match_library() && maps::find_cmd("FAS") == K_MAPS_PROTO_CMD_FAS && maps::find_cmd("XX") == K_MAPS_PROTO_CMD_UNKNOWN)
+        printf("C++ COMMANDS TABLE test PASSED\n");
+    else
+        printf("C++ COMMANDS TABLE test FAILED\n");
+
+    frame = MapsProtoCreateEJRequest(3,(tMAPS_PROTO_EJ_DATA *)"\x09\x03\x58");
+
+    if (frame && !maps::parse(frame->data,frame->size,msg) && maps::id_of(msg) == K_MAPS_PROTO_CMD_EJ && maps::type_of(msg) == 0 &&
+        std::visit(maps::overloaded {
+            [](const maps::request<K_MAPS_PROTO_CMD_EJ> &ej) { return ej.num == 3 && ej.data.paxes == 9 && ej.data.naxes == 3 && ej.data.ispeed == 88; },
+            [](const auto &) { return false; }
+        },msg))
+        printf("C++ PARSE REQUEST test PASSED\n");
+    else
+        printf("C++ PARSE REQUEST test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+    frame = MapsProtoCreateDEResponse(2,(tMAPS_PROTO_DE_DATA*)"\x02\x0B\x01\x00\x01\x02\x0B\x50\x03");
+
+    if (frame && !maps::parse(frame->data,frame->size,msg) && maps::type_of(msg) == 1 &&
+        std::get<maps::response<K_MAPS_PROTO_CMD_DE>>(msg).data.axis_ispeed == 11)
+        printf("C++ PARSE RESPONSE test PASSED\n");
+    else
+        printf("C++ PARSE RESPONSE test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+    frame = MapsProtoCreateEmptyRequest(1,"RE");
+
+    if (frame && !maps::parse(frame->data,frame->size,msg) && !std::get<maps::request<K_MAPS_PROTO_CMD_RE>>(msg).data.has_value())
+        printf("C++ PARSE EMPTY DATA test PASSED\n");
+    else
+        printf("C++ PARSE EMPTY DATA test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+    frame = MapsProtoCreateUnknownResponse(4,"XX");
+
+    if (frame && !maps::parse(frame->data,frame->size,msg) && maps::type_of(msg) == 2 && maps::id_of(msg) == K_MAPS_PROTO_CMD_UNKNOWN &&
+        (frame->data[5] ^= 1, maps::parse(frame->data,frame->size,msg) == ERANGE) && maps::type_of(msg) == 2)
+        printf("C++ PARSE NE & ERRORS test PASSED\n");
+    else
+        printf("C++ PARSE NE & ERRORS test FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+// The frames built at compile time must be the same as the frames of the C functions
+template <std::size_t N>
+static bool same_frame(const maps::fixed_frame<N> &fixed, tMAPS_PROTO_RAW_FRAME *frame)
+{
+    bool same = frame && frame->size == fixed.size() && !memcmp(frame->data,fixed.data(),N);
+
+    MapsProtoFreeRawFrame(frame);
+    return same;
+}
+//-----------------------------------------------------------------------------
+
+extern "C" void CppBuildTests()
+{
+    static constexpr auto de = maps::empty_request<3,"DE">();
+    static constexpr auto sm = maps::sm_request<2,2,1,2,'0','P'>();
+    tMAPS_PROTO_SM_DATA smdata = { 2, 1, 2, '0', 'P' };
+
+    static_assert(de.size() == 7 && de.bytes[1] == '3' && de.bytes[6] == 0x0D);
+    static_assert(sm.size() == 12 && sm.bytes[8] == 'P');
+
+    printf("\n#### C++ BUILD TESTS ####\n");
+
+    if (same_frame(de,MapsProtoCreateEmptyRequest(3,"DE")) && same_frame(sm,MapsProtoCreateSMRequest(2,5,&smdata)) &&
+        same_frame(maps::sm_request<4,3,11,0>(),MapsProtoCreateSMRequest(4,3,(tMAPS_PROTO_SM_DATA *)"\x03\x0B\x00\x00\x00")) &&
+        same_frame(maps::br_request<0,3>(),MapsProtoCreateBRRequest(0,3)) && same_frame(maps::ca_request<1,1,2>(),MapsProtoCreateCARequest(1,1,2)) &&
+        same_frame(maps::er_request<4,23>(),MapsProtoCreateERRequest(4,23)) && same_frame(maps::pr_request<9,99>(),MapsProtoCreatePRRequest(9,99)) &&
+        same_frame(maps::sc_request<1,'H',999>(),MapsProtoCreateSCRequest(1,'H',999)) && same_frame(maps::sr_request<3,4>(),MapsProtoCreateSRRequest(3,4)) &&
+        same_frame(maps::rh_request<5,1,20>(),MapsProtoCreateRHRequest(5,1,20)) && same_frame(maps::ia_request<8,0>(),MapsProtoCreateIARequest(8,0)) &&
+        same_frame(maps::rm_request<2,9>(),MapsProtoCreateRMRequest(2,9)))
+        printf("C++ BUILD REQUESTS test PASSED\n");
+    else
+        printf("C++ BUILD REQUESTS test FAILED\n");
+
+    if (same_frame(maps::empty_response<1,"BR">(),MapsProtoCreateEmptyResponse(1,"BR")) &&
+        same_frame(maps::unknown_response<0,"XX">(),MapsProtoCreateUnknownResponse(0,"XX")) &&
+        same_frame(maps::er_response<4,1>(),MapsProtoCreateERResponse(4,1)) && same_frame(maps::cb_response<7,0>(),MapsProtoCreateCBResponse(7,0)))
+        printf("C++ BUILD RESPONSES test PASSED\n");
+    else
+        printf("C++ BUILD RESPONSES test FAILED\n");
+}
+//-----------------------------------------------------------------------------
+
+// Write a frame from the barrier side
+static void barrier_send(int fd, tMAPS_PROTO_RAW_FRAME *frame)
+{
+    if (frame && write(fd,frame->data,frame->size) != frame->size)
+        printf("C++ CLIENT WRITE FAILED\n");
+
+    MapsProtoFreeRawFrame(frame);
+}
+//-----------------------------------------------------------------------------
+
+static maps::task<void> client_lane(maps::client &barrier, int peer, int *results)
+{
+    uint8_t sent[16];
+    uint64_t start;
+    tMAPS_PROTO_EJ_DATA ej = { 2, 0, 45 };
+    tMAPS_PROTO_END_VEHICLE end = {};
+    static constexpr auto de = maps::empty_request<0,"DE">();
+
+    end.smb    = 1;
+    end.vclass = 'A';
+    end.paxes  = 2;
+
+    // The response is in the socket before the request is sent. Must be matched
+    barrier_send(peer,MapsProtoCreateDEResponse(0,(tMAPS_PROTO_DE_DATA*)"\x02\x0B\x01\x00\x01\x02\x0B\x50\x03"));
+    maps::reply r = co_await barrier.request_de(500);
+
+    results[0] = !r.error && std::get<maps::response<K_MAPS_PROTO_CMD_DE>>(r.msg).data.axis_ispeed == 11 &&
+                 read(peer,sent,sizeof(sent)) == de.size() && !memcmp(sent,de.data(),de.size());
+
+    // A vehicle and a junk byte between the frames
+    barrier_send(peer,MapsProtoCreateIARequest(1,40));
+    barrier_send(peer,MapsProtoCreateEJRequest(2,&ej));
+    results[1] = write(peer,"X",1) == 1;
+    barrier_send(peer,MapsProtoCreateEndVehicleRequest(3,0,&end));
+
+    auto vehicle = co_await barrier.next_vehicle(500);
+    results[1] &= vehicle && vehicle->lane == 7 && vehicle->paxes == 2 && vehicle->vclass == 'A' && vehicle->speed == 45 && barrier.junk() == 1;
+
+    // NE and timeout
+    barrier_send(peer,MapsProtoCreateUnknownResponse(1,"TT"));
+    r = co_await barrier.request("TT",500);
+    results[2] = !r.error && maps::type_of(r.msg) == 2 && std::get<maps::not_executed>(r.msg).id == K_MAPS_PROTO_CMD_TT;
+
+    start = maps::executor::now();
+    r = co_await barrier.request_de(50);
+    results[2] &= r.error == ETIMEDOUT && maps::executor::now() - start >= 50;
+
+    vehicle = co_await barrier.next_vehicle(10);
+    results[2] &= !vehicle;
+}
+//-----------------------------------------------------------------------------
+
+// A request to a barrier with the peer closed or without response
+static maps::task<void> client_closed(maps::client &barrier, int expected, int *result)
+{
+    maps::reply r = co_await barrier.request_de(100);
+
+    *result = (expected) ? r.error == expected : r.error != 0;
+}
+//-----------------------------------------------------------------------------
+
+extern "C" void CppClientTests()
+{
+    int fds[2], closed[2], silent[2], results[3] = { 0 }, loops = 0;
+
+    printf("\n#### C++ CLIENT TESTS ####\n");
+
+    if (socketpair(AF_UNIX,SOCK_STREAM,0,fds))
+    {
+        printf("C++ CLIENT SOCKETPAIR test FAILED\n");
+        return;
+    }
+
+    {
+        maps::executor ex;
+        maps::client barrier(ex,fds[0],7);
+
+        ex.spawn(client_lane(barrier,fds[1],results));
+
+        if (ex.run() || ex.pending())
+            results[0] = 0;
+    }
+
+    printf("C++ CLIENT REQUEST test %s\n",(results[0]) ? "PASSED" : "FAILED");
+    printf("C++ CLIENT VEHICLE test %s\n",(results[1]) ? "PASSED" : "FAILED");
+    printf("C++ CLIENT NE & TIMEOUT test %s\n",(results[2]) ? "PASSED" : "FAILED");
+
+    close(fds[0]);
+    close(fds[1]);
+
+    // The peer of a barrier is closed while other barrier waits a timeout. No SIGPIPE and the executor not spins
+    if (socketpair(AF_UNIX,SOCK_STREAM,0,closed) || socketpair(AF_UNIX,SOCK_STREAM,0,silent))
+    {
+        printf("C++ CLIENT CLOSED test FAILED\n");
+        return;
+    }
+
+    close(closed[1]);
+    results[0] = results[1] = 0;
+
+    {
+        maps::executor ex;
+        maps::client gone(ex,closed[0],1);
+        maps::client barrier(ex,silent[0],2);
+
+        ex.spawn(client_closed(gone,0,&results[0]));
+        ex.spawn(client_closed(barrier,ETIMEDOUT,&results[1]));
+
+        while (ex.pending() && loops < 1000 && !ex.run_once())
+            loops++;
+    }
+
+    printf("C++ CLIENT CLOSED test %s\n",(results[0] && results[1] && loops < 100) ? "PASSED" : "FAILED");
+
+    close(closed[0]);
+    close(silent[0]);
+    close(silent[1]);
+}
+//-----------------------------------------------------------------------------
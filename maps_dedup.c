@@ -0,0 +1,49 @@
+
+#include <errno.h>
+
+#include "maps_dedup.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_DEDUP_SOH     0x01
+#define K_MAPS_PROTO_DEDUP_BASIS   2166136261U   // FNV-1a 32 bits
+#define K_MAPS_PROTO_DEDUP_PRIME   16777619U
+
+#define dedup_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoDedupCheck(tMAPS_PROTO_DEDUP *dedup, const uint8_t *frame, uint16_t size, uint64_t timestamp, uint32_t window_ms)
+{
+    uint32_t hash = K_MAPS_PROTO_DEDUP_BASIS, now;
+
+    if (!dedup || !frame)
+        dedup_error(EINVAL);
+
+    dedup->frames++;
+
+    // SOH, number, command, data, LRC (2) and CR
+    if (!window_ms || size < 5 || frame[0] != K_MAPS_PROTO_DEDUP_SOH)
+        return 0;
+
+    for (uint16_t i = 1; i < size - 1; i++)
+         hash = (hash ^ frame[i]) * K_MAPS_PROTO_DEDUP_PRIME;
+
+    hash = (hash) ? hash : 1;
+    now  = (uint32_t) (timestamp / 1000000);  // Wraps each 49 days. The differences are right
+
+    for (uint8_t i = 0; i < K_MAPS_PROTO_DEDUP_ENTRIES; i++)
+    {
+        if (dedup->hash[i] == hash && now - dedup->time[i] < window_ms)
+        {
+            dedup->suppressed++;
+            return 1;
+        }
+    }
+
+    dedup->hash[dedup->next] = hash;
+    dedup->time[dedup->next] = now;
+    dedup->next = (dedup->next + 1) & (K_MAPS_PROTO_DEDUP_ENTRIES - 1);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#ifndef MAPS_DEDUP_H
+#define MAPS_DEDUP_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_dedup.h
+ *  @brief Function prototypes for drop the frames repeated by a lane, i.e.
+ *         the frames replayed by a gateway after a reconnect.
+ *
+ *  The fingerprint of a frame is a hash of its bytes from the number to the
+ *  LRC (number, command and data). A frame is a repeat when a frame with the
+ *  same fingerprint arrived in the previous window milliseconds. The check
+ *  is done on the raw bytes, before MapsProtoParseFrame, so the repeats are
+ *  never parsed.
+ *
+ *  The last K_MAPS_PROTO_DEDUP_ENTRIES fingerprints are kept in a ring of
+ *  two cache lines. Use a tMAPS_PROTO_DEDUP for each lane initialized with
+ *  zeros. Only the framed messages (SOH ... CR) are checked: the unframed
+ *  SC and PA special messages have no number and the same value can arrive
+ *  each few milliseconds.
+ *
+ *  A replay is dropped when it is at most K_MAPS_PROTO_DEDUP_ENTRIES frames
+ *  deep. In a deeper replay each frame evicts the fingerprint of a later
+ *  one, so nothing is dropped. The numbers cycle from 0 to 9, so the window
+ *  must be shorter than ten poll periods of the lane: a new response with
+ *  the same number, command and data inside the window is dropped too.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_DEDUP_ENTRIES  16    ///< Fingerprints kept by lane. The deepest replay dropped. Power of 2.
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_DEDUP
+ * @brief  The recent fingerprints and the counters of a lane.
+ *
+ */
+typedef struct
+{
+    _Alignas(64) uint32_t hash[K_MAPS_PROTO_DEDUP_ENTRIES];  ///< The fingerprints. 0 is an empty entry.
+    uint32_t time[K_MAPS_PROTO_DEDUP_ENTRIES];               ///< The arrival of each fingerprint in milliseconds.
+    uint64_t frames;      ///< Frames checked.
+    uint64_t suppressed;  ///< Frames dropped as repeats.
+    uint8_t next;         ///< The entry for the next fingerprint.
+}tMAPS_PROTO_DEDUP;
+
+/** @brief Check if a frame of a lane is a repeat. The new frames are added to the ring.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The dedup or frame params are NULL.
+ *
+ * @param  dedup     The fingerprints of the lane.
+ * @param  frame     The raw frame (SOH ... CR).
+ * @param  size      The size of the frame.
+ * @param  timestamp The arrival of the frame in nanoseconds (CLOCK_MONOTONIC). See maps_stamp.h.
+ * @param  window_ms The milliseconds that a fingerprint is kept. Less than ten poll periods. 0 doesn't drop any frame.
+ * @return 1 when the frame is a repeat and must be dropped, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoDedupCheck(tMAPS_PROTO_DEDUP *dedup, const uint8_t *frame, uint16_t size, uint64_t timestamp, uint32_t window_ms);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,349 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pthread_setaffinity_np & CPU_* macros
+#endif
+
+#include <stdio.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "maps_corpus.h"
+#include "maps_reparse.h"
+#include "maps_shard.h"
+//-----------------------------------------------------------------------------
+
+/** @file maps_jitter_tool.c
+ *  @brief Measure the latency from MapsProtoShardPush to the callback of the
+ *         IP and FP frames with a real time shard and background load.
+ *
+ *  Usage: maps_jitter [-n frames] [-i interval_us] [-p priority] [-c worker_cpu] [-P producer_cpu] [-b load_threads] [-s seed]
+ *
+ *      -n: Frames pushed. By default 100000.
+ *      -i: Microseconds between two frames. By default 100.
+ *      -p: SCHED_FIFO priority of the worker. By default 80. 0 for not use SCHED_FIFO.
+ *      -c: The core of the worker. By default the last core of the process.
+ *      -P: The core of the producer. By default the first core of the process.
+ *      -b: Threads of background load (CPU, memory and system calls). By default one by core.
+ *      -s: The seed of the vehicles. By default 1.
+ *
+ *  The frames are the vehicles of a corpus (maps_corpus.h). Each frame is
+ *  pushed alone and the producer waits its callback, so the latency is the
+ *  path of a frame: ring, decoder, parse and vehicle assembler. The result
+ *  is the minimum, the percentiles and the maximum observed latency of the
+ *  IP and FP frames (presence) and of all the frames.
+ *
+ *  The memory is locked with MapsProtoShardLockMemory. SCHED_FIFO and
+ *  mlockall need CAP_SYS_NICE and CAP_IPC_LOCK (or the rlimits). Without
+ *  them the tool continues and prints a warning. For the real results use
+ *  two cores isolated from the load (i.e. isolcpus) for -c and -P.
+ */
+//-----------------------------------------------------------------------------
+
+#define BUCKETS      10000          // Histogram of 1 us buckets. The last is 10 ms or more
+#define TIMEOUT_NS   1000000000ULL  // A frame without callback in 1 s is lost
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[BUCKETS];
+}tJITTER_HISTOGRAM;
+//-----------------------------------------------------------------------------
+
+static _Atomic uint64_t arrived;     // The callbacks
+static _Atomic uint64_t arrived_ns;  // When was the last callback
+static _Atomic uint8_t presence;     // 1 when the last frame was an IP or FP
+static _Atomic uint8_t stop;
+
+// Preallocated. Nothing is allocated while the frames are measured
+static tJITTER_HISTOGRAM hpresence = { 0, UINT64_MAX, 0, { 0 } };
+static tJITTER_HISTOGRAM hall      = { 0, UINT64_MAX, 0, { 0 } };
+//-----------------------------------------------------------------------------
+
+uint64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+//-----------------------------------------------------------------------------
+
+void pin(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu,&set);
+    pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+}
+//-----------------------------------------------------------------------------
+
+void on_frame(uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_VEHICLE *vehicle, void *user)
+{
+    (void) lane;
+    (void) vehicle;
+    (void) user;
+
+    atomic_store_explicit(&arrived_ns,now_ns(),memory_order_relaxed);
+    atomic_store_explicit(&presence,(parsed->cmd[0] == 'I' || parsed->cmd[0] == 'F') && parsed->cmd[1] == 'P' && !parsed->cmd[2],
+                          memory_order_relaxed);
+    atomic_fetch_add_explicit(&arrived,1,memory_order_release);
+}
+//-----------------------------------------------------------------------------
+
+void * load_thread(void *param)
+{
+    int fd = open("/dev/null",O_WRONLY);
+    uint64_t x = (uintptr_t) param * 0x9E3779B97F4A7C15ULL + 1;
+    size_t size;
+    char *p;
+
+    while (!atomic_load_explicit(&stop,memory_order_relaxed))
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        size = 4096 + x % 0x100000;
+
+        if ((p = (char *)malloc(size)) != NULL)
+        {
+            memset(p,(int) x,size);
+
+            if (fd >= 0 && write(fd,p,4096) < 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+
+            free(p);
+        }
+    }
+
+    if (fd >= 0)
+        close(fd);
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+void record(tJITTER_HISTOGRAM *histogram, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+
+    histogram->count++;
+    histogram->min = (ns < histogram->min) ? ns : histogram->min;
+    histogram->max = (ns > histogram->max) ? ns : histogram->max;
+    histogram->buckets[(us < BUCKETS) ? us : BUCKETS - 1]++;
+}
+//-----------------------------------------------------------------------------
+
+void report(const char *name, const tJITTER_HISTOGRAM *histogram)
+{
+    static const double quantiles[5] = { 0.5, 0.99, 0.999, 0.9999, 1 };
+    uint64_t sum = 0;
+    uint8_t q = 0;
+
+    if (!histogram->count)
+    {
+        printf("%-9s %9s\n",name,"0");
+        return;
+    }
+
+    printf("%-9s %9llu %9.1f",name,(unsigned long long) histogram->count,histogram->min / 1000.0);
+
+    for (uint32_t i = 0; i < BUCKETS && q < 4; i++)
+    {
+        sum += histogram->buckets[i];
+
+        for (; q < 4 && sum >= quantiles[q] * histogram->count; q++)
+            printf(" %s%8u",(i == BUCKETS - 1) ? ">" : " ",i + 1);
+    }
+
+    printf(" %9.1f\n",histogram->max / 1000.0);
+}
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int opt, priority = 80, worker_cpu = -1, producer_cpu = -1, loads = -1, cpus[CPU_SETSIZE], ncpus = 0;
+    uint64_t frames = 100000, interval = 100, lost = 0, expected, start, deadline;
+    size_t size, offset = 0, count = 0;
+    uint16_t length, *lengths;
+    size_t *offsets;
+    uint8_t *data;
+    cpu_set_t set;
+    pthread_t threads[CPU_SETSIZE];
+    struct sched_param param;
+    struct timespec next;
+    tMAPS_PROTO_CORPUS_CONFIG config;
+    tMAPS_PROTO_SHARD *shard;
+
+    MapsProtoCorpusDefaults(&config,1);
+
+    while ((opt = getopt(argc,argv,"n:i:p:c:P:b:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                    frames = strtoull(optarg,NULL,0);
+            break;
+            case 'i':
+                    interval = strtoull(optarg,NULL,0);
+            break;
+            case 'p':
+                    priority = atoi(optarg);
+            break;
+            case 'c':
+                    worker_cpu = atoi(optarg);
+            break;
+            case 'P':
+                    producer_cpu = atoi(optarg);
+            break;
+            case 'b':
+                    loads = atoi(optarg);
+            break;
+            case 's':
+                    config.seed = strtoull(optarg,NULL,0);
+            break;
+            default:
+                    fprintf(stderr,"Usage: %s [-n frames] [-i interval_us] [-p priority] [-c worker_cpu] [-P producer_cpu] [-b load_threads] [-s seed]\n",argv[0]);
+            return 1;
+        }
+    }
+
+    if (sched_getaffinity(0,sizeof(set),&set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; c++)
+             if (CPU_ISSET(c,&set))
+                 cpus[ncpus++] = c;
+
+    if (!ncpus)
+        cpus[ncpus++] = 0;
+
+    worker_cpu   = (worker_cpu < 0) ? cpus[ncpus - 1] : worker_cpu;
+    producer_cpu = (producer_cpu < 0) ? cpus[0] : producer_cpu;
+    loads        = (loads < 0) ? ncpus : loads;
+
+    if (!frames || priority < 0 || priority > 99 || loads > CPU_SETSIZE)
+    {
+        fprintf(stderr,"The frames must be greater than 0, the priority between 0 and 99 and the load threads less than %d\n",CPU_SETSIZE);
+        return 1;
+    }
+
+    // A real time worker that spins in the core of the producer stops the producer
+    if (worker_cpu == producer_cpu && priority)
+    {
+        fprintf(stderr,"Warning: The worker and the producer use the core %d. SCHED_FIFO is not used\n",worker_cpu);
+        priority = 0;
+    }
+
+    // The frames of the vehicles. IP, AP, EJ, FA and FP
+    memset(config.weights,0,sizeof(config.weights));
+    config.weights[K_MAPS_PROTO_CORPUS_VEHICLE] = 1;
+    config.corrupt_permille = 0;
+
+    if ((data = MapsProtoCorpusBuffer(&config,4096,&size,NULL)) == NULL)
+    {
+        fprintf(stderr,"Error generating the vehicles: %s\n",strerror(errno));
+        return 1;
+    }
+
+    offsets = (size_t *)malloc(4096 * sizeof(size_t));
+    lengths = (uint16_t *)malloc(4096 * sizeof(uint16_t));
+
+    while (offsets && lengths && count < 4096 && MapsProtoReparseNext(data,size,&offset,&length,NULL) == 1)
+    {
+        offsets[count]   = offset;
+        lengths[count++] = length;
+        offset += length;
+    }
+
+    if ((shard = MapsProtoShardCreateRealtime(1,1,&worker_cpu,priority,on_frame,NULL)) == NULL && errno == EPERM)
+    {
+        fprintf(stderr,"Warning: SCHED_FIFO is not allowed. The worker runs with the normal policy\n");
+        shard = MapsProtoShardCreateRealtime(1,1,&worker_cpu,0,on_frame,NULL);
+    }
+
+    if (!shard || !count)
+    {
+        fprintf(stderr,"Error creating the shard: %s\n",strerror(errno));
+        return 1;
+    }
+
+    pin(producer_cpu);
+    param.sched_priority = priority;
+
+    if (priority && pthread_setschedparam(pthread_self(),SCHED_FIFO,&param))
+        fprintf(stderr,"Warning: The producer runs with the normal policy\n");
+
+    for (int i = 0; i < loads; i++)
+         if (pthread_create(&threads[i],NULL,load_thread,(void *)(uintptr_t) i))
+             loads = i;
+
+    if (MapsProtoShardLockMemory())
+        fprintf(stderr,"Warning: The memory is not locked: %s\n",strerror(errno));
+
+    printf("%llu frames every %llu us. Worker in core %d (priority %d), producer in core %d and %d load threads\n\n",
+           (unsigned long long) frames,(unsigned long long) interval,worker_cpu,priority,producer_cpu,loads);
+
+    clock_gettime(CLOCK_MONOTONIC,&next);
+
+    for (uint64_t i = 0; i < frames; i++)
+    {
+        expected = atomic_load_explicit(&arrived,memory_order_relaxed) + 1;
+        start    = now_ns();
+        deadline = start + TIMEOUT_NS;
+
+        MapsProtoShardPush(shard,0,&data[offsets[i % count]],lengths[i % count]);
+
+        while (atomic_load_explicit(&arrived,memory_order_acquire) < expected && now_ns() < deadline);
+
+        if (atomic_load_explicit(&arrived,memory_order_acquire) < expected)
+        {
+            lost++;
+            MapsProtoShardDrain(shard,1000);
+        }
+        else
+        {
+            record(&hall,atomic_load_explicit(&arrived_ns,memory_order_relaxed) - start);
+
+            if (atomic_load_explicit(&presence,memory_order_relaxed))
+                record(&hpresence,atomic_load_explicit(&arrived_ns,memory_order_relaxed) - start);
+        }
+
+        next.tv_nsec += interval * 1000;
+        next.tv_sec  += next.tv_nsec / 1000000000L;
+        next.tv_nsec %= 1000000000L;
+        clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,NULL);
+    }
+
+    atomic_store(&stop,1);
+
+    for (int i = 0; i < loads; i++)
+         pthread_join(threads[i],NULL);
+
+    MapsProtoShardFree(shard);
+
+    printf("Latency in microseconds (the percentiles are the upper limit of a bucket of 1 us)\n\n");
+    printf("%-9s %9s %9s %9s %9s %9s %9s %9s\n","frames","count","min","p50","p99","p99.9","p99.99","max");
+    report("IP/FP",&hpresence);
+    report("all",&hall);
+
+    if (lost)
+        printf("\n%llu frames without callback in 1 s\n",(unsigned long long) lost);
+
+    free(offsets);
+    free(lengths);
+    free(data);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,278 @@
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "maps_latency.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_LATENCY_LINEAR (2 * K_MAPS_PROTO_LATENCY_SUB_BUCKETS)  // Values with its own bucket (0 to 15)
+#define K_MAPS_PROTO_LATENCY_SHIFT  3                                      // log2 of the sub buckets
+
+#define latency_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_LATENCY_HIST
+ * @brief  A histogram. All the members are written with atomic operations.
+ *
+ */
+typedef struct
+{
+    _Atomic uint64_t sum_us;
+    _Atomic uint32_t min_us;   ///< UINT32_MAX when is empty.
+    _Atomic uint32_t max_us;
+    _Atomic uint32_t buckets[K_MAPS_PROTO_LATENCY_BUCKETS];
+}tMAPS_PROTO_LATENCY_HIST;
+
+/**
+ *
+ * @struct tMAPS_PROTO_LATENCY_PENDING
+ * @brief  A request without response. Only used by the thread of the lane.
+ *
+ */
+typedef struct
+{
+    uint64_t sent_us;     ///< When the request was written.
+    uint8_t cmd_id;       ///< The command of the request.
+    uint8_t used;         ///< 1 while the response is pending.
+}tMAPS_PROTO_LATENCY_PENDING;
+
+struct sMAPS_PROTO_LATENCY
+{
+    uint16_t lanes;                        ///< Number of lanes.
+    tMAPS_PROTO_LATENCY_HIST *hists;       ///< lanes * K_MAPS_PROTO_CMD_COUNT histograms.
+    tMAPS_PROTO_LATENCY_PENDING *pending;  ///< lanes * 10 requests (one by message number).
+};
+//-----------------------------------------------------------------------------
+
+static uint16_t  MapsProtoLatencyBucket    (uint32_t value);
+static void      MapsProtoLatencyClear     (tMAPS_PROTO_LATENCY_HIST *hist);
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+uint16_t MapsProtoLatencyBucket(uint32_t value)
+{
+    uint8_t exp;
+
+    if (value < K_MAPS_PROTO_LATENCY_LINEAR)
+        return value;
+
+    value = (value > K_MAPS_PROTO_LATENCY_MAX_US) ? K_MAPS_PROTO_LATENCY_MAX_US : value;
+    exp   = 31 - __builtin_clz(value);  // The power of two of the value. 4 or more
+
+    return K_MAPS_PROTO_LATENCY_LINEAR + (exp - 4) * K_MAPS_PROTO_LATENCY_SUB_BUCKETS +
+           ((value >> (exp - K_MAPS_PROTO_LATENCY_SHIFT)) - K_MAPS_PROTO_LATENCY_SUB_BUCKETS);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoLatencyClear(tMAPS_PROTO_LATENCY_HIST *hist)
+{
+    atomic_init(&hist->sum_us,0);
+    atomic_init(&hist->min_us,UINT32_MAX);
+    atomic_init(&hist->max_us,0);
+
+    for (uint16_t i = 0; i < K_MAPS_PROTO_LATENCY_BUCKETS; i++)
+         atomic_init(&hist->buckets[i],0);
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_LATENCY * MapsProtoLatencyCreate(uint16_t lanes)
+{
+    tMAPS_PROTO_LATENCY *latency;
+
+    if (!lanes)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((latency = (tMAPS_PROTO_LATENCY *)calloc(1,sizeof(tMAPS_PROTO_LATENCY))) == NULL ||
+        (latency->hists = (tMAPS_PROTO_LATENCY_HIST *)calloc((size_t) lanes * K_MAPS_PROTO_CMD_COUNT,sizeof(tMAPS_PROTO_LATENCY_HIST))) == NULL ||
+        (latency->pending = (tMAPS_PROTO_LATENCY_PENDING *)calloc((size_t) lanes * 10,sizeof(tMAPS_PROTO_LATENCY_PENDING))) == NULL)
+    {
+        MapsProtoLatencyFree(latency);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    latency->lanes = lanes;
+
+    for (uint32_t i = 0; i < (uint32_t) lanes * K_MAPS_PROTO_CMD_COUNT; i++)
+         MapsProtoLatencyClear(&latency->hists[i]);
+
+    return latency;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoLatencyFree(tMAPS_PROTO_LATENCY *latency)
+{
+    if (latency)
+    {
+        if (latency->hists)
+            free(latency->hists);
+        if (latency->pending)
+            free(latency->pending);
+
+        free(latency);
+    }
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoLatencySent(tMAPS_PROTO_LATENCY *latency, uint16_t lane, uint8_t num, uint8_t cmd_id, uint64_t now_us)
+{
+    tMAPS_PROTO_LATENCY_PENDING *pending;
+
+    if (!latency || lane >= latency->lanes || num > 9 || cmd_id >= K_MAPS_PROTO_CMD_COUNT)
+        latency_error(EINVAL);
+
+    pending = &latency->pending[lane * 10 + num];
+    pending->sent_us = now_us;
+    pending->cmd_id  = cmd_id;
+    pending->used    = 1;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoLatencyReceived(tMAPS_PROTO_LATENCY *latency, uint16_t lane, const tMAPS_PROTO_FRAME_HEADER *header, uint64_t now_us)
+{
+    uint64_t elapsed;
+    tMAPS_PROTO_LATENCY_PENDING *pending;
+
+    if (!latency || lane >= latency->lanes || !header)
+        latency_error(EINVAL);
+    if (header->type == 0 || header->num > 9)  // Requests and spontaneous messages
+        return 0;
+
+    pending = &latency->pending[lane * 10 + header->num];
+
+    if (!pending->used || pending->cmd_id != header->cmd_id)
+        return 0;
+
+    pending->used = 0;
+    elapsed = (now_us > pending->sent_us) ? now_us - pending->sent_us : 0;
+
+    MapsProtoLatencyRecord(latency,lane,pending->cmd_id,(elapsed > K_MAPS_PROTO_LATENCY_MAX_US) ? K_MAPS_PROTO_LATENCY_MAX_US : (uint32_t) elapsed);
+    return 1;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoLatencyRecord(tMAPS_PROTO_LATENCY *latency, uint16_t lane, uint8_t cmd_id, uint32_t latency_us)
+{
+    uint32_t current;
+    tMAPS_PROTO_LATENCY_HIST *hist;
+
+    if (!latency || lane >= latency->lanes || cmd_id >= K_MAPS_PROTO_CMD_COUNT)
+        latency_error(EINVAL);
+
+    hist = &latency->hists[lane * K_MAPS_PROTO_CMD_COUNT + cmd_id];
+    latency_us = (latency_us > K_MAPS_PROTO_LATENCY_MAX_US) ? K_MAPS_PROTO_LATENCY_MAX_US : latency_us;
+
+    atomic_fetch_add_explicit(&hist->buckets[MapsProtoLatencyBucket(latency_us)],1,memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_us,latency_us,memory_order_relaxed);
+
+    current = atomic_load_explicit(&hist->min_us,memory_order_relaxed);
+    while (latency_us < current && !atomic_compare_exchange_weak_explicit(&hist->min_us,&current,latency_us,memory_order_relaxed,memory_order_relaxed));
+
+    current = atomic_load_explicit(&hist->max_us,memory_order_relaxed);
+    while (latency_us > current && !atomic_compare_exchange_weak_explicit(&hist->max_us,&current,latency_us,memory_order_relaxed,memory_order_relaxed));
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoLatencySnapshot(tMAPS_PROTO_LATENCY *latency, uint16_t lane, uint8_t cmd_id, uint8_t reset, tMAPS_PROTO_LATENCY_HISTOGRAM *histogram)
+{
+    tMAPS_PROTO_LATENCY_HIST *hist;
+
+    if (!latency || lane >= latency->lanes || cmd_id >= K_MAPS_PROTO_CMD_COUNT || !histogram)
+        latency_error(EINVAL);
+
+    hist = &latency->hists[lane * K_MAPS_PROTO_CMD_COUNT + cmd_id];
+    histogram->count = 0;
+
+    // The count is the sum of the buckets copied, so the percentiles are always consistent
+    for (uint16_t i = 0; i < K_MAPS_PROTO_LATENCY_BUCKETS; i++)
+    {
+        histogram->buckets[i] = (reset) ? atomic_exchange_explicit(&hist->buckets[i],0,memory_order_relaxed) :
+                                          atomic_load_explicit(&hist->buckets[i],memory_order_relaxed);
+        histogram->count += histogram->buckets[i];
+    }
+
+    if (reset)
+    {
+        histogram->sum_us = atomic_exchange_explicit(&hist->sum_us,0,memory_order_relaxed);
+        histogram->min_us = atomic_exchange_explicit(&hist->min_us,UINT32_MAX,memory_order_relaxed);
+        histogram->max_us = atomic_exchange_explicit(&hist->max_us,0,memory_order_relaxed);
+    }
+    else
+    {
+        histogram->sum_us = atomic_load_explicit(&hist->sum_us,memory_order_relaxed);
+        histogram->min_us = atomic_load_explicit(&hist->min_us,memory_order_relaxed);
+        histogram->max_us = atomic_load_explicit(&hist->max_us,memory_order_relaxed);
+    }
+
+    if (histogram->min_us == UINT32_MAX)
+        histogram->min_us = 0;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoLatencyMerge(tMAPS_PROTO_LATENCY_HISTOGRAM *dst, const tMAPS_PROTO_LATENCY_HISTOGRAM *src)
+{
+    if (!dst || !src || !src->count)
+        return;
+
+    dst->min_us  = (!dst->count || src->min_us < dst->min_us) ? src->min_us : dst->min_us;
+    dst->max_us  = (src->max_us > dst->max_us) ? src->max_us : dst->max_us;
+    dst->count  += src->count;
+    dst->sum_us += src->sum_us;
+
+    for (uint16_t i = 0; i < K_MAPS_PROTO_LATENCY_BUCKETS; i++)
+         dst->buckets[i] += src->buckets[i];
+}
+//-----------------------------------------------------------------------------
+
+uint32_t MapsProtoLatencyPercentile(const tMAPS_PROTO_LATENCY_HISTOGRAM *histogram, double percentile)
+{
+    uint64_t target, total = 0;
+
+    if (!histogram || !histogram->count)
+        return 0;
+
+    percentile = (percentile < 0) ? 0 : (percentile > 100) ? 100 : percentile;
+    target     = (uint64_t)((percentile * histogram->count) / 100 + 0.5);
+    target     = (target) ? target : 1;
+
+    for (uint16_t i = 0; i < K_MAPS_PROTO_LATENCY_BUCKETS; i++)
+    {
+        if ((total += histogram->buckets[i]) >= target)
+        {
+            uint32_t limit = MapsProtoLatencyBucketLimit(i);
+            return (limit > histogram->max_us) ? histogram->max_us : limit;
+        }
+    }
+
+    return histogram->max_us;
+}
+//-----------------------------------------------------------------------------
+
+uint32_t MapsProtoLatencyBucketLimit(uint16_t bucket)
+{
+    uint8_t exp, sub;
+
+    if (bucket < K_MAPS_PROTO_LATENCY_LINEAR)
+        return bucket;
+    if (bucket >= K_MAPS_PROTO_LATENCY_BUCKETS)
+        return K_MAPS_PROTO_LATENCY_MAX_US;
+
+    exp = 4 + (bucket - K_MAPS_PROTO_LATENCY_LINEAR) / K_MAPS_PROTO_LATENCY_SUB_BUCKETS;
+    sub = (bucket - K_MAPS_PROTO_LATENCY_LINEAR) % K_MAPS_PROTO_LATENCY_SUB_BUCKETS;
+
+    return ((uint32_t)(K_MAPS_PROTO_LATENCY_SUB_BUCKETS + sub + 1) << (exp - K_MAPS_PROTO_LATENCY_SHIFT)) - 1;
+}
+//-----------------------------------------------------------------------------
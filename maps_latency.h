@@ -0,0 +1,155 @@
+#ifndef MAPS_LATENCY_H
+#define MAPS_LATENCY_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_latency.h
+ *  @brief Function prototypes for the histograms of the round trip time of
+ *         the requests by lane (barrier) and command.
+ *
+ *  The round trip is the time from the write of a request to its RS or NE
+ *  response (same number and command). The caller notifies both with
+ *  MapsProtoLatencySent and MapsProtoLatencyReceived, or records its own
+ *  times with MapsProtoLatencyRecord.
+ *
+ *  The histograms have log buckets in microseconds: 1 us up to 15 us and
+ *  then 8 buckets by power of two (the error of a value is less than 12.5%)
+ *  until K_MAPS_PROTO_LATENCY_MAX_US. The memory is allocated once by
+ *  MapsProtoLatencyCreate.
+ *
+ *  Record and snapshot are lock free, so the histograms can be read by a
+ *  thread (i.e. the metrics exporter) while the lanes record. A snapshot
+ *  with reset starts a new interval without lose any sample. The Sent and
+ *  Received functions of a lane must be called always from the same thread.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_LATENCY_SUB_BUCKETS 8                     ///< Buckets by power of two.
+#define K_MAPS_PROTO_LATENCY_BUCKETS     192                   ///< Buckets of a histogram.
+#define K_MAPS_PROTO_LATENCY_MAX_US      0x3FFFFFF             ///< The biggest value (67 seconds). Greater values are stored as it.
+//-----------------------------------------------------------------------------
+
+typedef struct sMAPS_PROTO_LATENCY tMAPS_PROTO_LATENCY;
+
+/**
+ *
+ * @struct tMAPS_PROTO_LATENCY_HISTOGRAM
+ * @brief  A copy of a histogram. Created by MapsProtoLatencySnapshot.
+ *
+ */
+typedef struct
+{
+    uint64_t count;       ///< Number of values.
+    uint64_t sum_us;      ///< The sum of the values. For the mean.
+    uint32_t min_us;      ///< The lowest value. 0 when count is 0.
+    uint32_t max_us;      ///< The biggest value.
+    uint32_t buckets[K_MAPS_PROTO_LATENCY_BUCKETS]; ///< The values by bucket. See MapsProtoLatencyBucketLimit.
+}tMAPS_PROTO_LATENCY_HISTOGRAM;
+
+/** @brief Creates the histograms of lanes lanes. One by each command of each lane.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: lanes is 0.
+ *      ENOMEM: Couldn't allocate memory.
+ *
+ * @param  lanes The number of lanes (barriers).
+ * @return NULL on error and errno is set or on success a new allocated tMAPS_PROTO_LATENCY.
+ */
+tMAPS_PROTO_LATENCY * MapsProtoLatencyCreate(uint16_t lanes);
+
+/** @brief Free the histograms created with MapsProtoLatencyCreate.
+ *
+ * @param  latency The histograms to free.
+ */
+void MapsProtoLatencyFree(tMAPS_PROTO_LATENCY *latency);
+
+/** @brief Notify that a request was written. Call it after the write.
+ *
+ *  A previous request with the same number without response is discarded.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid latency, lane, num or cmd_id param.
+ *
+ * @param  latency The histograms.
+ * @param  lane    The lane where the request was sent.
+ * @param  num     The message number of the request. Range 0 to 9.
+ * @param  cmd_id  The K_MAPS_PROTO_CMD_* of the request.
+ * @param  now_us  The current time in microseconds from a monotonic clock.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoLatencySent(tMAPS_PROTO_LATENCY *latency, uint16_t lane, uint8_t num, uint8_t cmd_id, uint64_t now_us);
+
+/** @brief Notify a received frame. The RS or NE response of a pending request records its round trip.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid latency, lane or header param.
+ *
+ * @param  latency The histograms.
+ * @param  lane    The lane where the frame was received.
+ * @param  header  The header of the frame (MapsProtoValidateFrame or MapsProtoParseFrameTo).
+ * @param  now_us  The current time in microseconds from a monotonic clock.
+ * @return 1 when the frame is the response of a pending request, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoLatencyReceived(tMAPS_PROTO_LATENCY *latency, uint16_t lane, const tMAPS_PROTO_FRAME_HEADER *header, uint64_t now_us);
+
+/** @brief Record a round trip time. Can be called from any thread.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid latency, lane or cmd_id param.
+ *
+ * @param  latency    The histograms.
+ * @param  lane       The lane of the request.
+ * @param  cmd_id     The K_MAPS_PROTO_CMD_* of the request.
+ * @param  latency_us The round trip time in microseconds.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoLatencyRecord(tMAPS_PROTO_LATENCY *latency, uint16_t lane, uint8_t cmd_id, uint32_t latency_us);
+
+/** @brief Copy the histogram of a lane and command.
+ *
+ *  With reset the histogram is cleared, so the next snapshot has the values
+ *  of the next interval only. The values recorded during the snapshot are
+ *  in this interval or in the next, never lost.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid latency, lane, cmd_id or histogram param.
+ *
+ * @param  latency   The histograms.
+ * @param  lane      The lane.
+ * @param  cmd_id    The K_MAPS_PROTO_CMD_* of the requests.
+ * @param  reset     1 to clear the histogram after copy it.
+ * @param  histogram Where the histogram is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoLatencySnapshot(tMAPS_PROTO_LATENCY *latency, uint16_t lane, uint8_t cmd_id, uint8_t reset, tMAPS_PROTO_LATENCY_HISTOGRAM *histogram);
+
+/** @brief Add the values of a histogram to other. i.e. All the commands of a lane.
+ *
+ * @param  dst The histogram to increment.
+ * @param  src The histogram to add.
+ */
+void MapsProtoLatencyMerge(tMAPS_PROTO_LATENCY_HISTOGRAM *dst, const tMAPS_PROTO_LATENCY_HISTOGRAM *src);
+
+/** @brief Get a percentile of a histogram. i.e. 50, 99 or 99.9
+ *
+ * @param  histogram  The histogram.
+ * @param  percentile The percentile. Range 0 to 100.
+ * @return The biggest value of the bucket of the percentile (never greater than max_us) or 0 when the histogram is empty.
+ */
+uint32_t MapsProtoLatencyPercentile(const tMAPS_PROTO_LATENCY_HISTOGRAM *histogram, double percentile);
+
+/** @brief Get the biggest value of a bucket. For export the buckets (i.e. Prometheus le labels).
+ *
+ * @param  bucket The bucket. Range 0 to K_MAPS_PROTO_LATENCY_BUCKETS-1.
+ * @return The biggest value in microseconds stored in the bucket.
+ */
+uint32_t MapsProtoLatencyBucketLimit(uint16_t bucket);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,568 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // accept4 & pipe2
+#endif
+
+#include <poll.h>
+#include <time.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "maps_stats.h"
+#include "maps_metrics.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_METRICS_BUFFER    0x10000   // The first size of the render buffer (64 KiB)
+#define K_MAPS_PROTO_METRICS_REQUEST   2048      // The biggest HTTP request read
+#define K_MAPS_PROTO_METRICS_TIMEOUT   1000      // Milliseconds for read the request and write the response
+
+#define metrics_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_METRICS_LANE
+ * @brief  The counters of a lane. Only written by the I/O thread of the lane.
+ *         In its own cache line for not share it with the other lanes.
+ *
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t frames;
+    _Atomic uint64_t errors;
+    _Atomic uint64_t not_executed;
+    _Atomic uint64_t resyncs;
+    _Atomic uint32_t queue_depth;
+}tMAPS_PROTO_METRICS_LANE;
+
+/**
+ *
+ * @struct tMAPS_PROTO_METRICS_TEXT
+ * @brief  The buffer of a render.
+ *
+ */
+typedef struct
+{
+    char *buffer;
+    size_t size;
+    size_t length;
+    uint8_t full;         ///< 1 when the text doesn't fit in the buffer.
+}tMAPS_PROTO_METRICS_TEXT;
+
+struct sMAPS_PROTO_METRICS
+{
+    uint16_t lanes;                          ///< Number of lanes.
+    tMAPS_PROTO_METRICS_LANE *lane;          ///< The counters of the lanes.
+    tMAPS_PROTO_LATENCY *latency;            ///< The round trip histograms. Can be NULL.
+    pthread_mutex_t mutex;                   ///< Only for the render. Protects previous and previous_ns.
+    tMAPS_PROTO_STATS previous;              ///< The library counters of the previous render.
+    uint64_t previous_ns;                    ///< When was the previous render. 0 before the first one.
+    int listen_fd;                           ///< The socket of the exporter or -1.
+    int stop_fd[2];                          ///< Pipe for stop the exporter thread.
+    char unix_path[sizeof(((struct sockaddr_un *)0)->sun_path)];  ///< The Unix socket to remove or empty.
+    pthread_t thread;
+    char *buffer;                            ///< The buffer of the exporter thread.
+    size_t size;
+};
+//-----------------------------------------------------------------------------
+
+static void      MapsProtoMetricsPrint     (tMAPS_PROTO_METRICS_TEXT *text, const char *format, ...) __attribute__((format(printf,2,3)));
+static void      MapsProtoMetricsHeader    (tMAPS_PROTO_METRICS_TEXT *text, const char *name, const char *type, const char *help);
+static void      MapsProtoMetricsCommands  (tMAPS_PROTO_METRICS_TEXT *text, const char *name, const uint64_t *counters);
+static void      MapsProtoMetricsLanes     (tMAPS_PROTO_METRICS_TEXT *text, tMAPS_PROTO_METRICS *metrics);
+static void      MapsProtoMetricsLatency   (tMAPS_PROTO_METRICS_TEXT *text, tMAPS_PROTO_METRICS *metrics);
+static int       MapsProtoMetricsSocket    (tMAPS_PROTO_METRICS *metrics, const char *address);
+static void      MapsProtoMetricsServe     (tMAPS_PROTO_METRICS *metrics, int fd);
+static void *    MapsProtoMetricsThread    (void *param);
+//-----------------------------------------------------------------------------
+
+static const double metrics_quantiles[4] = { 0.5, 0.9, 0.99, 0.999 };
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+void MapsProtoMetricsPrint(tMAPS_PROTO_METRICS_TEXT *text, const char *format, ...)
+{
+    int length;
+    va_list args;
+
+    if (text->full)
+        return;
+
+    va_start(args,format);
+    length = vsnprintf(&text->buffer[text->length],text->size - text->length,format,args);
+    va_end(args);
+
+    if (length < 0 || (size_t) length >= text->size - text->length)
+        text->full = 1;
+    else
+        text->length += length;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoMetricsHeader(tMAPS_PROTO_METRICS_TEXT *text, const char *name, const char *type, const char *help)
+{
+    MapsProtoMetricsPrint(text,"# HELP maps_proto_%s %s\n# TYPE maps_proto_%s %s\n",name,help,name,type);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoMetricsCommands(tMAPS_PROTO_METRICS_TEXT *text, const char *name, const uint64_t *counters)
+{
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CMD_COUNT; i++)
+         if (counters[i])
+             MapsProtoMetricsPrint(text,"maps_proto_%s{cmd=\"%s\"} %llu\n",name,MapsProtoGetCmdName(i),(unsigned long long) counters[i]);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoMetricsLanes(tMAPS_PROTO_METRICS_TEXT *text, tMAPS_PROTO_METRICS *metrics)
+{
+    static const char *names[4] = { "lane_frames_total", "lane_errors_total", "lane_not_executed_total", "lane_resyncs_total" };
+    static const char *helps[4] = { "Frames received by lane.", "Frames with errors by lane.",
+                                    "NE responses by lane.", "Times that the decoder of the lane skipped junk." };
+
+    for (uint8_t m = 0; m < 4; m++)
+    {
+        MapsProtoMetricsHeader(text,names[m],"counter",helps[m]);
+
+        for (uint16_t i = 0; i < metrics->lanes; i++)
+        {
+            tMAPS_PROTO_METRICS_LANE *lane = &metrics->lane[i];
+            uint64_t value = (m == 0) ? atomic_load_explicit(&lane->frames,memory_order_relaxed) :
+                             (m == 1) ? atomic_load_explicit(&lane->errors,memory_order_relaxed) :
+                             (m == 2) ? atomic_load_explicit(&lane->not_executed,memory_order_relaxed) :
+                                        atomic_load_explicit(&lane->resyncs,memory_order_relaxed);
+
+            MapsProtoMetricsPrint(text,"maps_proto_%s{lane=\"%u\"} %llu\n",names[m],i,(unsigned long long) value);
+        }
+    }
+
+    MapsProtoMetricsHeader(text,"lane_queue_depth","gauge","Requests waiting to be sent by lane.");
+
+    for (uint16_t i = 0; i < metrics->lanes; i++)
+         MapsProtoMetricsPrint(text,"maps_proto_lane_queue_depth{lane=\"%u\"} %u\n",i,
+                               atomic_load_explicit(&metrics->lane[i].queue_depth,memory_order_relaxed));
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoMetricsLatency(tMAPS_PROTO_METRICS_TEXT *text, tMAPS_PROTO_METRICS *metrics)
+{
+    tMAPS_PROTO_LATENCY_HISTOGRAM hist;
+
+    MapsProtoMetricsHeader(text,"rtt_microseconds","summary","Round trip time of the requests by lane and command.");
+
+    for (uint16_t i = 0; i < metrics->lanes; i++)
+    {
+        for (uint8_t c = 0; c < K_MAPS_PROTO_CMD_COUNT; c++)
+        {
+            if (MapsProtoLatencySnapshot(metrics->latency,i,c,0,&hist) || !hist.count)
+                continue;
+
+            for (uint8_t q = 0; q < sizeof(metrics_quantiles)/sizeof(metrics_quantiles[0]); q++)
+                 MapsProtoMetricsPrint(text,"maps_proto_rtt_microseconds{lane=\"%u\",cmd=\"%s\",quantile=\"%g\"} %u\n",i,MapsProtoGetCmdName(c),
+                                       metrics_quantiles[q],MapsProtoLatencyPercentile(&hist,metrics_quantiles[q] * 100));
+
+            MapsProtoMetricsPrint(text,"maps_proto_rtt_microseconds_sum{lane=\"%u\",cmd=\"%s\"} %llu\n",i,MapsProtoGetCmdName(c),(unsigned long long) hist.sum_us);
+            MapsProtoMetricsPrint(text,"maps_proto_rtt_microseconds_count{lane=\"%u\",cmd=\"%s\"} %llu\n",i,MapsProtoGetCmdName(c),(unsigned long long) hist.count);
+        }
+    }
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoMetricsSocket(tMAPS_PROTO_METRICS *metrics, const char *address)
+{
+    int fd, error;
+    struct stat st;
+    struct sockaddr_un un;
+    struct sockaddr_in in;
+    struct sockaddr *addr;
+    socklen_t addr_size;
+
+    memset(&un,0,sizeof(un));
+    memset(&in,0,sizeof(in));
+
+    if (!strncmp(address,"unix:",5))
+    {
+        if (!address[5] || strlen(&address[5]) >= sizeof(un.sun_path))
+            metrics_error(EINVAL);
+
+        un.sun_family = AF_UNIX;
+        strcpy(un.sun_path,&address[5]);
+
+        // Only a stale socket is removed. Never a regular file
+        if (!stat(un.sun_path,&st) && S_ISSOCK(st.st_mode))
+            unlink(un.sun_path);
+
+        addr = (struct sockaddr *) &un;
+        addr_size = sizeof(un);
+    }
+    else
+    {
+        char host[INET_ADDRSTRLEN] = "127.0.0.1";
+        const char *port = strrchr(address,':');
+        long value;
+        char *end;
+
+        if (port)
+        {
+            if ((size_t)(port - address) >= sizeof(host))
+                metrics_error(EINVAL);
+            if (port != address)
+            {
+                memcpy(host,address,port - address);
+                host[port - address] = 0;
+            }
+            port++;
+        }
+        else
+            port = address;
+
+        value = strtol(port,&end,10);
+
+        if (*end || end == port || value < 1 || value > 65535 || inet_pton(AF_INET,host,&in.sin_addr) != 1)
+            metrics_error(EINVAL);
+
+        in.sin_family = AF_INET;
+        in.sin_port   = htons((uint16_t) value);
+
+        addr = (struct sockaddr *) &in;
+        addr_size = sizeof(in);
+    }
+
+    if ((fd = socket(addr->sa_family,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0)) < 0)
+        return -1;
+
+    if (addr->sa_family == AF_INET)
+        setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&(int){ 1 },sizeof(int));
+
+    if (bind(fd,addr,addr_size) || listen(fd,16))
+    {
+        error = errno;
+        close(fd);
+        metrics_error(error);
+    }
+
+    if (addr->sa_family == AF_UNIX)
+        strcpy(metrics->unix_path,un.sun_path);
+
+    return fd;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoMetricsServe(tMAPS_PROTO_METRICS *metrics, int fd)
+{
+    int length;
+    ssize_t rc;
+    size_t used = 0, sent = 0;
+    char request[K_MAPS_PROTO_METRICS_REQUEST];
+    char header[160];
+    struct pollfd pfd = { .fd = fd, .events = POLLIN, };
+
+    // Read the request until the empty line. The connection is non blocking
+    while (used < sizeof(request) - 1 && poll(&pfd,1,K_MAPS_PROTO_METRICS_TIMEOUT) > 0)
+    {
+        if ((rc = read(fd,&request[used],sizeof(request) - 1 - used)) <= 0)
+            break;
+
+        used += rc;
+        request[used] = 0;
+
+        if (strstr(request,"\r\n\r\n") || strstr(request,"\n\n"))
+            break;
+    }
+
+    if (used < 4 || strncmp(request,"GET ",4))
+    {
+        length = snprintf(header,sizeof(header),"HTTP/1.0 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        rc = send(fd,header,length,MSG_NOSIGNAL);
+        return;
+    }
+
+    // The buffer grows until the render fits
+    while ((length = MapsProtoMetricsRender(metrics,metrics->buffer,metrics->size)) < 0 && metrics->size < K_MAPS_PROTO_METRICS_MAX_SIZE)
+    {
+        char *buffer = (char *)realloc(metrics->buffer,metrics->size * 2);
+
+        if (buffer == NULL)
+            break;
+
+        metrics->buffer = buffer;
+        metrics->size  *= 2;
+    }
+
+    if (length < 0)
+    {
+        length = snprintf(header,sizeof(header),"HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        rc = send(fd,header,length,MSG_NOSIGNAL);
+        return;
+    }
+
+    used = snprintf(header,sizeof(header),"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",length);
+
+    pfd.events = POLLOUT;
+
+    while (sent < used + length && poll(&pfd,1,K_MAPS_PROTO_METRICS_TIMEOUT) > 0)
+    {
+        if (sent < used)
+            rc = send(fd,&header[sent],used - sent,MSG_NOSIGNAL);  // A peer closed returns EPIPE, without SIGPIPE
+        else
+            rc = send(fd,&metrics->buffer[sent - used],used + length - sent,MSG_NOSIGNAL);
+
+        if (rc <= 0)
+            break;
+
+        sent += rc;
+    }
+}
+//-----------------------------------------------------------------------------
+
+void * MapsProtoMetricsThread(void *param)
+{
+    int fd;
+    tMAPS_PROTO_METRICS *metrics = (tMAPS_PROTO_METRICS *) param;
+    struct pollfd pfd[2] = { { .fd = metrics->listen_fd, .events = POLLIN, }, { .fd = metrics->stop_fd[0], .events = POLLIN, } };
+
+    while (poll(pfd,2,-1) >= 0 && !(pfd[1].revents & POLLIN))
+    {
+        if (!(pfd[0].revents & POLLIN))
+            continue;
+
+        if ((fd = accept4(metrics->listen_fd,NULL,NULL,SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0)
+            continue;
+
+        MapsProtoMetricsServe(metrics,fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_METRICS * MapsProtoMetricsCreate(uint16_t lanes, tMAPS_PROTO_LATENCY *latency)
+{
+    size_t size = (size_t) lanes * sizeof(tMAPS_PROTO_METRICS_LANE);
+    tMAPS_PROTO_METRICS *metrics;
+
+    if (!lanes)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((metrics = (tMAPS_PROTO_METRICS *)calloc(1,sizeof(tMAPS_PROTO_METRICS))) == NULL)
+        return NULL;
+
+    if ((metrics->lane = (tMAPS_PROTO_METRICS_LANE *)aligned_alloc(_Alignof(tMAPS_PROTO_METRICS_LANE),size)) == NULL)
+    {
+        free(metrics);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset(metrics->lane,0,size);
+    pthread_mutex_init(&metrics->mutex,NULL);
+
+    metrics->lanes      = lanes;
+    metrics->latency    = latency;
+    metrics->listen_fd  = -1;
+    metrics->stop_fd[0] = -1;
+    metrics->stop_fd[1] = -1;
+
+    return metrics;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoMetricsFree(tMAPS_PROTO_METRICS *metrics)
+{
+    if (metrics == NULL)
+        return;
+
+    if (metrics->listen_fd >= 0)
+    {
+        if (write(metrics->stop_fd[1],"",1) == 1)
+            pthread_join(metrics->thread,NULL);
+
+        close(metrics->listen_fd);
+        close(metrics->stop_fd[0]);
+        close(metrics->stop_fd[1]);
+
+        if (metrics->unix_path[0])
+            unlink(metrics->unix_path);
+    }
+
+    pthread_mutex_destroy(&metrics->mutex);
+    free(metrics->buffer);
+    free(metrics->lane);
+    free(metrics);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoMetricsLaneFrame(tMAPS_PROTO_METRICS *metrics, uint16_t lane, uint8_t status, uint8_t type)
+{
+    if (!metrics || lane >= metrics->lanes)
+        metrics_error(EINVAL);
+
+    atomic_fetch_add_explicit(&metrics->lane[lane].frames,1,memory_order_relaxed);
+
+    if (status != K_MAPS_PROTO_STATUS_OK)
+        atomic_fetch_add_explicit(&metrics->lane[lane].errors,1,memory_order_relaxed);
+    else if (type == 2)
+        atomic_fetch_add_explicit(&metrics->lane[lane].not_executed,1,memory_order_relaxed);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoMetricsLaneResync(tMAPS_PROTO_METRICS *metrics, uint16_t lane, uint32_t resyncs)
+{
+    if (!metrics || lane >= metrics->lanes)
+        metrics_error(EINVAL);
+
+    atomic_fetch_add_explicit(&metrics->lane[lane].resyncs,resyncs,memory_order_relaxed);
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoMetricsLaneQueue(tMAPS_PROTO_METRICS *metrics, uint16_t lane, uint32_t depth)
+{
+    if (!metrics || lane >= metrics->lanes)
+        metrics_error(EINVAL);
+
+    atomic_store_explicit(&metrics->lane[lane].queue_depth,depth,memory_order_relaxed);
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoMetricsRender(tMAPS_PROTO_METRICS *metrics, char *buffer, size_t size)
+{
+    uint64_t now_ns;
+    double seconds;
+    struct timespec ts;
+    tMAPS_PROTO_STATS stats, diff;
+    tMAPS_PROTO_METRICS_TEXT text = { buffer, size, 0, 0 };
+
+    if (!metrics || !buffer || !size)
+        metrics_error(EINVAL);
+
+    MapsProtoStatsSnapshot(&stats);
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    now_ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+    pthread_mutex_lock(&metrics->mutex);
+
+    seconds = (metrics->previous_ns) ? (now_ns - metrics->previous_ns) / 1e9 : 0;
+    MapsProtoStatsDiff(&stats,&metrics->previous,&diff);
+
+    MapsProtoMetricsHeader(&text,"frames_total","counter","Frames parsed by command.");
+    MapsProtoMetricsCommands(&text,"frames_total",stats.parsed);
+
+    MapsProtoMetricsHeader(&text,"frames_per_second","gauge","Frames parsed by second since the previous scrape.");
+    for (uint8_t i = 0; i < K_MAPS_PROTO_CMD_COUNT; i++)
+         if (stats.parsed[i])
+             MapsProtoMetricsPrint(&text,"maps_proto_frames_per_second{cmd=\"%s\"} %.3f\n",MapsProtoGetCmdName(i),(seconds > 0) ? diff.parsed[i] / seconds : 0.0);
+
+    MapsProtoMetricsHeader(&text,"created_total","counter","Frames created by command.");
+    MapsProtoMetricsCommands(&text,"created_total",stats.created);
+
+    MapsProtoMetricsHeader(&text,"parse_errors_total","counter","Parse errors by class.");
+    for (uint8_t i = K_MAPS_PROTO_STATUS_OK + 1; i < K_MAPS_PROTO_STATUS_COUNT; i++)
+    {
+        char name[16];
+        const char *status = MapsProtoStatusName((tMAPS_PROTO_STATUS) i);
+        uint8_t n;
+
+        for (n = 0; status[n] && n < sizeof(name) - 1; n++)
+             name[n] = (status[n] >= 'A' && status[n] <= 'Z') ? status[n] + 32 : status[n];
+        name[n] = 0;
+
+        MapsProtoMetricsPrint(&text,"maps_proto_parse_errors_total{class=\"%s\"} %llu\n",name,(unsigned long long) stats.errors[i]);
+    }
+
+    MapsProtoMetricsHeader(&text,"not_executed_total","counter","NE responses by command.");
+    MapsProtoMetricsCommands(&text,"not_executed_total",stats.not_executed);
+    if (stats.not_executed[K_MAPS_PROTO_CMD_COUNT])
+        MapsProtoMetricsPrint(&text,"maps_proto_not_executed_total{cmd=\"unknown\"} %llu\n",(unsigned long long) stats.not_executed[K_MAPS_PROTO_CMD_COUNT]);
+
+    MapsProtoMetricsHeader(&text,"bytes_parsed_total","counter","Bytes given to the parse functions.");
+    MapsProtoMetricsPrint(&text,"maps_proto_bytes_parsed_total %llu\n",(unsigned long long) stats.bytes_parsed);
+    MapsProtoMetricsHeader(&text,"bytes_created_total","counter","Bytes of the frames created.");
+    MapsProtoMetricsPrint(&text,"maps_proto_bytes_created_total %llu\n",(unsigned long long) stats.bytes_created);
+
+    MapsProtoMetricsLanes(&text,metrics);
+
+    if (metrics->latency)
+        MapsProtoMetricsLatency(&text,metrics);
+
+    // A render that doesn't fit is not a scrape. The next one uses the same interval
+    if (!text.full)
+    {
+        memcpy(&metrics->previous,&stats,sizeof(tMAPS_PROTO_STATS));
+        metrics->previous_ns = now_ns;
+    }
+
+    pthread_mutex_unlock(&metrics->mutex);
+
+    if (text.full)
+        metrics_error(ENOSPC);
+
+    return (int) text.length;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoMetricsListen(tMAPS_PROTO_METRICS *metrics, const char *address)
+{
+    int error;
+
+    if (!metrics || !address)
+        metrics_error(EINVAL);
+    if (metrics->listen_fd >= 0)
+        metrics_error(EALREADY);
+
+    if (metrics->buffer == NULL)
+    {
+        if ((metrics->buffer = (char *)malloc(K_MAPS_PROTO_METRICS_BUFFER)) == NULL)
+            metrics_error(ENOMEM);
+
+        metrics->size = K_MAPS_PROTO_METRICS_BUFFER;
+    }
+
+    if (pipe2(metrics->stop_fd,O_CLOEXEC))
+        return -1;
+
+    if ((metrics->listen_fd = MapsProtoMetricsSocket(metrics,address)) < 0)
+    {
+        error = errno;
+        close(metrics->stop_fd[0]);
+        close(metrics->stop_fd[1]);
+        metrics_error(error);
+    }
+
+    if ((error = pthread_create(&metrics->thread,NULL,MapsProtoMetricsThread,metrics)))
+    {
+        close(metrics->listen_fd);
+        close(metrics->stop_fd[0]);
+        close(metrics->stop_fd[1]);
+        metrics->listen_fd = -1;
+
+        if (metrics->unix_path[0])
+        {
+            unlink(metrics->unix_path);
+            metrics->unix_path[0] = 0;
+        }
+
+        metrics_error(error);
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
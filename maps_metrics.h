@@ -0,0 +1,146 @@
+#ifndef MAPS_METRICS_H
+#define MAPS_METRICS_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_metrics.h
+ *  @brief Function prototypes for export the counters of the library and
+ *         the lanes in the Prometheus text format.
+ *
+ *  The metrics are:
+ *
+ *      maps_proto_frames_total{cmd}                  Frames parsed by command (maps_stats.h).
+ *      maps_proto_frames_per_second{cmd}             Frames parsed by second since the previous render.
+ *      maps_proto_created_total{cmd}                 Frames created by command.
+ *      maps_proto_parse_errors_total{class}          Parse errors by tMAPS_PROTO_STATUS (lrc, framing, ...).
+ *      maps_proto_not_executed_total{cmd}            NE responses by command. cmd="unknown" for unknown commands.
+ *      maps_proto_bytes_parsed_total                 Bytes given to the parse functions.
+ *      maps_proto_bytes_created_total                Bytes of the frames created.
+ *      maps_proto_lane_frames_total{lane}            Frames received by lane.
+ *      maps_proto_lane_errors_total{lane}            Frames with errors by lane.
+ *      maps_proto_lane_not_executed_total{lane}      NE responses by lane.
+ *      maps_proto_lane_resyncs_total{lane}           Times that the decoder of the lane skipped junk.
+ *      maps_proto_lane_queue_depth{lane}             Requests waiting to be sent by lane.
+ *      maps_proto_rtt_microseconds{lane,cmd,quantile} Round trip time (maps_latency.h). Summary with _sum and _count.
+ *
+ *  The commands without frames are not written. The library counters are
+ *  only incremented with MAPS_PROTO_STATS defined.
+ *
+ *  The I/O thread of each lane updates its counters with MapsProtoMetricsLane*.
+ *  They are relaxed atomic operations and never block. The render reads the
+ *  lane counters, the per thread counters of maps_stats.h and the latency
+ *  histograms without locks of the I/O threads (the snapshot of maps_stats
+ *  locks the list of threads, that the I/O threads only use when start or
+ *  end). The render can be called from any thread or served by the exporter
+ *  thread of MapsProtoMetricsListen on a local HTTP socket:
+ *
+ *      curl http://127.0.0.1:9100/metrics
+ *      curl --unix-socket /run/maps.sock http://localhost/metrics
+ */
+
+#include <stddef.h>
+
+#include "maps_latency.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_METRICS_MAX_SIZE  0x1000000  ///< The biggest render served (16 MiB).
+//-----------------------------------------------------------------------------
+
+typedef struct sMAPS_PROTO_METRICS tMAPS_PROTO_METRICS;
+
+/** @brief Creates the counters of lanes lanes.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: lanes is 0.
+ *      ENOMEM: Couldn't allocate memory.
+ *
+ * @param  lanes   The number of lanes (barriers).
+ * @param  latency The histograms of the round trip times or NULL. Must be valid until MapsProtoMetricsFree.
+ * @return NULL on error and errno is set or on success a new allocated tMAPS_PROTO_METRICS.
+ */
+tMAPS_PROTO_METRICS * MapsProtoMetricsCreate(uint16_t lanes, tMAPS_PROTO_LATENCY *latency);
+
+/** @brief Stop the exporter thread (if any) and free the counters.
+ *
+ * @param  metrics The counters to free.
+ */
+void MapsProtoMetricsFree(tMAPS_PROTO_METRICS *metrics);
+
+/** @brief Count a frame received by a lane. Call it with the result of the parse or the validation.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid metrics or lane param.
+ *
+ * @param  metrics The counters.
+ * @param  lane    The lane.
+ * @param  status  The tMAPS_PROTO_STATUS of the frame.
+ * @param  type    The type of the frame (2 is NE). Only used when status is OK.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoMetricsLaneFrame(tMAPS_PROTO_METRICS *metrics, uint16_t lane, uint8_t status, uint8_t type);
+
+/** @brief Count the resyncs of the decoder of a lane. i.e. The junk skipped by MapsProtoReparseNext.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid metrics or lane param.
+ *
+ * @param  metrics The counters.
+ * @param  lane    The lane.
+ * @param  resyncs The resyncs to add.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoMetricsLaneResync(tMAPS_PROTO_METRICS *metrics, uint16_t lane, uint32_t resyncs);
+
+/** @brief Set the requests waiting to be sent by a lane.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid metrics or lane param.
+ *
+ * @param  metrics The counters.
+ * @param  lane    The lane.
+ * @param  depth   The requests in the queue.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoMetricsLaneQueue(tMAPS_PROTO_METRICS *metrics, uint16_t lane, uint32_t depth);
+
+/** @brief Write the metrics in the Prometheus text format.
+ *
+ *  The frames per second are calculated from the previous render.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The metrics or buffer params are NULL.
+ *      ENOSPC: The buffer is too small.
+ *
+ * @param  metrics The counters.
+ * @param  buffer  Where the text is written. Is NULL terminated.
+ * @param  size    The size of the buffer.
+ * @return The length of the text or -1 on error and errno is set.
+ */
+int MapsProtoMetricsRender(tMAPS_PROTO_METRICS *metrics, char *buffer, size_t size);
+
+/** @brief Start a thread that serves the metrics on a local HTTP socket.
+ *
+ *  The address is "unix:<path>" for a Unix socket or "[host:]port" for a
+ *  TCP socket. The default host is 127.0.0.1. Any GET request is answered
+ *  with the metrics and the connection is closed. A stale Unix socket is
+ *  replaced.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The metrics or address params are NULL or the address is invalid.
+ *      EALREADY: The exporter thread is running.
+ *
+ *  Or any errno value of socket, bind, listen, pipe or pthread_create.
+ *
+ * @param  metrics The counters.
+ * @param  address The address to listen.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoMetricsListen(tMAPS_PROTO_METRICS *metrics, const char *address);
+
+//-----------------------------------------------------------------------------
+#endif
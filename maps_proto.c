@@ -5,6 +5,12 @@
 #include <stdlib.h>
 
 #include "maps_proto.h"
+#include "maps_spec.h"
+#include "maps_trace.h"
+
+#ifdef MAPS_PROTO_STATS
+#include "maps_stats.h"
+#endif
 //-----------------------------------------------------------------------------
 
 #define K_MAPS_PROTO_SOH 0x01
@@ -20,12 +26,31 @@
 #define param_error(e) do { errno = e; return NULL; } while (0)
 #define parse_error(e) do { errno = e; goto PARSE_ERROR_EXEC; } while (0)
 #define frame_error(e) do { errno = e; MapsProtoFreeRawFrame(frame); return NULL; } while(0)
+
+// The counters of maps_stats.h. Compiled only with MAPS_PROTO_STATS defined
+#ifdef MAPS_PROTO_STATS
+#define stats_parse(s,i,t,n) MapsProtoStatsParse(s,(i)->cmd_id,t,n)
+#define stats_create(c,n)    MapsProtoStatsCreate(c,n)
+#define proto_calloc(n,s)    (MapsProtoStatsAlloc((n) * (s)), calloc(n,s))
+#else
+#define stats_parse(s,i,t,n) (s)
+#define stats_create(c,n)
+#define proto_calloc(n,s)    calloc(n,s)
+#endif
+
+#define spec_dec2(d,o) ((((d)[o] - 48) * 10) + ((d)[(o)+1] - 48))
+#define spec_hex(c)    (((c) < 58) ? ((c) - 48) : (((c) & 0xDF) - 55))
+#define lrc_value(c)   ((uint8_t)((((c)[0] - 48) << 4) | (((c)[1] - 48) & 0x0F)))
+
+#define K_MAPS_PROTO_SPEC_MAX_DATA 17  ///< The size of the biggest data of the variants of maps_spec.h (FA SPONTANEOUS of 24 bytes).
 //-----------------------------------------------------------------------------
 
+typedef struct sMAPS_PROTO_PARSE_CTX tMAPS_PROTO_PARSE_CTX;
+
 ///< @brief Function Pointer Callback for parse a request MAPS message.
-typedef uint8_t (*RequestParseCb) (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
+typedef uint8_t (*RequestParseCb) (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
 ///< @brief Function Pointer Callback for parse a response MAPS message.
-typedef uint8_t (*ResponseParseCb)(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
+typedef uint8_t (*ResponseParseCb)(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
 
 /**
  *
@@ -60,81 +85,126 @@ typedef uint8_t (*ResponseParseCb)(uint8_t *frame, uint16_t size, tMAPS_PROTO_PA
  *         RH = 100 SUPPORT UNKNOWN RESPONSES    , NOT SUPPORT EMPTY REQUEST, NOT SUPPORT EMPTY RESPONSE
  *         FR = 001 NOT SUPPORT UNKNOWN RESPONSES, NOT SUPPORT EMPTY REQUEST, SUPPORT EMPTY RESPONSE
  *         IR = 011 NOT SUPPORT UNKNOWN RESPONSES, SUPPORT EMPTY REQUEST    , SUPPORT EMPTY RESPONSE
+ *
+ *         The request and response sizes are the biggest frame (SOH to CR) that the
+ *         parse functions accepts for the command. i.e. The CF-220 variant when the
+ *         barriers have different formats.
  */
 typedef struct
 {
     uint8_t barriers;                    ///< Supported barriers.
     uint8_t suppdata;                    ///< The supported data.
+    uint16_t rqsize;                     ///< The maximum size in bytes of the request frame.
+    uint16_t rssize;                     ///< The maximum size in bytes of the response frame.
     char cmd[K_MAPS_PROTO_CMD_LENGTH+1]; ///< The MAPS command. Is a NULL terminate string.
     RequestParseCb  RequestParseFunc;    ///< The request parse callback function.
     ResponseParseCb ResponseParseFunc;   ///< The response parse callback function.
 }tMAPS_PROTO_CMD_INFO;
+
+/**
+ *
+ * @struct tMAPS_PROTO_PARSE_CTX
+ * @brief  The state of a parse shared with the parse callbacks.
+ *
+ *         When validate is 1 the callbacks only check the data section and
+ *         return before allocate the data. The data is allocated with
+ *         MapsProtoAllocData.
+ *
+ */
+struct sMAPS_PROTO_PARSE_CTX
+{
+    uint8_t validate;                   ///< 1 when the frame is only validated.
+    const tMAPS_PROTO_CMD_INFO *cinfo;  ///< The command of the frame. NULL on a NE of an unknown command.
+    void *buffer;                       ///< When is not NULL the data is stored here (K_MAPS_PROTO_MAX_DATA_SIZE bytes) instead of allocate it.
+    tMAPS_PROTO_STATUS_INFO *info;      ///< The reason of an error. The callbacks only set the field and offset.
+};
 //-----------------------------------------------------------------------------
 
 static const tMAPS_PROTO_CMD_INFO * MapsProtoFindCmd(const char *cmd);
-static uint16_t  MapsProtoCalculateLRC     (uint8_t *data, uint16_t size);
-static uint8_t   MapsProtoPrepareEMData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareEJData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareNoData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareAPData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareAJData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareTTData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareEAData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareDEData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareRHData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareSMData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareSCData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareCAData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareREData    (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareIARMData  (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareFailData  (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareDualData  (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareSingelData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareEndVehData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPreparePASpecial (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
-static uint8_t   MapsProtoPrepareSCSpecial (uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed);
+static uint16_t  MapsProtoCalculateLRC     (const uint8_t *data, uint16_t size);
+static void *    MapsProtoAllocData        (const tMAPS_PROTO_PARSE_CTX *ctx, size_t size);
+static uint8_t   MapsProtoDecodeFrame      (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, tMAPS_PROTO_PARSE_CTX *ctx);
+static void      MapsProtoFillHeader       (const uint8_t *frame, uint16_t size, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx, tMAPS_PROTO_FRAME_HEADER *header);
+static uint8_t   MapsProtoPrepareEMData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareEJData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareNoData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareAPData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareAJData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareTTData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareEAData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareDEData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareRHData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareSMData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareSCData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareCAData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareREData    (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareIARMData  (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareFailData  (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareDualData  (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareSingelData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareEndVehData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPreparePASpecial (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
+static uint8_t   MapsProtoPrepareSCSpecial (const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx);
 static tMAPS_PROTO_RAW_FRAME * MapsProtoCreateFrame(uint8_t type, uint8_t num, const char *cmd, uint8_t *data, uint16_t data_size);
+static tMAPS_PROTO_RAW_FRAME * MapsProtoCreateSpecFrame(uint8_t cmd_id, uint8_t num, const void *data);
+static uint8_t   MapsProtoWriteFrame       (uint8_t type, uint8_t num, const char *cmd, const uint8_t *data, uint16_t data_size,
+                                            uint8_t *frame, uint16_t frame_size, uint16_t *length, tMAPS_PROTO_STATUS_INFO *info);
+static uint8_t   MapsProtoEncodeSpec       (uint8_t cmd_id, const void *data, uint8_t *d, uint16_t *size, uint8_t *type, tMAPS_PROTO_STATUS_INFO *info);
+static uint8_t   MapsProtoSetStatus        (tMAPS_PROTO_STATUS_INFO *info, uint8_t status, uint16_t offset, uint16_t expected, uint16_t actual);
+static uint8_t   MapsProtoCallbackStatus   (const tMAPS_PROTO_PARSE_CTX *ctx, uint8_t code, uint16_t max, uint16_t size);
+static tMAPS_PROTO_STATUS_INFO * MapsProtoResetStatus(tMAPS_PROTO_STATUS_INFO *info, tMAPS_PROTO_STATUS_INFO *local);
+static void      MapsProtoSpecPutDec2      (uint8_t *d, uint8_t value, uint8_t max);
+
+#define spec_encoder_prototype(name,dtype,VARIANTS,cmd1,cmd2) \
+static uint8_t MapsProtoEncode##name##Data(const dtype *data, uint8_t *d, uint16_t *size, uint8_t *type, tMAPS_PROTO_STATUS_INFO *info);
+
+K_MAPS_PROTO_SPEC_MESSAGES(spec_encoder_prototype)
 //-----------------------------------------------------------------------------
 
+// The position of each command must be the same as its K_MAPS_PROTO_CMD_* identifier.
 static tMAPS_PROTO_CMD_INFO cmd_data [] =
 {
-    { .barriers = 0b101, .suppdata = 0b101, .cmd = "BR" , .RequestParseFunc = MapsProtoPrepareSingelData, .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b100, .suppdata = 0b101, .cmd = "CA" , .RequestParseFunc = MapsProtoPrepareCAData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b110, .cmd = "DE" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareDEData    , },
-    { .barriers = 0b101, .suppdata = 0b110, .cmd = "EA" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareEAData    , },
-    { .barriers = 0b101, .suppdata = 0b100, .cmd = "ER" , .RequestParseFunc = MapsProtoPrepareDualData  , .ResponseParseFunc = MapsProtoPrepareSingelData, },
-    { .barriers = 0b111, .suppdata = 0b111, .cmd = "FA" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b111, .cmd = "MV" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b111, .cmd = "PA" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b111, .cmd = "AC" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b100, .suppdata = 0b101, .cmd = "PR" , .RequestParseFunc = MapsProtoPrepareDualData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b111, .cmd = "RF" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b101, .suppdata = 0b101, .cmd = "SC" , .RequestParseFunc = MapsProtoPrepareSCData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b101, .cmd = "SM" , .RequestParseFunc = MapsProtoPrepareSMData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b100, .suppdata = 0b101, .cmd = "SR" , .RequestParseFunc = MapsProtoPrepareDualData  , .ResponseParseFunc = MapsProtoPrepareDualData  , },
-    { .barriers = 0b111, .suppdata = 0b110, .cmd = "TT" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareTTData    , },
-    { .barriers = 0b001, .suppdata = 0b100, .cmd = "RH" , .RequestParseFunc = MapsProtoPrepareRHData    , .ResponseParseFunc = MapsProtoPrepareRHData    , },
-    { .barriers = 0b010, .suppdata = 0b110, .cmd = "CB" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareSingelData, },
+    { .barriers = 0b101, .suppdata = 0b101, .rqsize =  8, .rssize =  9, .cmd = "BR" , .RequestParseFunc = MapsProtoPrepareSingelData, .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b100, .suppdata = 0b101, .rqsize = 11, .rssize =  9, .cmd = "CA" , .RequestParseFunc = MapsProtoPrepareCAData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b110, .rqsize =  7, .rssize = 19, .cmd = "DE" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareDEData    , },
+    { .barriers = 0b101, .suppdata = 0b110, .rqsize =  7, .rssize = 17, .cmd = "EA" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareEAData    , },
+    { .barriers = 0b101, .suppdata = 0b100, .rqsize =  9, .rssize = 10, .cmd = "ER" , .RequestParseFunc = MapsProtoPrepareDualData  , .ResponseParseFunc = MapsProtoPrepareSingelData, },
+    { .barriers = 0b111, .suppdata = 0b111, .rqsize =  7, .rssize =  9, .cmd = "FA" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b111, .rqsize =  7, .rssize =  9, .cmd = "MV" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b111, .rqsize =  7, .rssize =  9, .cmd = "PA" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b111, .rqsize =  7, .rssize =  9, .cmd = "AC" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b100, .suppdata = 0b101, .rqsize =  9, .rssize =  9, .cmd = "PR" , .RequestParseFunc = MapsProtoPrepareDualData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b111, .rqsize =  7, .rssize =  9, .cmd = "RF" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b101, .suppdata = 0b101, .rqsize = 15, .rssize =  9, .cmd = "SC" , .RequestParseFunc = MapsProtoPrepareSCData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b101, .rqsize = 12, .rssize =  9, .cmd = "SM" , .RequestParseFunc = MapsProtoPrepareSMData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b100, .suppdata = 0b101, .rqsize =  9, .rssize = 11, .cmd = "SR" , .RequestParseFunc = MapsProtoPrepareDualData  , .ResponseParseFunc = MapsProtoPrepareDualData  , },
+    { .barriers = 0b111, .suppdata = 0b110, .rqsize =  7, .rssize = 35, .cmd = "TT" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareTTData    , },
+    { .barriers = 0b001, .suppdata = 0b100, .rqsize = 10, .rssize = 12, .cmd = "RH" , .RequestParseFunc = MapsProtoPrepareRHData    , .ResponseParseFunc = MapsProtoPrepareRHData    , },
+    { .barriers = 0b010, .suppdata = 0b110, .rqsize =  7, .rssize = 10, .cmd = "CB" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareSingelData, },
 
     // THE NEXT 3 COMMANDS ARE SPECIAL SPONTANEOUS COMMANDS. INTERNAL USE ONLY
-    { .barriers = 0b111, .suppdata = 0b001, .cmd = "PAS", .RequestParseFunc = MapsProtoPreparePASpecial , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b101, .suppdata = 0b001, .cmd = "SCS", .RequestParseFunc = MapsProtoPrepareSCSpecial , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b110, .suppdata = 0b001, .cmd = "FAS", .RequestParseFunc = MapsProtoPrepareEndVehData, .ResponseParseFunc = MapsProtoPrepareNoData    , },
-
-    { .barriers = 0b111, .suppdata = 0b001, .cmd = "AJ" , .RequestParseFunc = MapsProtoPrepareAJData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b001, .cmd = "AP" , .RequestParseFunc = MapsProtoPrepareAPData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b100, .suppdata = 0b001, .cmd = "EJ" , .RequestParseFunc = MapsProtoPrepareEJData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b001, .cmd = "EM" , .RequestParseFunc = MapsProtoPrepareEMData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b001, .suppdata = 0b011, .cmd = "FP" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b110, .suppdata = 0b001, .cmd = "FR" , .RequestParseFunc = MapsProtoPrepareEndVehData, .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b001, .cmd = "FX" , .RequestParseFunc = MapsProtoPrepareFailData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b001, .suppdata = 0b011, .cmd = "IP" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b110, .suppdata = 0b011, .cmd = "IA" , .RequestParseFunc = MapsProtoPrepareIARMData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b110, .suppdata = 0b011, .cmd = "IR" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b001, .cmd = "PX" , .RequestParseFunc = MapsProtoPrepareFailData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b111, .suppdata = 0b011, .cmd = "RE" , .RequestParseFunc = MapsProtoPrepareREData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
-    { .barriers = 0b110, .suppdata = 0b011, .cmd = "RM" , .RequestParseFunc = MapsProtoPrepareIARMData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b001, .rqsize = 89, .rssize =  9, .cmd = "PAS", .RequestParseFunc = MapsProtoPreparePASpecial , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b101, .suppdata = 0b001, .rqsize = 14, .rssize =  9, .cmd = "SCS", .RequestParseFunc = MapsProtoPrepareSCSpecial , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b110, .suppdata = 0b001, .rqsize = 24, .rssize =  9, .cmd = "FAS", .RequestParseFunc = MapsProtoPrepareEndVehData, .ResponseParseFunc = MapsProtoPrepareNoData    , },
+
+    { .barriers = 0b111, .suppdata = 0b001, .rqsize = 95, .rssize =  9, .cmd = "AJ" , .RequestParseFunc = MapsProtoPrepareAJData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b001, .rqsize = 17, .rssize =  9, .cmd = "AP" , .RequestParseFunc = MapsProtoPrepareAPData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b100, .suppdata = 0b001, .rqsize = 13, .rssize =  9, .cmd = "EJ" , .RequestParseFunc = MapsProtoPrepareEJData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b001, .rqsize = 17, .rssize =  9, .cmd = "EM" , .RequestParseFunc = MapsProtoPrepareEMData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b001, .suppdata = 0b011, .rqsize =  7, .rssize =  9, .cmd = "FP" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b110, .suppdata = 0b001, .rqsize = 24, .rssize =  9, .cmd = "FR" , .RequestParseFunc = MapsProtoPrepareEndVehData, .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b001, .rqsize = 10, .rssize =  9, .cmd = "FX" , .RequestParseFunc = MapsProtoPrepareFailData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b001, .suppdata = 0b011, .rqsize =  7, .rssize =  9, .cmd = "IP" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b110, .suppdata = 0b011, .rqsize =  9, .rssize =  9, .cmd = "IA" , .RequestParseFunc = MapsProtoPrepareIARMData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b110, .suppdata = 0b011, .rqsize =  7, .rssize =  9, .cmd = "IR" , .RequestParseFunc = MapsProtoPrepareNoData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b001, .rqsize = 10, .rssize =  9, .cmd = "PX" , .RequestParseFunc = MapsProtoPrepareFailData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b111, .suppdata = 0b011, .rqsize = 39, .rssize =  9, .cmd = "RE" , .RequestParseFunc = MapsProtoPrepareREData    , .ResponseParseFunc = MapsProtoPrepareNoData    , },
+    { .barriers = 0b110, .suppdata = 0b011, .rqsize =  9, .rssize =  9, .cmd = "RM" , .RequestParseFunc = MapsProtoPrepareIARMData  , .ResponseParseFunc = MapsProtoPrepareNoData    , },
 };
+
+// The errno value and the name of each tMAPS_PROTO_STATUS
+static const int   status_errno[K_MAPS_PROTO_STATUS_COUNT] = { 0, EINVAL, ENOMEM, ENOSPC, ESPIPE, ERANGE, EBADF, EPERM, ENOEXEC };
+static const char *status_name [K_MAPS_PROTO_STATUS_COUNT] = { "OK", "PARAM", "NOMEM", "NOSPACE", "FRAMING", "LRC", "NUMBER", "COMMAND", "DATA" };
 //-----------------------------------------------------------------------------
 
 const tMAPS_PROTO_CMD_INFO * MapsProtoFindCmd(const char *cmd)
@@ -143,7 +213,7 @@ const tMAPS_PROTO_CMD_INFO * MapsProtoFindCmd(const char *cmd)
     {
         for (int i = 0, size = sizeof(cmd_data)/sizeof(cmd_data[0]); i < size; i++)
         {
-             if (strcmp(cmd_data[i].cmd,cmd) == 0)
+             if (cmd_data[i].cmd[0] == cmd[0] && strcmp(cmd_data[i].cmd,cmd) == 0)
                  return &cmd_data[i];
         }
     }
@@ -152,181 +222,113 @@ const tMAPS_PROTO_CMD_INFO * MapsProtoFindCmd(const char *cmd)
 }
 //-----------------------------------------------------------------------------
 
-uint16_t MapsProtoCalculateLRC(uint8_t *data, uint16_t size)
+uint16_t MapsProtoCalculateLRC(const uint8_t *data, uint16_t size)
 {
     uint16_t lrc;
-    uint8_t clrc[3];
+    uint8_t clrc[2];
     uint8_t xsum = 0;
 
     for (uint16_t i = 0; i < size; i++)
          xsum ^= data[i];
 
-    sprintf((char *)clrc,"%.2X",xsum);
-    clrc[0] = (clrc[0] > 0x39) ? (clrc[0] - 7) : clrc[0];
-    clrc[1] = (clrc[1] > 0x39) ? (clrc[1] - 7) : clrc[1];
+    // Each nibble is sent as 48 + nibble. i.e. 0x3A to 0x3F for A to F.
+    clrc[0] = 48 + (xsum >> 4);
+    clrc[1] = 48 + (xsum & 0x0F);
     memcpy(&lrc,clrc,2);
 
     return lrc;
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareNoData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+void * MapsProtoAllocData(const tMAPS_PROTO_PARSE_CTX *ctx, size_t size)
 {
-    (void) frame;
-    uint16_t fsize = (parsed->type) ? 9 : 7;  // The size of the frame. When response must be 9 on request 7
+    if (ctx->buffer == NULL)
+        return proto_calloc(1,size);
 
-    if (size == fsize)
-        return 0;
-
-    return 2;
+    return memset(ctx->buffer,0,size);
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareEMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareNoData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
-    tMAPS_PROTO_EM_DATA *data;
-
-    if (size == 16 || size == 17)
-    {
-        if ((data = (tMAPS_PROTO_EM_DATA *)calloc(1,sizeof(tMAPS_PROTO_EM_DATA))) == NULL)
-            return 1;
-
-        parsed->size = sizeof(tMAPS_PROTO_EM_DATA);
-        parsed->data = (char *) data;
-
-        if (!isdigit(frame[4]) || (frame[4] - 48) > 3)               // Mode
-            return 2;
-        if (!isxdigit(frame[5]))                                     // Axes
-            return 2;
-        if (!isdigit(frame[6]) || (frame[6] - 48) > 2)               // Hights
-            return 2;
-
-        data->work_mode   = frame[4] - 48;
-        data->axis_ispeed = (frame[5] < 58) ? (frame[5] - 48) : (frame[5] - 55);
-        data->axis_height = frame[6] - 48;
-
-        if (size == 16)                             // CF-150 & CF-24P
-        {
-            if (frame[7] != 49 && frame[7] != 50 && frame[7] != 51)  // HW Failure
-                return 2;
-            if (frame[8] != 49 && frame[8] != 50)                    // Cleaning
-                return 2;
-            if (!isdigit(frame[9]) || !isdigit(frame[10]))           // Firmware
-                return 2;
-
-            data->hw_failure   = frame[7] - 48;
-            data->se_cleaning  = frame[8] - 48;
-            data->firmware_ver = ((frame[9] - 48) * 10) + (frame[10] - 48);
-        }
-        else                                        // CF-220
-        {
-            if (frame[7] != 48 && frame[7] != 'R' && frame[7] != 'M' && frame[7] != 'N' && frame[7] != 'E' && frame[7] != 'T')  // Tow
-                return 2;
-            if (frame[8] != 49 && frame[8] != 50 && frame[8] != 51)  // HW Failure
-                return 2;
-            if (frame[9] != 49 && frame[9] != 50)                    // Cleaning
-                return 2;
-            if (!isdigit(frame[10]) || !isdigit(frame[11]))          // Firmware
-                return 2;
-            if (frame[12] != 'P' && frame[13] != 'N')                // Direction
-                return 2;
-
-            data->tow_detection  = frame[7];
-            data->hw_failure     = frame[8] - 48;
-            data->se_cleaning    = frame[9] - 48;
-            data->firmware_ver   = ((frame[10] - 48) * 10) + (frame[11] - 48);
-            data->rcvr_direction = frame[12];
-        }
+    (void) frame;
+    (void) ctx;
+    uint16_t fsize = (parsed->type) ? 9 : 7;  // The size of the frame. When response must be 9 on request 7
 
+    if (size == fsize)
         return 0;
-    }
 
     return 2;
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareEJData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
-{
-    tMAPS_PROTO_EJ_DATA *data;
-
-    if (size == 13)
-    {
-        for (uint8_t i = 4; i < 10; i++) {
-             if (!isdigit(frame[i]))
-                 return 2;
+// The parsers of the messages of maps_spec.h. d is the data in the frame
+#define spec_fail(m,o)            { ctx->info->field = #m; ctx->info->offset = (d - frame) + (o); return 2; }
+#define spec_check_DEC1(m,o,a,b)  if ((unsigned)(d[o] - 48 - (a)) > (unsigned)((b) - (a))) spec_fail(m,o)
+#define spec_check_DEC2(m,o,a,b)  if ((uint8_t)(d[o] - 48) > 9 || (uint8_t)(d[(o)+1] - 48) > 9 || (unsigned)(spec_dec2(d,o) - (a)) > (unsigned)((b) - (a))) spec_fail(m,o)
+#define spec_check_DEC2R(m,o,a,b) spec_check_DEC2(m,o,a,b)
+#define spec_check_HEX1(m,o,a,b)  if (!isxdigit(d[o])) spec_fail(m,o)
+#define spec_check_CHR(m,o,a,b)   if (!d[o] || !memchr(a,d[o],sizeof(a) - 1)) spec_fail(m,o)
+#define spec_check_SET(m,o,a,b)
+#define spec_check_FILL(m,o,a,b)
+#define spec_check_CHK(m,o,a,b)
+
+#define spec_decode_DEC1(m,o,a,b) data->m = d[o] - 48;
+#define spec_decode_DEC2(m,o,a,b) data->m = spec_dec2(d,o);
+#define spec_decode_DEC2R(m,o,a,b) data->m = spec_dec2(d,o);
+#define spec_decode_HEX1(m,o,a,b) data->m = spec_hex(d[o]);
+#define spec_decode_CHR(m,o,a,b)  data->m = d[o];
+#define spec_decode_SET(m,o,a,b)  data->m = a;
+#define spec_decode_FILL(m,o,a,b)
+#define spec_decode_CHK(m,o,a,b)
+
+#define spec_check(kind,m,o,a,b)  spec_check_##kind(m,o,a,b)
+#define spec_decode(kind,m,o,a,b) spec_decode_##kind(m,o,a,b)
+
+#define spec_parse_variant(fsize,dpos,when,FIELDS)                                                               \
+        case fsize:                                                                                              \
+        {                                                                                                        \
+            const uint8_t *d = &frame[dpos];                                                                     \
+                                                                                                                 \
+            FIELDS(spec_check)                                                                                   \
+            if (ctx->validate)                                                                                   \
+                return 0;                                                                                        \
+            if ((data = (tMAPS_PROTO_SPEC_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_SPEC_DATA))) == NULL) \
+                return 1;                                                                                        \
+                                                                                                                 \
+            FIELDS(spec_decode)                                                                                  \
+            parsed->size = sizeof(tMAPS_PROTO_SPEC_DATA);                                                        \
+            parsed->data = (char *) data;                                                                        \
+                                                                                                                 \
+            return 0;                                                                                            \
         }
 
-        if ((data = (tMAPS_PROTO_EJ_DATA *)calloc(1,sizeof(tMAPS_PROTO_EJ_DATA))) == NULL)
-            return 1;
-
-        data->paxes  = ((frame[4] - 48) * 10) + (frame[5] - 48);
-        data->naxes  = ((frame[6] - 48) * 10) + (frame[7] - 48);
-        data->ispeed = ((frame[8] - 48) * 10) + (frame[9] - 48);
-
-        parsed->size = sizeof(tMAPS_PROTO_EJ_DATA);
-        parsed->data = (char *) data;
-
-        return 0;
-    }
-
-    return 2;
+#define spec_parser(name,type,VARIANTS,cmd1,cmd2)                                                                              \
+uint8_t MapsProtoPrepare##name##Data(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx) \
+{                                                                                                                              \
+    typedef type tMAPS_PROTO_SPEC_DATA;  /* The casts of the variants. The file also compiles as C++ */                       \
+    tMAPS_PROTO_SPEC_DATA *data;                                                                                               \
+                                                                                                                               \
+    switch (size)                                                                                                              \
+    {                                                                                                                          \
+        VARIANTS(spec_parse_variant)                                                                                           \
+    }                                                                                                                          \
+                                                                                                                               \
+    return 2;                                                                                                                  \
 }
-//-----------------------------------------------------------------------------
-
-uint8_t MapsProtoPrepareAPData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
-{
-    tMAPS_PROTO_AP_DATA *data = (tMAPS_PROTO_AP_DATA *)calloc(1,sizeof(tMAPS_PROTO_AP_DATA));
-
-    if (data == NULL)
-        return 1;
 
-    parsed->data = (char *) data;
-    parsed->size = sizeof(tMAPS_PROTO_AP_DATA);
-
-    if (size == 9)        // IS A CF-150 BARRIER OR THIRD SM BYTE IS 0 [CF-24P] OR IS 1 [CF-220]
-    {
-        if (!isdigit(frame[4]) || !isdigit(frame[5]))
-            return 2;
-
-        data->smbyte  = 0;
-        data->vheight = ((frame[4] - 48) * 10) - (frame[5] - 48);
-        return 0;
-    }
-    else if (size == 17)  // ONLY CF-220 & CF-24P WHEN THIRD SM BYTE IS 2.
-    {
-        if (frame[4] != 48 && frame[4] != 'N' && frame[4] != 'P')
-            return 2;
-
-        for (uint8_t i = 6; i < 14; i++) {
-            if (!isdigit(frame[i]))
-                return 2;
-        }
-
-        data->smbyte  = 2;
-        data->vaxis = frame[4];
-
-        if (data->axis_height > 15) // The max value accoding to MAPS documentation is 15
-            return 2;
-
-        data->axis_height = ((frame[6]   - 48) * 10) + (frame[7]  - 48);
-        data->vmax_height = ((frame[8]   - 48) * 10) + (frame[9]  - 48);
-        data->hmin_height = ((frame[10]  - 48) * 10) + (frame[11] - 48);
-        data->lmax_height = ((frame[12]  - 48) * 10) + (frame[13] - 48);
-
-        return 0;
-    }
-
-    return 2;
-}
+K_MAPS_PROTO_SPEC_MESSAGES(spec_parser)
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareAJData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareAJData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     tMAPS_PROTO_BARRIER_ADJUST *data;
 
     if (size == 95)
     {
-        if ((data = (tMAPS_PROTO_BARRIER_ADJUST *)calloc(1,sizeof(tMAPS_PROTO_BARRIER_ADJUST))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_BARRIER_ADJUST *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_BARRIER_ADJUST))) == NULL)
             return 1;
 
         memcpy(data->rcv_map8,&frame[4],K_MAPS_PROTO_RECEIVE_GROUP8);
@@ -341,7 +343,7 @@ uint8_t MapsProtoPrepareAJData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareTTData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareTTData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     tMAPS_PROTO_TT_DATA *data;
 
@@ -356,7 +358,9 @@ uint8_t MapsProtoPrepareTTData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
                 return 2;
         }
 
-        if ((data = (tMAPS_PROTO_TT_DATA *)calloc(1,sizeof(tMAPS_PROTO_TT_DATA))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_TT_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_TT_DATA))) == NULL)
             return 1;
 
         data->mvar = frame[6];
@@ -373,35 +377,7 @@ uint8_t MapsProtoPrepareTTData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareEAData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
-{
-    tMAPS_PROTO_EA_DATA *data;
-
-    if (size == 17)
-    {
-        for (uint8_t i = 6; i <= 13; i++) {
-             if (!isdigit(frame[i]))
-                 return 2;
-        }
-
-        if ((data = (tMAPS_PROTO_EA_DATA *)calloc(1,sizeof(tMAPS_PROTO_EA_DATA))) == NULL)
-            return 1;
-
-        data->imax_height = ((frame[6]  - 48) * 10) + (frame[7]  - 48);
-        data->umax_height = ((frame[8]  - 48) * 10) + (frame[9]  - 48);
-        data->umin_height = ((frame[10] - 48) * 10) + (frame[11] - 48);
-        data->lmax_height = ((frame[12] - 48) * 10) + (frame[13] - 48);
-        parsed->size = sizeof(tMAPS_PROTO_EA_DATA);
-        parsed->data = (char *) data;
-
-        return 0;
-    }
-
-    return 2;
-}
-//-----------------------------------------------------------------------------
-
-uint8_t MapsProtoPrepareDEData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareDEData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     tMAPS_PROTO_DE_DATA *data;
 
@@ -421,7 +397,9 @@ uint8_t MapsProtoPrepareDEData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
             return 2;
         if (!isdigit(frame[12]) || !isdigit(frame[13]))  // Firmware
             return 2;
-        if ((data = (tMAPS_PROTO_DE_DATA *)calloc(1,sizeof(tMAPS_PROTO_DE_DATA))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_DE_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_DE_DATA))) == NULL)
             return 1;
 
         data->work_mode      = frame[6] - 48;
@@ -443,7 +421,7 @@ uint8_t MapsProtoPrepareDEData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareRHData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareRHData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     uint8_t number;
     tMAPS_PROTO_RH_DATA *data;
@@ -458,7 +436,9 @@ uint8_t MapsProtoPrepareRHData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
             return 2;
         if (number < 1 || number > 24)
             return 2;
-        if ((data = (tMAPS_PROTO_RH_DATA *)calloc(1,sizeof(tMAPS_PROTO_RH_DATA))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_RH_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_RH_DATA))) == NULL)
             return 1;
 
         data->wmode  = frame[dpos] - 48;
@@ -473,7 +453,7 @@ uint8_t MapsProtoPrepareRHData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareSMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareSMData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     tMAPS_PROTO_SM_DATA *data;
 
@@ -489,7 +469,9 @@ uint8_t MapsProtoPrepareSMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
             return 2;
         if (size == 12 && frame[8] != 'P' && frame[8] != 'N')
             return 2;
-        if ((data = (tMAPS_PROTO_SM_DATA *)calloc(1,sizeof(tMAPS_PROTO_SM_DATA))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_SM_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_SM_DATA))) == NULL)
             return 1;
 
         data->work_mode      = frame[4] - 48;
@@ -507,10 +489,8 @@ uint8_t MapsProtoPrepareSMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareSCData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareSCData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
-    char stime[4] = {0};
-
     if (size == 11)      // SC REQUEST. HAVE 4 BYTES IN DATA
     {
         tMAPS_PROTO_SC_DATA *data;
@@ -520,12 +500,13 @@ uint8_t MapsProtoPrepareSCData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
             return 2;
         if (!isdigit(frame[5]) || !isdigit(frame[6]) || !isdigit(frame[7]))
             return 2;
-        if ((data = (tMAPS_PROTO_SC_DATA *)calloc(1,sizeof(tMAPS_PROTO_SC_DATA))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_SC_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_SC_DATA))) == NULL)
             return 1;
 
-        memcpy(stime,&frame[5],3);
         data->mode      = frame[4];
-        data->send_time = atoi(stime);
+        data->send_time = (frame[5] - 48) * 100 + spec_dec2(frame,6);
         parsed->size = sizeof (tMAPS_PROTO_SC_DATA);
         parsed->data = (char *) data;
 
@@ -545,7 +526,12 @@ uint8_t MapsProtoPrepareSCData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 
         if (!isdigit(frame[11]))
             return 2;
-        if ((data = (tMAPS_PROTO_SC_SPECIAL*)calloc(1,sizeof(tMAPS_PROTO_SC_SPECIAL))) == NULL)
+
+        strcpy(parsed->cmd,"SCS");
+
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_SC_SPECIAL*)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_SC_SPECIAL))) == NULL)
             return 1;
 
         data->mode = 'A';
@@ -553,7 +539,6 @@ uint8_t MapsProtoPrepareSCData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
         data->MODES.ABCMODES.sweeps_num = frame[11] - 48;
         memcpy(data->MODES.ABCMODES.sensors,&frame[5],6);
 
-        strcpy(parsed->cmd,"SCS");
         parsed->size = sizeof(tMAPS_PROTO_SC_SPECIAL);
         parsed->data = (char *) data;
 
@@ -564,13 +549,15 @@ uint8_t MapsProtoPrepareSCData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareCAData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareCAData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     if (size == 11 && isdigit(frame[4]) && isdigit(frame[5]) && isdigit(frame[6]) && isdigit(frame[7]))
     {
-        tMAPS_PROTO_CA_DATA *data = (tMAPS_PROTO_CA_DATA *)calloc(1,sizeof(tMAPS_PROTO_CA_DATA));
+        tMAPS_PROTO_CA_DATA *data;
 
-        if (data == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_CA_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_CA_DATA))) == NULL)
             return 1;
 
         data->ca_sensors = ((frame[4] - 48) * 10) + (frame[5] - 48);
@@ -585,16 +572,18 @@ uint8_t MapsProtoPrepareCAData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareREData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareREData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     if (size == 7)
         return 0;
     else if (size == 39)
     {
         uint8_t pos = 4;
-        tMAPS_PROTO_RE_DATA *data = (tMAPS_PROTO_RE_DATA *) calloc(1,sizeof(tMAPS_PROTO_RE_DATA));
+        tMAPS_PROTO_RE_DATA *data;
 
-        if (data == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((data = (tMAPS_PROTO_RE_DATA *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_RE_DATA))) == NULL)
             return 1;
 
         memcpy(data->bmodel  ,&frame[pos+1] ,K_MAPS_PROTO_BMODEL_LENGTH);
@@ -612,7 +601,7 @@ uint8_t MapsProtoPrepareREData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareIARMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareIARMData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     if (size == 7)      // No data
         return 0;
@@ -620,7 +609,9 @@ uint8_t MapsProtoPrepareIARMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARS
     {
         if (!isdigit(frame[4]) && !isdigit(frame[5]))
             return 2;
-        if ((parsed->data = (char *)calloc(1,sizeof(char))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((parsed->data = (char *)MapsProtoAllocData(ctx,sizeof(char))) == NULL)
             return 1;
 
         parsed->size    = 1;
@@ -633,35 +624,7 @@ uint8_t MapsProtoPrepareIARMData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARS
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareFailData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
-{
-    tMAPS_PROTO_FAILURE_DATA *data;
-
-    if (size == 10)
-    {
-        if (frame[4] != 'R' && frame[4] != 'E')
-            return 2;
-        if (!isdigit(frame[5]) || (frame[5] - 48) > 8)
-            return 2;
-        if (!isdigit(frame[6]) || (frame[6] - 48) > 8)
-            return 2;
-        if ((data = (tMAPS_PROTO_FAILURE_DATA *)calloc(1,sizeof(tMAPS_PROTO_FAILURE_DATA))) == NULL)
-            return 1;
-
-        data->type    = frame[4];
-        data->ngroup  = frame[5] - 48;
-        data->nsensor = frame[6] - 48;
-        parsed->size  = sizeof(tMAPS_PROTO_FAILURE_DATA);
-        parsed->data  = (char *) data;
-
-        return 0;
-    }
-
-    return 2;
-}
-//-----------------------------------------------------------------------------
-
-uint8_t MapsProtoPrepareDualData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareDualData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     uint8_t number;
     uint8_t fpos   = (parsed->type) ?  4 : 2; // CMF position in the frame. When response start in pos 4 on request 2
@@ -675,7 +638,9 @@ uint8_t MapsProtoPrepareDualData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARS
             return 2;
         if (!strcmp(parsed->cmd,"SR") && (number < 3 || number > 10))
             return 2;
-        if ((parsed->data = (char *)calloc(1,sizeof(char))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((parsed->data = (char *)MapsProtoAllocData(ctx,sizeof(char))) == NULL)
             return 1;
 
         parsed->size    = 1;
@@ -688,7 +653,7 @@ uint8_t MapsProtoPrepareDualData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARS
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareSingelData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareSingelData(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     uint8_t fpos   = (parsed->type) ?  4 : 2; // CMF position in the frame. When response start in pos 4 on request 2
     uint16_t fsize = (parsed->type) ? 10 : 8; // The size of the frame. When response must be 9 on request 7
@@ -697,7 +662,9 @@ uint8_t MapsProtoPrepareSingelData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PA
     {
         if (!strcmp(parsed->cmd,"BR") && (frame[fpos+2] < 49 || frame[fpos+2] > 53))
             return 2;
-        if ((parsed->data = (char *)calloc(1,sizeof(char))) == NULL)
+        if (ctx->validate)
+            return 0;
+        if ((parsed->data = (char *)MapsProtoAllocData(ctx,sizeof(char))) == NULL)
             return 1;
 
         parsed->size    = 1;
@@ -710,57 +677,16 @@ uint8_t MapsProtoPrepareSingelData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PA
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareEndVehData(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
-{
-    tMAPS_PROTO_END_VEHICLE *data;
-
-    if (size != 11 && size != 12 && size != 24)
-        return 2;
-
-    for (uint16_t i = 4, s = (size - 7) + i, c = (s > 8) ? (s - 1) : 8; i < s; i++)
-    {
-         if (i == c && (frame[i] != 'M' && frame[i] != 'X' && (frame[i] < 65 || frame[i] > 70)))
-             return 2;
-         else if (i != c && !isdigit(frame[i]))
-             return 2;
-    }
-
-    if ((data = (tMAPS_PROTO_END_VEHICLE *)calloc(1,sizeof(tMAPS_PROTO_END_VEHICLE))) == NULL)
-        return 1;
-
-    // Common bytes are 4 to 7
-    data->paxes  = ((frame[4] - 48) * 10) + (frame[5] - 48);
-    data->naxes  = ((frame[6] - 48) * 10) + (frame[7] - 48);
-    data->vclass = (size == 12) ? frame[8] : 0;
-    data->smb    = (size == 11) ? 3 : 1;
-
-    if (size == 24) // Is a CF-220 barrier message with the second SM BYTE equal to 2
-    {
-        data->paxes10 = ((frame[8]  - 48) * 10) + (frame[9]  - 48);
-        data->naxes10 = ((frame[10] - 48) * 10) + (frame[11] - 48);
-        data->paxes16 = ((frame[12] - 48) * 10) + (frame[13] - 48);
-        data->naxes16 = ((frame[14] - 48) * 10) + (frame[15] - 48);
-        data->paxes22 = ((frame[16] - 48) * 10) + (frame[17] - 48);
-        data->naxes22 = ((frame[18] - 48) * 10) + (frame[19] - 48);
-        data->vclass  = frame[20];
-        data->smb     = 2;
-    }
-
-    parsed->data = (char *) data;
-    parsed->size = sizeof(tMAPS_PROTO_END_VEHICLE);
-
-    return 0;
-}
-//-----------------------------------------------------------------------------
-
-uint8_t MapsProtoPreparePASpecial(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPreparePASpecial(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     tMAPS_PROTO_BARRIER_ADJUST *bdata;
 
     parsed->size = size-1;
     strcpy(parsed->cmd,"PAS");
 
-    if ((bdata = (tMAPS_PROTO_BARRIER_ADJUST *)calloc(1,sizeof(tMAPS_PROTO_BARRIER_ADJUST))) == NULL)
+    if (ctx->validate)
+        return 0;
+    if ((bdata = (tMAPS_PROTO_BARRIER_ADJUST *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_BARRIER_ADJUST))) == NULL)
         return 1;
 
     memcpy(bdata->rcv_map8,frame,K_MAPS_PROTO_RECEIVE_GROUP8);
@@ -771,133 +697,152 @@ uint8_t MapsProtoPreparePASpecial(uint8_t *frame, uint16_t size, tMAPS_PROTO_PAR
 }
 //-----------------------------------------------------------------------------
 
-uint8_t MapsProtoPrepareSCSpecial(uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed)
+uint8_t MapsProtoPrepareSCSpecial(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx)
 {
     tMAPS_PROTO_SC_SPECIAL *scdata;
     char mode = (size == 13) ? 'D' : 'H';
 
-    parsed->size = K_MAPS_PROTO_DEHI_BUFFER;
+    parsed->size = sizeof(tMAPS_PROTO_SC_SPECIAL);
     strcpy(parsed->cmd,"SCS");
 
-    if ((scdata = (tMAPS_PROTO_SC_SPECIAL *)calloc(1,sizeof(tMAPS_PROTO_SC_SPECIAL))) == NULL)
+    if (ctx->validate)
+        return 0;
+    if ((scdata = (tMAPS_PROTO_SC_SPECIAL *)MapsProtoAllocData(ctx,sizeof(tMAPS_PROTO_SC_SPECIAL))) == NULL)
         return 1;
 
     scdata->mode = mode;
-    memcpy(scdata->MODES.DEHI_MODES,frame,parsed->size);
+    memcpy(scdata->MODES.DEHI_MODES,frame,K_MAPS_PROTO_DEHI_BUFFER);
     parsed->data = (char *) scdata;
 
     return 0;
 }
 //-----------------------------------------------------------------------------
 
-tMAPS_PROTO_RAW_FRAME * MapsProtoCreateFrame(uint8_t type, uint8_t num, const char *cmd, uint8_t *data, uint16_t data_size)
+uint8_t MapsProtoWriteFrame(uint8_t type, uint8_t num, const char *cmd, const uint8_t *data, uint16_t data_size,
+                            uint8_t *frame, uint16_t frame_size, uint16_t *length, tMAPS_PROTO_STATUS_INFO *info)
 {
     const char   *types[3]  = {"","RS","NE"};
-    tMAPS_PROTO_RAW_FRAME      *frame = NULL;
     const tMAPS_PROTO_CMD_INFO *cinfo = NULL;
     uint16_t lrc , pos = 2, size = (type) ? (9+data_size) : (7+data_size);
 
     if (type > 2 || num > 9 || !cmd || (!(cinfo = MapsProtoFindCmd(cmd)) && type != 2) || (!data && data_size))
-        frame_error(EINVAL);
+        return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+
+    info->cmd_id = (cinfo) ? (uint8_t)(cinfo - cmd_data) : K_MAPS_PROTO_CMD_UNKNOWN;
+
     if (type == 1 && !data_size && !(cinfo->suppdata & 1))
-        frame_error(EINVAL);
+        return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
     if (type == 0 && !data_size && !(cinfo->suppdata & 2))
-        frame_error(EINVAL);
-    if ((frame = (tMAPS_PROTO_RAW_FRAME *)calloc(1,sizeof(tMAPS_PROTO_RAW_FRAME))) == NULL)
-        frame_error(ENOMEM);
-    if ((frame->data = (uint8_t *)calloc(size,sizeof(uint8_t))) == NULL)
-        frame_error(ENOMEM);
+        return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+
+    *length = size;
+
+    if (frame == NULL)  // Only check the params
+        return K_MAPS_PROTO_STATUS_OK;
+    if (frame_size < size)
+        return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_NOSPACE,0,size,frame_size);
 
-    frame->data[0] = K_MAPS_PROTO_SOH;
-    frame->data[1] = num + 48;
-    frame->size    = size;
+    frame[0] = K_MAPS_PROTO_SOH;
+    frame[1] = num + 48;
 
     if (type) {
-        memcpy(&frame->data[pos],types[type],2);
+        memcpy(&frame[pos],types[type],2);
         pos += 2;
     }
 
-    memcpy(&frame->data[pos],cmd,2);
+    memcpy(&frame[pos],cmd,2);
     pos += 2;
 
     if (data_size) {
-        memcpy(&frame->data[pos],data,data_size);
+        memcpy(&frame[pos],data,data_size);
         pos += data_size;
     }
 
-    lrc = MapsProtoCalculateLRC(&frame->data[1],size-4);
-    memcpy(&frame->data[pos],&lrc,2);
-    frame->data[size-1] = K_MAPS_PROTO_CR;
+    lrc = MapsProtoCalculateLRC(&frame[1],size-4);
+    memcpy(&frame[pos],&lrc,2);
+    frame[size-1] = K_MAPS_PROTO_CR;
 
-    return frame;
+    stats_create(info->cmd_id,size);
+    return K_MAPS_PROTO_STATUS_OK;
 }
 //-----------------------------------------------------------------------------
-//############################# PUBLIC  FUNCTIONS #############################
-//-------------  F R E E   R E S O U R C E S   F U N C T I O N S  -------------
 
-void MapsProtoFreeRawFrame(tMAPS_PROTO_RAW_FRAME *raw)
+tMAPS_PROTO_RAW_FRAME * MapsProtoCreateFrame(uint8_t type, uint8_t num, const char *cmd, uint8_t *data, uint16_t data_size)
 {
-    if (raw)
-    {
-        if (raw->data)
-            free(raw->data);
+    uint8_t status;
+    uint16_t size;
+    tMAPS_PROTO_RAW_FRAME   *frame = NULL;
+    tMAPS_PROTO_STATUS_INFO info;
 
-        free(raw);
-    }
-}
-//-----------------------------------------------------------------------------
+    trace_create_entry(type,num,data_size);
 
-void MapsProtoFreeParsedFrame(tMAPS_PROTO_PARSED_FRAME *parsed)
-{
-    if (parsed)
+    if ((status = MapsProtoWriteFrame(type,num,cmd,data,data_size,NULL,0,&size,MapsProtoResetStatus(NULL,&info))))
     {
-        if (parsed->data)
-            free(parsed->data);
-
-        free(parsed);
+        trace_create_return(info.cmd_id,0,status);
+        frame_error(status_errno[status]);
     }
+    if ((frame = (tMAPS_PROTO_RAW_FRAME *)proto_calloc(1,sizeof(tMAPS_PROTO_RAW_FRAME))) == NULL)
+        frame_error(ENOMEM);
+    if ((frame->data = (uint8_t *)proto_calloc(size,sizeof(uint8_t))) == NULL)
+        frame_error(ENOMEM);
+
+    frame->size = size;
+    MapsProtoWriteFrame(type,num,cmd,data,data_size,frame->data,size,&size,&info);
+    trace_create_return(info.cmd_id,size,K_MAPS_PROTO_STATUS_OK);
+
+    return frame;
 }
 //-----------------------------------------------------------------------------
-//----------------------  P A R S E   F U N C T I O N S  ----------------------
 
-tMAPS_PROTO_PARSED_FRAME * MapsProtoParseFrame(uint8_t *frame, uint16_t size)
+uint8_t MapsProtoDecodeFrame(const uint8_t *frame, uint16_t size, tMAPS_PROTO_PARSED_FRAME *parsed, tMAPS_PROTO_PARSE_CTX *ctx)
 {
     uint8_t code;
     uint16_t lrc, clrc;
-    uint8_t errors [] = {0, ENOMEM, ENOEXEC};
-    tMAPS_PROTO_PARSED_FRAME *parsed  = NULL;
-    const tMAPS_PROTO_CMD_INFO *cinfo = NULL;
-
-    if (frame == NULL)
-        parse_error(EINVAL);
-    if (size < 7)                                                                                                // INVALID FRAME. Minimum size is 7
-        parse_error(ESPIPE);
-    if ((parsed = (tMAPS_PROTO_PARSED_FRAME *)calloc(1, sizeof (tMAPS_PROTO_PARSED_FRAME))) == NULL)
-        parse_error(ENOMEM);
+    tMAPS_PROTO_STATUS_INFO *info = ctx->info;
 
     if (size == K_MAPS_PROTO_PASF_SIZE+1 && frame[88] == K_MAPS_PROTO_CR)                                        // (ALL BARRIERS) PA SPECIAL 88 + <CR>
     {
-        if (MapsProtoPreparePASpecial(frame,size,parsed))
-            parse_error(ENOMEM);
+        ctx->cinfo = &cmd_data[K_MAPS_PROTO_CMD_PAS];
+
+        info->cmd_id = K_MAPS_PROTO_CMD_PAS;
+
+        trace_prepare_entry(K_MAPS_PROTO_CMD_PAS,0,size);
+        code = MapsProtoPreparePASpecial(frame,size,parsed,ctx);
+        trace_prepare_return(K_MAPS_PROTO_CMD_PAS,0,code);
+
+        if (code)
+            return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_NOMEM,0,0,0);
     }
-    else if ((size == K_MAPS_PROTO_SCSF_SIZE+1 && frame[12] == K_MAPS_PROTO_CR) ||                               // (CF220 & CF24P) SC SPECIAL MODES D,E 12 + <CR>
-             (size == K_MAPS_PROTO_SCSF_SIZE+2 && frame[12] == K_MAPS_PROTO_CR && frame[13] == K_MAPS_PROTO_LF)) // (CF220 & CF24P) SC SPECIAL MODES H,I 12 + <CR><LF>
+    else if (frame[0] != K_MAPS_PROTO_SOH &&                                                                     // A framed message of 13 bytes (EJ) also ends with <CR>
+             ((size == K_MAPS_PROTO_SCSF_SIZE+1 && frame[12] == K_MAPS_PROTO_CR) ||                              // (CF220 & CF24P) SC SPECIAL MODES D,E 12 + <CR>
+              (size == K_MAPS_PROTO_SCSF_SIZE+2 && frame[12] == K_MAPS_PROTO_CR && frame[13] == K_MAPS_PROTO_LF)))// (CF220 & CF24P) SC SPECIAL MODES H,I 12 + <CR><LF>
     {
-        if (MapsProtoPrepareSCSpecial(frame,size,parsed))
-            parse_error(ENOMEM);
+        ctx->cinfo = &cmd_data[K_MAPS_PROTO_CMD_SCS];
+
+        info->cmd_id = K_MAPS_PROTO_CMD_SCS;
+
+        trace_prepare_entry(K_MAPS_PROTO_CMD_SCS,0,size);
+        code = MapsProtoPrepareSCSpecial(frame,size,parsed,ctx);
+        trace_prepare_return(K_MAPS_PROTO_CMD_SCS,0,code);
+
+        if (code)
+            return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_NOMEM,0,0,0);
     }
     else
     {
         parsed->num = frame[1] - 48;      // Get the frame number.
         memcpy(&lrc,&frame[size-3],2);    // Get the LRC checksum (2 bytes).
         clrc = MapsProtoCalculateLRC(&frame[1],size-4); // Calculate the checksum (LRC)
+        trace_lrc(size,lrc_value((uint8_t *)&clrc),lrc_value(&frame[size-3]));
 
         if (lrc != clrc)
-            parse_error(ERANGE);
-        if (frame[0] != K_MAPS_PROTO_SOH || frame[size-1] != K_MAPS_PROTO_CR)
-            parse_error(ESPIPE);
+            return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_LRC,size-3,lrc_value((uint8_t *)&clrc),lrc_value(&frame[size-3]));
+        if (frame[0] != K_MAPS_PROTO_SOH)
+            return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_FRAMING,0,K_MAPS_PROTO_SOH,frame[0]);
+        if (frame[size-1] != K_MAPS_PROTO_CR)
+            return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_FRAMING,size-1,K_MAPS_PROTO_CR,frame[size-1]);
         if (parsed->num > 9)
-            parse_error(EBADF);
+            return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_NUMBER,1,0,frame[1]);
 
         if (!strncmp((char *)&frame[2],"NE",2))         // ### Unknown or not Executed Message ###
         {
@@ -905,32 +850,290 @@ tMAPS_PROTO_PARSED_FRAME * MapsProtoParseFrame(uint8_t *frame, uint16_t size)
             memcpy(parsed->cmd,&frame[4],2);
 
             if (size != 9)
-                parse_error(EPERM);
+                return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_COMMAND,4,9,size);
+            if ((ctx->cinfo = MapsProtoFindCmd(parsed->cmd)))
+                info->cmd_id = ctx->cinfo - cmd_data;
         }
         else if (!strncmp((char *)&frame[2],"RS",2))    // ### Response Message ###
         {
             parsed->type = 1; // Set frame type to RS (Response).
             memcpy(parsed->cmd,&frame[4],2);
 
-            if ((cinfo = MapsProtoFindCmd(parsed->cmd)) == NULL)
-                parse_error(EPERM);
-            if ((code = cinfo->ResponseParseFunc(frame,size,parsed)))
-                parse_error(errors[code]);
+            if ((ctx->cinfo = MapsProtoFindCmd(parsed->cmd)) == NULL)
+                return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_COMMAND,4,0,0);
+
+            info->cmd_id = ctx->cinfo - cmd_data;
+
+            trace_prepare_entry(info->cmd_id,1,size);
+            code = ctx->cinfo->ResponseParseFunc(frame,size,parsed,ctx);
+            trace_prepare_return(info->cmd_id,1,code);
+
+            if (code)
+                return MapsProtoCallbackStatus(ctx,code,ctx->cinfo->rssize,size);
         }
         else                                          // ### Request or Spontaneous Message ###
-        {   
+        {
             if (!strncmp((char *)&frame[2],"FA",2) && size > 7) // Spontaneous FA request command have data. Check for it
                 memcpy(parsed->cmd,"FAS",3);                    // To differentiate Spontaneous from the normal FA request we add an S at the end.
             else
                 memcpy(parsed->cmd,&frame[2],2);
 
-            if ((cinfo = MapsProtoFindCmd(parsed->cmd)) == NULL)
-                parse_error(EPERM);
-            if ((code = cinfo->RequestParseFunc(frame,size,parsed)))
-                parse_error(errors[code]);
-        }        
+            if ((ctx->cinfo = MapsProtoFindCmd(parsed->cmd)) == NULL)
+                return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_COMMAND,2,0,0);
+
+            info->cmd_id = ctx->cinfo - cmd_data;
+
+            trace_prepare_entry(info->cmd_id,0,size);
+            code = ctx->cinfo->RequestParseFunc(frame,size,parsed,ctx);
+            trace_prepare_return(info->cmd_id,0,code);
+
+            if (code)
+                return MapsProtoCallbackStatus(ctx,code,ctx->cinfo->rqsize,size);
+
+            if (!strcmp(parsed->cmd,"SCS"))  // The SC SPECIAL with MAPS structure is parsed by the SC callback
+                ctx->cinfo = &cmd_data[K_MAPS_PROTO_CMD_SCS];
+        }
+    }
+
+    return K_MAPS_PROTO_STATUS_OK;
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoCallbackStatus(const tMAPS_PROTO_PARSE_CTX *ctx, uint8_t code, uint16_t max, uint16_t size)
+{
+    if (code == 1)
+        return MapsProtoSetStatus(ctx->info,K_MAPS_PROTO_STATUS_NOMEM,0,0,0);
+    if (ctx->info->field)  // A field of a message of maps_spec.h. The offset is set by the parser
+        return MapsProtoSetStatus(ctx->info,K_MAPS_PROTO_STATUS_DATA,ctx->info->offset,0,0);
+
+    return MapsProtoSetStatus(ctx->info,K_MAPS_PROTO_STATUS_DATA,0,max,size);
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoSetStatus(tMAPS_PROTO_STATUS_INFO *info, uint8_t status, uint16_t offset, uint16_t expected, uint16_t actual)
+{
+    info->status   = (tMAPS_PROTO_STATUS) status;
+    info->offset   = offset;
+    info->expected = expected;
+    info->actual   = actual;
+
+    return status;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STATUS_INFO * MapsProtoResetStatus(tMAPS_PROTO_STATUS_INFO *info, tMAPS_PROTO_STATUS_INFO *local)
+{
+    info = (info) ? info : local;
+
+    memset(info,0,sizeof(tMAPS_PROTO_STATUS_INFO));
+    info->cmd_id = K_MAPS_PROTO_CMD_UNKNOWN;
+
+    return info;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoFillHeader(const uint8_t *frame, uint16_t size, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_PARSE_CTX *ctx, tMAPS_PROTO_FRAME_HEADER *header)
+{
+    header->num    = parsed->num;
+    header->type   = parsed->type;
+    header->cmd_id = (ctx->cinfo) ? (uint8_t)(ctx->cinfo - cmd_data) : K_MAPS_PROTO_CMD_UNKNOWN;
+    memcpy(header->cmd,parsed->cmd,sizeof(header->cmd));
+
+    if (frame[0] != K_MAPS_PROTO_SOH)  // Unframed PA SPECIAL or SC SPECIAL. All the frame is data
+    {
+        header->data_pos  = 0;
+        header->data_size = (header->cmd_id == K_MAPS_PROTO_CMD_PAS) ? K_MAPS_PROTO_PASF_SIZE : K_MAPS_PROTO_SCSF_SIZE;
+    }
+    else
+    {
+        header->data_pos  = (parsed->type) ? 6 : 4;
+        header->data_size = size - header->data_pos - 3;
+    }
+}
+//-----------------------------------------------------------------------------
+// The encoders of the messages of maps_spec.h. d is the data of the frame
+#define spec_invalid(m,o)         { info->field = #m; return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,dpos + (o),0,0); }
+#define spec_encode_DEC1(m,o,a,b) if ((unsigned)(data->m - (a)) > (unsigned)((b) - (a))) spec_invalid(m,o) d[o] = data->m + 48;
+#define spec_encode_DEC2(m,o,a,b) MapsProtoSpecPutDec2(&d[o],data->m,b);
+#define spec_encode_DEC2R(m,o,a,b) if ((unsigned)(data->m - (a)) > (unsigned)((b) - (a))) spec_invalid(m,o) MapsProtoSpecPutDec2(&d[o],data->m,b);
+#define spec_encode_HEX1(m,o,a,b) if ((unsigned)(data->m - (a)) > (unsigned)((b) - (a))) spec_invalid(m,o) d[o] = (data->m < 10) ? (data->m + 48) : (data->m + 55);
+#define spec_encode_CHR(m,o,a,b)  d[o] = (data->m) ? (uint8_t) data->m : (b); if (!d[o] || !memchr(a,d[o],sizeof(a) - 1)) spec_invalid(m,o)
+#define spec_encode_SET(m,o,a,b)
+#define spec_encode_FILL(m,o,a,b) d[o] = a;
+#define spec_encode_CHK(m,o,a,b)  if (!memchr(a,(data->m) ? (uint8_t) data->m : (b),sizeof(a) - 1)) spec_invalid(m,o)
+
+#define spec_encode(kind,m,o,a,b) spec_encode_##kind(m,o,a,b)
+
+#define spec_encode_variant(fsize,data_pos,when,FIELDS)                                               \
+    if (when)                                                                                         \
+    {                                                                                                 \
+        const uint16_t dpos = data_pos;                                                               \
+                                                                                                      \
+        FIELDS(spec_encode)                                                                           \
+        *size = fsize - dpos - 3;                                                                     \
+        *type = (dpos == 6) ? K_MAPS_PROTO_RES_TYPE : K_MAPS_PROTO_REQ_TYPE;                          \
+        return K_MAPS_PROTO_STATUS_OK;                                                                \
     }
 
+#define spec_encoder(name,dtype,VARIANTS,cmd1,cmd2)                                                                                \
+uint8_t MapsProtoEncode##name##Data(const dtype *data, uint8_t *d, uint16_t *size, uint8_t *type, tMAPS_PROTO_STATUS_INFO *info) \
+{                                                                                                                                  \
+    VARIANTS(spec_encode_variant)                                                                                                  \
+    return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);                                                               \
+}
+
+K_MAPS_PROTO_SPEC_MESSAGES(spec_encoder)
+//-----------------------------------------------------------------------------
+
+#define spec_dispatch(name,dtype,VARIANTS,cmd1,cmd2)                             \
+    if (cmd_id == cmd1 || cmd_id == cmd2)                                        \
+        return MapsProtoEncode##name##Data((const dtype *) data,d,size,type,info);
+
+uint8_t MapsProtoEncodeSpec(uint8_t cmd_id, const void *data, uint8_t *d, uint16_t *size, uint8_t *type, tMAPS_PROTO_STATUS_INFO *info)
+{
+    info->cmd_id = cmd_id;
+
+    if (!data)
+        return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+
+    K_MAPS_PROTO_SPEC_MESSAGES(spec_dispatch)
+
+    info->cmd_id = K_MAPS_PROTO_CMD_UNKNOWN;
+    return MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_COMMAND,0,0,0);
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_RAW_FRAME * MapsProtoCreateSpecFrame(uint8_t cmd_id, uint8_t num, const void *data)
+{
+    uint8_t d[K_MAPS_PROTO_SPEC_MAX_DATA], type, status;
+    uint16_t size;
+    tMAPS_PROTO_STATUS_INFO info;
+
+    if ((status = MapsProtoEncodeSpec(cmd_id,data,d,&size,&type,MapsProtoResetStatus(NULL,&info))))
+        param_error(status_errno[status]);
+
+    return MapsProtoCreateFrame(type,num,cmd_data[cmd_id].cmd,d,size);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoSpecPutDec2(uint8_t *d, uint8_t value, uint8_t max)
+{
+    value = (value > max) ? max : value;
+
+    d[0] = 48 + (value / 10);
+    d[1] = 48 + (value % 10);
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+//-------------  F R E E   R E S O U R C E S   F U N C T I O N S  -------------
+
+void MapsProtoFreeRawFrame(tMAPS_PROTO_RAW_FRAME *raw)
+{
+    if (raw)
+    {
+        if (raw->data)
+            free(raw->data);
+
+        free(raw);
+    }
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoFreeParsedFrame(tMAPS_PROTO_PARSED_FRAME *parsed)
+{
+    if (parsed)
+    {
+        if (parsed->data)
+            free(parsed->data);
+
+        free(parsed);
+    }
+}
+//-----------------------------------------------------------------------------
+//---------------  C O M M A N D   I N F O   F U N C T I O N S  ---------------
+
+int MapsProtoGetCmdSpec(const char *cmd, tMAPS_PROTO_CMD_SPEC *spec)
+{
+    const tMAPS_PROTO_CMD_INFO *cinfo;
+
+    if (spec == NULL)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((cinfo = MapsProtoFindCmd(cmd)) == NULL)
+    {
+        errno = EPERM;
+        return -1;
+    }
+
+    spec->barriers = cinfo->barriers;
+    spec->suppdata = cinfo->suppdata;
+    spec->req_size = cinfo->rqsize;
+    spec->res_size = cinfo->rssize;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoGetCmdId(const char *cmd)
+{
+    const tMAPS_PROTO_CMD_INFO *cinfo = MapsProtoFindCmd(cmd);
+
+    return (cinfo) ? (uint8_t)(cinfo - cmd_data) : K_MAPS_PROTO_CMD_UNKNOWN;
+}
+//-----------------------------------------------------------------------------
+
+const char * MapsProtoGetCmdName(uint8_t id)
+{
+    return (id < K_MAPS_PROTO_CMD_COUNT) ? cmd_data[id].cmd : NULL;
+}
+//-----------------------------------------------------------------------------
+
+uint32_t MapsProtoGetWireTime(uint16_t size, uint8_t baud_rate)
+{
+    const uint32_t bauds[] = {9600,9600,19200,38400,57600,115200};
+
+    baud_rate = (baud_rate > 5) ? 1 : baud_rate;
+
+    // Each byte is sent as 8N1. i.e. 10 bits on the line. Round up to the next microsecond.
+    return (uint32_t)(((uint64_t) size * 10 * 1000000 + bauds[baud_rate] - 1) / bauds[baud_rate]);
+}
+//-----------------------------------------------------------------------------
+//----------------------  P A R S E   F U N C T I O N S  ----------------------
+
+tMAPS_PROTO_PARSED_FRAME * MapsProtoParseFrame(uint8_t *frame, uint16_t size)
+{
+    uint8_t code;
+    tMAPS_PROTO_STATUS_INFO info;
+    tMAPS_PROTO_PARSED_FRAME *parsed = NULL;
+    tMAPS_PROTO_PARSE_CTX ctx = { .validate = 0, .cinfo = NULL, .buffer = NULL, .info = MapsProtoResetStatus(NULL,&info) };
+
+    trace_parse_entry(frame,size);
+
+    if (frame == NULL)
+    {
+        trace_parse_return(K_MAPS_PROTO_CMD_UNKNOWN,size,K_MAPS_PROTO_STATUS_PARAM);
+        parse_error(EINVAL);
+    }
+    if (size < 7)                                                                                                // INVALID FRAME. Minimum size is 7
+    {
+        trace_parse_return(K_MAPS_PROTO_CMD_UNKNOWN,size,K_MAPS_PROTO_STATUS_FRAMING);
+        parse_error(status_errno[stats_parse(K_MAPS_PROTO_STATUS_FRAMING,ctx.info,0,size)]);
+    }
+    if ((parsed = (tMAPS_PROTO_PARSED_FRAME *)proto_calloc(1, sizeof (tMAPS_PROTO_PARSED_FRAME))) == NULL)
+    {
+        trace_parse_return(K_MAPS_PROTO_CMD_UNKNOWN,size,K_MAPS_PROTO_STATUS_NOMEM);
+        parse_error(ENOMEM);
+    }
+
+    code = MapsProtoDecodeFrame(frame,size,parsed,&ctx);
+    trace_parse_return(info.cmd_id,size,code);
+
+    if (stats_parse(code,ctx.info,parsed->type,size))
+        parse_error(status_errno[code]);
+
     return parsed;
 
     PARSE_ERROR_EXEC:
@@ -939,6 +1142,138 @@ tMAPS_PROTO_PARSED_FRAME * MapsProtoParseFrame(uint8_t *frame, uint16_t size)
     return NULL;
 }
 //-----------------------------------------------------------------------------
+
+int MapsProtoValidateFrame(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header)
+{
+    tMAPS_PROTO_STATUS status;
+
+    if ((status = MapsProtoStatusValidate(frame,size,header,NULL)))
+    {
+        errno = status_errno[status];
+        return -1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoParseFrameTo(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header, void *data, uint16_t data_size)
+{
+    uint16_t length;
+    tMAPS_PROTO_STATUS status;
+
+    if ((status = MapsProtoStatusParse(frame,size,header,data,data_size,&length,NULL)))
+    {
+        errno = status_errno[status];
+        return -1;
+    }
+
+    return length;
+}
+//-----------------------------------------------------------------------------
+//---------------------  S T A T U S   F U N C T I O N S  ---------------------
+
+tMAPS_PROTO_STATUS MapsProtoStatusValidate(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header, tMAPS_PROTO_STATUS_INFO *info)
+{
+    uint8_t status;
+    tMAPS_PROTO_STATUS_INFO  local;
+    tMAPS_PROTO_PARSED_FRAME parsed = { 0 };
+    tMAPS_PROTO_PARSE_CTX ctx = { .validate = 1, .cinfo = NULL, .buffer = NULL, .info = MapsProtoResetStatus(info,&local) };
+
+    trace_parse_entry(frame,size);
+
+    if (frame == NULL)
+        status = MapsProtoSetStatus(ctx.info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+    else if (size < 7)
+        status = MapsProtoSetStatus(ctx.info,K_MAPS_PROTO_STATUS_FRAMING,0,7,size);
+    else
+        status = MapsProtoDecodeFrame(frame,size,&parsed,&ctx);
+
+    trace_parse_return(ctx.info->cmd_id,size,status);
+
+    if (stats_parse(status,ctx.info,parsed.type,size) == K_MAPS_PROTO_STATUS_OK && header)
+        MapsProtoFillHeader(frame,size,&parsed,&ctx,header);
+
+    return (tMAPS_PROTO_STATUS) status;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STATUS MapsProtoStatusParse(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header, void *data, uint16_t data_size,
+                                        uint16_t *length, tMAPS_PROTO_STATUS_INFO *info)
+{
+    uint8_t status;
+    tMAPS_PROTO_STATUS_INFO  local;
+    tMAPS_PROTO_PARSED_FRAME parsed = { 0 };
+    tMAPS_PROTO_PARSE_CTX ctx = { .validate = 0, .cinfo = NULL, .buffer = data, .info = MapsProtoResetStatus(info,&local) };
+
+    trace_parse_entry(frame,size);
+
+    if (frame == NULL || data == NULL)
+        status = MapsProtoSetStatus(ctx.info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+    else if (data_size < K_MAPS_PROTO_MAX_DATA_SIZE)
+        status = MapsProtoSetStatus(ctx.info,K_MAPS_PROTO_STATUS_NOSPACE,0,K_MAPS_PROTO_MAX_DATA_SIZE,data_size);
+    else if (size < 7)
+        status = MapsProtoSetStatus(ctx.info,K_MAPS_PROTO_STATUS_FRAMING,0,7,size);
+    else
+        status = MapsProtoDecodeFrame(frame,size,&parsed,&ctx);
+
+    trace_parse_return(ctx.info->cmd_id,size,status);
+
+    if (stats_parse(status,ctx.info,parsed.type,size))
+        return (tMAPS_PROTO_STATUS) status;
+    if (header)
+        MapsProtoFillHeader(frame,size,&parsed,&ctx,header);
+    if (length)
+        *length = (parsed.data) ? parsed.size : 0;
+
+    return K_MAPS_PROTO_STATUS_OK;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STATUS MapsProtoStatusCreate(uint8_t type, uint8_t num, const char *cmd, const uint8_t *data, uint16_t data_size,
+                                         uint8_t *frame, uint16_t frame_size, uint16_t *length, tMAPS_PROTO_STATUS_INFO *info)
+{
+    tMAPS_PROTO_STATUS_INFO local;
+
+    info = MapsProtoResetStatus(info,&local);
+
+    if (frame == NULL || length == NULL)
+        return (tMAPS_PROTO_STATUS) MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+
+    return (tMAPS_PROTO_STATUS) MapsProtoWriteFrame(type,num,cmd,data,data_size,frame,frame_size,length,info);
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STATUS MapsProtoStatusCreateData(uint8_t cmd_id, uint8_t num, const void *data, uint8_t *frame, uint16_t frame_size,
+                                             uint16_t *length, tMAPS_PROTO_STATUS_INFO *info)
+{
+    uint8_t d[K_MAPS_PROTO_SPEC_MAX_DATA], type, status;
+    uint16_t size;
+    tMAPS_PROTO_STATUS_INFO local;
+
+    info = MapsProtoResetStatus(info,&local);
+
+    if (frame == NULL || length == NULL)
+        return (tMAPS_PROTO_STATUS) MapsProtoSetStatus(info,K_MAPS_PROTO_STATUS_PARAM,0,0,0);
+    if ((status = MapsProtoEncodeSpec(cmd_id,data,d,&size,&type,info)))
+        return (tMAPS_PROTO_STATUS) status;
+
+    return (tMAPS_PROTO_STATUS) MapsProtoWriteFrame(type,num,cmd_data[cmd_id].cmd,d,size,frame,frame_size,length,info);
+}
+//-----------------------------------------------------------------------------
+
+const char * MapsProtoStatusName(tMAPS_PROTO_STATUS status)
+{
+    return ((unsigned) status < K_MAPS_PROTO_STATUS_COUNT) ? status_name[status] : "UNKNOWN";
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStatusErrno(tMAPS_PROTO_STATUS status)
+{
+    return ((unsigned) status < K_MAPS_PROTO_STATUS_COUNT) ? status_errno[status] : EINVAL;
+}
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
 //--------------------  R E Q U E S T   F U N C T I O N S  --------------------
 
 tMAPS_PROTO_RAW_FRAME * MapsProtoCreateEmptyRequest(uint8_t num, const char *cmd)
@@ -1075,15 +1410,16 @@ tMAPS_PROTO_RAW_FRAME *MapsProtoCreateBarrierAdjRequest(uint8_t num, uint8_t typ
     {
         tMAPS_PROTO_RAW_FRAME *frame = NULL;
 
-        if ((frame = (tMAPS_PROTO_RAW_FRAME *)calloc(1,sizeof(tMAPS_PROTO_RAW_FRAME))) == NULL)
+        if ((frame = (tMAPS_PROTO_RAW_FRAME *)proto_calloc(1,sizeof(tMAPS_PROTO_RAW_FRAME))) == NULL)
             frame_error(ENOMEM);
-        if ((frame->data = (uint8_t *)calloc(K_MAPS_PROTO_PASF_SIZE+1,sizeof(uint8_t))) == NULL)
+        if ((frame->data = (uint8_t *)proto_calloc(K_MAPS_PROTO_PASF_SIZE+1,sizeof(uint8_t))) == NULL)
             frame_error(ENOMEM);
 
         frame->size = K_MAPS_PROTO_PASF_SIZE+1;
         memcpy(frame->data,buffer,K_MAPS_PROTO_PASF_SIZE);
         frame->data[K_MAPS_PROTO_PASF_SIZE] = K_MAPS_PROTO_CR;
 
+        stats_create(K_MAPS_PROTO_CMD_PAS,frame->size);
         return frame;
     }
 }
@@ -1120,9 +1456,9 @@ tMAPS_PROTO_RAW_FRAME *MapsProtoCreateSCSpecialRequest(uint8_t num, tMAPS_PROTO_
              if (!isxdigit(data->MODES.DEHI_MODES[i]))
                  param_error(EINVAL);
 
-        if ((frame = (tMAPS_PROTO_RAW_FRAME *)calloc(1,sizeof(tMAPS_PROTO_RAW_FRAME))) == NULL)
+        if ((frame = (tMAPS_PROTO_RAW_FRAME *)proto_calloc(1,sizeof(tMAPS_PROTO_RAW_FRAME))) == NULL)
             frame_error(ENOMEM);
-        if ((frame->data = (uint8_t *)calloc(K_MAPS_PROTO_DEHI_BUFFER+size,sizeof(uint8_t))) == NULL)
+        if ((frame->data = (uint8_t *)proto_calloc(K_MAPS_PROTO_DEHI_BUFFER+size,sizeof(uint8_t))) == NULL)
             frame_error(ENOMEM);
 
         frame->size = K_MAPS_PROTO_DEHI_BUFFER+size;
@@ -1132,6 +1468,7 @@ tMAPS_PROTO_RAW_FRAME *MapsProtoCreateSCSpecialRequest(uint8_t num, tMAPS_PROTO_
         if (size == 2)
             frame->data[K_MAPS_PROTO_DEHI_BUFFER+1] = K_MAPS_PROTO_LF;
 
+        stats_create(K_MAPS_PROTO_CMD_SCS,frame->size);
         return frame;
     }
     else
@@ -1141,154 +1478,31 @@ tMAPS_PROTO_RAW_FRAME *MapsProtoCreateSCSpecialRequest(uint8_t num, tMAPS_PROTO_
 
 tMAPS_PROTO_RAW_FRAME *MapsProtoCreateAPRequest(uint8_t num, tMAPS_PROTO_AP_DATA *data)
 {
-    uint8_t buffer[11];
-
-    if (!data)
-        param_error(EINVAL);
-
-    if (data->smbyte >= 2)
-    {
-        if (data->vaxis != 'P' && data->vaxis != 'N' && data->vaxis != 48  && data->vaxis != 0)
-            param_error(EINVAL);
-
-        buffer[0] = (data->vaxis == 0) ? 48 : data->vaxis;
-        buffer[1] = 48;
-        sprintf((char *)&buffer[2],"%.2u%.2u%.2u%.2u",(data->axis_height > 15) ? 15 : data->axis_height
-                                                     ,(data->vmax_height > 99) ? 99 : data->vmax_height
-                                                     ,(data->hmin_height > 99) ? 99 : data->hmin_height
-                                                     ,(data->lmax_height > 99) ? 99 : data->lmax_height);
-
-        return MapsProtoCreateFrame(K_MAPS_PROTO_REQ_TYPE,num,"AP",buffer,10);
-    }
-    else {
-        sprintf((char *)buffer,"%.2u",(data->vheight > 99) ? 99 : data->vheight);
-        return MapsProtoCreateFrame(K_MAPS_PROTO_REQ_TYPE,num,"AP",buffer,2);
-    }
+    return MapsProtoCreateSpecFrame(K_MAPS_PROTO_CMD_AP,num,data);
 }
 //-----------------------------------------------------------------------------
 
 tMAPS_PROTO_RAW_FRAME *MapsProtoCreateEJRequest(uint8_t num, tMAPS_PROTO_EJ_DATA *data)
 {
-    uint8_t buffer[7];
-
-    if (!data)
-        param_error(EINVAL);
-
-    sprintf((char *)buffer,"%.2u%.2u%.2u",(data->paxes  > 99) ? 99 : data->paxes
-                                         ,(data->naxes  > 99) ? 99 : data->naxes
-                                         ,(data->ispeed > 99) ? 99 : data->ispeed);
-
-    return MapsProtoCreateFrame(K_MAPS_PROTO_REQ_TYPE,num,"EJ",buffer,6);
+    return MapsProtoCreateSpecFrame(K_MAPS_PROTO_CMD_EJ,num,data);
 }
 //-----------------------------------------------------------------------------
 
 tMAPS_PROTO_RAW_FRAME *MapsProtoCreateEMRequest(uint8_t num, tMAPS_PROTO_EM_DATA *data)
 {
-    uint8_t buffer[11], size = 9;
-
-    if (!data)
-        param_error(EINVAL);
-
-    char td = (data->tow_detection == 0) ? 48 : data->tow_detection;
-
-    if (data->work_mode > 3)
-        param_error(EINVAL);
-    if (data->axis_ispeed > 15)
-        param_error(EINVAL);
-    if (data->axis_height > 2)
-        param_error(EINVAL);
-    if (td != 48  && td != 'R' && td != 'M' && td != 'N' && td != 'E' && td != 'T')
-        param_error(EINVAL);
-    if (!data->hw_failure  || data->hw_failure > 3)
-        param_error(EINVAL);
-    if (!data->se_cleaning || data->se_cleaning > 2)
-        param_error(EINVAL);
-    if (data->firmware_ver > 99)
-        param_error(EINVAL);
-    if (data->rcvr_direction != 0 && data->rcvr_direction != 'P' && data->rcvr_direction != 'N')
-        param_error(EINVAL);
-
-    buffer[0] = data->work_mode      + 48;
-    buffer[1] = (data->axis_ispeed < 10) ? (data->axis_ispeed + 48) : (data->axis_ispeed + 55);
-    buffer[2] = data->axis_height    + 48;
-
-    if (data->rcvr_direction == 0)
-    {
-        buffer[3] = data->hw_failure     + 48;
-        buffer[4] = data->se_cleaning    + 48;
-
-        sprintf((char *)&buffer[5],"%.2u",data->firmware_ver);
-
-        buffer[7] = 48;
-        buffer[8] = 48;
-    }
-    else
-    {
-        size = 10;
-        buffer[3] = td;
-        buffer[4] = data->hw_failure     + 48;
-        buffer[5] = data->se_cleaning    + 48;
-
-        sprintf((char *)&buffer[6],"%.2u",data->firmware_ver);
-
-        buffer[8] = data->rcvr_direction;
-        buffer[9] = 48;
-    }
-
-    return MapsProtoCreateFrame(K_MAPS_PROTO_REQ_TYPE,num,"EM",buffer,size);
+    return MapsProtoCreateSpecFrame(K_MAPS_PROTO_CMD_EM,num,data);
 }
 //-----------------------------------------------------------------------------
 
 tMAPS_PROTO_RAW_FRAME *MapsProtoCreateEndVehicleRequest(uint8_t num, uint8_t type, tMAPS_PROTO_END_VEHICLE *data)
 {
-    const char *cmds[] = {"FA","FR"};
-    uint8_t buffer[17] , size = 4;
-
-    if (!data || data->smb > 3)
-        param_error(EINVAL);
-    if (data->smb != 3 && (data->vclass != 'M' && data->vclass != 'X' && (data->vclass < 65 || data->vclass > 70)))
-        param_error(EINVAL);
-
-    type = (type) ? 1 : 0;
-    sprintf((char *)buffer,"%.2u%.2u",(data->paxes > 99) ? 99 : data->paxes
-                                     ,(data->naxes > 99) ? 99 : data->naxes);
-
-    if (data->smb <= 1)
-    {
-        buffer[4] = data->vclass;
-        size = 5;
-    }
-    else if (data->smb == 2)
-    {
-        sprintf((char *)&buffer[4],"%.2u%.2u%.2u%.2u%.2u%.2u",(data->paxes10 > 99) ? 99 : data->paxes10
-                                                             ,(data->naxes10 > 99) ? 99 : data->naxes10
-                                                             ,(data->paxes16 > 99) ? 99 : data->paxes16
-                                                             ,(data->naxes16 > 99) ? 99 : data->naxes16
-                                                             ,(data->paxes22 > 99) ? 99 : data->paxes22
-                                                             ,(data->naxes22 > 99) ? 99 : data->naxes22);
-
-        buffer[16] = data->vclass;
-        size = 17;
-    }
-
-    return MapsProtoCreateFrame(K_MAPS_PROTO_REQ_TYPE,num,cmds[type],buffer,size);
+    return MapsProtoCreateSpecFrame((type) ? K_MAPS_PROTO_CMD_FR : K_MAPS_PROTO_CMD_FAS,num,data);
 }
 //-----------------------------------------------------------------------------
 
 tMAPS_PROTO_RAW_FRAME *MapsProtoCreateFailureRequest(uint8_t num, uint8_t type, tMAPS_PROTO_FAILURE_DATA *data)
 {
-    uint8_t buffer[3];
-    const char *cmds[] = {"FX","PX"};
-
-    if (!data || (data->type != 'R' && data->type != 'E') || data->ngroup > 8 || data->nsensor > 8)
-        param_error(EINVAL);
-
-    type = (type) ? 1 : 0;
-    buffer[0] = data->type;
-    buffer[1] = data->ngroup  + 48;
-    buffer[2] = data->nsensor + 48;
-
-    return MapsProtoCreateFrame(K_MAPS_PROTO_REQ_TYPE,num,cmds[type],buffer,3);
+    return MapsProtoCreateSpecFrame((type) ? K_MAPS_PROTO_CMD_PX : K_MAPS_PROTO_CMD_FX,num,data);
 }
 //-----------------------------------------------------------------------------
 
@@ -1409,14 +1623,7 @@ tMAPS_PROTO_RAW_FRAME *MapsProtoCreateDEResponse(uint8_t num, tMAPS_PROTO_DE_DAT
 
 tMAPS_PROTO_RAW_FRAME *MapsProtoCreateEAResponse(uint8_t num, tMAPS_PROTO_EA_DATA *data)
 {
-    uint8_t buffer[9];
-
-    if (!data)
-        param_error(EINVAL);
-
-    sprintf((char *)buffer,"%.2u%.2u%.2u%.2u",data->imax_height,data->umax_height,data->umin_height,data->lmax_height);
-
-    return MapsProtoCreateFrame(K_MAPS_PROTO_RES_TYPE,num,"EA",buffer,8);
+    return MapsProtoCreateSpecFrame(K_MAPS_PROTO_CMD_EA,num,data);
 }
 //-----------------------------------------------------------------------------
 
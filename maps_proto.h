@@ -27,6 +27,48 @@
 #define K_MAPS_PROTO_FVERSION_LENGTH    4
 #define K_MAPS_PROTO_FNUM_REV_LENGTH    4
 #define K_MAPS_PROTO_VER_DATE_LENGTH    8
+#define K_MAPS_PROTO_MAX_DATA_SIZE      88   ///< The size of the biggest data structure (tMAPS_PROTO_BARRIER_ADJUST).
+
+#define K_MAPS_PROTO_BARRIER_CF24P      0x01
+#define K_MAPS_PROTO_BARRIER_CF150      0x02
+#define K_MAPS_PROTO_BARRIER_CF220      0x04
+
+// Command identifiers. See MapsProtoGetCmdId
+#define K_MAPS_PROTO_CMD_BR             0
+#define K_MAPS_PROTO_CMD_CA             1
+#define K_MAPS_PROTO_CMD_DE             2
+#define K_MAPS_PROTO_CMD_EA             3
+#define K_MAPS_PROTO_CMD_ER             4
+#define K_MAPS_PROTO_CMD_FA             5
+#define K_MAPS_PROTO_CMD_MV             6
+#define K_MAPS_PROTO_CMD_PA             7
+#define K_MAPS_PROTO_CMD_AC             8
+#define K_MAPS_PROTO_CMD_PR             9
+#define K_MAPS_PROTO_CMD_RF             10
+#define K_MAPS_PROTO_CMD_SC             11
+#define K_MAPS_PROTO_CMD_SM             12
+#define K_MAPS_PROTO_CMD_SR             13
+#define K_MAPS_PROTO_CMD_TT             14
+#define K_MAPS_PROTO_CMD_RH             15
+#define K_MAPS_PROTO_CMD_CB             16
+#define K_MAPS_PROTO_CMD_PAS            17
+#define K_MAPS_PROTO_CMD_SCS            18
+#define K_MAPS_PROTO_CMD_FAS            19
+#define K_MAPS_PROTO_CMD_AJ             20
+#define K_MAPS_PROTO_CMD_AP             21
+#define K_MAPS_PROTO_CMD_EJ             22
+#define K_MAPS_PROTO_CMD_EM             23
+#define K_MAPS_PROTO_CMD_FP             24
+#define K_MAPS_PROTO_CMD_FR             25
+#define K_MAPS_PROTO_CMD_FX             26
+#define K_MAPS_PROTO_CMD_IP             27
+#define K_MAPS_PROTO_CMD_IA             28
+#define K_MAPS_PROTO_CMD_IR             29
+#define K_MAPS_PROTO_CMD_PX             30
+#define K_MAPS_PROTO_CMD_RE             31
+#define K_MAPS_PROTO_CMD_RM             32
+#define K_MAPS_PROTO_CMD_COUNT          33   ///< Number of commands.
+#define K_MAPS_PROTO_CMD_UNKNOWN        0xFF ///< Unknown command. i.e. The command of a NE response to an invalid command.
 //-----------------------------------------------------------------------------
 
 /**
@@ -115,8 +157,91 @@ typedef struct
     char cmd[K_MAPS_PROTO_CMD_LENGTH+1]; ///< The Command. SCS = SC Special, PAS = PA Special and FAS = FA Spontaneous. Is a NULL terminate string
     uint16_t size;        ///< The size of the data field.
     char *data;           ///< The data in the frame.
+    uint64_t timestamp;   ///< Arrival of the first byte in nanoseconds (CLOCK_MONOTONIC). 0 when unknown. Set by maps_shard.c or the application.
 }tMAPS_PROTO_PARSED_FRAME;
 
+/**
+ *
+ * @struct tMAPS_PROTO_CMD_SPEC
+ * @brief  Static information of a MAPS command.
+ *
+ *         The barriers member have the K_MAPS_PROTO_BARRIER_* bits of the
+ *         barriers that support the command.
+ *
+ *         The suppdata member indicates when the command accepts empty data:
+ *
+ *         Third bit:  Supports unknown responses (NE).
+ *         Second bit: Supports empty requests.
+ *         First bit:  Supports empty responses.
+ *
+ *         The sizes are the biggest frame from SOH to CR accepted for the
+ *         command, so they can be used to calculate the time on the line.
+ *
+ */
+typedef struct
+{
+    uint8_t barriers;     ///< Supported barriers. K_MAPS_PROTO_BARRIER_* bits.
+    uint8_t suppdata;     ///< The supported data. See description.
+    uint16_t req_size;    ///< Maximum size in bytes of the request frame.
+    uint16_t res_size;    ///< Maximum size in bytes of the response frame.
+}tMAPS_PROTO_CMD_SPEC;
+
+/**
+ *
+ * @struct tMAPS_PROTO_FRAME_HEADER
+ * @brief  The header of a valid MAPS frame. Is filled by MapsProtoValidateFrame.
+ *
+ *         The data section is not copied. It is in the original frame from
+ *         data_pos to data_pos + data_size. For the unframed PAS and SCS
+ *         messages data_pos is 0 and num is 0.
+ *
+ */
+typedef struct
+{
+    uint8_t num;          ///< Number between 0-9
+    uint8_t type;         ///< Type of frame: 0: Request. 1: Response. 2: Unknown MSG or Not Executed.
+    uint8_t cmd_id;       ///< The K_MAPS_PROTO_CMD_* identifier. K_MAPS_PROTO_CMD_UNKNOWN on a NE of an unknown command.
+    char cmd[K_MAPS_PROTO_CMD_LENGTH+1]; ///< The Command. The same as tMAPS_PROTO_PARSED_FRAME cmd.
+    uint8_t data_pos;     ///< The position of the data section in the frame.
+    uint8_t data_size;    ///< The size of the data section in the frame. 0 when the frame has no data.
+}tMAPS_PROTO_FRAME_HEADER;
+
+/**
+ *
+ * @enum   tMAPS_PROTO_STATUS
+ * @brief  The result of the status functions (MapsProtoStatus*). Each error is an errno value of the other functions.
+ *
+ */
+typedef enum
+{
+    K_MAPS_PROTO_STATUS_OK = 0,   ///< Success.
+    K_MAPS_PROTO_STATUS_PARAM,    ///< EINVAL:  Invalid param or value of a field to encode.
+    K_MAPS_PROTO_STATUS_NOMEM,    ///< ENOMEM:  Couldn't allocate memory.
+    K_MAPS_PROTO_STATUS_NOSPACE,  ///< ENOSPC:  The buffer of the caller is too small.
+    K_MAPS_PROTO_STATUS_FRAMING,  ///< ESPIPE:  The frame is too short or not have SOH or CR.
+    K_MAPS_PROTO_STATUS_LRC,      ///< ERANGE:  The frame checksum is invalid.
+    K_MAPS_PROTO_STATUS_NUMBER,   ///< EBADF:   The frame number is out of range 0 to 9.
+    K_MAPS_PROTO_STATUS_COMMAND,  ///< EPERM:   Unknown or unsupported command or an invalid NE frame.
+    K_MAPS_PROTO_STATUS_DATA,     ///< ENOEXEC: The data section has an invalid length or value.
+    K_MAPS_PROTO_STATUS_COUNT     ///< Number of status. i.e. The size of an array of counters by status.
+}tMAPS_PROTO_STATUS;
+
+/**
+ *
+ * @struct tMAPS_PROTO_STATUS_INFO
+ * @brief  The reason of an error of the status functions. Only valid when the status is not OK.
+ *
+ */
+typedef struct
+{
+    tMAPS_PROTO_STATUS status;  ///< The status returned.
+    uint8_t cmd_id;             ///< The K_MAPS_PROTO_CMD_* of the frame or K_MAPS_PROTO_CMD_UNKNOWN if is not known.
+    uint16_t offset;            ///< The position in the frame of the byte that failed or 0.
+    const char *field;          ///< The member of the data structure that failed or NULL. Only the messages of maps_spec.h.
+    uint16_t expected;          ///< LRC: The calculated checksum. FRAMING: The minimum size or the byte (SOH/CR). DATA: The maximum size of the frame. NOSPACE: The size needed.
+    uint16_t actual;            ///< LRC: The checksum in the frame. FRAMING: The size or the byte. DATA: The size of the frame. NOSPACE: The size of the buffer.
+}tMAPS_PROTO_STATUS_INFO;
+
 /**
  *
  * @struct tMAPS_PROTO_CA_DATA
@@ -629,6 +754,186 @@ void MapsProtoFreeParsedFrame(tMAPS_PROTO_PARSED_FRAME *parsed);
  */
 tMAPS_PROTO_PARSED_FRAME * MapsProtoParseFrame(uint8_t *frame, uint16_t size);
 
+/** @brief Validate a MAPS frame without parse its data section.
+ *
+ *  Does the same checks that MapsProtoParseFrame (framing, LRC, number,
+ *  command and the length and characters of the data section) but nothing
+ *  is allocated or copied. Useful when only the command or the result of
+ *  a frame is needed. i.e. A MV poll, an ACK or relay the raw frame.
+ *
+ *  The errno values are the same as MapsProtoParseFrame except ENOMEM.
+ *
+ * @param  frame  The MAPS frame to validate.
+ * @param  size   The message size.
+ * @param  header Where the header of the frame is stored. Can be NULL.
+ * @return 0 when the frame is valid or -1 on error and errno is set.
+ */
+int MapsProtoValidateFrame(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header);
+
+/** @brief Parse a MAPS frame into a buffer of the caller.
+ *
+ *  The same as MapsProtoParseFrame but nothing is allocated. The data
+ *  section is stored in data with the same structure of the data member of
+ *  tMAPS_PROTO_PARSED_FRAME and the header of the frame in header.
+ *
+ *  The errno values are the same as MapsProtoParseFrame except ENOMEM and:
+ *
+ *       EINVAL: The frame or data params are NULL.
+ *       ENOSPC: The data_size is less than K_MAPS_PROTO_MAX_DATA_SIZE.
+ *
+ * @param  frame     The MAPS frame to parse.
+ * @param  size      The message size.
+ * @param  header    Where the header of the frame is stored. Can be NULL.
+ * @param  data      Where the data is stored. Must be aligned for the data structures.
+ * @param  data_size The size of the data buffer. At least K_MAPS_PROTO_MAX_DATA_SIZE.
+ * @return The size of the data (0 when the frame not have data) or -1 on error and errno is set.
+ */
+int MapsProtoParseFrameTo(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header, void *data, uint16_t data_size);
+
+// Status Functions. The same as the parse and create functions but errno is not used
+//-----------------------------------------------------------------------------
+
+/** @brief Validate a MAPS frame. The same as MapsProtoValidateFrame.
+ *
+ * @param  frame  The MAPS frame to validate.
+ * @param  size   The message size.
+ * @param  header Where the header of the frame is stored. Can be NULL.
+ * @param  info   Where the reason of an error is stored. Can be NULL.
+ * @return K_MAPS_PROTO_STATUS_OK or the error.
+ */
+tMAPS_PROTO_STATUS MapsProtoStatusValidate(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header, tMAPS_PROTO_STATUS_INFO *info);
+
+/** @brief Parse a MAPS frame into a buffer of the caller. The same as MapsProtoParseFrameTo.
+ *
+ * @param  frame     The MAPS frame to parse.
+ * @param  size      The message size.
+ * @param  header    Where the header of the frame is stored. Can be NULL.
+ * @param  data      Where the data is stored. Must be aligned for the data structures.
+ * @param  data_size The size of the data buffer. At least K_MAPS_PROTO_MAX_DATA_SIZE.
+ * @param  length    Where the size of the data is stored (0 when the frame not have data). Can be NULL.
+ * @param  info      Where the reason of an error is stored. Can be NULL.
+ * @return K_MAPS_PROTO_STATUS_OK or the error.
+ */
+tMAPS_PROTO_STATUS MapsProtoStatusParse(const uint8_t *frame, uint16_t size, tMAPS_PROTO_FRAME_HEADER *header, void *data, uint16_t data_size,
+                                        uint16_t *length, tMAPS_PROTO_STATUS_INFO *info);
+
+/** @brief Create a MAPS frame with a raw data section in a buffer of the caller.
+ *
+ *  The data is not checked, only the type, num and cmd as the empty request
+ *  and response functions. The frame needs 7 + data_size bytes on requests
+ *  and 9 + data_size on responses and NE.
+ *
+ * @param  type       0: Request. 1: Response. 2: Unknown MSG or Not Executed.
+ * @param  num        The message number to use. Range 0 to 9.
+ * @param  cmd        The command. Must be a NULL terminate string.
+ * @param  data       The data section. Can be NULL when data_size is 0.
+ * @param  data_size  The size of the data section.
+ * @param  frame      Where the frame is stored.
+ * @param  frame_size The size of the frame buffer.
+ * @param  length     Where the size of the frame is stored.
+ * @param  info       Where the reason of an error is stored. Can be NULL.
+ * @return K_MAPS_PROTO_STATUS_OK or the error.
+ */
+tMAPS_PROTO_STATUS MapsProtoStatusCreate(uint8_t type, uint8_t num, const char *cmd, const uint8_t *data, uint16_t data_size,
+                                         uint8_t *frame, uint16_t frame_size, uint16_t *length, tMAPS_PROTO_STATUS_INFO *info);
+
+/** @brief Create a MAPS frame of a message with fixed fields in a buffer of the caller.
+ *
+ *  The messages are the same as the Create functions with a data structure:
+ *
+ *      K_MAPS_PROTO_CMD_EJ:  tMAPS_PROTO_EJ_DATA       (MapsProtoCreateEJRequest)
+ *      K_MAPS_PROTO_CMD_EA:  tMAPS_PROTO_EA_DATA       (MapsProtoCreateEAResponse)
+ *      K_MAPS_PROTO_CMD_AP:  tMAPS_PROTO_AP_DATA       (MapsProtoCreateAPRequest)
+ *      K_MAPS_PROTO_CMD_EM:  tMAPS_PROTO_EM_DATA       (MapsProtoCreateEMRequest)
+ *      K_MAPS_PROTO_CMD_FX:  tMAPS_PROTO_FAILURE_DATA  (MapsProtoCreateFailureRequest)
+ *      K_MAPS_PROTO_CMD_PX:  tMAPS_PROTO_FAILURE_DATA  (MapsProtoCreateFailureRequest)
+ *      K_MAPS_PROTO_CMD_FAS: tMAPS_PROTO_END_VEHICLE   (MapsProtoCreateEndVehicleRequest)
+ *      K_MAPS_PROTO_CMD_FR:  tMAPS_PROTO_END_VEHICLE   (MapsProtoCreateEndVehicleRequest)
+ *
+ *  When a value is out of range the status is PARAM and the field of info
+ *  is the member of the data structure.
+ *
+ * @param  cmd_id     The K_MAPS_PROTO_CMD_* of the message.
+ * @param  num        The message number to use. Range 0 to 9.
+ * @param  data       The data structure of the message.
+ * @param  frame      Where the frame is stored.
+ * @param  frame_size The size of the frame buffer. The frame is never bigger than 24 bytes.
+ * @param  length     Where the size of the frame is stored.
+ * @param  info       Where the reason of an error is stored. Can be NULL.
+ * @return K_MAPS_PROTO_STATUS_OK or the error. COMMAND when the command is not in the list.
+ */
+tMAPS_PROTO_STATUS MapsProtoStatusCreateData(uint8_t cmd_id, uint8_t num, const void *data, uint8_t *frame, uint16_t frame_size,
+                                             uint16_t *length, tMAPS_PROTO_STATUS_INFO *info);
+
+/** @brief Get the name of a status. i.e. "LRC". Use it instead of strerror.
+ *
+ * @param  status The status.
+ * @return A static string. "UNKNOWN" when the status is out of range.
+ */
+const char * MapsProtoStatusName(tMAPS_PROTO_STATUS status);
+
+/** @brief Get the errno value of a status. The same value that sets the function of the errno API.
+ *
+ * @param  status The status.
+ * @return The errno value or 0 on K_MAPS_PROTO_STATUS_OK. EINVAL when the status is out of range.
+ */
+int MapsProtoStatusErrno(tMAPS_PROTO_STATUS status);
+
+// Command Information Functions
+//-----------------------------------------------------------------------------
+
+/** @brief Get the static information of a MAPS command.
+ *
+ *  The cmd can be any command listed in the tMAPS_PROTO_PARSED_FRAME
+ *  description including the spontaneous FAS, PAS and SCS.
+ *
+ *  The errno values are:
+ *
+ *       EINVAL: The spec param is NULL.
+ *        EPERM: Unknown or unsupported MAPS command.
+ *
+ * @param  cmd  The command to find. Must be a NULL terminate string.
+ * @param  spec The structure where the command information is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoGetCmdSpec(const char *cmd, tMAPS_PROTO_CMD_SPEC *spec);
+
+/** @brief Get the time in microseconds that takes to send some bytes on the line.
+ *
+ *  The time is calculated with 10 bits per byte (8N1) and the baud rate
+ *  codes used by the BR command:
+ *
+ *      1: 9600 bps
+ *      2: 19200 bps
+ *      3: 38400 bps
+ *      4: 57600 bps
+ *      5: 115200 bps
+ *
+ *  For example: A TT response (35 bytes) at 9600 bps takes 36459 us.
+ *
+ * @param  size      The number of bytes to send.
+ * @param  baud_rate The baud rate code. If isn´t a valid value then 1 (9600 bps) is used.
+ * @return The time on the line in microseconds.
+ */
+uint32_t MapsProtoGetWireTime(uint16_t size, uint8_t baud_rate);
+
+/** @brief Get the numeric identifier of a MAPS command.
+ *
+ *  The identifiers are the K_MAPS_PROTO_CMD_* values and can be used
+ *  as index of arrays with K_MAPS_PROTO_CMD_COUNT elements.
+ *
+ * @param  cmd The command. Must be a NULL terminate string. i.e. The cmd member of tMAPS_PROTO_PARSED_FRAME.
+ * @return The command identifier or K_MAPS_PROTO_CMD_UNKNOWN if the cmd is NULL or unknown.
+ */
+uint8_t MapsProtoGetCmdId(const char *cmd);
+
+/** @brief Get the command of a numeric identifier.
+ *
+ * @param  id The command identifier. One of the K_MAPS_PROTO_CMD_* values.
+ * @return The command as a NULL terminate string or NULL if the id is out of range.
+ */
+const char * MapsProtoGetCmdName(uint8_t id);
+
 // Create MAPS Request Frame
 //-----------------------------------------------------------------------------
 
@@ -0,0 +1,361 @@
+#ifndef MAPS_PROTO_HPP
+#define MAPS_PROTO_HPP
+//-----------------------------------------------------------------------------
+
+/** @file maps_proto.hpp
+ *  @brief C++20 typed messages over the MAPS library (header only).
+ *
+ *  Each command and direction is a value structure (maps::request<id> and
+ *  maps::response<id>) and a frame is a maps::message, a std::variant of
+ *  all of them. The messages are parsed with MapsProtoParseFrameTo, so the
+ *  heap is never used and the data is owned by the message.
+ *
+ *  The variant index is the numeric command identifier, so std::visit
+ *  dispatches without compare the command strings:
+ *
+ *      maps::message msg;
+ *
+ *      if (maps::parse(frame,size,msg) == 0)
+ *          std::visit(maps::overloaded {
+ *              [](const maps::request<K_MAPS_PROTO_CMD_EJ> &ej) { use(ej.data.paxes); },
+ *              [](const auto &) { }
+ *          },msg);
+ *
+ *  The data member of each message has the same type of the data of the
+ *  tMAPS_PROTO_PARSED_FRAME: std::monostate when the command has no data,
+ *  uint8_t for the commands with 1 byte, the structure of maps_proto.h or a
+ *  std::optional when the data can be empty (IA, RM and RE).
+ */
+
+#include <array>
+#include <cstring>
+#include <variant>
+#include <utility>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+extern "C" {
+#include "maps_proto.h"
+}
+//-----------------------------------------------------------------------------
+
+namespace maps
+{
+
+/**
+ *
+ * @struct cmd_info
+ * @brief  Static information of a MAPS command. The same as tMAPS_PROTO_CMD_SPEC.
+ *
+ */
+struct cmd_info
+{
+    std::string_view name;   ///< The command.
+    uint8_t barriers;        ///< Supported barriers. K_MAPS_PROTO_BARRIER_* bits.
+    uint8_t suppdata;        ///< The supported data. See tMAPS_PROTO_CMD_SPEC.
+    uint16_t req_size;       ///< Maximum size in bytes of the request frame.
+    uint16_t res_size;       ///< Maximum size in bytes of the response frame.
+};
+
+// The position of each command is its K_MAPS_PROTO_CMD_* identifier. Must be the same as cmd_data in maps_proto.c
+inline constexpr std::array<cmd_info,K_MAPS_PROTO_CMD_COUNT> commands
+{{
+    { "BR" , 0b101, 0b101,  8,  9 },
+    { "CA" , 0b100, 0b101, 11,  9 },
+    { "DE" , 0b111, 0b110,  7, 19 },
+    { "EA" , 0b101, 0b110,  7, 17 },
+    { "ER" , 0b101, 0b100,  9, 10 },
+    { "FA" , 0b111, 0b111,  7,  9 },
+    { "MV" , 0b111, 0b111,  7,  9 },
+    { "PA" , 0b111, 0b111,  7,  9 },
+    { "AC" , 0b111, 0b111,  7,  9 },
+    { "PR" , 0b100, 0b101,  9,  9 },
+    { "RF" , 0b111, 0b111,  7,  9 },
+    { "SC" , 0b101, 0b101, 15,  9 },
+    { "SM" , 0b111, 0b101, 12,  9 },
+    { "SR" , 0b100, 0b101,  9, 11 },
+    { "TT" , 0b111, 0b110,  7, 35 },
+    { "RH" , 0b001, 0b100, 10, 12 },
+    { "CB" , 0b010, 0b110,  7, 10 },
+    { "PAS", 0b111, 0b001, 89,  9 },
+    { "SCS", 0b101, 0b001, 14,  9 },
+    { "FAS", 0b110, 0b001, 24,  9 },
+    { "AJ" , 0b111, 0b001, 95,  9 },
+    { "AP" , 0b111, 0b001, 17,  9 },
+    { "EJ" , 0b100, 0b001, 13,  9 },
+    { "EM" , 0b111, 0b001, 17,  9 },
+    { "FP" , 0b001, 0b011,  7,  9 },
+    { "FR" , 0b110, 0b001, 24,  9 },
+    { "FX" , 0b111, 0b001, 10,  9 },
+    { "IP" , 0b001, 0b011,  7,  9 },
+    { "IA" , 0b110, 0b011,  9,  9 },
+    { "IR" , 0b110, 0b011,  7,  9 },
+    { "PX" , 0b111, 0b001, 10,  9 },
+    { "RE" , 0b111, 0b011, 39,  9 },
+    { "RM" , 0b110, 0b011,  9,  9 },
+}};
+
+static_assert(commands[K_MAPS_PROTO_CMD_CB].name == "CB" && commands[K_MAPS_PROTO_CMD_PAS].name == "PAS" &&
+              commands[K_MAPS_PROTO_CMD_AJ].name == "AJ" && commands[K_MAPS_PROTO_CMD_RM].name == "RM",
+              "The commands table must be in the K_MAPS_PROTO_CMD_* order");
+
+/** @brief Get the identifier of a command.
+ *
+ * @param  name The command.
+ * @return The K_MAPS_PROTO_CMD_* identifier or K_MAPS_PROTO_CMD_UNKNOWN.
+ */
+constexpr uint8_t find_cmd(std::string_view name)
+{
+    for (uint8_t i = 0; i < commands.size(); i++)
+    {
+        if (commands[i].name == name)
+            return i;
+    }
+
+    return K_MAPS_PROTO_CMD_UNKNOWN;
+}
+
+/** @brief Check that the commands table is the same as the table of the library.
+ *
+ * @return true when all the commands have the same information.
+ */
+inline bool commands_match_library()
+{
+    tMAPS_PROTO_CMD_SPEC spec;
+    char name[K_MAPS_PROTO_CMD_LENGTH+1];
+
+    for (const cmd_info &info : commands)
+    {
+        std::memset(name,0,sizeof(name));
+        info.name.copy(name,K_MAPS_PROTO_CMD_LENGTH);
+
+        if (MapsProtoGetCmdSpec(name,&spec) || spec.barriers != info.barriers ||
+            spec.suppdata != info.suppdata || spec.req_size != info.req_size || spec.res_size != info.res_size)
+            return false;
+    }
+
+    return true;
+}
+
+// The type of the data of each command and direction
+//-----------------------------------------------------------------------------
+
+template <uint8_t Id> struct request_data  { using type = std::monostate; };
+template <uint8_t Id> struct response_data { using type = std::monostate; };
+
+template <> struct request_data<K_MAPS_PROTO_CMD_BR>  { using type = uint8_t; };
+template <> struct request_data<K_MAPS_PROTO_CMD_CA>  { using type = tMAPS_PROTO_CA_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_ER>  { using type = uint8_t; };
+template <> struct request_data<K_MAPS_PROTO_CMD_PR>  { using type = uint8_t; };
+template <> struct request_data<K_MAPS_PROTO_CMD_SC>  { using type = tMAPS_PROTO_SC_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_SM>  { using type = tMAPS_PROTO_SM_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_SR>  { using type = uint8_t; };
+template <> struct request_data<K_MAPS_PROTO_CMD_RH>  { using type = tMAPS_PROTO_RH_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_PAS> { using type = tMAPS_PROTO_BARRIER_ADJUST; };
+template <> struct request_data<K_MAPS_PROTO_CMD_SCS> { using type = tMAPS_PROTO_SC_SPECIAL; };
+template <> struct request_data<K_MAPS_PROTO_CMD_FAS> { using type = tMAPS_PROTO_END_VEHICLE; };
+template <> struct request_data<K_MAPS_PROTO_CMD_AJ>  { using type = tMAPS_PROTO_BARRIER_ADJUST; };
+template <> struct request_data<K_MAPS_PROTO_CMD_AP>  { using type = tMAPS_PROTO_AP_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_EJ>  { using type = tMAPS_PROTO_EJ_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_EM>  { using type = tMAPS_PROTO_EM_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_FR>  { using type = tMAPS_PROTO_END_VEHICLE; };
+template <> struct request_data<K_MAPS_PROTO_CMD_FX>  { using type = tMAPS_PROTO_FAILURE_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_IA>  { using type = std::optional<uint8_t>; };
+template <> struct request_data<K_MAPS_PROTO_CMD_PX>  { using type = tMAPS_PROTO_FAILURE_DATA; };
+template <> struct request_data<K_MAPS_PROTO_CMD_RE>  { using type = std::optional<tMAPS_PROTO_RE_DATA>; };
+template <> struct request_data<K_MAPS_PROTO_CMD_RM>  { using type = std::optional<uint8_t>; };
+
+template <> struct response_data<K_MAPS_PROTO_CMD_DE> { using type = tMAPS_PROTO_DE_DATA; };
+template <> struct response_data<K_MAPS_PROTO_CMD_EA> { using type = tMAPS_PROTO_EA_DATA; };
+template <> struct response_data<K_MAPS_PROTO_CMD_ER> { using type = uint8_t; };
+template <> struct response_data<K_MAPS_PROTO_CMD_SR> { using type = uint8_t; };
+template <> struct response_data<K_MAPS_PROTO_CMD_TT> { using type = tMAPS_PROTO_TT_DATA; };
+template <> struct response_data<K_MAPS_PROTO_CMD_RH> { using type = tMAPS_PROTO_RH_DATA; };
+template <> struct response_data<K_MAPS_PROTO_CMD_CB> { using type = uint8_t; };
+
+// The messages
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct request
+ * @brief  A request or spontaneous message of the command Id.
+ *
+ */
+template <uint8_t Id>
+struct request
+{
+    static constexpr uint8_t id   = Id;
+    static constexpr uint8_t type = 0;
+
+    uint8_t num;                             ///< Number between 0-9
+    typename request_data<Id>::type data;    ///< The data of the message.
+};
+
+/**
+ *
+ * @struct response
+ * @brief  A response (RS) message of the command Id.
+ *
+ */
+template <uint8_t Id>
+struct response
+{
+    static constexpr uint8_t id   = Id;
+    static constexpr uint8_t type = 1;
+
+    uint8_t num;                             ///< Number between 0-9
+    typename response_data<Id>::type data;   ///< The data of the message.
+};
+
+/**
+ *
+ * @struct not_executed
+ * @brief  An unknown or not executed (NE) response.
+ *
+ */
+struct not_executed
+{
+    static constexpr uint8_t type = 2;
+
+    uint8_t num;                             ///< Number between 0-9
+    uint8_t id;                              ///< The command identifier or K_MAPS_PROTO_CMD_UNKNOWN.
+    char cmd[K_MAPS_PROTO_CMD_LENGTH+1];     ///< The command. Is a NULL terminate string
+};
+
+template <class Seq> struct message_of;
+template <std::size_t... I> struct message_of<std::index_sequence<I...>>
+{
+    using type = std::variant<not_executed, request<I>..., response<I>...>;
+};
+
+/// Any MAPS message. Index 0 is not_executed, then the requests and the responses in K_MAPS_PROTO_CMD_* order.
+using message = typename message_of<std::make_index_sequence<K_MAPS_PROTO_CMD_COUNT>>::type;
+
+/// Helper for build a visitor from several lambdas.
+template <class... F> struct overloaded : F... { using F::operator()...; };
+template <class... F> overloaded(F...) -> overloaded<F...>;
+
+/** @brief Get the command identifier of a message.
+ *
+ * @param  msg The message.
+ * @return The K_MAPS_PROTO_CMD_* identifier or K_MAPS_PROTO_CMD_UNKNOWN.
+ */
+constexpr uint8_t id_of(const message &msg)
+{
+    if (msg.index() == 0)
+        return std::get<0>(msg).id;
+
+    return (msg.index() - 1) % K_MAPS_PROTO_CMD_COUNT;
+}
+
+/** @brief Get the type of a message.
+ *
+ * @param  msg The message.
+ * @return 0: Request. 1: Response. 2: Unknown MSG or Not Executed.
+ */
+constexpr uint8_t type_of(const message &msg)
+{
+    return (msg.index() == 0) ? 2 : (msg.index() - 1) / K_MAPS_PROTO_CMD_COUNT;
+}
+
+namespace detail
+{
+
+inline void assign(std::monostate &, const void *, int) { }
+
+inline void assign(uint8_t &value, const void *data, int size)
+{
+    value = (size) ? *static_cast<const uint8_t *>(data) : 0;
+}
+
+template <class T>
+void assign(T &value, const void *data, int size)
+{
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= K_MAPS_PROTO_MAX_DATA_SIZE);
+
+    if (size)
+        std::memcpy(&value,data,sizeof(T));
+}
+
+template <class T>
+void assign(std::optional<T> &value, const void *data, int size)
+{
+    if (size)
+        assign(value.emplace(),data,size);
+    else
+        value.reset();
+}
+
+using factory = void (*)(message &msg, uint8_t num, const void *data, int size);
+
+template <class M>
+void make(message &msg, uint8_t num, const void *data, int size)
+{
+    M &m = msg.emplace<M>();
+
+    m.num = num;
+    assign(m.data,data,size);
+}
+
+template <std::size_t... I>
+constexpr std::array<factory,sizeof...(I)> request_factories(std::index_sequence<I...>)
+{
+    return {{ &make<request<I>>... }};
+}
+
+template <std::size_t... I>
+constexpr std::array<factory,sizeof...(I)> response_factories(std::index_sequence<I...>)
+{
+    return {{ &make<response<I>>... }};
+}
+
+inline constexpr auto requests  = request_factories (std::make_index_sequence<K_MAPS_PROTO_CMD_COUNT>{});
+inline constexpr auto responses = response_factories(std::make_index_sequence<K_MAPS_PROTO_CMD_COUNT>{});
+
+// The message of a frame decoded with MapsProtoParseFrameTo
+inline void to_message(message &msg, const tMAPS_PROTO_FRAME_HEADER &header, const void *data, int size)
+{
+    if (header.type == 2)
+    {
+        not_executed &ne = msg.emplace<not_executed>();
+
+        ne.num = header.num;
+        ne.id  = header.cmd_id;
+        std::memcpy(ne.cmd,header.cmd,sizeof(ne.cmd));
+    }
+    else if (header.type == 1)
+        responses[header.cmd_id](msg,header.num,data,size);
+    else
+        requests[header.cmd_id](msg,header.num,data,size);
+}
+
+} // namespace detail
+
+/** @brief Parse a MAPS frame into a message.
+ *
+ *  The heap is not used. On error the message is not changed.
+ *
+ * @param  frame The MAPS frame to parse.
+ * @param  size  The size of the frame.
+ * @param  msg   Where the message is stored.
+ * @return 0 on success or the errno value of MapsProtoParseFrameTo.
+ */
+inline int parse(const uint8_t *frame, uint16_t size, message &msg) noexcept
+{
+    int length;
+    tMAPS_PROTO_FRAME_HEADER header;
+    alignas(8) uint8_t data[K_MAPS_PROTO_MAX_DATA_SIZE];
+
+    if ((length = MapsProtoParseFrameTo(frame,size,&header,data,sizeof(data))) < 0)
+        return errno;
+
+    detail::to_message(msg,header,data,length);
+    return 0;
+}
+
+} // namespace maps
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,87 @@
+
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "maps_record.h"
+//-----------------------------------------------------------------------------
+
+_Static_assert(sizeof(tMAPS_PROTO_PAYLOAD) == K_MAPS_PROTO_PAYLOAD_SIZE, "The payload must have the size of the biggest data structure");
+_Static_assert(sizeof(tMAPS_PROTO_RECORD)  == K_MAPS_PROTO_RECORD_SIZE , "The record must have a fixed size");
+_Static_assert(offsetof(tMAPS_PROTO_RECORD,timestamp) % 8 == 0, "The timestamp must be aligned");
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoRecordEncode(const tMAPS_PROTO_PARSED_FRAME *parsed, uint16_t lane, uint64_t timestamp, tMAPS_PROTO_RECORD *record)
+{
+    if (!parsed || !record)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (parsed->size > K_MAPS_PROTO_PAYLOAD_SIZE || (parsed->size && !parsed->data))
+    {
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    memset(record,0,sizeof(tMAPS_PROTO_RECORD));
+
+    record->version   = K_MAPS_PROTO_RECORD_VERSION;
+    record->cmd_id    = MapsProtoGetCmdId(parsed->cmd);
+    record->num       = parsed->num;
+    record->type      = parsed->type;
+    record->lane      = lane;
+    record->size      = (parsed->data) ? parsed->size : 0;
+    record->timestamp = (timestamp) ? timestamp : parsed->timestamp;
+    memcpy(record->cmd,parsed->cmd,K_MAPS_PROTO_CMD_LENGTH);
+
+    if (record->size)
+        memcpy(record->payload.raw,parsed->data,record->size);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_PARSED_FRAME * MapsProtoRecordDecode(const tMAPS_PROTO_RECORD *record)
+{
+    tMAPS_PROTO_PARSED_FRAME *parsed;
+
+    if (!record)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (record->version != K_MAPS_PROTO_RECORD_VERSION || record->size > K_MAPS_PROTO_PAYLOAD_SIZE)
+    {
+        errno = ENOEXEC;
+        return NULL;
+    }
+
+    if ((parsed = (tMAPS_PROTO_PARSED_FRAME *)calloc(1,sizeof(tMAPS_PROTO_PARSED_FRAME))) == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (record->size && (parsed->data = (char *)calloc(record->size,sizeof(char))) == NULL)
+    {
+        MapsProtoFreeParsedFrame(parsed);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    parsed->num  = record->num;
+    parsed->type = record->type;
+    parsed->size = record->size;
+    parsed->timestamp = record->timestamp;
+    memcpy(parsed->cmd,record->cmd,K_MAPS_PROTO_CMD_LENGTH);
+
+    if (record->size)
+        memcpy(parsed->data,record->payload.raw,record->size);
+
+    return parsed;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+#ifndef MAPS_RECORD_H
+#define MAPS_RECORD_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_record.h
+ *  @brief Function prototypes for encode parsed MAPS frames in a fixed
+ *         size binary record and decode them.
+ *
+ *  The tMAPS_PROTO_PARSED_FRAME structure have a pointer to the data so it
+ *  can't be copied or shared between processes. The tMAPS_PROTO_RECORD have
+ *  the data inside a union with all the data structures, so the record can
+ *  be copied with memcpy, stored in shared memory or written to a file.
+ *
+ *  The record uses the byte order of the host. The version member must be
+ *  checked before use a record created by other process or read from a file.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_RECORD_VERSION  1     ///< The current version of the record format.
+#define K_MAPS_PROTO_RECORD_SIZE     128   ///< The size of the record in bytes.
+#define K_MAPS_PROTO_PAYLOAD_SIZE    88    ///< The size of the payload union. The biggest data structure (tMAPS_PROTO_BARRIER_ADJUST).
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @union  tMAPS_PROTO_PAYLOAD
+ * @brief  The data of a parsed frame. The member to use depends on the command.
+ *         See the table in the tMAPS_PROTO_PARSED_FRAME description.
+ *
+ *         The commands with data of 1 byte (BR, ER, PR, SR, CB, IA and RM) use value.
+ *
+ */
+typedef union
+{
+    uint8_t value;                      ///< Data of 1 byte.
+    tMAPS_PROTO_CA_DATA ca;             ///< CA request.
+    tMAPS_PROTO_DE_DATA de;             ///< DE response.
+    tMAPS_PROTO_EA_DATA ea;             ///< EA response.
+    tMAPS_PROTO_SC_DATA sc;             ///< SC request.
+    tMAPS_PROTO_SM_DATA sm;             ///< SM request.
+    tMAPS_PROTO_TT_DATA tt;             ///< TT response.
+    tMAPS_PROTO_RH_DATA rh;             ///< RH request or response.
+    tMAPS_PROTO_BARRIER_ADJUST adjust;  ///< AJ or PA SPECIAL.
+    tMAPS_PROTO_SC_SPECIAL scs;         ///< SC SPECIAL.
+    tMAPS_PROTO_AP_DATA ap;             ///< AP.
+    tMAPS_PROTO_EJ_DATA ej;             ///< EJ.
+    tMAPS_PROTO_EM_DATA em;             ///< EM.
+    tMAPS_PROTO_END_VEHICLE end;        ///< FA SPONTANEOUS or FR.
+    tMAPS_PROTO_FAILURE_DATA failure;   ///< FX or PX.
+    tMAPS_PROTO_RE_DATA re;             ///< RE for CF-220.
+    uint8_t raw[K_MAPS_PROTO_PAYLOAD_SIZE]; ///< The payload as bytes.
+}tMAPS_PROTO_PAYLOAD;
+
+/**
+ *
+ * @struct tMAPS_PROTO_RECORD
+ * @brief  A parsed frame in a fixed size record of K_MAPS_PROTO_RECORD_SIZE bytes.
+ *
+ *         All the members are aligned to its size so the record can be used
+ *         directly from a shared memory or a mapped file.
+ *
+ */
+typedef struct
+{
+    uint8_t version;      ///< The record format version. K_MAPS_PROTO_RECORD_VERSION.
+    uint8_t cmd_id;       ///< The command identifier. K_MAPS_PROTO_CMD_* value.
+    uint8_t num;          ///< Number between 0-9
+    uint8_t type;         ///< Type of frame: 0: Request. 1: Response. 2: Unknown MSG or Not Executed.
+    char cmd[K_MAPS_PROTO_CMD_LENGTH+1]; ///< The command as in tMAPS_PROTO_PARSED_FRAME. Is a NULL terminate string.
+    uint16_t lane;        ///< The lane (barrier) of the frame. Assigned by the application.
+    uint16_t size;        ///< The size of the data in the payload. 0 when the frame not have data.
+    uint32_t reserved;    ///< Not used. Always 0.
+    uint64_t timestamp;   ///< The time of the frame. Assigned by the application. i.e. Nanoseconds.
+    tMAPS_PROTO_PAYLOAD payload; ///< The data of the frame.
+    uint8_t padding[K_MAPS_PROTO_RECORD_SIZE-24-K_MAPS_PROTO_PAYLOAD_SIZE]; ///< Not used. Always 0.
+}tMAPS_PROTO_RECORD;
+
+/** @brief Encode a parsed frame in a record.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The parsed or record params are NULL.
+ *      ENOEXEC: The data of the parsed frame is bigger than the payload.
+ *
+ * @param  parsed    The parsed frame. Created with MapsProtoParseFrame.
+ * @param  lane      The lane of the frame.
+ * @param  timestamp The time of the frame. 0 to use the timestamp of the parsed frame.
+ * @param  record    The record where the frame is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoRecordEncode(const tMAPS_PROTO_PARSED_FRAME *parsed, uint16_t lane, uint64_t timestamp, tMAPS_PROTO_RECORD *record);
+
+/** @brief Decode a record in a new parsed frame. The timestamp of the record is the timestamp of the frame.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The record param is NULL.
+ *      ENOEXEC: The record have other version or an invalid data size.
+ *
+ * @param  record The record to decode.
+ * @return NULL on error and Errno is set or on sucess a new allocated tMAPS_PROTO_PARSED_FRAME structure.
+ *         Must be freed with MapsProtoFreeParsedFrame.
+ */
+tMAPS_PROTO_PARSED_FRAME * MapsProtoRecordDecode(const tMAPS_PROTO_RECORD *record);
+
+//-----------------------------------------------------------------------------
+#endif
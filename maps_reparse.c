@@ -0,0 +1,335 @@
+
+#include <fcntl.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "maps_reparse.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_REPARSE_SOH  0x01
+#define K_MAPS_PROTO_REPARSE_LF   0x0A
+#define K_MAPS_PROTO_REPARSE_CR   0x0D
+#define K_MAPS_PROTO_PASF_SIZE    88
+#define K_MAPS_PROTO_SCSF_SIZE    12
+
+#define reparse_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_REPARSE_CHUNK
+ * @brief  A chunk of the capture and the frames found in it.
+ *
+ */
+typedef struct
+{
+    const uint8_t *data;  ///< The capture.
+    size_t size;          ///< The size of the capture.
+    size_t start;         ///< The first byte of the chunk. Is a boundary.
+    size_t end;           ///< The first byte of the next chunk.
+    size_t count;         ///< Frames found.
+    size_t capacity;      ///< Size of the frames array.
+    uint64_t junk;
+    uint64_t resyncs;
+    uint64_t errors;
+    int error;            ///< ENOMEM when the frames array can't grow.
+    pthread_t thread;
+    tMAPS_PROTO_REPARSE_FRAME *frames;
+}tMAPS_PROTO_REPARSE_CHUNK;
+//-----------------------------------------------------------------------------
+
+static uint8_t MapsProtoReparseCheckLRC(const uint8_t *frame, uint16_t size);
+static size_t  MapsProtoReparseSync(const uint8_t *data, size_t size, size_t offset);
+static void *  MapsProtoReparseChunk(void *param);
+static void    MapsProtoReparseFreeChunk(tMAPS_PROTO_REPARSE_CHUNK *chunk);
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoReparseCheckLRC(const uint8_t *frame, uint16_t size)
+{
+    uint8_t lrc = 0;
+
+    for (uint16_t i = 1; i < size-3; i++)
+        lrc ^= frame[i];
+
+    return (frame[size-3] == 48 + (lrc >> 4) && frame[size-2] == 48 + (lrc & 0x0F));
+}
+//-----------------------------------------------------------------------------
+
+size_t MapsProtoReparseSync(const uint8_t *data, size_t size, size_t offset)
+{
+    const uint8_t *cr;
+
+    if (offset == 0 || offset >= size)
+        return (offset) ? size : 0;
+
+    if ((cr = (const uint8_t *) memchr(&data[offset-1],K_MAPS_PROTO_REPARSE_CR,size-offset+1)) == NULL)
+        return size;
+
+    return (cr - data) + 1;
+}
+//-----------------------------------------------------------------------------
+
+void * MapsProtoReparseChunk(void *param)
+{
+    int found;
+    size_t pos, junk;
+    uint16_t length;
+    tMAPS_PROTO_REPARSE_FRAME *frame;
+    tMAPS_PROTO_REPARSE_CHUNK *chunk = (tMAPS_PROTO_REPARSE_CHUNK *) param;
+
+    for (pos = chunk->start; pos < chunk->end; pos += length)
+    {
+        found = MapsProtoReparseNext(chunk->data,chunk->end,&pos,&length,&junk);
+
+        chunk->junk    += junk;
+        chunk->resyncs += (junk != 0);
+
+        if (!found && pos < chunk->end)  // Incomplete frame at the end of the capture (the chunks end after a <CR>)
+        {
+            chunk->resyncs += (junk == 0);
+            chunk->junk    += chunk->end - pos;
+        }
+
+        if (!found)
+            break;
+
+        // A SC SPECIAL at the end of the chunk. The <LF> is the first byte of the next chunk.
+        if (length == K_MAPS_PROTO_SCSF_SIZE + 1 && pos + length == chunk->end && chunk->end < chunk->size &&
+            chunk->data[chunk->end] == K_MAPS_PROTO_REPARSE_LF && chunk->data[pos] != K_MAPS_PROTO_REPARSE_SOH)
+            length++;
+
+        if (chunk->count == chunk->capacity)
+        {
+            size_t capacity = (chunk->capacity) ? chunk->capacity * 2 : 1024;
+
+            if ((frame = (tMAPS_PROTO_REPARSE_FRAME *)realloc(chunk->frames,capacity * sizeof(tMAPS_PROTO_REPARSE_FRAME))) == NULL)
+            {
+                chunk->error = ENOMEM;
+                break;
+            }
+
+            chunk->frames   = frame;
+            chunk->capacity = capacity;
+        }
+
+        frame = &chunk->frames[chunk->count++];
+        frame->offset = pos;
+        frame->size   = length;
+        frame->error  = 0;
+
+        if ((frame->parsed = MapsProtoParseFrame((uint8_t *) &chunk->data[pos],length)) == NULL)
+        {
+            frame->error = errno;
+            chunk->errors++;
+        }
+    }
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoReparseFreeChunk(tMAPS_PROTO_REPARSE_CHUNK *chunk)
+{
+    for (size_t i = 0; i < chunk->count; i++)
+        MapsProtoFreeParsedFrame(chunk->frames[i].parsed);
+
+    free(chunk->frames);
+    chunk->frames   = NULL;
+    chunk->count    = 0;
+    chunk->capacity = 0;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoReparseNext(const uint8_t *data, size_t size, size_t *offset, uint16_t *length, size_t *junk)
+{
+    size_t pos, next, n, skipped = 0;
+    uint8_t found = 0;
+    const uint8_t *cr;
+
+    if (!data || !offset || !length)
+        reparse_error(EINVAL);
+
+    for (pos = *offset; pos < size && !found; pos = next)
+    {
+        if (data[pos] == K_MAPS_PROTO_REPARSE_LF && pos > 0 && data[pos-1] == K_MAPS_PROTO_REPARSE_CR)
+        {
+            next = pos + 1;  // The <LF> after a <CR> is a boundary, not junk
+            continue;
+        }
+
+        if (data[pos] == K_MAPS_PROTO_REPARSE_SOH)  // Framed message. SOH ... LRC LRC <CR>
+        {
+            n  = (size - pos < K_MAPS_PROTO_REPARSE_MAX_FRAME) ? size - pos : K_MAPS_PROTO_REPARSE_MAX_FRAME;
+            cr = (const uint8_t *) memchr(&data[pos],K_MAPS_PROTO_REPARSE_CR,n);
+
+            if (!cr && n < K_MAPS_PROTO_REPARSE_MAX_FRAME)  // Incomplete
+                break;
+            if (cr && cr - &data[pos] >= 6 && MapsProtoReparseCheckLRC(&data[pos],cr - &data[pos] + 1))
+            {
+                *length = cr - &data[pos] + 1;
+                found = 1;
+                break;
+            }
+        }
+        else  // Unframed PA SPECIAL (88 + <CR>) or SC SPECIAL (12 + <CR>[<LF>]). Only hex chars
+        {
+            for (n = 0; n <= K_MAPS_PROTO_PASF_SIZE && pos + n < size && isxdigit(data[pos+n]); n++);
+
+            if (pos + n == size && n <= K_MAPS_PROTO_PASF_SIZE)  // Incomplete
+                break;
+            if ((n == K_MAPS_PROTO_PASF_SIZE || n == K_MAPS_PROTO_SCSF_SIZE) && data[pos+n] == K_MAPS_PROTO_REPARSE_CR)
+            {
+                *length = n + 1 + (n == K_MAPS_PROTO_SCSF_SIZE && pos + n + 1 < size && data[pos+n+1] == K_MAPS_PROTO_REPARSE_LF);
+                found = 1;
+                break;
+            }
+        }
+
+        // Junk. Skip to the next boundary: SOH or the byte after a <CR>
+        for (next = pos + 1; next < size && data[next] != K_MAPS_PROTO_REPARSE_SOH && data[next-1] != K_MAPS_PROTO_REPARSE_CR; next++);
+
+        skipped += next - pos;
+    }
+
+    if (junk)
+        *junk = skipped;
+
+    *offset = pos;
+
+    return found;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoReparseBuffer(const uint8_t *data, size_t size, uint16_t threads, size_t chunk_size,
+                           tMAPS_PROTO_REPARSE_FUNC callback, void *user, tMAPS_PROTO_REPARSE_STATS *stats)
+{
+    long cores;
+    uint16_t i, used;
+    size_t pos = 0;
+    int rc = 0, error = 0;
+    tMAPS_PROTO_REPARSE_CHUNK *chunks;
+    tMAPS_PROTO_REPARSE_STATS result = { 0 };
+
+    if (!data || !callback)
+        reparse_error(EINVAL);
+
+    if (!threads)
+        threads = ((cores = sysconf(_SC_NPROCESSORS_ONLN)) > 0) ? (cores > 1024) ? 1024 : cores : 1;
+    if (!chunk_size)
+        chunk_size = K_MAPS_PROTO_REPARSE_CHUNK_SIZE;
+
+    if ((chunks = (tMAPS_PROTO_REPARSE_CHUNK *)calloc(threads,sizeof(tMAPS_PROTO_REPARSE_CHUNK))) == NULL)
+        reparse_error(ENOMEM);
+
+    while (pos < size && !rc)
+    {
+        // Each round parses one chunk by thread. The first chunk is parsed by the caller thread.
+        for (used = 0; used < threads && pos < size; used++)
+        {
+            chunks[used].data  = data;
+            chunks[used].size  = size;
+            chunks[used].start = pos;
+            chunks[used].end   = pos = MapsProtoReparseSync(data,size,(size - pos > chunk_size) ? pos + chunk_size : size);
+
+            if (used && (error = pthread_create(&chunks[used].thread,NULL,MapsProtoReparseChunk,&chunks[used])))
+                break;
+        }
+
+        MapsProtoReparseChunk(&chunks[0]);
+
+        for (i = 1; i < used; i++)
+            pthread_join(chunks[i].thread,NULL);
+
+        for (i = 0; i < used; i++)
+        {
+            tMAPS_PROTO_REPARSE_CHUNK *chunk = &chunks[i];
+
+            if (chunk->error && !error)
+                error = chunk->error;
+
+            for (size_t f = 0; f < chunk->count && !rc && !error; f++) {
+                if (callback(&chunk->frames[f],user))
+                    rc = -1;
+            }
+
+            result.frames  += chunk->count;
+            result.errors  += chunk->errors;
+            result.junk    += chunk->junk;
+            result.resyncs += chunk->resyncs;
+            result.chunks++;
+
+            MapsProtoReparseFreeChunk(chunk);
+            memset(chunk,0,sizeof(tMAPS_PROTO_REPARSE_CHUNK));
+        }
+
+        if (error)
+            break;
+    }
+
+    free(chunks);
+
+    if (stats)
+        memcpy(stats,&result,sizeof(tMAPS_PROTO_REPARSE_STATS));
+
+    if (error)
+        reparse_error(error);
+    if (rc)
+        reparse_error(ECANCELED);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoReparseFile(const char *path, uint16_t threads, size_t chunk_size,
+                         tMAPS_PROTO_REPARSE_FUNC callback, void *user, tMAPS_PROTO_REPARSE_STATS *stats)
+{
+    int fd, rc, error;
+    struct stat st;
+    uint8_t *data;
+
+    if (!path || !callback)
+        reparse_error(EINVAL);
+
+    if ((fd = open(path,O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+
+    if (fstat(fd,&st))
+    {
+        error = errno;
+        close(fd);
+        reparse_error(error);
+    }
+
+    if (st.st_size == 0)
+    {
+        close(fd);
+
+        if (stats)
+            memset(stats,0,sizeof(tMAPS_PROTO_REPARSE_STATS));
+
+        return 0;
+    }
+
+    data = (uint8_t *)mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    error = errno;
+    close(fd);
+
+    if (data == MAP_FAILED)
+        reparse_error(error);
+
+    madvise(data,st.st_size,MADV_SEQUENTIAL);
+
+    rc = MapsProtoReparseBuffer(data,st.st_size,threads,chunk_size,callback,user,stats);
+    error = errno;
+    munmap(data,st.st_size);
+    errno = error;
+
+    return rc;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,131 @@
+#ifndef MAPS_REPARSE_H
+#define MAPS_REPARSE_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_reparse.h
+ *  @brief Function prototypes for find and parse the frames of a raw
+ *         capture of a serial line.
+ *
+ *  A capture can have incomplete frames, noise or frames with a bad LRC. The
+ *  frames are found from a boundary: the start of the capture, the byte
+ *  after a <CR> (the last byte of every frame) or a SOH. A framed message
+ *  starts with SOH and is accepted when its LRC is valid. The unframed PA
+ *  SPECIAL (88 hex + <CR>) and SC SPECIAL (12 hex + <CR>[<LF>]) messages
+ *  are accepted when they start in a boundary. The other bytes until the
+ *  next boundary are junk.
+ *
+ *  The frames never have a <CR> inside, so a big capture is split in chunks
+ *  that start after a <CR> and all the chunks are parsed at the same time
+ *  by several threads. The frames are given to the callback in the original
+ *  order.
+ */
+
+#include <stddef.h>
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_REPARSE_MAX_FRAME  95          ///< The size of the biggest frame (AJ).
+#define K_MAPS_PROTO_REPARSE_CHUNK_SIZE 0x100000    ///< Default chunk size (1 MiB). The parsed frames of threads chunks are in memory at the same time.
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_REPARSE_FRAME
+ * @brief  A frame found in the capture.
+ *
+ */
+typedef struct
+{
+    uint64_t offset;      ///< The offset of the frame in the capture.
+    uint16_t size;        ///< The size of the frame.
+    int error;            ///< 0 or the errno value of MapsProtoParseFrame.
+    tMAPS_PROTO_PARSED_FRAME *parsed;  ///< The parsed frame. NULL when error is not 0. Is freed after the callback.
+}tMAPS_PROTO_REPARSE_FRAME;
+
+/**
+ *
+ * @struct tMAPS_PROTO_REPARSE_STATS
+ * @brief  The result of a reparse.
+ *
+ */
+typedef struct
+{
+    uint64_t frames;      ///< Frames found (parsed or with error).
+    uint64_t errors;      ///< Frames that MapsProtoParseFrame can't parse.
+    uint64_t junk;        ///< Bytes that are not part of a frame.
+    uint64_t resyncs;     ///< Times that junk was skipped to find the next frame.
+    uint32_t chunks;      ///< Chunks parsed.
+}tMAPS_PROTO_REPARSE_STATS;
+
+/**
+ * The callback for each frame. Must return 0 to continue or other value to stop.
+ */
+typedef int (*tMAPS_PROTO_REPARSE_FUNC)(const tMAPS_PROTO_REPARSE_FRAME *frame, void *user);
+
+/** @brief Find the next frame in a buffer.
+ *
+ *  The search starts in offset, that must be a boundary (0 or the end of
+ *  the previous frame). When a frame is found offset is the start of the
+ *  frame. When the buffer ends with an incomplete frame offset is the start
+ *  of that frame, so the function can be called again when more data is
+ *  available.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The data, offset or length params are NULL.
+ *
+ * @param  data   The buffer.
+ * @param  size   The size of the buffer.
+ * @param  offset The start of the search. Is updated with the start of the frame.
+ * @param  length Where the size of the frame is stored.
+ * @param  junk   If is not NULL, the bytes skipped before the frame are stored.
+ * @return 1 when a frame is found, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoReparseNext(const uint8_t *data, size_t size, size_t *offset, uint16_t *length, size_t *junk);
+
+/** @brief Parse all the frames of a buffer with several threads.
+ *
+ *  The callback is called from the caller thread with the frames in the
+ *  original order.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The data or callback params are NULL.
+ *      ECANCELED: The callback returned a value different of 0.
+ *
+ *  Or any errno value of pthread_create.
+ *
+ * @param  data       The buffer with the capture.
+ * @param  size       The size of the buffer.
+ * @param  threads    The threads to use. 0 to use one thread by core.
+ * @param  chunk_size The size of each chunk. 0 to use K_MAPS_PROTO_REPARSE_CHUNK_SIZE.
+ * @param  callback   The function called for each frame.
+ * @param  user       The user param of the callback.
+ * @param  stats      If is not NULL, the result is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoReparseBuffer(const uint8_t *data, size_t size, uint16_t threads, size_t chunk_size,
+                           tMAPS_PROTO_REPARSE_FUNC callback, void *user, tMAPS_PROTO_REPARSE_STATS *stats);
+
+/** @brief Parse all the frames of a capture file with several threads.
+ *
+ *  The file is mapped and parsed with MapsProtoReparseBuffer.
+ *
+ *  The errno values are the same as MapsProtoReparseBuffer or any errno
+ *  value of open, fstat or mmap.
+ *
+ * @param  path       The path of the capture file.
+ * @param  threads    The threads to use. 0 to use one thread by core.
+ * @param  chunk_size The size of each chunk. 0 to use K_MAPS_PROTO_REPARSE_CHUNK_SIZE.
+ * @param  callback   The function called for each frame.
+ * @param  user       The user param of the callback.
+ * @param  stats      If is not NULL, the result is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoReparseFile(const char *path, uint16_t threads, size_t chunk_size,
+                         tMAPS_PROTO_REPARSE_FUNC callback, void *user, tMAPS_PROTO_REPARSE_STATS *stats);
+
+//-----------------------------------------------------------------------------
+#endif
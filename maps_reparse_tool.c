@@ -0,0 +1,128 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "maps_serial.h"
+#include "maps_reparse.h"
+//-----------------------------------------------------------------------------
+
+/** @file maps_reparse_tool.c
+ *  @brief Parse a raw capture of a serial line with all the cores and write
+ *         the frames as JSON lines (see maps_serial.h) to the standard output.
+ *
+ *  Usage: maps_reparse [-t threads] [-c chunk_kb] [-e] capture_file
+ *
+ *      -t: Threads to use. Range 1 to 1024. By default one by core.
+ *      -c: Chunk size in KiB. Range 1 to 1048576. By default 1024.
+ *      -e: Write the frames that can't be parsed as {"offset":N,"size":N,"error":"..."}.
+ *
+ *  The statistics are written to the standard error. An option out of its
+ *  range is a usage error.
+ */
+//-----------------------------------------------------------------------------
+
+#define USAGE "Usage: %s [-t threads] [-c chunk_kb] [-e] capture_file\n"
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint8_t errors;       ///< 1 for write the frames that can't be parsed.
+    uint64_t failed;      ///< Frames that can't be written.
+}tREPARSE_OUTPUT;
+//-----------------------------------------------------------------------------
+
+int write_frame(const tMAPS_PROTO_REPARSE_FRAME *frame, void *user)
+{
+    int size;
+    char line[1024];
+    tREPARSE_OUTPUT *output = (tREPARSE_OUTPUT *) user;
+
+    if (frame->parsed)
+    {
+        if ((size = MapsProtoSerialJson(frame->parsed,line,sizeof(line))) < 0)
+            output->failed++;
+        else
+            fwrite(line,1,size,stdout);
+    }
+    else if (output->errors)
+        printf("{\"offset\":%llu,\"size\":%u,\"error\":\"%s\"}\n",(unsigned long long) frame->offset,frame->size,strerror(frame->error));
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+// Parse a numeric option. -1 when it is not a number between min and max
+int parse_range(const char *arg, unsigned long min, unsigned long max, unsigned long *value)
+{
+    char *end;
+
+    errno  = 0;
+    *value = strtoul(arg,&end,0);
+
+    if (errno || end == arg || *end || *arg == '-' || *value < min || *value > max)
+        return -1;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    unsigned long value;
+    uint16_t threads = 0;
+    size_t chunk_size = 0;
+    tREPARSE_OUTPUT output = { 0, 0 };
+    tMAPS_PROTO_REPARSE_STATS stats;
+
+    while ((opt = getopt(argc,argv,"t:c:e")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                    if (parse_range(optarg,1,1024,&value))
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+                    threads = value;
+            break;
+            case 'c':
+                    if (parse_range(optarg,1,1048576,&value))
+                    {
+                        fprintf(stderr,USAGE,argv[0]);
+                        return 1;
+                    }
+                    chunk_size = (size_t) value * 1024;
+            break;
+            case 'e':
+                    output.errors = 1;
+            break;
+            default:
+                    fprintf(stderr,USAGE,argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        fprintf(stderr,USAGE,argv[0]);
+        return 1;
+    }
+
+    if (MapsProtoReparseFile(argv[optind],threads,chunk_size,write_frame,&output,&stats))
+    {
+        fprintf(stderr,"Error parsing %s: %s\n",argv[optind],strerror(errno));
+        return 1;
+    }
+
+    fflush(stdout);
+    fprintf(stderr,"frames: %llu errors: %llu junk bytes: %llu resyncs: %llu chunks: %u not written: %llu\n",
+            (unsigned long long) stats.frames,(unsigned long long) stats.errors,(unsigned long long) stats.junk,
+            (unsigned long long) stats.resyncs,stats.chunks,(unsigned long long) output.failed);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,349 @@
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "maps_sched.h"
+//-----------------------------------------------------------------------------
+
+#define sched_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_SCHED_ENTRY
+ * @brief  A periodic poll of a lane.
+ *
+ */
+typedef struct
+{
+    char cmd[K_MAPS_PROTO_CMD_LENGTH+1]; ///< The command to send.
+    uint32_t period_ms;   ///< Time between polls.
+    uint32_t req_us;      ///< Time on the line of the request.
+    uint32_t cost_us;     ///< Time on the line of the request and the response.
+    uint64_t due_ms;      ///< When the next poll must be sent.
+}tMAPS_PROTO_SCHED_ENTRY;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SCHED_LANE
+ * @brief  A barrier connected to a line.
+ *
+ */
+typedef struct
+{
+    uint8_t line;         ///< The line of the barrier.
+    uint8_t baud_rate;    ///< The baud rate code (1 to 5).
+    uint8_t barrier;      ///< The barrier model. K_MAPS_PROTO_BARRIER_* value.
+    uint8_t num;          ///< The next message number to use.
+    uint8_t present;      ///< 1 when a vehicle is present.
+    uint8_t npolls;       ///< Number of polls used in the entries array.
+    uint64_t present_ms;  ///< When the vehicle presence starts.
+    tMAPS_PROTO_SCHED_ENTRY entries[K_MAPS_PROTO_SCHED_MAX_POLLS]; ///< The polls of the lane.
+}tMAPS_PROTO_SCHED_LANE;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SCHED_LINE
+ * @brief  The state of a serial line.
+ *
+ *         The tokens are the line time available for polls. They are refilled
+ *         at max_load percent of the real time and consumed by the polls and the
+ *         spontaneous messages. They can be negative when the spontaneous
+ *         traffic uses more time than the allowed for the polls.
+ *
+ */
+typedef struct
+{
+    int64_t tokens_us;    ///< Line time available for polls.
+    uint64_t last_ms;     ///< Last time that the tokens were refilled.
+    int32_t pending;      ///< The lane with a poll without response or -1.
+    uint64_t deadline_ms; ///< The time limit for the response of the pending poll.
+    uint64_t window_ms;   ///< When the current window starts.
+    uint8_t started;      ///< 1 when the line was used at least one time.
+    uint8_t completed;    ///< 1 when the last member have the usage of a complete window.
+    tMAPS_PROTO_SCHED_USAGE current; ///< Usage of the current window.
+    tMAPS_PROTO_SCHED_USAGE last;    ///< Usage of the last complete window.
+}tMAPS_PROTO_SCHED_LINE;
+
+struct sMAPS_PROTO_SCHED
+{
+    uint16_t budget_ms;   ///< The planning window.
+    uint8_t max_load;     ///< Percent of the line time for polls.
+    uint8_t nlines;       ///< Number of lines.
+    uint16_t nlanes;      ///< Number of lanes used.
+    uint16_t maxlanes;    ///< Number of lanes allocated.
+    tMAPS_PROTO_SCHED_LINE *lines;
+    tMAPS_PROTO_SCHED_LANE *lanes;
+};
+//-----------------------------------------------------------------------------
+
+static void MapsProtoSchedUpdate(tMAPS_PROTO_SCHED *sched, tMAPS_PROTO_SCHED_LINE *line, uint64_t now_ms);
+//-----------------------------------------------------------------------------
+
+void MapsProtoSchedUpdate(tMAPS_PROTO_SCHED *sched, tMAPS_PROTO_SCHED_LINE *line, uint64_t now_ms)
+{
+    int64_t capacity = (int64_t) sched->budget_ms * 10 * sched->max_load;  // budget_ms * 1000 * max_load / 100
+
+    if (!line->started)   // The line starts with the full budget.
+    {
+        line->started   = 1;
+        line->tokens_us = capacity;
+        line->last_ms   = now_ms;
+        line->window_ms = now_ms;
+    }
+
+    if (now_ms > line->last_ms)
+    {
+        line->tokens_us += (int64_t)(now_ms - line->last_ms) * 10 * sched->max_load;
+        line->tokens_us  = (line->tokens_us > capacity) ? capacity : line->tokens_us;
+        line->last_ms    = now_ms;
+    }
+
+    if (now_ms - line->window_ms >= sched->budget_ms)
+    {
+        uint64_t total = (uint64_t) line->current.poll_us + line->current.spont_us;
+
+        line->current.window_ms = (uint32_t)(now_ms - line->window_ms);
+        line->current.load      = (total >= (uint64_t) line->current.window_ms * 1000) ? 100 :
+                                  (uint8_t)((total * 100) / ((uint64_t) line->current.window_ms * 1000));
+
+        line->last      = line->current;
+        line->completed = 1;
+        line->window_ms = now_ms;
+        memset(&line->current,0,sizeof(tMAPS_PROTO_SCHED_USAGE));
+    }
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_SCHED * MapsProtoSchedCreate(uint8_t lines, uint16_t lanes, uint16_t budget_ms, uint8_t max_load)
+{
+    tMAPS_PROTO_SCHED *sched;
+
+    if (!lines || !lanes || !budget_ms || !max_load || max_load > 100)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((sched = (tMAPS_PROTO_SCHED *)calloc(1,sizeof(tMAPS_PROTO_SCHED))) == NULL ||
+        (sched->lines = (tMAPS_PROTO_SCHED_LINE *)calloc(lines,sizeof(tMAPS_PROTO_SCHED_LINE))) == NULL ||
+        (sched->lanes = (tMAPS_PROTO_SCHED_LANE *)calloc(lanes,sizeof(tMAPS_PROTO_SCHED_LANE))) == NULL)
+    {
+        MapsProtoSchedFree(sched);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    sched->budget_ms = budget_ms;
+    sched->max_load  = max_load;
+    sched->nlines    = lines;
+    sched->maxlanes  = lanes;
+
+    for (uint8_t i = 0; i < lines; i++)
+         sched->lines[i].pending = -1;
+
+    return sched;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoSchedFree(tMAPS_PROTO_SCHED *sched)
+{
+    if (sched)
+    {
+        if (sched->lines)
+            free(sched->lines);
+        if (sched->lanes)
+            free(sched->lanes);
+
+        free(sched);
+    }
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSchedAddLane(tMAPS_PROTO_SCHED *sched, uint8_t line, uint8_t baud_rate, uint8_t barrier)
+{
+    tMAPS_PROTO_SCHED_LANE *lane;
+
+    if (!sched || line >= sched->nlines || baud_rate < 1 || baud_rate > 5)
+        sched_error(EINVAL);
+    if (barrier != K_MAPS_PROTO_BARRIER_CF24P && barrier != K_MAPS_PROTO_BARRIER_CF150 && barrier != K_MAPS_PROTO_BARRIER_CF220)
+        sched_error(EINVAL);
+    if (sched->nlanes >= sched->maxlanes)
+        sched_error(ENOSPC);
+
+    lane = &sched->lanes[sched->nlanes];
+    lane->line      = line;
+    lane->baud_rate = baud_rate;
+    lane->barrier   = barrier;
+
+    return sched->nlanes++;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSchedAddPoll(tMAPS_PROTO_SCHED *sched, uint16_t lane, const char *cmd, uint32_t period_ms)
+{
+    tMAPS_PROTO_CMD_SPEC spec;
+    tMAPS_PROTO_SCHED_LANE  *sl;
+    tMAPS_PROTO_SCHED_ENTRY *entry;
+
+    if (!sched || lane >= sched->nlanes || !period_ms)
+        sched_error(EINVAL);
+    if (MapsProtoGetCmdSpec(cmd,&spec) || strlen(cmd) != 2 || !(spec.barriers & sched->lanes[lane].barrier))
+        sched_error(EPERM);
+    if (!(spec.suppdata & 2))
+        sched_error(EINVAL);
+
+    sl = &sched->lanes[lane];
+
+    if (sl->npolls >= K_MAPS_PROTO_SCHED_MAX_POLLS)
+        sched_error(ENOSPC);
+
+    entry = &sl->entries[sl->npolls++];
+    memcpy(entry->cmd,cmd,3);
+    entry->period_ms = period_ms;
+    entry->req_us    = MapsProtoGetWireTime(spec.req_size,sl->baud_rate);
+    entry->cost_us   = entry->req_us + MapsProtoGetWireTime(spec.res_size,sl->baud_rate);
+    entry->due_ms    = 0;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSchedNext(tMAPS_PROTO_SCHED *sched, uint8_t line, uint64_t now_ms, tMAPS_PROTO_SCHED_POLL *poll)
+{
+    tMAPS_PROTO_SCHED_LINE  *sline;
+    tMAPS_PROTO_SCHED_LANE  *blane = NULL;
+    tMAPS_PROTO_SCHED_ENTRY *best  = NULL;
+
+    if (!sched || line >= sched->nlines || !poll)
+        sched_error(EINVAL);
+
+    sline = &sched->lines[line];
+    MapsProtoSchedUpdate(sched,sline,now_ms);
+
+    if (sline->pending >= 0)
+    {
+        if (now_ms < sline->deadline_ms)
+            return 0;
+
+        sline->current.timeouts++;
+        sline->pending = -1;
+    }
+
+    for (uint16_t i = 0; i < sched->nlanes; i++)
+    {
+        tMAPS_PROTO_SCHED_LANE *lane = &sched->lanes[i];
+
+        if (lane->line != line)
+            continue;
+        if (lane->present && now_ms - lane->present_ms < K_MAPS_PROTO_SCHED_PRESENCE_MS)
+            continue;
+
+        lane->present = 0;
+
+        for (uint8_t j = 0; j < lane->npolls; j++)
+        {
+            if (lane->entries[j].due_ms <= now_ms && (!best || lane->entries[j].due_ms < best->due_ms))
+            {
+                best  = &lane->entries[j];
+                blane = lane;
+            }
+        }
+    }
+
+    if (best == NULL)
+        return 0;
+
+    if (sline->tokens_us < (int64_t) best->cost_us)  // Spontaneous traffic has priority. Wait for line time.
+    {
+        sline->current.deferred++;
+        return 0;
+    }
+
+    poll->lane      = (uint16_t)(blane - sched->lanes);
+    poll->num       = blane->num;
+    poll->wire_time = best->cost_us;
+    memcpy(poll->cmd,best->cmd,K_MAPS_PROTO_CMD_LENGTH+1);
+
+    blane->num = (blane->num + 1) % 10;
+    best->due_ms = (best->due_ms + best->period_ms > now_ms) ? (best->due_ms + best->period_ms) : (now_ms + best->period_ms);
+
+    sline->tokens_us  -= best->cost_us;
+    sline->pending     = poll->lane;
+    sline->deadline_ms = now_ms + (best->cost_us + 999) / 1000 + K_MAPS_PROTO_SCHED_TURNAROUND_MS;
+    sline->current.poll_us += best->req_us;
+    sline->current.sent++;
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSchedOnFrame(tMAPS_PROTO_SCHED *sched, uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, uint16_t size, uint64_t now_ms)
+{
+    uint32_t wire;
+    tMAPS_PROTO_SCHED_LANE *sl;
+    tMAPS_PROTO_SCHED_LINE *sline;
+
+    if (!sched || lane >= sched->nlanes)
+        sched_error(EINVAL);
+
+    sl    = &sched->lanes[lane];
+    sline = &sched->lines[sl->line];
+    wire  = MapsProtoGetWireTime(size,sl->baud_rate);
+
+    MapsProtoSchedUpdate(sched,sline,now_ms);
+
+    if (parsed && parsed->type)  // ### Response (RS) or not executed (NE) ###
+    {
+        sline->current.poll_us += wire;
+
+        if (sline->pending == lane)
+            sline->pending = -1;
+    }
+    else                         // ### Spontaneous or invalid frame ###
+    {
+        sline->current.spont_us += wire;
+        sline->tokens_us        -= wire;
+
+        if (parsed == NULL)
+            return 0;
+
+        if (!strcmp(parsed->cmd,"IP") || !strcmp(parsed->cmd,"IA") || !strcmp(parsed->cmd,"IR"))
+        {
+            sl->present    = 1;
+            sl->present_ms = now_ms;
+        }
+        else if (!strcmp(parsed->cmd,"FP") || !strcmp(parsed->cmd,"FAS") || !strcmp(parsed->cmd,"FR"))
+            sl->present = 0;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSchedGetUsage(tMAPS_PROTO_SCHED *sched, uint8_t line, uint64_t now_ms, tMAPS_PROTO_SCHED_USAGE *usage)
+{
+    tMAPS_PROTO_SCHED_LINE *sline;
+
+    if (!sched || line >= sched->nlines || !usage)
+        sched_error(EINVAL);
+
+    sline = &sched->lines[line];
+    MapsProtoSchedUpdate(sched,sline,now_ms);
+
+    if (sline->completed)
+        *usage = sline->last;
+    else
+    {
+        uint64_t total = (uint64_t) sline->current.poll_us + sline->current.spont_us;
+
+        *usage = sline->current;
+        usage->window_ms = (uint32_t)(now_ms - sline->window_ms);
+        usage->load      = (!usage->window_ms) ? 0 : (total >= (uint64_t) usage->window_ms * 1000) ? 100 :
+                           (uint8_t)((total * 100) / ((uint64_t) usage->window_ms * 1000));
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
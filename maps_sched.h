@@ -0,0 +1,172 @@
+#ifndef MAPS_SCHED_H
+#define MAPS_SCHED_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_sched.h
+ *  @brief Function prototypes for plan the barrier polls (DE, EA, MV, TT...)
+ *         on serial lines shared by several barriers.
+ *
+ *  The scheduler not make any I/O. The caller ask for the next poll of a line
+ *  with MapsProtoSchedNext, create the frame with MapsProtoCreateEmptyRequest
+ *  and send it. Every frame received on the lane (responses and spontaneous)
+ *  must be notified with MapsProtoSchedOnFrame.
+ *
+ *  The time on the line of each poll (request + response) is calculated with
+ *  the command sizes (MapsProtoGetCmdSpec) and the lane baud rate. The polls
+ *  only can use max_load percent of the line time and the spontaneous traffic
+ *  always consumes from the same budget, so when the barriers send vehicle
+ *  messages the polls are delayed. The polls of a lane are suspended while
+ *  a vehicle is present (IP/IA/IR to FP/FA/FR).
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SCHED_MAX_POLLS      8      ///< Max polls configured by lane.
+#define K_MAPS_PROTO_SCHED_TURNAROUND_MS  10     ///< Time given to the barrier for start the response.
+#define K_MAPS_PROTO_SCHED_PRESENCE_MS    30000  ///< Max presence time. After it, the polls of the lane are restarted.
+//-----------------------------------------------------------------------------
+
+typedef struct sMAPS_PROTO_SCHED tMAPS_PROTO_SCHED;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SCHED_POLL
+ * @brief  A poll to send. Created by MapsProtoSchedNext.
+ *
+ */
+typedef struct
+{
+    uint16_t lane;        ///< The lane (barrier) where the poll must be sent.
+    uint8_t num;          ///< The message number to use. Range 0 to 9.
+    char cmd[K_MAPS_PROTO_CMD_LENGTH+1]; ///< The command to send. Is a NULL terminate string.
+    uint32_t wire_time;   ///< Time on the line in microseconds of the request and the response.
+}tMAPS_PROTO_SCHED_POLL;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SCHED_USAGE
+ * @brief  The usage of a line in the last complete window.
+ *
+ *         When the first window is not complete, the values are from
+ *         the beginning of the window until now.
+ *
+ */
+typedef struct
+{
+    uint32_t window_ms;   ///< The window time in milliseconds.
+    uint32_t poll_us;     ///< Time on the line used by polls and responses in microseconds.
+    uint32_t spont_us;    ///< Time on the line used by spontaneous messages in microseconds.
+    uint8_t load;         ///< Line utilization in percent. Range 0 to 100.
+    uint32_t sent;        ///< Number of polls sent in the window.
+    uint32_t deferred;    ///< Number of times that a due poll was delayed for not have line time.
+    uint32_t timeouts;    ///< Number of polls without response in the window.
+}tMAPS_PROTO_SCHED_USAGE;
+
+/** @brief Creates a new poll scheduler.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: Some param is zero or max_load is greater than 100.
+ *
+ * @param  lines     The number of serial lines. Range 1 to 255.
+ * @param  lanes     The max number of lanes (barriers) in all lines.
+ * @param  budget_ms The planning window in milliseconds. i.e. 1000
+ * @param  max_load  The percent of the line time that the polls can use. Range 1 to 100.
+ * @return NULL on error and Errno is set or on sucess a new allocated scheduler.
+ */
+tMAPS_PROTO_SCHED * MapsProtoSchedCreate(uint8_t lines, uint16_t lanes, uint16_t budget_ms, uint8_t max_load);
+
+/** @brief Free a scheduler created with MapsProtoSchedCreate.
+ *
+ * @param  sched The scheduler to free.
+ */
+void MapsProtoSchedFree(tMAPS_PROTO_SCHED *sched);
+
+/** @brief Add a lane (barrier) to a line.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid sched, line, baud_rate or barrier param.
+ *      ENOSPC: The max number of lanes is reached.
+ *
+ * @param  sched     The scheduler.
+ * @param  line      The line number where the barrier is connected. Range 0 to lines-1.
+ * @param  baud_rate The baud rate code of the barrier (BR command). Range 1 to 5.
+ * @param  barrier   The barrier model. One of K_MAPS_PROTO_BARRIER_* values.
+ * @return The lane number or -1 on error and errno is set.
+ */
+int MapsProtoSchedAddLane(tMAPS_PROTO_SCHED *sched, uint8_t line, uint8_t baud_rate, uint8_t barrier);
+
+/** @brief Add a periodic poll to a lane.
+ *
+ *  Only commands with empty request (DE, EA, MV, TT, ...) can be used.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid sched or lane param, period_ms is zero or the command not have empty request.
+ *       EPERM: Unknown command or is not supported by the lane barrier.
+ *      ENOSPC: The lane have K_MAPS_PROTO_SCHED_MAX_POLLS polls.
+ *
+ * @param  sched     The scheduler.
+ * @param  lane      The lane returned by MapsProtoSchedAddLane.
+ * @param  cmd       The command to send. Must be a NULL terminate string.
+ * @param  period_ms The time between polls in milliseconds.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoSchedAddPoll(tMAPS_PROTO_SCHED *sched, uint16_t lane, const char *cmd, uint32_t period_ms);
+
+/** @brief Get the next poll to send on a line.
+ *
+ *  Only one poll is pending by line. The next poll is returned when the
+ *  response of the previous poll arrives or when the response time expires.
+ *  From the due polls the most delayed is selected.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid sched, line or poll param.
+ *
+ * @param  sched  The scheduler.
+ * @param  line   The line number.
+ * @param  now_ms The current time in milliseconds from a monotonic clock.
+ * @param  poll   The structure where the poll to send is stored.
+ * @return 1 when there is a poll to send, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoSchedNext(tMAPS_PROTO_SCHED *sched, uint8_t line, uint64_t now_ms, tMAPS_PROTO_SCHED_POLL *poll);
+
+/** @brief Notify a received frame on a lane.
+ *
+ *  The responses (RS/NE) complete the pending poll of the line. The
+ *  spontaneous messages consume line time from the polls budget and
+ *  the IP, IA, IR, FP, FA and FR messages changes the vehicle presence.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid sched or lane param.
+ *
+ * @param  sched  The scheduler.
+ * @param  lane   The lane where the frame was received.
+ * @param  parsed The parsed frame. Can be NULL when the frame is invalid.
+ * @param  size   The size of the received frame in bytes.
+ * @param  now_ms The current time in milliseconds from a monotonic clock.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoSchedOnFrame(tMAPS_PROTO_SCHED *sched, uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, uint16_t size, uint64_t now_ms);
+
+/** @brief Get the utilization of a line.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid sched, line or usage param.
+ *
+ * @param  sched  The scheduler.
+ * @param  line   The line number.
+ * @param  now_ms The current time in milliseconds from a monotonic clock.
+ * @param  usage  The structure where the usage is stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoSchedGetUsage(tMAPS_PROTO_SCHED *sched, uint8_t line, uint64_t now_ms, tMAPS_PROTO_SCHED_USAGE *usage);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,459 @@
+
+#include <string.h>
+#include <stddef.h>
+
+#include "maps_serial.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SERIAL_NUM   0   ///< uint8_t member. Written as number.
+#define K_MAPS_PROTO_SERIAL_NUM16 1   ///< uint16_t member. Written as number.
+#define K_MAPS_PROTO_SERIAL_CHAR  2   ///< char member. Written as string. 0 is an empty string.
+#define K_MAPS_PROTO_SERIAL_TEXT  3   ///< char array member. Written as string until the length or a NULL character.
+
+#define K_MAPS_PROTO_SERIAL_JSON  0
+#define K_MAPS_PROTO_SERIAL_CSV   1
+#define K_MAPS_PROTO_SERIAL_HEAD  2
+
+#define serial_field(st,m,k,n,l) { n, k, l, offsetof(st,m) }
+#define serial_num(st,m)         serial_field(st,m,K_MAPS_PROTO_SERIAL_NUM,#m,1)
+#define serial_char(st,m)        serial_field(st,m,K_MAPS_PROTO_SERIAL_CHAR,#m,1)
+#define serial_text(st,m,l)      serial_field(st,m,K_MAPS_PROTO_SERIAL_TEXT,#m,l)
+#define serial_schema(st,f)      { f, sizeof(f) / sizeof(f[0]), sizeof(st) }
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_SERIAL_FIELD
+ * @brief  A member of a data structure.
+ *
+ */
+typedef struct
+{
+    const char *name;     ///< The name of the member in maps_proto.h.
+    uint8_t kind;         ///< K_MAPS_PROTO_SERIAL_NUM, NUM16, CHAR or TEXT.
+    uint8_t length;       ///< The length of the TEXT members.
+    uint16_t offset;      ///< The offset of the member in the structure.
+}tMAPS_PROTO_SERIAL_FIELD;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SERIAL_SCHEMA
+ * @brief  The members of a data structure.
+ *
+ */
+typedef struct
+{
+    const tMAPS_PROTO_SERIAL_FIELD *fields;
+    uint8_t count;        ///< Number of fields.
+    uint16_t size;        ///< The size of the data structure. Must be the size of the parsed data.
+}tMAPS_PROTO_SERIAL_SCHEMA;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SERIAL_OUT
+ * @brief  The buffer of the caller and the write position.
+ *
+ */
+typedef struct
+{
+    char *buffer;
+    uint32_t size;
+    uint32_t pos;
+    uint8_t full;         ///< 1 when some data not fit in the buffer.
+}tMAPS_PROTO_SERIAL_OUT;
+//-----------------------------------------------------------------------------
+
+static const tMAPS_PROTO_SERIAL_FIELD value_fields[] = {
+    { "value", K_MAPS_PROTO_SERIAL_NUM, 1, 0 }
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD ca_fields[] = {
+    serial_num(tMAPS_PROTO_CA_DATA,ca_sensors),
+    serial_num(tMAPS_PROTO_CA_DATA,da_sensors)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD de_fields[] = {
+    serial_num (tMAPS_PROTO_DE_DATA,work_mode),
+    serial_num (tMAPS_PROTO_DE_DATA,axis_ispeed),
+    serial_num (tMAPS_PROTO_DE_DATA,axis_height),
+    serial_char(tMAPS_PROTO_DE_DATA,tow_detection),
+    serial_num (tMAPS_PROTO_DE_DATA,hw_failure),
+    serial_num (tMAPS_PROTO_DE_DATA,se_cleaning),
+    serial_num (tMAPS_PROTO_DE_DATA,firmware_ver),
+    serial_char(tMAPS_PROTO_DE_DATA,rcvr_direction),
+    serial_char(tMAPS_PROTO_DE_DATA,barrier_model)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD ea_fields[] = {
+    serial_num(tMAPS_PROTO_EA_DATA,imax_height),
+    serial_num(tMAPS_PROTO_EA_DATA,umax_height),
+    serial_num(tMAPS_PROTO_EA_DATA,umin_height),
+    serial_num(tMAPS_PROTO_EA_DATA,lmax_height)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD sc_fields[] = {
+    serial_char (tMAPS_PROTO_SC_DATA,mode),
+    serial_field(tMAPS_PROTO_SC_DATA,send_time,K_MAPS_PROTO_SERIAL_NUM16,"send_time",2)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD sm_fields[] = {
+    serial_num (tMAPS_PROTO_SM_DATA,work_mode),
+    serial_num (tMAPS_PROTO_SM_DATA,axis_ispeed),
+    serial_num (tMAPS_PROTO_SM_DATA,axis_height),
+    serial_char(tMAPS_PROTO_SM_DATA,tow_detection),
+    serial_char(tMAPS_PROTO_SM_DATA,rcvr_direction)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD tt_fields[] = {
+    serial_char(tMAPS_PROTO_TT_DATA,mvar),
+    serial_text(tMAPS_PROTO_TT_DATA,e_map,K_MAPS_PROTO_EMITTERS_MAP_SIZE),
+    serial_char(tMAPS_PROTO_TT_DATA,rvar),
+    serial_text(tMAPS_PROTO_TT_DATA,r_map,K_MAPS_PROTO_RECEIVERS_MAP_SIZE)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD rh_fields[] = {
+    serial_num(tMAPS_PROTO_RH_DATA,wmode),
+    serial_num(tMAPS_PROTO_RH_DATA,recvn)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD adjust_fields[] = {
+    serial_text(tMAPS_PROTO_BARRIER_ADJUST,rcv_map8,K_MAPS_PROTO_RECEIVE_GROUP8),
+    serial_text(tMAPS_PROTO_BARRIER_ADJUST,rcv_map3,K_MAPS_PROTO_RECEIVE_GROUP3)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD scs_abc_fields[] = {
+    serial_char (tMAPS_PROTO_SC_SPECIAL,mode),
+    serial_field(tMAPS_PROTO_SC_SPECIAL,MODES.ABCMODES.presence,K_MAPS_PROTO_SERIAL_NUM,"presence",1),
+    serial_field(tMAPS_PROTO_SC_SPECIAL,MODES.ABCMODES.sensors,K_MAPS_PROTO_SERIAL_TEXT,"sensors",K_MAPS_PROTO_SENSORS_MAP),
+    serial_field(tMAPS_PROTO_SC_SPECIAL,MODES.ABCMODES.sweeps_num,K_MAPS_PROTO_SERIAL_NUM,"sweeps_num",1)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD scs_dehi_fields[] = {
+    serial_char (tMAPS_PROTO_SC_SPECIAL,mode),
+    serial_field(tMAPS_PROTO_SC_SPECIAL,MODES.DEHI_MODES,K_MAPS_PROTO_SERIAL_TEXT,"DEHI_MODES",K_MAPS_PROTO_DEHI_BUFFER)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD ap_fields[] = {
+    serial_num (tMAPS_PROTO_AP_DATA,smbyte),
+    serial_num (tMAPS_PROTO_AP_DATA,vheight),
+    serial_char(tMAPS_PROTO_AP_DATA,vaxis),
+    serial_num (tMAPS_PROTO_AP_DATA,reserved),
+    serial_num (tMAPS_PROTO_AP_DATA,axis_height),
+    serial_num (tMAPS_PROTO_AP_DATA,vmax_height),
+    serial_num (tMAPS_PROTO_AP_DATA,hmin_height),
+    serial_num (tMAPS_PROTO_AP_DATA,lmax_height)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD ej_fields[] = {
+    serial_num(tMAPS_PROTO_EJ_DATA,paxes),
+    serial_num(tMAPS_PROTO_EJ_DATA,naxes),
+    serial_num(tMAPS_PROTO_EJ_DATA,ispeed)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD em_fields[] = {
+    serial_num (tMAPS_PROTO_EM_DATA,work_mode),
+    serial_num (tMAPS_PROTO_EM_DATA,axis_ispeed),
+    serial_num (tMAPS_PROTO_EM_DATA,axis_height),
+    serial_char(tMAPS_PROTO_EM_DATA,tow_detection),
+    serial_num (tMAPS_PROTO_EM_DATA,hw_failure),
+    serial_num (tMAPS_PROTO_EM_DATA,se_cleaning),
+    serial_num (tMAPS_PROTO_EM_DATA,firmware_ver),
+    serial_char(tMAPS_PROTO_EM_DATA,rcvr_direction),
+    serial_char(tMAPS_PROTO_EM_DATA,reserved)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD end_fields[] = {
+    serial_num (tMAPS_PROTO_END_VEHICLE,smb),
+    serial_char(tMAPS_PROTO_END_VEHICLE,vclass),
+    serial_num (tMAPS_PROTO_END_VEHICLE,paxes),
+    serial_num (tMAPS_PROTO_END_VEHICLE,naxes),
+    serial_num (tMAPS_PROTO_END_VEHICLE,paxes10),
+    serial_num (tMAPS_PROTO_END_VEHICLE,naxes10),
+    serial_num (tMAPS_PROTO_END_VEHICLE,paxes16),
+    serial_num (tMAPS_PROTO_END_VEHICLE,naxes16),
+    serial_num (tMAPS_PROTO_END_VEHICLE,paxes22),
+    serial_num (tMAPS_PROTO_END_VEHICLE,naxes22)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD failure_fields[] = {
+    serial_char(tMAPS_PROTO_FAILURE_DATA,type),
+    serial_num (tMAPS_PROTO_FAILURE_DATA,ngroup),
+    serial_num (tMAPS_PROTO_FAILURE_DATA,nsensor)
+};
+
+static const tMAPS_PROTO_SERIAL_FIELD re_fields[] = {
+    serial_text(tMAPS_PROTO_RE_DATA,bmodel,K_MAPS_PROTO_BMODEL_LENGTH),
+    serial_text(tMAPS_PROTO_RE_DATA,fversion,K_MAPS_PROTO_FVERSION_LENGTH),
+    serial_text(tMAPS_PROTO_RE_DATA,fnum_rev,K_MAPS_PROTO_FNUM_REV_LENGTH),
+    serial_text(tMAPS_PROTO_RE_DATA,ver_date,K_MAPS_PROTO_VER_DATE_LENGTH)
+};
+//-----------------------------------------------------------------------------
+
+static const tMAPS_PROTO_SERIAL_SCHEMA value_schema    = { value_fields, 1, 1 };
+static const tMAPS_PROTO_SERIAL_SCHEMA ca_schema       = serial_schema(tMAPS_PROTO_CA_DATA,ca_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA de_schema       = serial_schema(tMAPS_PROTO_DE_DATA,de_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA ea_schema       = serial_schema(tMAPS_PROTO_EA_DATA,ea_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA sc_schema       = serial_schema(tMAPS_PROTO_SC_DATA,sc_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA sm_schema       = serial_schema(tMAPS_PROTO_SM_DATA,sm_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA tt_schema       = serial_schema(tMAPS_PROTO_TT_DATA,tt_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA rh_schema       = serial_schema(tMAPS_PROTO_RH_DATA,rh_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA adjust_schema   = serial_schema(tMAPS_PROTO_BARRIER_ADJUST,adjust_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA scs_abc_schema  = serial_schema(tMAPS_PROTO_SC_SPECIAL,scs_abc_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA scs_dehi_schema = serial_schema(tMAPS_PROTO_SC_SPECIAL,scs_dehi_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA ap_schema       = serial_schema(tMAPS_PROTO_AP_DATA,ap_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA ej_schema       = serial_schema(tMAPS_PROTO_EJ_DATA,ej_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA em_schema       = serial_schema(tMAPS_PROTO_EM_DATA,em_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA end_schema      = serial_schema(tMAPS_PROTO_END_VEHICLE,end_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA failure_schema  = serial_schema(tMAPS_PROTO_FAILURE_DATA,failure_fields);
+static const tMAPS_PROTO_SERIAL_SCHEMA re_schema       = serial_schema(tMAPS_PROTO_RE_DATA,re_fields);
+
+/**
+ * The schemas of each command by type. [0] request. [1] response.
+ * The data of 1 byte uses value_schema and the SC SPECIAL uses the schema of the mode.
+ */
+static const tMAPS_PROTO_SERIAL_SCHEMA *schemas[K_MAPS_PROTO_CMD_COUNT][2] =
+{
+    [K_MAPS_PROTO_CMD_CA]  = { &ca_schema      , NULL       },
+    [K_MAPS_PROTO_CMD_DE]  = { NULL            , &de_schema },
+    [K_MAPS_PROTO_CMD_EA]  = { NULL            , &ea_schema },
+    [K_MAPS_PROTO_CMD_SC]  = { &sc_schema      , NULL       },
+    [K_MAPS_PROTO_CMD_SM]  = { &sm_schema      , NULL       },
+    [K_MAPS_PROTO_CMD_TT]  = { NULL            , &tt_schema },
+    [K_MAPS_PROTO_CMD_RH]  = { &rh_schema      , &rh_schema },
+    [K_MAPS_PROTO_CMD_PAS] = { &adjust_schema  , NULL       },
+    [K_MAPS_PROTO_CMD_SCS] = { &scs_abc_schema , NULL       },
+    [K_MAPS_PROTO_CMD_FAS] = { &end_schema     , NULL       },
+    [K_MAPS_PROTO_CMD_AJ]  = { &adjust_schema  , NULL       },
+    [K_MAPS_PROTO_CMD_AP]  = { &ap_schema      , NULL       },
+    [K_MAPS_PROTO_CMD_EJ]  = { &ej_schema      , NULL       },
+    [K_MAPS_PROTO_CMD_EM]  = { &em_schema      , NULL       },
+    [K_MAPS_PROTO_CMD_FR]  = { &end_schema     , NULL       },
+    [K_MAPS_PROTO_CMD_FX]  = { &failure_schema , NULL       },
+    [K_MAPS_PROTO_CMD_PX]  = { &failure_schema , NULL       },
+    [K_MAPS_PROTO_CMD_RE]  = { &re_schema      , NULL       }
+};
+//-----------------------------------------------------------------------------
+
+static const tMAPS_PROTO_SERIAL_SCHEMA * MapsProtoSerialGetSchema(const tMAPS_PROTO_PARSED_FRAME *parsed);
+static void MapsProtoSerialPut(tMAPS_PROTO_SERIAL_OUT *out, const char *data, uint32_t size);
+static void MapsProtoSerialPutNumber(tMAPS_PROTO_SERIAL_OUT *out, uint16_t value);
+static void MapsProtoSerialPutText(tMAPS_PROTO_SERIAL_OUT *out, uint8_t format, const char *text, uint32_t length);
+static int  MapsProtoSerialWrite(const tMAPS_PROTO_PARSED_FRAME *parsed, uint8_t format, char *buffer, uint32_t size);
+//-----------------------------------------------------------------------------
+
+const tMAPS_PROTO_SERIAL_SCHEMA * MapsProtoSerialGetSchema(const tMAPS_PROTO_PARSED_FRAME *parsed)
+{
+    uint8_t id;
+    const tMAPS_PROTO_SERIAL_SCHEMA *schema = NULL;
+
+    if (!parsed->data || !parsed->size)
+        return NULL;
+    if (parsed->size == 1)
+        return &value_schema;
+
+    if ((id = MapsProtoGetCmdId(parsed->cmd)) < K_MAPS_PROTO_CMD_COUNT && parsed->type < 2)
+        schema = schemas[id][parsed->type];
+
+    if (schema == &scs_abc_schema)
+    {
+        uint8_t mode = ((const tMAPS_PROTO_SC_SPECIAL *) parsed->data)->mode;
+
+        if (mode != 'A' && mode != 'B' && mode != 'C')
+            schema = &scs_dehi_schema;
+    }
+
+    if (!schema || schema->size != parsed->size)
+    {
+        errno = ENOEXEC;
+        return NULL;
+    }
+
+    return schema;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoSerialPut(tMAPS_PROTO_SERIAL_OUT *out, const char *data, uint32_t size)
+{
+    if (out->full || out->size - out->pos <= size)  // Always keep a byte for the NULL character
+    {
+        out->full = 1;
+        return;
+    }
+
+    memcpy(&out->buffer[out->pos],data,size);
+    out->pos += size;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoSerialPutNumber(tMAPS_PROTO_SERIAL_OUT *out, uint16_t value)
+{
+    char digits[5];
+    uint8_t pos = sizeof(digits);
+
+    do
+    {
+        digits[--pos] = (value % 10) + 48;
+        value /= 10;
+    } while (value);
+
+    MapsProtoSerialPut(out,&digits[pos],sizeof(digits) - pos);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoSerialPutText(tMAPS_PROTO_SERIAL_OUT *out, uint8_t format, const char *text, uint32_t length)
+{
+    uint32_t i, start;
+    uint8_t quote = (format == K_MAPS_PROTO_SERIAL_JSON);
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (i = 0; i < length && text[i]; i++) {  // On CSV only the text with separators are quoted
+        if (text[i] == ',' || text[i] == '"' || text[i] == '\r' || text[i] == '\n')
+            quote = 1;
+    }
+
+    length = i;
+
+    if (quote)
+        MapsProtoSerialPut(out,"\"",1);
+
+    for (i = 0, start = 0; i < length; i++)
+    {
+        uint8_t c = text[i];
+
+        if (format == K_MAPS_PROTO_SERIAL_JSON && (c < 0x20 || c > 0x7E || c == '"' || c == '\\'))
+        {
+            char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+
+            MapsProtoSerialPut(out,&text[start],i - start);
+
+            if (c == '"' || c == '\\')
+                MapsProtoSerialPut(out,(c == '"') ? "\\\"" : "\\\\",2);
+            else
+                MapsProtoSerialPut(out,escape,6);
+
+            start = i + 1;
+        }
+        else if (format == K_MAPS_PROTO_SERIAL_CSV && c == '"')
+        {
+            MapsProtoSerialPut(out,&text[start],i - start + 1);
+            start = i;  // The quote is written twice
+        }
+    }
+
+    MapsProtoSerialPut(out,&text[start],length - start);
+
+    if (quote)
+        MapsProtoSerialPut(out,"\"",1);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSerialWrite(const tMAPS_PROTO_PARSED_FRAME *parsed, uint8_t format, char *buffer, uint32_t size)
+{
+    uint8_t i;
+    const uint8_t *data;
+    const tMAPS_PROTO_SERIAL_SCHEMA *schema;
+    tMAPS_PROTO_SERIAL_OUT out = { buffer, size, 0, 0 };
+
+    if (!parsed || !buffer)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((schema = MapsProtoSerialGetSchema(parsed)) == NULL && parsed->data && parsed->size)
+        return -1;
+
+    data = (const uint8_t *) parsed->data;
+
+    if (format == K_MAPS_PROTO_SERIAL_HEAD)
+    {
+        MapsProtoSerialPut(&out,"num,type,cmd",12);
+
+        for (i = 0; schema && i < schema->count; i++)
+        {
+            MapsProtoSerialPut(&out,",",1);
+            MapsProtoSerialPut(&out,schema->fields[i].name,strlen(schema->fields[i].name));
+        }
+    }
+    else
+    {
+        uint8_t json = (format == K_MAPS_PROTO_SERIAL_JSON);
+
+        MapsProtoSerialPut(&out,(json) ? "{\"num\":" : "",(json) ? 7 : 0);
+        MapsProtoSerialPutNumber(&out,parsed->num);
+        MapsProtoSerialPut(&out,(json) ? ",\"type\":" : ",",(json) ? 8 : 1);
+        MapsProtoSerialPutNumber(&out,parsed->type);
+        MapsProtoSerialPut(&out,(json) ? ",\"cmd\":" : ",",(json) ? 7 : 1);
+        MapsProtoSerialPutText(&out,format,parsed->cmd,K_MAPS_PROTO_CMD_LENGTH);
+
+        for (i = 0; schema && i < schema->count; i++)
+        {
+            const tMAPS_PROTO_SERIAL_FIELD *field = &schema->fields[i];
+
+            MapsProtoSerialPut(&out,",",1);
+
+            if (json)
+            {
+                MapsProtoSerialPut(&out,"\"",1);
+                MapsProtoSerialPut(&out,field->name,strlen(field->name));
+                MapsProtoSerialPut(&out,"\":",2);
+            }
+
+            switch (field->kind)
+            {
+                case K_MAPS_PROTO_SERIAL_NUM:
+                        MapsProtoSerialPutNumber(&out,data[field->offset]);
+                break;
+                case K_MAPS_PROTO_SERIAL_NUM16:
+                {
+                        uint16_t value;
+
+                        memcpy(&value,&data[field->offset],sizeof(uint16_t));
+                        MapsProtoSerialPutNumber(&out,value);
+                }
+                break;
+                default:
+                        MapsProtoSerialPutText(&out,format,(const char *) &data[field->offset],field->length);
+                break;
+            }
+        }
+
+        if (json)
+            MapsProtoSerialPut(&out,"}",1);
+    }
+
+    MapsProtoSerialPut(&out,"\n",1);
+
+    if (out.full)
+    {
+        if (size)
+            buffer[0] = 0;
+
+        errno = ENOSPC;
+        return -1;
+    }
+
+    buffer[out.pos] = 0;
+
+    return out.pos;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoSerialJson(const tMAPS_PROTO_PARSED_FRAME *parsed, char *buffer, uint32_t size)
+{
+    return MapsProtoSerialWrite(parsed,K_MAPS_PROTO_SERIAL_JSON,buffer,size);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSerialCsv(const tMAPS_PROTO_PARSED_FRAME *parsed, char *buffer, uint32_t size)
+{
+    return MapsProtoSerialWrite(parsed,K_MAPS_PROTO_SERIAL_CSV,buffer,size);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoSerialCsvHeader(const tMAPS_PROTO_PARSED_FRAME *parsed, char *buffer, uint32_t size)
+{
+    return MapsProtoSerialWrite(parsed,K_MAPS_PROTO_SERIAL_HEAD,buffer,size);
+}
+//-----------------------------------------------------------------------------
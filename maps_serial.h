@@ -0,0 +1,72 @@
+#ifndef MAPS_SERIAL_H
+#define MAPS_SERIAL_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_serial.h
+ *  @brief Function prototypes for serialize parsed MAPS frames to JSON lines
+ *         and CSV.
+ *
+ *  The functions write into a buffer of the caller. They not use the heap or
+ *  the printf family of functions, so they can be used on the hot path of
+ *  the sinks that store or monitor every frame.
+ *
+ *  Each frame starts with the num, type and cmd members. Then the members of
+ *  the data structure of the command (see tMAPS_PROTO_PARSED_FRAME) are
+ *  written with the same names that have in maps_proto.h. The commands with
+ *  data of 1 byte have the member value. The numeric members are written as
+ *  numbers and the char members as strings.
+ *
+ *  JSON example for a DE response:
+ *
+ *  {"num":2,"type":1,"cmd":"DE","work_mode":0,"axis_ispeed":0,...,"barrier_model":"4"}
+ *
+ *  The CSV rows have different columns for each command. Use
+ *  MapsProtoSerialCsvHeader for get the header of a frame.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+/** @brief Serialize a parsed frame as a JSON line (ends with '\n').
+ *
+ *  The string in the buffer is NULL terminated.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The parsed or buffer params are NULL.
+ *      ENOSPC: The buffer is too small.
+ *      ENOEXEC: The data of the frame not match the command.
+ *
+ * @param  parsed The parsed frame.
+ * @param  buffer The buffer where the JSON line is stored.
+ * @param  size   The size of the buffer.
+ * @return The length of the line without the NULL character or -1 on error and errno is set.
+ */
+int MapsProtoSerialJson(const tMAPS_PROTO_PARSED_FRAME *parsed, char *buffer, uint32_t size);
+
+/** @brief Serialize a parsed frame as a CSV row (ends with '\n').
+ *
+ *  The string in the buffer is NULL terminated. The errno values are the
+ *  same as MapsProtoSerialJson.
+ *
+ * @param  parsed The parsed frame.
+ * @param  buffer The buffer where the CSV row is stored.
+ * @param  size   The size of the buffer.
+ * @return The length of the row without the NULL character or -1 on error and errno is set.
+ */
+int MapsProtoSerialCsv(const tMAPS_PROTO_PARSED_FRAME *parsed, char *buffer, uint32_t size);
+
+/** @brief Write the CSV header for the rows of a parsed frame (ends with '\n').
+ *
+ *  The frames with the same cmd, type and data structure have the same header.
+ *  The errno values are the same as MapsProtoSerialJson.
+ *
+ * @param  parsed The parsed frame.
+ * @param  buffer The buffer where the CSV header is stored.
+ * @param  size   The size of the buffer.
+ * @return The length of the header without the NULL character or -1 on error and errno is set.
+ */
+int MapsProtoSerialCsvHeader(const tMAPS_PROTO_PARSED_FRAME *parsed, char *buffer, uint32_t size);
+
+//-----------------------------------------------------------------------------
+#endif
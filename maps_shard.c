@@ -0,0 +1,809 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pthread_attr_setaffinity_np & CPU_* macros
+#endif
+
+#include <time.h>
+#include <sched.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#ifdef MAPS_PROTO_NUMA
+#include <numa.h>
+#endif
+
+#include "maps_stats.h"
+#include "maps_reparse.h"
+#include "maps_stamp.h"
+#include "maps_dedup.h"
+#include "maps_shed.h"
+#include "maps_shard.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SHARD_DECODER  0x1000    // Bytes of the decoder buffer of each lane. Bigger than a frame
+#define K_MAPS_PROTO_SHARD_IDLE_MS  100       // Milliseconds that an idle worker waits before check its lanes again
+#define K_MAPS_PROTO_SHARD_STAMPS   0x100     // Arrival times kept by lane. Power of 2
+#define K_MAPS_PROTO_SHARD_CR       0x0D
+
+#define shard_error(e) do { errno = e; return -1; } while (0)
+
+// Hint for the core while a real time worker spins
+#if defined(__x86_64__) || defined(__i386__)
+#define shard_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define shard_relax() __asm__ __volatile__("yield")
+#else
+#define shard_relax()
+#endif
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_SHARD_STAMP
+ * @brief  The arrival time of the bytes of a push.
+ *
+ */
+typedef struct
+{
+    uint64_t offset;                         ///< The position of the first byte of the push in the bytes of the lane.
+    uint64_t timestamp;                      ///< The arrival time of the bytes in nanoseconds (CLOCK_MONOTONIC).
+}tMAPS_PROTO_SHARD_STAMP;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SHARD_LANE
+ * @brief  The state of a lane. tail, stail and stamps are only written by
+ *         the producer and the rest only by the worker that owns the lane,
+ *         each group in its own cache lines.
+ *
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t tail;      ///< Bytes pushed. Written by the producer.
+    _Atomic uint64_t stail;                  ///< Arrival times pushed. Written by the producer.
+    _Alignas(64) _Atomic uint64_t head;      ///< Bytes copied to the decoder buffer.
+    _Atomic uint64_t shead;                  ///< Arrival times consumed.
+    uint64_t stamp;                          ///< The arrival time of the last stamp consumed.
+    _Atomic uint64_t done;                   ///< Bytes decoded.
+    _Atomic uint64_t frames;
+    _Atomic uint64_t errors;
+    _Atomic uint64_t resyncs;
+    _Atomic uint64_t vehicles;
+    _Atomic uint64_t moves;
+    _Atomic uint64_t duplicates;
+    _Atomic uint64_t shed;
+    _Atomic uint16_t owner;                  ///< The worker that owns the lane.
+    _Atomic uint16_t target;                 ///< The worker that must own the lane. Set by MapsProtoShardMove.
+    uint16_t fill;                           ///< Bytes in the decoder buffer.
+    uint8_t numa;                            ///< 1 when allocated with numa_alloc_onnode.
+    tMAPS_PROTO_DEDUP dedup;                 ///< The fingerprints of the last frames.
+    tMAPS_PROTO_SHED held;                   ///< The low priority frames held while the lane is overloaded.
+    tMAPS_PROTO_VEHICLE vehicle;             ///< The vehicle being assembled.
+    tMAPS_PROTO_PARSED_FRAME parsed;         ///< The frame of the callback. Parsed with MapsProtoParseFrameTo in data.
+    _Alignas(16) uint8_t data[K_MAPS_PROTO_MAX_DATA_SIZE];
+    uint8_t buffer[K_MAPS_PROTO_SHARD_DECODER];
+    _Alignas(64) uint8_t ring[K_MAPS_PROTO_SHARD_RING];
+    tMAPS_PROTO_SHARD_STAMP stamps[K_MAPS_PROTO_SHARD_STAMPS];
+}tMAPS_PROTO_SHARD_LANE;
+
+/**
+ *
+ * @struct tMAPS_PROTO_SHARD_WORKER
+ * @brief  A worker thread and the list of its lanes. The list is only used
+ *         by the worker thread. The lanes moved from other workers are
+ *         appended to the arrivals, protected by the mutex, and the worker
+ *         takes the mutex only when arrived is not 0.
+ *
+ */
+typedef struct
+{
+    _Alignas(64) pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    _Atomic uint8_t idle;                    ///< 1 while the worker waits for bytes.
+    uint16_t id;
+    uint16_t count;                          ///< Lanes in the list.
+    uint16_t *list;                          ///< The lanes of the worker. Room for all the lanes.
+    _Atomic uint16_t arrived;                ///< Lanes in the arrivals. Read without the mutex.
+    uint16_t *arrivals;                      ///< The lanes moved to the worker. Room for all the lanes.
+    int cpu;                                 ///< The core or -1.
+    uint8_t started;
+    pthread_t thread;
+    tMAPS_PROTO_SHARD *shard;
+}tMAPS_PROTO_SHARD_WORKER;
+
+struct sMAPS_PROTO_SHARD
+{
+    uint16_t lanes;                          ///< Number of lanes.
+    uint16_t workers;                        ///< Number of workers.
+    tMAPS_PROTO_SHARD_LANE **lane;           ///< The state of each lane. Allocated one by one.
+    tMAPS_PROTO_SHARD_WORKER *worker;
+    tMAPS_PROTO_SHARD_FUNC callback;
+    void *user;
+    uint8_t realtime;                        ///< 1 when the workers spin instead of sleep.
+    _Atomic uint8_t stop;                    ///< 1 when the workers must end.
+    _Atomic uint32_t dedup_ms;               ///< The window of the repeated frames. 0 when disabled.
+    _Atomic uint32_t shed_bytes;             ///< The bytes pending in a ring that overload the lane. 0 when disabled.
+    uint64_t *previous;                      ///< Bytes decoded by lane in the previous balance.
+    uint64_t *load;                          ///< Bytes decoded by lane since the previous balance.
+    uint64_t *worker_load;                   ///< Bytes decoded by worker since the previous balance.
+};
+//-----------------------------------------------------------------------------
+
+static tMAPS_PROTO_SHARD_LANE * MapsProtoShardAllocLane (int cpu);
+static void      MapsProtoShardFreeLane    (tMAPS_PROTO_SHARD_LANE *lane);
+static void      MapsProtoShardWake        (tMAPS_PROTO_SHARD_WORKER *worker);
+static uint64_t  MapsProtoShardStamp       (tMAPS_PROTO_SHARD_LANE *lane, uint64_t offset);
+static void      MapsProtoShardDeliver     (tMAPS_PROTO_SHARD *shard, uint16_t id, const uint8_t *frame, uint16_t length, uint64_t timestamp);
+static uint32_t  MapsProtoShardDecode      (tMAPS_PROTO_SHARD *shard, uint16_t id);
+static void      MapsProtoShardHandOver    (tMAPS_PROTO_SHARD *shard, uint16_t id);
+static uint8_t   MapsProtoShardPending     (tMAPS_PROTO_SHARD *shard, tMAPS_PROTO_SHARD_WORKER *worker);
+static void *    MapsProtoShardThread      (void *param);
+static tMAPS_PROTO_SHARD * MapsProtoShardStart(uint16_t lanes, uint16_t workers, const int *cpus, uint8_t priority,
+                                               uint8_t realtime, tMAPS_PROTO_SHARD_FUNC callback, void *user);
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+tMAPS_PROTO_SHARD_LANE * MapsProtoShardAllocLane(int cpu)
+{
+    tMAPS_PROTO_SHARD_LANE *lane;
+
+#ifdef MAPS_PROTO_NUMA
+    if (cpu >= 0 && numa_available() >= 0 && numa_node_of_cpu(cpu) >= 0)
+    {
+        // Page aligned and zeroed
+        if ((lane = (tMAPS_PROTO_SHARD_LANE *)numa_alloc_onnode(sizeof(tMAPS_PROTO_SHARD_LANE),numa_node_of_cpu(cpu))) != NULL)
+        {
+            lane->numa = 1;
+            return lane;
+        }
+    }
+#else
+    (void) cpu;
+#endif
+
+    if ((lane = (tMAPS_PROTO_SHARD_LANE *)aligned_alloc(_Alignof(tMAPS_PROTO_SHARD_LANE),sizeof(tMAPS_PROTO_SHARD_LANE))) != NULL)
+        memset(lane,0,sizeof(tMAPS_PROTO_SHARD_LANE));
+
+    return lane;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoShardFreeLane(tMAPS_PROTO_SHARD_LANE *lane)
+{
+    if (lane == NULL)
+        return;
+
+#ifdef MAPS_PROTO_NUMA
+    if (lane->numa)
+    {
+        numa_free(lane,sizeof(tMAPS_PROTO_SHARD_LANE));
+        return;
+    }
+#endif
+
+    free(lane);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoShardWake(tMAPS_PROTO_SHARD_WORKER *worker)
+{
+    pthread_mutex_lock(&worker->mutex);
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+}
+//-----------------------------------------------------------------------------
+
+uint64_t MapsProtoShardStamp(tMAPS_PROTO_SHARD_LANE *lane, uint64_t offset)
+{
+    uint64_t shead = atomic_load_explicit(&lane->shead,memory_order_relaxed);
+    uint64_t stail = atomic_load_explicit(&lane->stail,memory_order_acquire);
+
+    // The time of the last push that starts at or before the byte
+    while (shead < stail && lane->stamps[shead & (K_MAPS_PROTO_SHARD_STAMPS - 1)].offset <= offset)
+    {
+        lane->stamp = lane->stamps[shead & (K_MAPS_PROTO_SHARD_STAMPS - 1)].timestamp;
+        shead++;
+    }
+
+    atomic_store_explicit(&lane->shead,shead,memory_order_release);
+    return lane->stamp;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoShardDeliver(tMAPS_PROTO_SHARD *shard, uint16_t id, const uint8_t *frame, uint16_t length, uint64_t timestamp)
+{
+    tMAPS_PROTO_SHARD_LANE *lane = shard->lane[id];
+    tMAPS_PROTO_FRAME_HEADER header;
+    struct timespec ts;
+    int size, completed;
+
+    // Without allocations. The data is stored in the lane
+    if ((size = MapsProtoParseFrameTo(frame,length,&header,lane->data,sizeof(lane->data))) < 0)
+    {
+        atomic_fetch_add_explicit(&lane->errors,1,memory_order_relaxed);
+        return;
+    }
+
+    lane->parsed.num  = header.num;
+    lane->parsed.type = header.type;
+    lane->parsed.size = size;
+    lane->parsed.data = (size) ? (char *) lane->data : NULL;
+    memcpy(lane->parsed.cmd,header.cmd,sizeof(lane->parsed.cmd));
+    lane->parsed.timestamp = timestamp;
+
+    clock_gettime(CLOCK_REALTIME,&ts);  // vDSO. Not a system call
+    completed = MapsProtoStoreAssemble(&lane->vehicle,&lane->parsed,id,(uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+
+    if (completed == 1)
+        atomic_fetch_add_explicit(&lane->vehicles,1,memory_order_relaxed);
+
+    shard->callback(id,&lane->parsed,(completed == 1) ? &lane->vehicle : NULL,shard->user);
+}
+//-----------------------------------------------------------------------------
+
+uint32_t MapsProtoShardDecode(tMAPS_PROTO_SHARD *shard, uint16_t id)
+{
+    tMAPS_PROTO_SHARD_LANE *lane = shard->lane[id];
+    uint64_t head = atomic_load_explicit(&lane->head,memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&lane->tail,memory_order_acquire);
+    uint32_t copied = 0, n, first;
+    size_t pos, junk = 0, keep;
+    uint16_t length, size;
+    uint64_t timestamp;
+    uint32_t window = atomic_load_explicit(&shard->dedup_ms,memory_order_relaxed);
+    uint32_t overload = atomic_load_explicit(&shard->shed_bytes,memory_order_relaxed);
+    const uint8_t *held;
+    uint8_t behind;
+    int rc;
+
+    while (head < tail)
+    {
+        // Copy the bytes of the ring to the decoder buffer. The ring can wrap
+        n     = K_MAPS_PROTO_SHARD_DECODER - lane->fill;
+        n     = (tail - head < n) ? (uint32_t) (tail - head) : n;
+        first = K_MAPS_PROTO_SHARD_RING - (head & (K_MAPS_PROTO_SHARD_RING - 1));
+        first = (first < n) ? first : n;
+
+        memcpy(&lane->buffer[lane->fill],&lane->ring[head & (K_MAPS_PROTO_SHARD_RING - 1)],first);
+        memcpy(&lane->buffer[lane->fill + first],lane->ring,n - first);
+
+        lane->fill += n;
+        head       += n;
+        copied     += n;
+        atomic_store_explicit(&lane->head,head,memory_order_release);
+
+        // A <CR> kept from the previous frame is a boundary, not part of a frame
+        pos = (lane->fill > n && lane->buffer[0] == K_MAPS_PROTO_SHARD_CR);
+        behind = (overload && tail - head >= overload);  // The consumer is behind. The low priority frames are held
+
+        while (MapsProtoReparseNext(lane->buffer,lane->fill,&pos,&length,&junk) == 1)
+        {
+            if (junk)
+                atomic_fetch_add_explicit(&lane->resyncs,1,memory_order_relaxed);
+
+            atomic_fetch_add_explicit(&lane->frames,1,memory_order_relaxed);
+
+            // The arrival of the first byte of the frame. The buffer has the bytes before head
+            timestamp = MapsProtoShardStamp(lane,head - lane->fill + pos);
+
+            // The repeats and the low priority frames of an overloaded lane are not parsed
+            if (window && MapsProtoDedupCheck(&lane->dedup,&lane->buffer[pos],length,timestamp,window) == 1)
+                atomic_fetch_add_explicit(&lane->duplicates,1,memory_order_relaxed);
+            else if (behind && (rc = MapsProtoShedHold(&lane->held,&lane->buffer[pos],length,timestamp)) > 0)
+            {
+                if (rc == 2)
+                    atomic_fetch_add_explicit(&lane->shed,1,memory_order_relaxed);
+            }
+            else
+                MapsProtoShardDeliver(shard,id,&lane->buffer[pos],length,timestamp);
+
+            pos += length;
+        }
+
+        if (junk)
+            atomic_fetch_add_explicit(&lane->resyncs,1,memory_order_relaxed);
+
+        // Keep the incomplete frame (smaller than a frame) and the <CR> before it. A <LF> after it is not junk
+        keep = (pos > 0 && lane->buffer[pos-1] == K_MAPS_PROTO_SHARD_CR);
+        memmove(lane->buffer,&lane->buffer[pos - keep],lane->fill - pos + keep);
+        lane->fill = lane->fill - pos + keep;
+        MapsProtoShardStamp(lane,head - lane->fill);  // The times of the bytes already discarded
+
+        // Caught up. The latest value of each low priority command
+        while (!behind && MapsProtoShedNext(&lane->held,&held,&size,&timestamp) == 1)
+            MapsProtoShardDeliver(shard,id,held,size,timestamp);
+
+        atomic_store_explicit(&lane->done,head,memory_order_release);
+    }
+
+    return copied;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoShardHandOver(tMAPS_PROTO_SHARD *shard, uint16_t id)
+{
+    tMAPS_PROTO_SHARD_LANE *lane = shard->lane[id];
+    tMAPS_PROTO_SHARD_WORKER *worker = &shard->worker[atomic_load_explicit(&lane->target,memory_order_acquire)];
+
+    // The mutex of the new worker publishes the state of the lane
+    pthread_mutex_lock(&worker->mutex);
+    worker->arrivals[atomic_load_explicit(&worker->arrived,memory_order_relaxed)] = id;
+    atomic_fetch_add_explicit(&worker->arrived,1,memory_order_release);
+    atomic_store_explicit(&lane->owner,worker->id,memory_order_release);
+    atomic_fetch_add_explicit(&lane->moves,1,memory_order_relaxed);
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoShardPending(tMAPS_PROTO_SHARD *shard, tMAPS_PROTO_SHARD_WORKER *worker)
+{
+    tMAPS_PROTO_SHARD_LANE *lane;
+
+    if (atomic_load_explicit(&worker->arrived,memory_order_relaxed))
+        return 1;
+
+    for (uint16_t i = 0; i < worker->count; i++)
+    {
+        lane = shard->lane[worker->list[i]];
+
+        if (atomic_load(&lane->tail) != atomic_load_explicit(&lane->head,memory_order_relaxed) ||
+            atomic_load_explicit(&lane->target,memory_order_relaxed) != worker->id)
+            return 1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+void * MapsProtoShardThread(void *param)
+{
+    tMAPS_PROTO_SHARD_WORKER *worker = (tMAPS_PROTO_SHARD_WORKER *) param;
+    tMAPS_PROTO_SHARD *shard = worker->shard;
+    struct timespec deadline;
+    uint64_t decoded;
+    uint16_t id, arrived;
+
+#ifdef MAPS_PROTO_STATS
+    MapsProtoStatsLocal();  // The counters of the thread are allocated before the first frame
+#endif
+
+    while (!atomic_load_explicit(&shard->stop,memory_order_relaxed))
+    {
+        decoded = 0;
+
+        // The mutex is only taken when other worker has moved a lane to this one
+        if (atomic_load_explicit(&worker->arrived,memory_order_acquire))
+        {
+            pthread_mutex_lock(&worker->mutex);
+            arrived = atomic_load_explicit(&worker->arrived,memory_order_relaxed);
+            memcpy(&worker->list[worker->count],worker->arrivals,arrived * sizeof(uint16_t));
+            worker->count += arrived;
+            atomic_store_explicit(&worker->arrived,0,memory_order_relaxed);
+            pthread_mutex_unlock(&worker->mutex);
+        }
+
+        for (int i = 0; i < worker->count; i++)
+        {
+            id = worker->list[i];
+
+            if (atomic_load_explicit(&shard->lane[id]->target,memory_order_acquire) != worker->id)
+            {
+                // Moved. Released between two frames
+                worker->list[i--] = worker->list[--worker->count];
+                MapsProtoShardHandOver(shard,id);
+                continue;
+            }
+
+            decoded += MapsProtoShardDecode(shard,id);
+        }
+
+        if (decoded)
+            continue;
+
+        // Real time. The producers never wake the worker, so the bytes are decoded without system calls
+        if (shard->realtime)
+        {
+            shard_relax();
+            continue;
+        }
+
+        // The producers wake the worker when idle is 1. The check is done with the mutex locked, so the signal is not lost
+        pthread_mutex_lock(&worker->mutex);
+        atomic_store(&worker->idle,1);
+
+        if (!MapsProtoShardPending(shard,worker) && !atomic_load(&shard->stop))
+        {
+            clock_gettime(CLOCK_MONOTONIC,&deadline);
+            deadline.tv_nsec += K_MAPS_PROTO_SHARD_IDLE_MS * 1000000L;
+            deadline.tv_sec  += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&worker->cond,&worker->mutex,&deadline);
+        }
+
+        atomic_store(&worker->idle,0);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_SHARD * MapsProtoShardStart(uint16_t lanes, uint16_t workers, const int *cpus, uint8_t priority,
+                                        uint8_t realtime, tMAPS_PROTO_SHARD_FUNC callback, void *user)
+{
+    int error = 0, allowed[CPU_SETSIZE], count = 0;
+    cpu_set_t set;
+    pthread_attr_t attr;
+    pthread_condattr_t cattr;
+    struct sched_param param = { .sched_priority = priority };
+    tMAPS_PROTO_SHARD *shard;
+    tMAPS_PROTO_SHARD_WORKER *worker;
+
+    if (!lanes || !workers || workers > K_MAPS_PROTO_SHARD_MAX_WORKERS || !callback ||
+        (priority && (priority < sched_get_priority_min(SCHED_FIFO) || priority > sched_get_priority_max(SCHED_FIFO))))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((shard = (tMAPS_PROTO_SHARD *)calloc(1,sizeof(tMAPS_PROTO_SHARD))) == NULL)
+        return NULL;
+
+    shard->lanes    = lanes;
+    shard->workers  = workers;
+    shard->callback = callback;
+    shard->user     = user;
+    shard->realtime = realtime;
+
+    shard->lane        = (tMAPS_PROTO_SHARD_LANE **)calloc(lanes,sizeof(tMAPS_PROTO_SHARD_LANE *));
+    shard->previous    = (uint64_t *)calloc(lanes,sizeof(uint64_t));
+    shard->load        = (uint64_t *)calloc(lanes,sizeof(uint64_t));
+    shard->worker_load = (uint64_t *)calloc(workers,sizeof(uint64_t));
+
+    if ((shard->worker = (tMAPS_PROTO_SHARD_WORKER *)aligned_alloc(_Alignof(tMAPS_PROTO_SHARD_WORKER),workers * sizeof(tMAPS_PROTO_SHARD_WORKER))) != NULL)
+        memset(shard->worker,0,workers * sizeof(tMAPS_PROTO_SHARD_WORKER));
+
+    if (!shard->lane || !shard->previous || !shard->load || !shard->worker_load || !shard->worker)
+    {
+        free(shard->lane);
+        free(shard->previous);
+        free(shard->load);
+        free(shard->worker_load);
+        free(shard->worker);
+        free(shard);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // The default cores are the cores where the process can run
+    if (!cpus && sched_getaffinity(0,sizeof(set),&set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; c++)
+             if (CPU_ISSET(c,&set))
+                 allowed[count++] = c;
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr,CLOCK_MONOTONIC);
+
+    for (uint16_t i = 0; i < workers; i++)
+    {
+        worker = &shard->worker[i];
+        worker->id    = i;
+        worker->shard = shard;
+        worker->cpu   = (cpus) ? cpus[i] : (count) ? allowed[i % count] : -1;
+
+        pthread_mutex_init(&worker->mutex,NULL);
+        pthread_cond_init(&worker->cond,&cattr);
+
+        worker->list     = (uint16_t *)malloc(lanes * sizeof(uint16_t));
+        worker->arrivals = (uint16_t *)malloc(lanes * sizeof(uint16_t));
+
+        if (!worker->list || !worker->arrivals)
+            error = ENOMEM;
+    }
+
+    pthread_condattr_destroy(&cattr);
+
+    for (uint16_t i = 0; i < lanes && !error; i++)
+    {
+        worker = &shard->worker[i % workers];
+
+        if ((shard->lane[i] = MapsProtoShardAllocLane(worker->cpu)) == NULL)
+            error = ENOMEM;
+        else
+        {
+            shard->lane[i]->owner  = worker->id;
+            shard->lane[i]->target = worker->id;
+            worker->list[worker->count++] = i;
+        }
+    }
+
+    for (uint16_t i = 0; i < workers && !error; i++)
+    {
+        worker = &shard->worker[i];
+        pthread_attr_init(&attr);
+
+        if (worker->cpu >= 0)
+        {
+            CPU_ZERO(&set);
+            CPU_SET(worker->cpu,&set);
+            pthread_attr_setaffinity_np(&attr,sizeof(set),&set);
+        }
+
+        if (priority)
+        {
+            pthread_attr_setinheritsched(&attr,PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr,SCHED_FIFO);
+            pthread_attr_setschedparam(&attr,&param);
+        }
+
+        if ((error = pthread_create(&worker->thread,&attr,MapsProtoShardThread,worker)) == 0)
+            worker->started = 1;
+
+        pthread_attr_destroy(&attr);
+    }
+
+    if (error)
+    {
+        MapsProtoShardFree(shard);
+        errno = error;
+        return NULL;
+    }
+
+    return shard;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_SHARD * MapsProtoShardCreate(uint16_t lanes, uint16_t workers, const int *cpus, tMAPS_PROTO_SHARD_FUNC callback, void *user)
+{
+    return MapsProtoShardStart(lanes,workers,cpus,0,0,callback,user);
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_SHARD * MapsProtoShardCreateRealtime(uint16_t lanes, uint16_t workers, const int *cpus, uint8_t priority,
+                                                 tMAPS_PROTO_SHARD_FUNC callback, void *user)
+{
+    return MapsProtoShardStart(lanes,workers,cpus,priority,1,callback,user);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardLockMemory(void)
+{
+    // The memory freed is kept by malloc and never returned with munmap or trimmed
+    mallopt(M_TRIM_THRESHOLD,-1);
+    mallopt(M_MMAP_MAX,0);
+
+    return mlockall(MCL_CURRENT | MCL_FUTURE);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoShardFree(tMAPS_PROTO_SHARD *shard)
+{
+    if (shard == NULL)
+        return;
+
+    atomic_store(&shard->stop,1);
+
+    for (uint16_t i = 0; i < shard->workers; i++)
+    {
+        if (!shard->worker[i].started)
+            continue;
+
+        MapsProtoShardWake(&shard->worker[i]);
+        pthread_join(shard->worker[i].thread,NULL);
+    }
+
+    for (uint16_t i = 0; i < shard->workers; i++)
+    {
+        pthread_mutex_destroy(&shard->worker[i].mutex);
+        pthread_cond_destroy(&shard->worker[i].cond);
+        free(shard->worker[i].list);
+        free(shard->worker[i].arrivals);
+    }
+
+    for (uint16_t i = 0; i < shard->lanes; i++)
+         MapsProtoShardFreeLane(shard->lane[i]);
+
+    free(shard->lane);
+    free(shard->previous);
+    free(shard->load);
+    free(shard->worker_load);
+    free(shard->worker);
+    free(shard);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardPush(tMAPS_PROTO_SHARD *shard, uint16_t lane, const uint8_t *data, uint32_t size)
+{
+    return MapsProtoShardPushAt(shard,lane,data,size,MapsProtoStampNow());
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardPushAt(tMAPS_PROTO_SHARD *shard, uint16_t lane, const uint8_t *data, uint32_t size, uint64_t timestamp)
+{
+    tMAPS_PROTO_SHARD_LANE *state;
+    tMAPS_PROTO_SHARD_WORKER *worker;
+    uint64_t tail, head, stail;
+    uint32_t n, first;
+
+    if (!shard || lane >= shard->lanes || (!data && size))
+        shard_error(EINVAL);
+
+    if (!size)
+        return 0;
+
+    state = shard->lane[lane];
+    tail  = atomic_load_explicit(&state->tail,memory_order_relaxed);
+    head  = atomic_load_explicit(&state->head,memory_order_acquire);
+
+    if ((n = K_MAPS_PROTO_SHARD_RING - (uint32_t) (tail - head)) == 0)
+        shard_error(EAGAIN);
+
+    n     = (size < n) ? size : n;
+    first = K_MAPS_PROTO_SHARD_RING - (tail & (K_MAPS_PROTO_SHARD_RING - 1));
+    first = (first < n) ? first : n;
+
+    memcpy(&state->ring[tail & (K_MAPS_PROTO_SHARD_RING - 1)],data,first);
+    memcpy(state->ring,&data[first],n - first);
+
+    // When the times are full the bytes keep the time of the previous push
+    stail = atomic_load_explicit(&state->stail,memory_order_relaxed);
+
+    if (stail - atomic_load_explicit(&state->shead,memory_order_acquire) < K_MAPS_PROTO_SHARD_STAMPS)
+    {
+        state->stamps[stail & (K_MAPS_PROTO_SHARD_STAMPS - 1)] = (tMAPS_PROTO_SHARD_STAMP) { tail, timestamp };
+        atomic_store_explicit(&state->stail,stail + 1,memory_order_release);
+    }
+
+    // Sequentially consistent with the idle flag of the worker, so a worker that goes to sleep sees the bytes or is woken
+    atomic_store(&state->tail,tail + n);
+    worker = &shard->worker[atomic_load_explicit(&state->owner,memory_order_acquire)];
+
+    if (atomic_load(&worker->idle))
+        MapsProtoShardWake(worker);
+
+    return n;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardDrain(tMAPS_PROTO_SHARD *shard, uint32_t timeout_ms)
+{
+    struct timespec ts, wait = { 0, 1000000 };
+    uint64_t start, now;
+    uint16_t i;
+
+    if (!shard)
+        shard_error(EINVAL);
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    start = (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    for (i = 0; i < shard->lanes; )
+    {
+        if (atomic_load_explicit(&shard->lane[i]->done,memory_order_acquire) == atomic_load_explicit(&shard->lane[i]->tail,memory_order_relaxed))
+        {
+            i++;
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        now = (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+        if (now - start >= timeout_ms)
+            shard_error(ETIMEDOUT);
+
+        nanosleep(&wait,NULL);
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardMove(tMAPS_PROTO_SHARD *shard, uint16_t lane, uint16_t worker)
+{
+    uint16_t owner;
+
+    if (!shard || lane >= shard->lanes || worker >= shard->workers)
+        shard_error(EINVAL);
+
+    atomic_store_explicit(&shard->lane[lane]->target,worker,memory_order_release);
+    owner = atomic_load_explicit(&shard->lane[lane]->owner,memory_order_acquire);
+
+    if (owner != worker)
+        MapsProtoShardWake(&shard->worker[owner]);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardBalance(tMAPS_PROTO_SHARD *shard)
+{
+    uint64_t bytes;
+    uint16_t i, target, busiest = 0, idlest = 0;
+    int lane = -1;
+
+    if (!shard)
+        shard_error(EINVAL);
+
+    memset(shard->worker_load,0,shard->workers * sizeof(uint64_t));
+
+    for (i = 0; i < shard->lanes; i++)
+    {
+        bytes = atomic_load_explicit(&shard->lane[i]->done,memory_order_relaxed);
+        shard->load[i]     = bytes - shard->previous[i];
+        shard->previous[i] = bytes;
+
+        target = atomic_load_explicit(&shard->lane[i]->target,memory_order_relaxed);
+        shard->worker_load[target] += shard->load[i];
+    }
+
+    for (i = 1; i < shard->workers; i++)
+    {
+        if (shard->worker_load[i] > shard->worker_load[busiest])
+            busiest = i;
+        if (shard->worker_load[i] < shard->worker_load[idlest])
+            idlest = i;
+    }
+
+    // The move reduces the difference when the load of the lane is smaller than the difference
+    for (i = 0; i < shard->lanes; i++)
+         if (atomic_load_explicit(&shard->lane[i]->target,memory_order_relaxed) == busiest && shard->load[i] &&
+             shard->load[i] < shard->worker_load[busiest] - shard->worker_load[idlest] &&
+             (lane < 0 || shard->load[i] > shard->load[lane]))
+             lane = i;
+
+    if (lane < 0)
+        shard_error(EAGAIN);
+
+    MapsProtoShardMove(shard,lane,idlest);
+    return lane;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardDedup(tMAPS_PROTO_SHARD *shard, uint32_t window_ms)
+{
+    if (!shard)
+        shard_error(EINVAL);
+
+    atomic_store_explicit(&shard->dedup_ms,window_ms,memory_order_relaxed);
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardShed(tMAPS_PROTO_SHARD *shard, uint32_t backlog)
+{
+    if (!shard || backlog > K_MAPS_PROTO_SHARD_RING)
+        shard_error(EINVAL);
+
+    atomic_store_explicit(&shard->shed_bytes,backlog,memory_order_relaxed);
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShardGetLane(tMAPS_PROTO_SHARD *shard, uint16_t lane, tMAPS_PROTO_SHARD_LANE_STATS *stats)
+{
+    tMAPS_PROTO_SHARD_LANE *state;
+
+    if (!shard || lane >= shard->lanes || !stats)
+        shard_error(EINVAL);
+
+    state = shard->lane[lane];
+    stats->bytes      = atomic_load_explicit(&state->done,memory_order_relaxed);
+    stats->frames     = atomic_load_explicit(&state->frames,memory_order_relaxed);
+    stats->errors     = atomic_load_explicit(&state->errors,memory_order_relaxed);
+    stats->resyncs    = atomic_load_explicit(&state->resyncs,memory_order_relaxed);
+    stats->vehicles   = atomic_load_explicit(&state->vehicles,memory_order_relaxed);
+    stats->moves      = atomic_load_explicit(&state->moves,memory_order_relaxed);
+    stats->duplicates = atomic_load_explicit(&state->duplicates,memory_order_relaxed);
+    stats->shed       = atomic_load_explicit(&state->shed,memory_order_relaxed);
+    stats->worker     = atomic_load_explicit(&state->owner,memory_order_relaxed);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,260 @@
+#ifndef MAPS_SHARD_H
+#define MAPS_SHARD_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_shard.h
+ *  @brief Function prototypes for decode many lanes with worker threads
+ *         pinned to the cores.
+ *
+ *  Each lane (barrier) has its own state: a ring with the bytes received,
+ *  the decoder buffer, the vehicle assembled (maps_store.h) and the
+ *  counters. The state of each lane starts in a cache line and the indexes
+ *  written by the producer and by the worker are in different cache lines,
+ *  so two lanes never share a cache line.
+ *
+ *  The lanes are distributed between the workers and each worker is pinned
+ *  to a core. Only the worker that owns a lane reads its ring, decodes its
+ *  frames and calls the callback, so the lane state stays in the cache of
+ *  that core. A lane can be moved to other worker at any time with
+ *  MapsProtoShardMove or MapsProtoShardBalance: the old worker releases it
+ *  between two frames and the new worker continues with the same state.
+ *
+ *  Only one thread can push the bytes of a lane (usually the I/O thread of
+ *  the serial line). Different lanes can be pushed from different threads.
+ *
+ *  The frames are parsed with MapsProtoParseFrameTo in a buffer of the
+ *  lane, so nothing is allocated after MapsProtoShardCreate. For a low and
+ *  deterministic latency (i.e. lanes that trigger cameras) use
+ *  MapsProtoShardCreateRealtime: the workers run with SCHED_FIFO and spin
+ *  instead of sleep, so the path from MapsProtoShardPush to the callback
+ *  has no system calls, locks or libc formatting. The workers read their
+ *  lists without locks: the mutex of a worker is only taken while a lane
+ *  is moved to it. Pin the real time workers to cores isolated from the
+ *  producers and call MapsProtoShardLockMemory after create all the
+ *  objects of the process.
+ *
+ *  With MAPS_PROTO_NUMA defined (DEFINES += MAPS_PROTO_NUMA and LIBS +=
+ *  -lnuma) the state of each lane is allocated in the NUMA node of the core
+ *  of its first worker. Without it the memory is allocated with
+ *  aligned_alloc. The memory of a lane is not moved with the lane.
+ */
+
+#include "maps_store.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SHARD_RING        0x4000    ///< Bytes of the ring of each lane (16 KiB). Power of 2.
+#define K_MAPS_PROTO_SHARD_MAX_WORKERS 1024      ///< The biggest number of workers.
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_SHARD_LANE_STATS
+ * @brief  The counters of a lane.
+ *
+ */
+typedef struct
+{
+    uint64_t bytes;       ///< Bytes decoded.
+    uint64_t frames;      ///< Frames found (parsed, with error or repeated).
+    uint64_t errors;      ///< Frames that MapsProtoParseFrame can't parse.
+    uint64_t resyncs;     ///< Times that junk was skipped to find the next frame.
+    uint64_t vehicles;    ///< Vehicles completed.
+    uint64_t moves;       ///< Times that the lane was moved to other worker.
+    uint64_t duplicates;  ///< Frames dropped as repeats. See MapsProtoShardDedup.
+    uint64_t shed;        ///< Low priority frames dropped while the lane was overloaded. See MapsProtoShardShed.
+    uint16_t worker;      ///< The worker that owns the lane.
+}tMAPS_PROTO_SHARD_LANE_STATS;
+
+typedef struct sMAPS_PROTO_SHARD tMAPS_PROTO_SHARD;
+
+/**
+ * The callback for each frame parsed. Is called from the worker that owns the lane.
+ * vehicle is not NULL when the frame completes a vehicle (the times are CLOCK_REALTIME milliseconds).
+ * Both are only valid during the callback.
+ */
+typedef void (*tMAPS_PROTO_SHARD_FUNC)(uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_VEHICLE *vehicle, void *user);
+
+/** @brief Creates the lanes and starts the workers. The lanes are distributed in round robin.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: lanes or workers are 0, workers is bigger than K_MAPS_PROTO_SHARD_MAX_WORKERS or callback is NULL.
+ *      ENOMEM: Couldn't allocate memory.
+ *
+ *  Or any errno value of pthread_create.
+ *
+ * @param  lanes    The number of lanes (barriers).
+ * @param  workers  The number of worker threads.
+ * @param  cpus     The core of each worker or NULL to pin the worker i to the core i (modulo the cores). -1 doesn't pin the worker.
+ * @param  callback The function called for each frame parsed.
+ * @param  user     The user param of the callback.
+ * @return NULL on error and errno is set or on success a new allocated tMAPS_PROTO_SHARD.
+ */
+tMAPS_PROTO_SHARD * MapsProtoShardCreate(uint16_t lanes, uint16_t workers, const int *cpus, tMAPS_PROTO_SHARD_FUNC callback, void *user);
+
+/** @brief Stop the workers and free the lanes. The bytes not decoded are lost.
+ *
+ * @param  shard The shard to free.
+ */
+void MapsProtoShardFree(tMAPS_PROTO_SHARD *shard);
+
+/** @brief The same as MapsProtoShardCreate but the workers never sleep and run with SCHED_FIFO.
+ *
+ *  Each worker uses all the time of its core, even without bytes. A worker
+ *  in the same core that its producer stops the producer, so the cpus must
+ *  be different of the cores of the producers.
+ *
+ *  The errno values are the same as MapsProtoShardCreate and:
+ *
+ *      EINVAL: The priority is out of the range of SCHED_FIFO.
+ *      EPERM: The process can't use SCHED_FIFO (needs CAP_SYS_NICE or RLIMIT_RTPRIO).
+ *
+ * @param  lanes    The number of lanes (barriers).
+ * @param  workers  The number of worker threads.
+ * @param  cpus     The core of each worker or NULL to pin the worker i to the core i (modulo the cores). -1 doesn't pin the worker.
+ * @param  priority The SCHED_FIFO priority of the workers (1 to 99) or 0 for not change the policy.
+ * @param  callback The function called for each frame parsed.
+ * @param  user     The user param of the callback.
+ * @return NULL on error and errno is set or on success a new allocated tMAPS_PROTO_SHARD.
+ */
+tMAPS_PROTO_SHARD * MapsProtoShardCreateRealtime(uint16_t lanes, uint16_t workers, const int *cpus, uint8_t priority,
+                                                 tMAPS_PROTO_SHARD_FUNC callback, void *user);
+
+/** @brief Lock all the memory of the process (mlockall) and keep the memory freed by malloc.
+ *
+ *  After it the pages are never swapped and the hot path has no page
+ *  faults. Affects all the process. Call it once, after create the shard.
+ *
+ *  The errno values are any errno value of mlockall. i.e. ENOMEM when
+ *  RLIMIT_MEMLOCK is too small or EPERM.
+ *
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoShardLockMemory(void);
+
+/** @brief Add the bytes received from a lane. Never blocks.
+ *
+ *  The bytes are copied to the ring of the lane. When the ring is full only
+ *  the bytes that fit are copied.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid shard, lane or data param.
+ *      EAGAIN: The ring is full.
+ *
+ * @param  shard The shard.
+ * @param  lane  The lane.
+ * @param  data  The bytes received.
+ * @param  size  The number of bytes.
+ * @return The bytes copied or -1 on error and errno is set.
+ */
+int MapsProtoShardPush(tMAPS_PROTO_SHARD *shard, uint16_t lane, const uint8_t *data, uint32_t size);
+
+/** @brief The same as MapsProtoShardPush with the arrival time of the bytes.
+ *
+ *  The timestamp of each frame parsed is the arrival time of the push with
+ *  its first byte. MapsProtoShardPush uses the time of the call. Use it
+ *  with the time of MapsProtoStampRecv or a time taken just after the read.
+ *
+ *  The errno values are the same as MapsProtoShardPush.
+ *
+ * @param  shard     The shard.
+ * @param  lane      The lane.
+ * @param  data      The bytes received.
+ * @param  size      The number of bytes.
+ * @param  timestamp The arrival time in nanoseconds (CLOCK_MONOTONIC). See maps_stamp.h.
+ * @return The bytes copied or -1 on error and errno is set.
+ */
+int MapsProtoShardPushAt(tMAPS_PROTO_SHARD *shard, uint16_t lane, const uint8_t *data, uint32_t size, uint64_t timestamp);
+
+/** @brief Wait until the workers have decoded all the bytes pushed.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The shard is NULL.
+ *      ETIMEDOUT: The bytes were not decoded in timeout_ms.
+ *
+ * @param  shard      The shard.
+ * @param  timeout_ms The milliseconds to wait.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoShardDrain(tMAPS_PROTO_SHARD *shard, uint32_t timeout_ms);
+
+/** @brief Move a lane to other worker. Returns without wait the move.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid shard, lane or worker param.
+ *
+ * @param  shard  The shard.
+ * @param  lane   The lane.
+ * @param  worker The new worker of the lane.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoShardMove(tMAPS_PROTO_SHARD *shard, uint16_t lane, uint16_t worker);
+
+/** @brief Move the busiest lane of the busiest worker to the least busy worker.
+ *
+ *  The load is the bytes decoded since the previous call. The lane is
+ *  moved only when the move reduces the difference between both workers.
+ *  Call it periodically (i.e. each second) from one thread.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The shard is NULL.
+ *      EAGAIN: There is no lane to move. The workers are balanced.
+ *
+ * @param  shard The shard.
+ * @return The lane moved or -1 on error and errno is set.
+ */
+int MapsProtoShardBalance(tMAPS_PROTO_SHARD *shard);
+
+/** @brief Drop the frames repeated by the lanes (maps_dedup.h). i.e. The frames replayed by a gateway after a reconnect.
+ *
+ *  The repeats are dropped before parse and counted in the duplicates of
+ *  the lane. Disabled by default. Can be called from any thread.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The shard is NULL.
+ *
+ * @param  shard     The shard.
+ * @param  window_ms The milliseconds that a frame is a repeat of other with the same number, command and data. Less than ten poll periods. 0 disables it.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoShardDedup(tMAPS_PROTO_SHARD *shard, uint32_t window_ms);
+
+/** @brief Shed the low priority frames of the lanes whose callback falls behind (maps_shed.h).
+ *
+ *  A lane is overloaded while the bytes pushed and not decoded are backlog
+ *  or more. Its SC SPECIAL frames and polling responses are held, one by
+ *  command, and only the latest is delivered when the lane catches up. The
+ *  frames replaced are counted in the shed of the lane. The vehicle and
+ *  failure frames are always delivered. Disabled by default. Can be called
+ *  from any thread.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The shard is NULL or backlog is bigger than K_MAPS_PROTO_SHARD_RING.
+ *
+ * @param  shard   The shard.
+ * @param  backlog The bytes pending in the ring of a lane that overload it. i.e. K_MAPS_PROTO_SHARD_RING / 4. 0 disables it.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoShardShed(tMAPS_PROTO_SHARD *shard, uint32_t backlog);
+
+/** @brief Get the counters of a lane. Can be called from any thread.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Invalid shard, lane or stats param.
+ *
+ * @param  shard The shard.
+ * @param  lane  The lane.
+ * @param  stats Where the counters are stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoShardGetLane(tMAPS_PROTO_SHARD *shard, uint16_t lane, tMAPS_PROTO_SHARD_LANE_STATS *stats);
+
+//-----------------------------------------------------------------------------
+#endif
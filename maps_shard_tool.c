@@ -0,0 +1,303 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pthread_setaffinity_np & CPU_* macros
+#endif
+
+#include <stdio.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "maps_corpus.h"
+#include "maps_shard.h"
+//-----------------------------------------------------------------------------
+
+/** @file maps_shard_tool.c
+ *  @brief Measure the lane sharding of maps_shard.c with 1 to N cores.
+ *
+ *  Usage: maps_shard [-l lanes] [-w workers] [-n frames] [-s seed] [-i increments]
+ *
+ *      -l: Lanes. By default 256.
+ *      -w: The biggest number of workers. By default the cores of the process.
+ *      -n: Frames of the corpus pushed in each lane. By default 2000.
+ *      -s: The seed of the corpus. By default 1.
+ *      -i: Increments of each thread in the false sharing test. By default 10000000.
+ *
+ *  The first test increments the counters of a lane from 1, 2, 4... threads
+ *  pinned to different cores. The packed counters are in consecutive
+ *  words (the lanes share cache lines) and the padded counters are in
+ *  their own cache line, as the state of the lanes of maps_shard.c. The
+ *  ratio is the cost of the false sharing.
+ *
+ *  The second test pushes the corpus in all the lanes from one producer
+ *  by worker and measures the frames decoded by second with 1, 2, 4...
+ *  workers. The speedup is against one worker. Each worker needs two
+ *  cores (the producer and the worker) for scale.
+ */
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t value;
+}tPADDED_COUNTER;
+
+typedef struct
+{
+    _Atomic uint64_t *counter;
+    uint64_t increments;
+    int cpu;
+}tCOUNTER_THREAD;
+
+typedef struct
+{
+    tMAPS_PROTO_SHARD *shard;
+    const uint8_t *data;
+    size_t size;
+    uint16_t first;       ///< The first lane of the producer.
+    uint16_t step;        ///< The producer pushes first, first + step...
+    uint16_t lanes;
+}tPRODUCER_THREAD;
+//-----------------------------------------------------------------------------
+
+static int cpus[CPU_SETSIZE];
+static int ncpus;
+static _Atomic uint64_t decoded;
+//-----------------------------------------------------------------------------
+
+uint64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+//-----------------------------------------------------------------------------
+
+void * counter_thread(void *param)
+{
+    tCOUNTER_THREAD *thread = (tCOUNTER_THREAD *) param;
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(thread->cpu,&set);
+    pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+
+    for (uint64_t i = 0; i < thread->increments; i++)
+         atomic_fetch_add_explicit(thread->counter,1,memory_order_relaxed);
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+double run_counters(_Atomic uint64_t **counters, uint16_t threads, uint64_t increments)
+{
+    uint64_t start = now_ns();
+    pthread_t ids[K_MAPS_PROTO_SHARD_MAX_WORKERS];
+    tCOUNTER_THREAD params[K_MAPS_PROTO_SHARD_MAX_WORKERS];
+
+    for (uint16_t i = 0; i < threads; i++)
+    {
+        params[i].counter    = counters[i];
+        params[i].increments = increments;
+        params[i].cpu        = cpus[i % ncpus];
+        pthread_create(&ids[i],NULL,counter_thread,&params[i]);
+    }
+
+    for (uint16_t i = 0; i < threads; i++)
+         pthread_join(ids[i],NULL);
+
+    return (double)(now_ns() - start) / increments;
+}
+//-----------------------------------------------------------------------------
+
+void false_sharing(uint16_t workers, uint64_t increments)
+{
+    _Atomic uint64_t packed[K_MAPS_PROTO_SHARD_MAX_WORKERS];
+    _Atomic uint64_t *counters[K_MAPS_PROTO_SHARD_MAX_WORKERS];
+    tPADDED_COUNTER *padded = (tPADDED_COUNTER *)aligned_alloc(_Alignof(tPADDED_COUNTER),workers * sizeof(tPADDED_COUNTER));
+    double tpacked, tpadded;
+
+    if (padded == NULL)
+        return;
+
+    printf("False sharing (ns by increment of each thread)\n\n    threads     packed     padded    ratio\n");
+
+    for (uint16_t threads = 1; threads <= workers; threads = (threads * 2 > workers && threads < workers) ? workers : threads * 2)
+    {
+        for (uint16_t i = 0; i < threads; i++)
+            counters[i] = &packed[i];
+
+        tpacked = run_counters(counters,threads,increments);
+
+        for (uint16_t i = 0; i < threads; i++)
+            counters[i] = &padded[i].value;
+
+        tpadded = run_counters(counters,threads,increments);
+
+        printf("    %7u %10.2f %10.2f %8.2fx\n",threads,tpacked,tpadded,tpacked / tpadded);
+    }
+
+    free(padded);
+}
+//-----------------------------------------------------------------------------
+
+void count_decoded(uint16_t lane, const tMAPS_PROTO_PARSED_FRAME *parsed, const tMAPS_PROTO_VEHICLE *vehicle, void *user)
+{
+    (void) lane;
+    (void) parsed;
+    (void) vehicle;
+    (void) user;
+
+    atomic_fetch_add_explicit(&decoded,1,memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+void * producer_thread(void *param)
+{
+    tPRODUCER_THREAD *producer = (tPRODUCER_THREAD *) param;
+    size_t *pos = (size_t *)calloc(producer->lanes,sizeof(size_t));
+    uint8_t pending = 1;
+    int n;
+
+    if (pos == NULL)
+        return NULL;
+
+    // Round robin between the lanes, as the bytes arrive from the serial lines
+    while (pending)
+    {
+        pending = 0;
+
+        for (uint16_t l = producer->first; l < producer->lanes; l += producer->step)
+        {
+            if (pos[l] == producer->size)
+                continue;
+
+            if ((n = MapsProtoShardPush(producer->shard,l,&producer->data[pos[l]],(producer->size - pos[l] < 512) ? producer->size - pos[l] : 512)) > 0)
+                pos[l] += n;
+
+            pending |= (pos[l] < producer->size);
+        }
+    }
+
+    free(pos);
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+int scaling(uint16_t lanes, uint16_t workers, const uint8_t *data, size_t size)
+{
+    double base = 0, rate;
+    uint64_t start, elapsed;
+    pthread_t ids[K_MAPS_PROTO_SHARD_MAX_WORKERS];
+    tPRODUCER_THREAD producers[K_MAPS_PROTO_SHARD_MAX_WORKERS];
+    tMAPS_PROTO_SHARD *shard;
+
+    printf("\nScaling (%u lanes, %zu bytes by lane)\n\n    workers   frames/s       MB/s  speedup\n",lanes,size);
+
+    for (uint16_t w = 1; w <= workers; w = (w * 2 > workers && w < workers) ? workers : w * 2)
+    {
+        atomic_store(&decoded,0);
+
+        if ((shard = MapsProtoShardCreate(lanes,w,NULL,count_decoded,NULL)) == NULL)
+        {
+            fprintf(stderr,"Error creating the shard: %s\n",strerror(errno));
+            return -1;
+        }
+
+        start = now_ns();
+
+        for (uint16_t i = 0; i < w; i++)
+        {
+            producers[i] = (tPRODUCER_THREAD) { shard, data, size, i, w, lanes };
+            pthread_create(&ids[i],NULL,producer_thread,&producers[i]);
+        }
+
+        for (uint16_t i = 0; i < w; i++)
+            pthread_join(ids[i],NULL);
+
+        MapsProtoShardDrain(shard,60000);
+        elapsed = now_ns() - start;
+        MapsProtoShardFree(shard);
+
+        rate = atomic_load(&decoded) * 1e9 / elapsed;
+        base = (w == 1) ? rate : base;
+
+        printf("    %7u %10.0f %10.2f %7.2fx\n",w,rate,(double) size * lanes * 1e3 / elapsed,rate / base);
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int opt, lanes = 256, workers = 0;
+    uint64_t frames = 2000, increments = 10000000;
+    uint8_t *data;
+    size_t size;
+    cpu_set_t set;
+    tMAPS_PROTO_CORPUS_CONFIG config;
+
+    MapsProtoCorpusDefaults(&config,1);
+
+    while ((opt = getopt(argc,argv,"l:w:n:s:i:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+                    lanes = atoi(optarg);
+            break;
+            case 'w':
+                    workers = atoi(optarg);
+            break;
+            case 'n':
+                    frames = strtoull(optarg,NULL,0);
+            break;
+            case 's':
+                    config.seed = strtoull(optarg,NULL,0);
+            break;
+            case 'i':
+                    increments = strtoull(optarg,NULL,0);
+            break;
+            default:
+                    fprintf(stderr,"Usage: %s [-l lanes] [-w workers] [-n frames] [-s seed] [-i increments]\n",argv[0]);
+            return 1;
+        }
+    }
+
+    if (sched_getaffinity(0,sizeof(set),&set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; c++)
+             if (CPU_ISSET(c,&set))
+                 cpus[ncpus++] = c;
+
+    if (!ncpus)
+        cpus[ncpus++] = 0;
+    if (!workers)
+        workers = ncpus;
+
+    if (lanes < 1 || lanes > 65535 || workers < 1 || workers > K_MAPS_PROTO_SHARD_MAX_WORKERS || !frames || !increments)
+    {
+        fprintf(stderr,"The lanes must be between 1 and 65535, the workers between 1 and %d and the frames and increments greater than 0\n",
+                K_MAPS_PROTO_SHARD_MAX_WORKERS);
+        return 1;
+    }
+
+    if ((data = MapsProtoCorpusBuffer(&config,frames,&size,NULL)) == NULL)
+    {
+        fprintf(stderr,"Error generating the corpus: %s\n",strerror(errno));
+        return 1;
+    }
+
+    printf("%d cores available\n\n",ncpus);
+
+    false_sharing(workers,increments);
+    opt = scaling(lanes,workers,data,size);
+
+    free(data);
+    return (opt) ? 1 : 0;
+}
+//-----------------------------------------------------------------------------
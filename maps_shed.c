@@ -0,0 +1,80 @@
+
+#include <errno.h>
+#include <string.h>
+
+#include "maps_shed.h"
+//-----------------------------------------------------------------------------
+
+#define shed_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+uint8_t MapsProtoShedClass(const tMAPS_PROTO_FRAME_HEADER *header)
+{
+    tMAPS_PROTO_CMD_SPEC spec;
+
+    if (!header)
+        return K_MAPS_PROTO_SHED_KEEP;
+
+    if (header->type == 0 && header->cmd_id == K_MAPS_PROTO_CMD_SCS)
+        return K_MAPS_PROTO_SHED_SCANNER;
+
+    // The polls are the commands with empty request, as in MapsProtoSchedAddPoll. The RS of a configuration is never held
+    if (header->type == 1 && header->cmd_id < K_MAPS_PROTO_CMD_PAS && !MapsProtoGetCmdSpec(header->cmd,&spec) && (spec.suppdata & 2))
+        return K_MAPS_PROTO_SHED_POLLING;
+
+    return K_MAPS_PROTO_SHED_KEEP;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShedHold(tMAPS_PROTO_SHED *shed, const uint8_t *frame, uint16_t size, uint64_t timestamp)
+{
+    uint64_t bit;
+    tMAPS_PROTO_FRAME_HEADER header;
+    int rc = 1;
+
+    if (!shed || !frame)
+        shed_error(EINVAL);
+
+    if (size > K_MAPS_PROTO_SHED_FRAME || MapsProtoValidateFrame(frame,size,&header) ||
+        MapsProtoShedClass(&header) == K_MAPS_PROTO_SHED_KEEP)
+        return 0;
+
+    bit = 1ULL << header.cmd_id;
+
+    if (shed->held & bit)
+    {
+        shed->dropped[header.cmd_id]++;
+        shed->drops++;
+        rc = 2;
+    }
+
+    memcpy(shed->frame[header.cmd_id],frame,size);
+    shed->size[header.cmd_id]      = size;
+    shed->timestamp[header.cmd_id] = timestamp;
+    shed->held |= bit;
+
+    return rc;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoShedNext(tMAPS_PROTO_SHED *shed, const uint8_t **frame, uint16_t *size, uint64_t *timestamp)
+{
+    int id;
+
+    if (!shed || !frame || !size || !timestamp)
+        shed_error(EINVAL);
+
+    if (!shed->held)
+        return 0;
+
+    id = __builtin_ctzll(shed->held);
+    shed->held &= shed->held - 1;
+
+    *frame     = shed->frame[id];
+    *size      = shed->size[id];
+    *timestamp = shed->timestamp[id];
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
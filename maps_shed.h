@@ -0,0 +1,95 @@
+#ifndef MAPS_SHED_H
+#define MAPS_SHED_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_shed.h
+ *  @brief Function prototypes for shed the low priority frames of a lane
+ *         when its consumer falls behind.
+ *
+ *  While a lane is overloaded the low priority frames are held instead of
+ *  delivered, one by command. A newer frame of the same command replaces
+ *  the held frame, that is dropped and counted. When the lane catches up
+ *  the held frames (the latest value of each command) are delivered with
+ *  MapsProtoShedNext. The queue of a lane never grows more than one frame
+ *  by command and only the frames replaced are lost.
+ *
+ *  The low priority frames are the SC SPECIAL frames of the scanner mode
+ *  and the responses to the polling requests (the commands with empty
+ *  request that MapsProtoSchedAddPoll accepts: DE, EA, MV, TT, CB...). The
+ *  responses to the configuration commands (BR, CA, ER, PR, SC, SM, SR and
+ *  RH), the vehicle frames (IP, IR, IA, AP, EJ, RM, FA SPONTANEOUS, FR and
+ *  FP), the failures (EM, FX and PX) and the rest of frames are never held
+ *  or dropped. A held
+ *  frame is delivered after the frames that arrive before the lane catches
+ *  up, so it can be out of order with them.
+ *
+ *  Use a tMAPS_PROTO_SHED for each lane initialized with zeros. maps_shard.c
+ *  uses it with MapsProtoShardShed.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SHED_FRAME     40    ///< The biggest frame held. The TT response (35 bytes).
+
+#define K_MAPS_PROTO_SHED_KEEP      0     ///< Never held. Vehicle, failure and other frames.
+#define K_MAPS_PROTO_SHED_SCANNER   1     ///< SC SPECIAL frames.
+#define K_MAPS_PROTO_SHED_POLLING   2     ///< Responses to the polling requests.
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_SHED
+ * @brief  The frames held and the drop counters of a lane.
+ *
+ */
+typedef struct
+{
+    uint64_t dropped[K_MAPS_PROTO_CMD_COUNT];   ///< Frames replaced by a newer frame, by K_MAPS_PROTO_CMD_* of the frame.
+    uint64_t drops;                             ///< Total of dropped.
+    uint64_t held;                              ///< A bit by K_MAPS_PROTO_CMD_* with a frame held.
+    uint64_t timestamp[K_MAPS_PROTO_CMD_COUNT]; ///< The timestamp of each frame held.
+    uint8_t size[K_MAPS_PROTO_CMD_COUNT];       ///< The size of each frame held.
+    uint8_t frame[K_MAPS_PROTO_CMD_COUNT][K_MAPS_PROTO_SHED_FRAME];
+}tMAPS_PROTO_SHED;
+
+/** @brief The priority class of a frame.
+ *
+ * @param  header The header of the frame (MapsProtoValidateFrame).
+ * @return K_MAPS_PROTO_SHED_KEEP, K_MAPS_PROTO_SHED_SCANNER or K_MAPS_PROTO_SHED_POLLING. KEEP when header is NULL.
+ */
+uint8_t MapsProtoShedClass(const tMAPS_PROTO_FRAME_HEADER *header);
+
+/** @brief Hold a frame of an overloaded lane if it has low priority.
+ *
+ *  The frames that are not valid (MapsProtoValidateFrame) are never held,
+ *  so its error is reported when they are parsed.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The shed or frame params are NULL.
+ *
+ * @param  shed      The frames held of the lane.
+ * @param  frame     The raw frame.
+ * @param  size      The size of the frame.
+ * @param  timestamp The timestamp of the frame. Returned by MapsProtoShedNext.
+ * @return 0 when the frame must be delivered now, 1 when is held, 2 when is held and the previous frame of its command is dropped or -1 on error and errno is set.
+ */
+int MapsProtoShedHold(tMAPS_PROTO_SHED *shed, const uint8_t *frame, uint16_t size, uint64_t timestamp);
+
+/** @brief Get and release the next frame held. Call it until returns 0 when the lane is not overloaded.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: Any param is NULL.
+ *
+ * @param  shed      The frames held of the lane.
+ * @param  frame     Where the pointer to the frame is stored. Valid until the next MapsProtoShedHold.
+ * @param  size      Where the size of the frame is stored.
+ * @param  timestamp Where the timestamp of the frame is stored.
+ * @return 1 when a frame is returned, 0 when there are no frames held or -1 on error and errno is set.
+ */
+int MapsProtoShedNext(tMAPS_PROTO_SHED *shed, const uint8_t **frame, uint16_t *size, uint64_t *timestamp);
+
+//-----------------------------------------------------------------------------
+#endif
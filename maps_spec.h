@@ -0,0 +1,155 @@
+#ifndef MAPS_SPEC_H
+#define MAPS_SPEC_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_spec.h
+ *  @brief The wire layout of the MAPS messages with fixed fields.
+ *
+ *  Each message is a list of variants and each variant a list of fields.
+ *  maps_proto.c expands the tables into the MapsProtoPrepare*Data parsers
+ *  and the encoders of the MapsProtoCreate* functions, so the layout of a
+ *  command is written only once. A new firmware variant is a new VARIANT
+ *  line in its message.
+ *
+ *  MESSAGE(name, data structure, variants, command, command)
+ *
+ *      The parser is MapsProtoPrepare<name>Data and the encoder
+ *      MapsProtoEncode<name>Data. The commands are the K_MAPS_PROTO_CMD_*
+ *      that use the message (the same twice when is only one).
+ *
+ *  VARIANT(frame size, data position, encoder condition, fields)
+ *
+ *      The parser selects the variant by the size of the frame and the
+ *      encoder with the first condition that is true (data is the param of
+ *      the Create function). The data position is 4 in requests and 6 in
+ *      responses.
+ *
+ *  FIELD(kind, member, offset, a, b)
+ *
+ *      The offset is from the start of the data. The kinds are:
+ *
+ *      DEC1: One decimal digit between a and b. The encoder fails with EINVAL out of range.
+ *      DEC2: Two decimal digits between a and b. The encoder rounds the values greater than b.
+ *      DEC2R: The same as DEC2 but the encoder fails with EINVAL out of range.
+ *      HEX1: One hex digit (uppercase on encode) between a and b. EINVAL out of range.
+ *      CHR:  One of the chars of the string a. The encoder uses b when the member is 0.
+ *      SET:  Not in the frame. The parser sets the member to a.
+ *      FILL: Not in the structure. The encoder writes the char a.
+ *      CHK:  Not in the frame. The encoder checks the member as CHR (a and b) and fails with EINVAL.
+ */
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SPEC_MESSAGES(MESSAGE)                                                                   \
+    MESSAGE(EJ,     tMAPS_PROTO_EJ_DATA,      K_MAPS_PROTO_SPEC_EJ,     K_MAPS_PROTO_CMD_EJ,  K_MAPS_PROTO_CMD_EJ) \
+    MESSAGE(EA,     tMAPS_PROTO_EA_DATA,      K_MAPS_PROTO_SPEC_EA,     K_MAPS_PROTO_CMD_EA,  K_MAPS_PROTO_CMD_EA) \
+    MESSAGE(AP,     tMAPS_PROTO_AP_DATA,      K_MAPS_PROTO_SPEC_AP,     K_MAPS_PROTO_CMD_AP,  K_MAPS_PROTO_CMD_AP) \
+    MESSAGE(EM,     tMAPS_PROTO_EM_DATA,      K_MAPS_PROTO_SPEC_EM,     K_MAPS_PROTO_CMD_EM,  K_MAPS_PROTO_CMD_EM) \
+    MESSAGE(Fail,   tMAPS_PROTO_FAILURE_DATA, K_MAPS_PROTO_SPEC_FAIL,   K_MAPS_PROTO_CMD_FX,  K_MAPS_PROTO_CMD_PX) \
+    MESSAGE(EndVeh, tMAPS_PROTO_END_VEHICLE,  K_MAPS_PROTO_SPEC_ENDVEH, K_MAPS_PROTO_CMD_FAS, K_MAPS_PROTO_CMD_FR)
+
+// EJ request
+#define K_MAPS_PROTO_SPEC_EJ(VARIANT)                                         \
+    VARIANT(13, 4, 1, K_MAPS_PROTO_SPEC_EJ13)
+
+#define K_MAPS_PROTO_SPEC_EJ13(FIELD)                                         \
+    FIELD(DEC2, paxes,  0, 0, 99)                                             \
+    FIELD(DEC2, naxes,  2, 0, 99)                                             \
+    FIELD(DEC2, ispeed, 4, 0, 99)
+
+// EA response
+#define K_MAPS_PROTO_SPEC_EA(VARIANT)                                         \
+    VARIANT(17, 6, 1, K_MAPS_PROTO_SPEC_EA17)
+
+#define K_MAPS_PROTO_SPEC_EA17(FIELD)                                         \
+    FIELD(DEC2, imax_height, 0, 0, 99)                                        \
+    FIELD(DEC2, umax_height, 2, 0, 99)                                        \
+    FIELD(DEC2, umin_height, 4, 0, 99)                                        \
+    FIELD(DEC2, lmax_height, 6, 0, 99)
+
+// AP request. CF-150, CF-24P (third SM BYTE 0) or CF-220 (third SM BYTE 1) and
+// CF-24P or CF-220 with the third SM BYTE 2
+#define K_MAPS_PROTO_SPEC_AP(VARIANT)                                         \
+    VARIANT(9,  4, data->smbyte < 2,  K_MAPS_PROTO_SPEC_AP9)                  \
+    VARIANT(17, 4, data->smbyte >= 2, K_MAPS_PROTO_SPEC_AP17)
+
+#define K_MAPS_PROTO_SPEC_AP9(FIELD)                                          \
+    FIELD(SET,  smbyte,      0, 0, 0)                                         \
+    FIELD(DEC2, vheight,     0, 0, 99)
+
+#define K_MAPS_PROTO_SPEC_AP17(FIELD)                                         \
+    FIELD(SET,  smbyte,      0, 2, 0)                                         \
+    FIELD(CHR,  vaxis,       0, "0NP", '0')                                   \
+    FIELD(FILL, reserved,    1, '0', 0)                                       \
+    FIELD(DEC2, axis_height, 2, 0, 15)                                        \
+    FIELD(DEC2, vmax_height, 4, 0, 99)                                        \
+    FIELD(DEC2, hmin_height, 6, 0, 99)                                        \
+    FIELD(DEC2, lmax_height, 8, 0, 99)
+
+// EM request. CF-150 & CF-24P and CF-220
+#define K_MAPS_PROTO_SPEC_EM(VARIANT)                                         \
+    VARIANT(16, 4, data->rcvr_direction == 0, K_MAPS_PROTO_SPEC_EM16)         \
+    VARIANT(17, 4, data->rcvr_direction != 0, K_MAPS_PROTO_SPEC_EM17)
+
+#define K_MAPS_PROTO_SPEC_EM16(FIELD)                                         \
+    FIELD(DEC1, work_mode,      0, 0, 3)                                      \
+    FIELD(HEX1, axis_ispeed,    1, 0, 15)                                     \
+    FIELD(DEC1, axis_height,    2, 0, 2)                                      \
+    FIELD(DEC1, hw_failure,     3, 1, 3)                                      \
+    FIELD(DEC1, se_cleaning,    4, 1, 2)                                      \
+    FIELD(DEC2R, firmware_ver,  5, 0, 99)                                     \
+    FIELD(CHK,  tow_detection,  0, "0RMNET", '0')                             \
+    FIELD(FILL, reserved,       7, '0', 0)                                    \
+    FIELD(FILL, reserved,       8, '0', 0)
+
+#define K_MAPS_PROTO_SPEC_EM17(FIELD)                                         \
+    FIELD(DEC1, work_mode,      0, 0, 3)                                      \
+    FIELD(HEX1, axis_ispeed,    1, 0, 15)                                     \
+    FIELD(DEC1, axis_height,    2, 0, 2)                                      \
+    FIELD(CHR,  tow_detection,  3, "0RMNET", '0')                             \
+    FIELD(DEC1, hw_failure,     4, 1, 3)                                      \
+    FIELD(DEC1, se_cleaning,    5, 1, 2)                                      \
+    FIELD(DEC2R, firmware_ver,  6, 0, 99)                                     \
+    FIELD(CHR,  rcvr_direction, 8, "PN", 0)                                   \
+    FIELD(FILL, reserved,       9, '0', 0)
+
+// FX and PX requests
+#define K_MAPS_PROTO_SPEC_FAIL(VARIANT)                                       \
+    VARIANT(10, 4, 1, K_MAPS_PROTO_SPEC_FAIL10)
+
+#define K_MAPS_PROTO_SPEC_FAIL10(FIELD)                                       \
+    FIELD(CHR,  type,    0, "RE", 0)                                          \
+    FIELD(DEC1, ngroup,  1, 0, 8)                                             \
+    FIELD(DEC1, nsensor, 2, 0, 8)
+
+// FA SPONTANEOUS and FR requests. CF-150 (no SM BYTE), CF-220 with the second
+// SM BYTE 0 or 1 and CF-220 with the second SM BYTE 2
+#define K_MAPS_PROTO_SPEC_ENDVEH(VARIANT)                                     \
+    VARIANT(11, 4, data->smb == 3, K_MAPS_PROTO_SPEC_ENDVEH11)                \
+    VARIANT(12, 4, data->smb <= 1, K_MAPS_PROTO_SPEC_ENDVEH12)                \
+    VARIANT(24, 4, data->smb == 2, K_MAPS_PROTO_SPEC_ENDVEH24)
+
+#define K_MAPS_PROTO_SPEC_ENDVEH11(FIELD)                                     \
+    FIELD(SET,  smb,     0, 3, 0)                                             \
+    FIELD(DEC2, paxes,   0, 0, 99)                                            \
+    FIELD(DEC2, naxes,   2, 0, 99)
+
+#define K_MAPS_PROTO_SPEC_ENDVEH12(FIELD)                                     \
+    FIELD(SET,  smb,     0, 1, 0)                                             \
+    FIELD(DEC2, paxes,   0, 0, 99)                                            \
+    FIELD(DEC2, naxes,   2, 0, 99)                                            \
+    FIELD(CHR,  vclass,  4, "ABCDEFMX", 0)
+
+#define K_MAPS_PROTO_SPEC_ENDVEH24(FIELD)                                     \
+    FIELD(SET,  smb,     0, 2, 0)                                             \
+    FIELD(DEC2, paxes,   0, 0, 99)                                            \
+    FIELD(DEC2, naxes,   2, 0, 99)                                            \
+    FIELD(DEC2, paxes10, 4, 0, 99)                                            \
+    FIELD(DEC2, naxes10, 6, 0, 99)                                            \
+    FIELD(DEC2, paxes16, 8, 0, 99)                                            \
+    FIELD(DEC2, naxes16, 10, 0, 99)                                           \
+    FIELD(DEC2, paxes22, 12, 0, 99)                                           \
+    FIELD(DEC2, naxes22, 14, 0, 99)                                           \
+    FIELD(CHR,  vclass,  16, "ABCDEFMX", 0)
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,116 @@
+
+#include <errno.h>
+#include <string.h>
+
+#include "maps_speed.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_SPEED_KMH  3.6   // Km/h by m/s
+
+#define speed_error(e) do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+static void      MapsProtoSpeedReading     (tMAPS_PROTO_SPEED *speed, uint64_t timestamp, uint8_t reading);
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+void MapsProtoSpeedReading(tMAPS_PROTO_SPEED *speed, uint64_t timestamp, uint8_t reading)
+{
+    double t, n, slope, denominator, value = reading;
+
+    if (!speed->readings)
+        speed->origin = timestamp;
+    else  // The distance between the readings with the mean of both speeds
+        speed->span += (speed->last_speed + value) / (2 * K_MAPS_PROTO_SPEED_KMH) * ((timestamp - speed->last) / 1e9);
+
+    t = (timestamp - speed->origin) / 1e9;
+    n = ++speed->readings;
+
+    speed->st  += t;
+    speed->stt += t * t;
+    speed->sv  += value;
+    speed->stv += t * value;
+    speed->last       = timestamp;
+    speed->last_speed = value;
+    speed->mean_speed = speed->sv / n;
+
+    // Least squares. Without two different times the line is the mean
+    denominator = n * speed->stt - speed->st * speed->st;
+
+    if (speed->readings < 2 || denominator <= 1e-12)
+    {
+        speed->speed        = speed->mean_speed;
+        speed->acceleration = 0;
+        return;
+    }
+
+    slope = (n * speed->stv - speed->st * speed->sv) / denominator;
+
+    speed->speed        = (speed->sv - slope * speed->st) / n + slope * t;
+    speed->speed        = (speed->speed > 0) ? speed->speed : 0;
+    speed->acceleration = slope / K_MAPS_PROTO_SPEED_KMH;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoSpeedUpdate(tMAPS_PROTO_SPEED *speed, const tMAPS_PROTO_PARSED_FRAME *parsed)
+{
+    uint8_t id;
+
+    if (!speed || !parsed)
+        speed_error(EINVAL);
+
+    if (parsed->type != 0)
+        return 0;
+
+    id = MapsProtoGetCmdId(parsed->cmd);
+
+    if (id != K_MAPS_PROTO_CMD_IP && id != K_MAPS_PROTO_CMD_IA && id != K_MAPS_PROTO_CMD_EJ &&
+        id != K_MAPS_PROTO_CMD_FAS && id != K_MAPS_PROTO_CMD_FR && id != K_MAPS_PROTO_CMD_FP)
+        return 0;
+
+    if (!parsed->timestamp)
+        speed_error(EINVAL);
+
+    // As MapsProtoStoreAssemble a new IP or IA drops the vehicle without end
+    if (speed->completed || id == K_MAPS_PROTO_CMD_IP || id == K_MAPS_PROTO_CMD_IA)
+    {
+        memset(speed,0,sizeof(tMAPS_PROTO_SPEED));
+
+        if (id == K_MAPS_PROTO_CMD_IP || id == K_MAPS_PROTO_CMD_IA)
+            speed->start = parsed->timestamp;
+    }
+
+    switch (id)
+    {
+        case K_MAPS_PROTO_CMD_IA:
+            if (parsed->data && parsed->size == 1 && parsed->data[0])
+                MapsProtoSpeedReading(speed,parsed->timestamp,(uint8_t) parsed->data[0]);
+        break;
+        case K_MAPS_PROTO_CMD_EJ:
+            if (parsed->data && parsed->size == sizeof(tMAPS_PROTO_EJ_DATA))
+            {
+                const tMAPS_PROTO_EJ_DATA *ej = (const tMAPS_PROTO_EJ_DATA *) parsed->data;
+
+                speed->axles++;
+
+                // 0 is a barrier without the speed measurement
+                if (ej->ispeed)
+                    MapsProtoSpeedReading(speed,parsed->timestamp,ej->ispeed);
+            }
+        break;
+        case K_MAPS_PROTO_CMD_FAS:
+        case K_MAPS_PROTO_CMD_FR:
+        case K_MAPS_PROTO_CMD_FP:
+            if (speed->start && parsed->timestamp > speed->start)
+            {
+                speed->duration = (parsed->timestamp - speed->start) / 1e9;
+                speed->length   = speed->mean_speed / K_MAPS_PROTO_SPEED_KMH * speed->duration;
+            }
+            speed->completed = 1;
+        return 1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
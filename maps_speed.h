@@ -0,0 +1,76 @@
+#ifndef MAPS_SPEED_H
+#define MAPS_SPEED_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_speed.h
+ *  @brief Function prototypes for derive the speed, acceleration and length
+ *         of the vehicles from the arrival times of the frames of a lane.
+ *
+ *  The CF-220 barriers send the speed of each axle (EJ) in whole Km/h.
+ *  With the arrival time of each EJ (the timestamp of
+ *  tMAPS_PROTO_PARSED_FRAME) the readings of the vehicle are fitted to a
+ *  line, speed = v0 + a * t, so the quantization of the readings is
+ *  averaged and the speed at the last axle has a resolution below 1 Km/h.
+ *  The slope is the acceleration. The presence duration (IP or IA to the
+ *  end of the vehicle) multiplied by the mean speed is the length of the
+ *  vehicle plus the length of the detection zone. The CF-24P barriers
+ *  (IP to FP) have no speed readings, only the duration.
+ *
+ *  The values are updated with running sums on each frame, so nothing is
+ *  stored by axle and the cost by frame is constant. Use a
+ *  tMAPS_PROTO_SPEED for each lane initialized with zeros, as the vehicle
+ *  of MapsProtoStoreAssemble. The timestamps must be from the same clock
+ *  (maps_stamp.h) and the frames of the lane in the order of arrival.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_SPEED
+ * @brief  The state and the results of the vehicle of a lane. The results
+ *         are valid after each update. The rest of members are internal.
+ *
+ */
+typedef struct
+{
+    double speed;         ///< The fitted speed at the last axle in Km/h. The mean speed with less than 2 readings.
+    double acceleration;  ///< The acceleration in m/s^2. 0 with less than 2 readings at different times.
+    double mean_speed;    ///< The mean of the speed readings in Km/h.
+    double span;          ///< Meters from the first to the last axle.
+    double duration;      ///< Seconds of presence. Set by FAS, FR or FP.
+    double length;        ///< The mean speed by the presence duration in meters. Set by FAS, FR or FP.
+    uint16_t axles;       ///< EJ frames received.
+    uint16_t readings;    ///< Speed readings in the fit (EJ and IA with speed).
+    uint8_t completed;    ///< 1 after FAS, FR or FP. The next frame starts a new vehicle.
+    uint64_t start;       ///< Presence start (IP/IA) in nanoseconds. 0 when not received.
+    uint64_t origin;      ///< The time of the first reading. The times of the sums are from it.
+    uint64_t last;        ///< The time of the last reading.
+    double last_speed;    ///< The speed of the last reading.
+    double st;            ///< Sum of the times (seconds).
+    double stt;           ///< Sum of the squared times.
+    double sv;            ///< Sum of the speeds.
+    double stv;           ///< Sum of the times by the speeds.
+}tMAPS_PROTO_SPEED;
+
+/** @brief Add a frame of a lane to the speed of its vehicle.
+ *
+ *  The vehicles end on the same frames as MapsProtoStoreAssemble. The IP
+ *  and IA frames start a new vehicle and drop the vehicle without end. The
+ *  EJ frames and the IA frames with speed (CF-220) add a reading to the
+ *  fit. The FAS, FR (CF-220) and FP (CF-24P) frames set the duration and
+ *  the length and complete the vehicle. Other frames are ignored.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The speed or parsed params are NULL or an IP, IA, EJ, FAS, FR or FP frame has no timestamp.
+ *
+ * @param  speed  The speed of the lane.
+ * @param  parsed The frame received from the lane with its timestamp.
+ * @return 1 when the vehicle is completed (FAS, FR or FP), 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoSpeedUpdate(tMAPS_PROTO_SPEED *speed, const tMAPS_PROTO_PARSED_FRAME *parsed);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,90 @@
+
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#include "maps_stamp.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_STAMP_FLAGS (SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE)
+//-----------------------------------------------------------------------------
+
+static uint64_t  MapsProtoStampToMonotonic (const struct timespec *realtime);
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+uint64_t MapsProtoStampToMonotonic(const struct timespec *realtime)
+{
+    struct timespec now_real, now_mono;
+    int64_t real = (int64_t) realtime->tv_sec * 1000000000LL + realtime->tv_nsec;
+
+    clock_gettime(CLOCK_REALTIME,&now_real);
+    clock_gettime(CLOCK_MONOTONIC,&now_mono);
+
+    // The age of the packet is the same in both clocks
+    real -= (int64_t) now_real.tv_sec * 1000000000LL + now_real.tv_nsec;
+    real += (int64_t) now_mono.tv_sec * 1000000000LL + now_mono.tv_nsec;
+
+    return (real > 0) ? (uint64_t) real : 0;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+uint64_t MapsProtoStampNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStampEnable(int fd)
+{
+    int flags = K_MAPS_PROTO_STAMP_FLAGS;
+
+    return setsockopt(fd,SOL_SOCKET,SO_TIMESTAMPING,&flags,sizeof(flags));
+}
+//-----------------------------------------------------------------------------
+
+ssize_t MapsProtoStampRecv(int fd, uint8_t *buffer, size_t size, uint64_t *timestamp)
+{
+    ssize_t n;
+    char control[CMSG_SPACE(sizeof(struct scm_timestamping))];
+    struct iovec iov = { .iov_base = buffer, .iov_len = size };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control) };
+    struct scm_timestamping *ts;
+    struct cmsghdr *cmsg;
+
+    if (!buffer || !timestamp)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((n = recvmsg(fd,&msg,0)) < 0)
+        return -1;
+
+    *timestamp = 0;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg && !*timestamp; cmsg = CMSG_NXTHDR(&msg,cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+
+        // ts[0] is the software time (CLOCK_REALTIME). ts[2], the raw hardware time, is in the clock of the NIC and is not used
+        ts = (struct scm_timestamping *) CMSG_DATA(cmsg);
+
+        if (ts->ts[0].tv_sec || ts->ts[0].tv_nsec)
+            *timestamp = MapsProtoStampToMonotonic(&ts->ts[0]);
+    }
+
+    if (!*timestamp)
+        *timestamp = MapsProtoStampNow();
+
+    return n;
+}
+//-----------------------------------------------------------------------------
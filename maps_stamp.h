@@ -0,0 +1,67 @@
+#ifndef MAPS_STAMP_H
+#define MAPS_STAMP_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_stamp.h
+ *  @brief Function prototypes for get the arrival time of the bytes of a
+ *         lane, for the timestamp of tMAPS_PROTO_PARSED_FRAME.
+ *
+ *  All the times are nanoseconds of CLOCK_MONOTONIC. For a serial line use
+ *  MapsProtoStampNow just after read (maps_shard.c does it in
+ *  MapsProtoShardPush). For a TCP gateway enable SO_TIMESTAMPING on the
+ *  socket and read with MapsProtoStampRecv: the time is taken by the kernel
+ *  when the packet arrives, so the delay of the scheduler of the reader is
+ *  not included. The software times of the kernel are CLOCK_REALTIME and
+ *  are converted to CLOCK_MONOTONIC with the offset between both clocks at
+ *  the read.
+ *
+ *  The hardware timestamps of the NIC are not used: they are in the clock
+ *  of the NIC (PHC), not CLOCK_REALTIME, and are only comparable with the
+ *  system clock while phc2sys keeps both in sync.
+ *
+ *  Pass the time to MapsProtoShardPushAt or set it in the timestamp of the
+ *  parsed frames.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+//-----------------------------------------------------------------------------
+
+/** @brief The current time for a timestamp.
+ *
+ * @return The nanoseconds of CLOCK_MONOTONIC.
+ */
+uint64_t MapsProtoStampNow(void);
+
+/** @brief Enable the software receive timestamps of the kernel in a socket.
+ *
+ *  The errno values are any errno value of setsockopt.
+ *
+ * @param  fd The socket. i.e. A TCP connection with a serial gateway.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoStampEnable(int fd);
+
+/** @brief Read from a socket with the arrival time of the bytes.
+ *
+ *  The time is the software timestamp of the kernel or, when the socket has
+ *  no timestamps (not enabled or not supported), the time after the read. On TCP the time is the arrival of the last
+ *  packet read.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The buffer or timestamp params are NULL.
+ *
+ *  Or any errno value of recvmsg.
+ *
+ * @param  fd        The socket.
+ * @param  buffer    Where the bytes are stored.
+ * @param  size      The size of the buffer.
+ * @param  timestamp Where the arrival time is stored. Nanoseconds of CLOCK_MONOTONIC.
+ * @return The bytes read, 0 when the connection is closed or -1 on error and errno is set.
+ */
+ssize_t MapsProtoStampRecv(int fd, uint8_t *buffer, size_t size, uint64_t *timestamp);
+
+//-----------------------------------------------------------------------------
+#endif
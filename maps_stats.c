@@ -0,0 +1,191 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "maps_stats.h"
+//-----------------------------------------------------------------------------
+
+// All the members of tMAPS_PROTO_STATS are uint64_t counters
+#define K_MAPS_PROTO_STATS_COUNTERS (sizeof(tMAPS_PROTO_STATS) / sizeof(uint64_t))
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_STATS_NODE
+ * @brief  The counters of a thread in the list of the registered threads.
+ *
+ */
+typedef struct sMAPS_PROTO_STATS_NODE
+{
+    tMAPS_PROTO_STATS stats;             ///< Only written by its thread.
+    struct sMAPS_PROTO_STATS_NODE *prev;
+    struct sMAPS_PROTO_STATS_NODE *next;
+}tMAPS_PROTO_STATS_NODE;
+//-----------------------------------------------------------------------------
+
+static void      MapsProtoStatsInitKey     (void);
+static void      MapsProtoStatsRelease     (void *node);
+static tMAPS_PROTO_STATS * MapsProtoStatsRegister(void);
+//-----------------------------------------------------------------------------
+
+static pthread_key_t   stats_key;
+static pthread_once_t  stats_once  = PTHREAD_ONCE_INIT;
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static tMAPS_PROTO_STATS_NODE *stats_threads = NULL;  ///< The registered threads.
+static tMAPS_PROTO_STATS       stats_retired;         ///< The counters of the ended threads.
+
+static __thread tMAPS_PROTO_STATS_NODE *stats_local = NULL;
+//-----------------------------------------------------------------------------
+//############################ PRIVATE  FUNCTIONS #############################
+
+void MapsProtoStatsInitKey()
+{
+    pthread_key_create(&stats_key,MapsProtoStatsRelease);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStatsRelease(void *node)
+{
+    tMAPS_PROTO_STATS_NODE *n = (tMAPS_PROTO_STATS_NODE *) node;
+
+    pthread_mutex_lock(&stats_mutex);
+
+    MapsProtoStatsMerge(&stats_retired,&n->stats);
+
+    if (n->prev)
+        n->prev->next = n->next;
+    else
+        stats_threads = n->next;
+    if (n->next)
+        n->next->prev = n->prev;
+
+    pthread_mutex_unlock(&stats_mutex);
+
+    stats_local = NULL;
+    free(n);
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STATS * MapsProtoStatsRegister()
+{
+    tMAPS_PROTO_STATS_NODE *n;
+
+    pthread_once(&stats_once,MapsProtoStatsInitKey);
+
+    if ((n = (tMAPS_PROTO_STATS_NODE *)calloc(1,sizeof(tMAPS_PROTO_STATS_NODE))) == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&stats_mutex);
+
+    n->next = stats_threads;
+    if (stats_threads)
+        stats_threads->prev = n;
+    stats_threads = n;
+
+    pthread_mutex_unlock(&stats_mutex);
+
+    pthread_setspecific(stats_key,n);  // The counters are retired when the thread ends
+    stats_local = n;
+
+    return &n->stats;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+tMAPS_PROTO_STATS * MapsProtoStatsLocal()
+{
+    return (stats_local) ? &stats_local->stats : MapsProtoStatsRegister();
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStatsSnapshot(tMAPS_PROTO_STATS *stats)
+{
+    tMAPS_PROTO_STATS_NODE *n;
+
+    if (stats == NULL)
+        return;
+
+    pthread_mutex_lock(&stats_mutex);
+
+    memcpy(stats,&stats_retired,sizeof(tMAPS_PROTO_STATS));
+
+    for (n = stats_threads; n; n = n->next)
+        MapsProtoStatsMerge(stats,&n->stats);
+
+    pthread_mutex_unlock(&stats_mutex);
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStatsMerge(tMAPS_PROTO_STATS *dst, const tMAPS_PROTO_STATS *src)
+{
+    size_t i;
+    uint64_t *d = (uint64_t *) dst;
+    const volatile uint64_t *s = (const volatile uint64_t *) src;  // src can be the counters of another thread
+
+    for (i = 0; i < K_MAPS_PROTO_STATS_COUNTERS; i++)
+        d[i] += s[i];
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStatsDiff(const tMAPS_PROTO_STATS *now, const tMAPS_PROTO_STATS *before, tMAPS_PROTO_STATS *diff)
+{
+    size_t i;
+    const uint64_t *n = (const uint64_t *) now;
+    const uint64_t *b = (const uint64_t *) before;
+    uint64_t *d = (uint64_t *) diff;
+
+    for (i = 0; i < K_MAPS_PROTO_STATS_COUNTERS; i++)
+        d[i] = n[i] - b[i];
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoStatsParse(uint8_t status, uint8_t cmd_id, uint8_t type, uint16_t size)
+{
+    tMAPS_PROTO_STATS *stats = MapsProtoStatsLocal();
+
+    if (stats == NULL)
+        return status;
+
+    stats->bytes_parsed += size;
+
+    if (status)
+        stats->errors[(status < K_MAPS_PROTO_STATUS_COUNT) ? status : 0]++;
+    else
+    {
+        if (cmd_id < K_MAPS_PROTO_CMD_COUNT)
+            stats->parsed[cmd_id]++;
+        if (type == 2)
+            stats->not_executed[(cmd_id < K_MAPS_PROTO_CMD_COUNT) ? cmd_id : K_MAPS_PROTO_CMD_COUNT]++;
+    }
+
+    return status;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStatsCreate(uint8_t cmd_id, uint16_t size)
+{
+    tMAPS_PROTO_STATS *stats = MapsProtoStatsLocal();
+
+    if (stats == NULL)
+        return;
+
+    stats->bytes_created += size;
+
+    if (cmd_id < K_MAPS_PROTO_CMD_COUNT)
+        stats->created[cmd_id]++;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStatsAlloc(size_t size)
+{
+    tMAPS_PROTO_STATS *stats = MapsProtoStatsLocal();
+
+    if (stats == NULL)
+        return;
+
+    stats->allocs++;
+    stats->alloc_bytes += size;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+#ifndef MAPS_STATS_H
+#define MAPS_STATS_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_stats.h
+ *  @brief Function prototypes for the counters of the parse and create
+ *         functions.
+ *
+ *  The counters are only incremented when maps_proto.c is compiled with
+ *  MAPS_PROTO_STATS defined (i.e. DEFINES += MAPS_PROTO_STATS). Without it
+ *  the hooks are empty macros and the counters are always 0.
+ *
+ *  Each thread has its own counters, so the hot path is a plain increment
+ *  without atomics or locks. A thread is registered the first time that
+ *  counts something and its counters are added to the totals when the
+ *  thread ends. MapsProtoStatsSnapshot adds the counters of all the
+ *  threads. While the other threads are counting the snapshot is not
+ *  exact, each counter can be some frames behind (and can be torn on 32
+ *  bits targets).
+ *
+ *  The counters are never reset. For the counts of an interval keep the
+ *  previous snapshot and use MapsProtoStatsDiff.
+ */
+
+#include <stddef.h>
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_STATS
+ * @brief  The counters of the parse and create functions.
+ *
+ */
+typedef struct
+{
+    uint64_t parsed[K_MAPS_PROTO_CMD_COUNT];          ///< The frames parsed or validated without error by K_MAPS_PROTO_CMD_*. Includes the NE frames.
+    uint64_t created[K_MAPS_PROTO_CMD_COUNT];         ///< The frames created by K_MAPS_PROTO_CMD_*.
+    uint64_t not_executed[K_MAPS_PROTO_CMD_COUNT+1];  ///< The NE frames by K_MAPS_PROTO_CMD_*. The last is the NE of unknown commands.
+    uint64_t errors[K_MAPS_PROTO_STATUS_COUNT];       ///< The parse errors by tMAPS_PROTO_STATUS (LRC, FRAMING, COMMAND, DATA, ...). errors[0] is not used.
+    uint64_t bytes_parsed;                            ///< The bytes given to the parse functions. Includes the frames with errors.
+    uint64_t bytes_created;                           ///< The bytes of the frames created.
+    uint64_t allocs;                                  ///< The calls to calloc of the library.
+    uint64_t alloc_bytes;                             ///< The bytes requested to calloc.
+}tMAPS_PROTO_STATS;
+
+/** @brief Get the counters of the calling thread. The thread is registered if it was not.
+ *
+ * @return The counters of the thread or NULL when couldn't allocate memory.
+ */
+tMAPS_PROTO_STATS * MapsProtoStatsLocal(void);
+
+/** @brief Get the sum of the counters of all the threads (the ended threads too).
+ *
+ * @param  stats Where the counters are stored.
+ */
+void MapsProtoStatsSnapshot(tMAPS_PROTO_STATS *stats);
+
+/** @brief Add the counters of src to dst.
+ *
+ * @param  dst The counters to increment.
+ * @param  src The counters to add.
+ */
+void MapsProtoStatsMerge(tMAPS_PROTO_STATS *dst, const tMAPS_PROTO_STATS *src);
+
+/** @brief Get the counts between two snapshots. i.e. The counts of the last minute.
+ *
+ * @param  now    The last snapshot.
+ * @param  before The previous snapshot.
+ * @param  diff   Where now - before is stored. Can be the same as now.
+ */
+void MapsProtoStatsDiff(const tMAPS_PROTO_STATS *now, const tMAPS_PROTO_STATS *before, tMAPS_PROTO_STATS *diff);
+
+// Hooks of maps_proto.c. Only called with MAPS_PROTO_STATS defined
+//-----------------------------------------------------------------------------
+
+/** @brief Count a frame given to a parse function.
+ *
+ * @param  status The result of the parse.
+ * @param  cmd_id The K_MAPS_PROTO_CMD_* of the frame or K_MAPS_PROTO_CMD_UNKNOWN.
+ * @param  type   The type of the frame (2 is NE). Only used when status is OK.
+ * @param  size   The size of the frame.
+ * @return The status param.
+ */
+uint8_t MapsProtoStatsParse(uint8_t status, uint8_t cmd_id, uint8_t type, uint16_t size);
+
+/** @brief Count a frame created.
+ *
+ * @param  cmd_id The K_MAPS_PROTO_CMD_* of the frame or K_MAPS_PROTO_CMD_UNKNOWN (NE).
+ * @param  size   The size of the frame.
+ */
+void MapsProtoStatsCreate(uint8_t cmd_id, uint16_t size);
+
+/** @brief Count an allocation.
+ *
+ * @param  size The bytes to allocate.
+ */
+void MapsProtoStatsAlloc(size_t size);
+
+//-----------------------------------------------------------------------------
+#endif
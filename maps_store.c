@@ -0,0 +1,644 @@
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "maps_store.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_STORE_MAGIC        "MPST"
+#define K_MAPS_PROTO_STORE_HEADER_SIZE  16
+#define K_MAPS_PROTO_STORE_BLOCK_SIZE   (8 + (16 * K_MAPS_PROTO_STORE_COLUMNS))
+
+#define store_pad(s)    (((s) + 7) & ~((size_t) 7))
+#define store_error(e)  do { errno = e; return -1; } while (0)
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_STORE_COLUMN
+ * @brief  A column of the store. A member of tMAPS_PROTO_VEHICLE.
+ *
+ */
+typedef struct
+{
+    uint8_t size;         ///< The size of the member: 1, 2 or 8 bytes.
+    uint16_t offset;      ///< The offset of the member in tMAPS_PROTO_VEHICLE.
+}tMAPS_PROTO_STORE_COLUMN;
+
+/**
+ *
+ * @struct tMAPS_PROTO_STORE_HEADER
+ * @brief  The header of the file.
+ *
+ */
+typedef struct
+{
+    char magic[4];        ///< K_MAPS_PROTO_STORE_MAGIC.
+    uint16_t version;     ///< K_MAPS_PROTO_STORE_VERSION.
+    uint16_t columns;     ///< K_MAPS_PROTO_STORE_COLUMNS.
+    uint32_t block_rows;  ///< The rows of a full block.
+    uint32_t reserved;    ///< Not used. Always 0.
+}tMAPS_PROTO_STORE_HEADER;
+
+/**
+ *
+ * @struct tMAPS_PROTO_STORE_BLOCK
+ * @brief  The header of a block. The columns are after the header.
+ *
+ */
+typedef struct
+{
+    uint32_t rows;        ///< The rows in the block.
+    uint32_t reserved;    ///< Not used. Always 0.
+    uint64_t min[K_MAPS_PROTO_STORE_COLUMNS];
+    uint64_t max[K_MAPS_PROTO_STORE_COLUMNS];
+}tMAPS_PROTO_STORE_BLOCK;
+
+/**
+ *
+ * @struct tMAPS_PROTO_STORE_FILTER
+ * @brief  A filter of a reader.
+ *
+ */
+typedef struct
+{
+    uint8_t column;
+    uint64_t min;
+    uint64_t max;
+}tMAPS_PROTO_STORE_FILTER;
+
+struct sMAPS_PROTO_STORE_WRITER
+{
+    int fd;
+    uint32_t block_rows;  ///< The rows of a full block.
+    tMAPS_PROTO_STORE_BLOCK block;  ///< The block in memory.
+    uint8_t *columns[K_MAPS_PROTO_STORE_COLUMNS];  ///< The values of the block. block_rows values by column.
+};
+
+struct sMAPS_PROTO_STORE_READER
+{
+    uint8_t *map;         ///< The mapped file.
+    size_t size;          ///< The size of the mapped file.
+    size_t offset;        ///< The offset of the current block.
+    uint32_t row;         ///< The next row in the current block.
+    uint8_t filters_num;
+    tMAPS_PROTO_STORE_SCAN scan;
+    const tMAPS_PROTO_STORE_BLOCK *block;  ///< The current block. NULL when must find the next block.
+    const uint8_t *columns[K_MAPS_PROTO_STORE_COLUMNS];  ///< The columns of the current block.
+    tMAPS_PROTO_STORE_FILTER filters[K_MAPS_PROTO_STORE_MAX_FILTERS];
+};
+//-----------------------------------------------------------------------------
+
+_Static_assert(sizeof(tMAPS_PROTO_STORE_HEADER) == K_MAPS_PROTO_STORE_HEADER_SIZE, "The header must have a fixed size");
+_Static_assert(sizeof(tMAPS_PROTO_STORE_BLOCK)  == K_MAPS_PROTO_STORE_BLOCK_SIZE , "The block header must have a fixed size");
+
+/**
+ * The columns of the store. The position of each column must be the same as its K_MAPS_PROTO_STORE_COL_* identifier.
+ */
+static const tMAPS_PROTO_STORE_COLUMN columns[K_MAPS_PROTO_STORE_COLUMNS] =
+{
+    { 8, offsetof(tMAPS_PROTO_VEHICLE,start)       },
+    { 8, offsetof(tMAPS_PROTO_VEHICLE,end)         },
+    { 2, offsetof(tMAPS_PROTO_VEHICLE,lane)        },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,paxes)       },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,naxes)       },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,vclass)      },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,height)      },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,vmax_height) },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,hmin_height) },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,lmax_height) },
+    { 1, offsetof(tMAPS_PROTO_VEHICLE,speed)       }
+};
+//-----------------------------------------------------------------------------
+
+static uint64_t MapsProtoStoreGetValue(const uint8_t *data, uint8_t size);
+static void     MapsProtoStoreSetValue(uint8_t *data, uint8_t size, uint64_t value);
+static uint8_t  MapsProtoStoreNextBlock(tMAPS_PROTO_STORE_READER *reader);
+//-----------------------------------------------------------------------------
+
+uint64_t MapsProtoStoreGetValue(const uint8_t *data, uint8_t size)
+{
+    uint8_t  v8;
+    uint16_t v16;
+    uint64_t v64;
+
+    switch (size)
+    {
+        case 1:  memcpy(&v8 ,data,1); return v8;
+        case 2:  memcpy(&v16,data,2); return v16;
+        default: memcpy(&v64,data,8); return v64;
+    }
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStoreSetValue(uint8_t *data, uint8_t size, uint64_t value)
+{
+    uint8_t  v8  = value;
+    uint16_t v16 = value;
+
+    switch (size)
+    {
+        case 1:  memcpy(data,&v8  ,1); break;
+        case 2:  memcpy(data,&v16 ,2); break;
+        default: memcpy(data,&value,8); break;
+    }
+}
+//-----------------------------------------------------------------------------
+
+uint8_t MapsProtoStoreNextBlock(tMAPS_PROTO_STORE_READER *reader)
+{
+    uint8_t i, c;
+    size_t size;
+    const tMAPS_PROTO_STORE_BLOCK *block;
+
+    while (reader->size - reader->offset >= sizeof(tMAPS_PROTO_STORE_BLOCK))
+    {
+        block = (const tMAPS_PROTO_STORE_BLOCK *) &reader->map[reader->offset];
+        size  = sizeof(tMAPS_PROTO_STORE_BLOCK);
+
+        for (c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++)
+            size += store_pad((size_t) block->rows * columns[c].size);
+
+        if (!block->rows || reader->size - reader->offset < size)  // Incomplete block. A writer is appending it.
+            break;
+
+        reader->scan.blocks++;
+
+        for (i = 0; i < reader->filters_num; i++)
+        {
+            c = reader->filters[i].column;
+
+            if (block->min[c] > reader->filters[i].max || block->max[c] < reader->filters[i].min)
+                break;
+        }
+
+        if (i < reader->filters_num)
+        {
+            reader->scan.skipped++;
+            reader->offset += size;
+            continue;
+        }
+
+        size = reader->offset + sizeof(tMAPS_PROTO_STORE_BLOCK);
+
+        for (c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++)
+        {
+            reader->columns[c] = &reader->map[size];
+            size += store_pad((size_t) block->rows * columns[c].size);
+        }
+
+        reader->block   = block;
+        reader->row     = 0;
+        reader->offset  = size;
+
+        return 1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoStoreAssemble(tMAPS_PROTO_VEHICLE *vehicle, const tMAPS_PROTO_PARSED_FRAME *parsed, uint16_t lane, uint64_t timestamp)
+{
+    uint8_t id;
+
+    if (!vehicle || !parsed)
+        store_error(EINVAL);
+
+    id = MapsProtoGetCmdId(parsed->cmd);
+
+    if (parsed->type == 2 || (parsed->type == 1 && id != K_MAPS_PROTO_CMD_EA))
+        return 0;
+    if (parsed->type == 0 && id != K_MAPS_PROTO_CMD_IP && id != K_MAPS_PROTO_CMD_IA && id != K_MAPS_PROTO_CMD_AP &&
+        id != K_MAPS_PROTO_CMD_EJ && id != K_MAPS_PROTO_CMD_FAS && id != K_MAPS_PROTO_CMD_FR && id != K_MAPS_PROTO_CMD_FP)
+        return 0;
+
+    if (vehicle->end || (parsed->type == 0 && (id == K_MAPS_PROTO_CMD_IP || id == K_MAPS_PROTO_CMD_IA)))
+    {
+        memset(vehicle,0,sizeof(tMAPS_PROTO_VEHICLE));
+        vehicle->start = timestamp;
+        vehicle->lane  = lane;
+    }
+
+    if (!vehicle->start)
+    {
+        vehicle->start = timestamp;
+        vehicle->lane  = lane;
+    }
+
+    if (parsed->type == 1)  // The EA response
+    {
+        if (parsed->data && parsed->size == sizeof(tMAPS_PROTO_EA_DATA))
+        {
+            const tMAPS_PROTO_EA_DATA *ea = (const tMAPS_PROTO_EA_DATA *) parsed->data;
+
+            vehicle->height      = (ea->imax_height > vehicle->height)      ? ea->imax_height : vehicle->height;
+            vehicle->vmax_height = (ea->umax_height > vehicle->vmax_height) ? ea->umax_height : vehicle->vmax_height;
+            vehicle->lmax_height = (ea->lmax_height > vehicle->lmax_height) ? ea->lmax_height : vehicle->lmax_height;
+
+            if (ea->umin_height && (!vehicle->hmin_height || ea->umin_height < vehicle->hmin_height))
+                vehicle->hmin_height = ea->umin_height;
+        }
+
+        return 0;
+    }
+
+    switch (id)
+    {
+        case K_MAPS_PROTO_CMD_IA:
+            if (parsed->data && parsed->size == 1 && (uint8_t) parsed->data[0] > vehicle->speed)
+                vehicle->speed = parsed->data[0];
+        break;
+        case K_MAPS_PROTO_CMD_AP:
+            if (parsed->data && parsed->size == sizeof(tMAPS_PROTO_AP_DATA))
+            {
+                const tMAPS_PROTO_AP_DATA *ap = (const tMAPS_PROTO_AP_DATA *) parsed->data;
+
+                if (ap->smbyte < 2)
+                    vehicle->height = ap->vheight;
+                else
+                {
+                    if (!vehicle->height)
+                        vehicle->height = ap->axis_height;
+
+                    vehicle->vmax_height = (ap->vmax_height > vehicle->vmax_height) ? ap->vmax_height : vehicle->vmax_height;
+                    vehicle->lmax_height = (ap->lmax_height > vehicle->lmax_height) ? ap->lmax_height : vehicle->lmax_height;
+
+                    if (ap->hmin_height && (!vehicle->hmin_height || ap->hmin_height < vehicle->hmin_height))
+                        vehicle->hmin_height = ap->hmin_height;
+                }
+            }
+        break;
+        case K_MAPS_PROTO_CMD_EJ:
+            if (parsed->data && parsed->size == sizeof(tMAPS_PROTO_EJ_DATA))
+            {
+                const tMAPS_PROTO_EJ_DATA *ej = (const tMAPS_PROTO_EJ_DATA *) parsed->data;
+
+                vehicle->paxes = ej->paxes;
+                vehicle->naxes = ej->naxes;
+                vehicle->speed = (ej->ispeed > vehicle->speed) ? ej->ispeed : vehicle->speed;
+            }
+        break;
+        case K_MAPS_PROTO_CMD_FAS:
+        case K_MAPS_PROTO_CMD_FR:
+            if (parsed->data && parsed->size == sizeof(tMAPS_PROTO_END_VEHICLE))
+            {
+                const tMAPS_PROTO_END_VEHICLE *end = (const tMAPS_PROTO_END_VEHICLE *) parsed->data;
+
+                vehicle->paxes  = end->paxes;
+                vehicle->naxes  = end->naxes;
+                vehicle->vclass = end->vclass;
+            }
+            vehicle->end = timestamp;
+        return 1;
+        case K_MAPS_PROTO_CMD_FP:
+            vehicle->end = timestamp;
+        return 1;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STORE_WRITER * MapsProtoStoreCreate(const char *path, uint32_t block_rows)
+{
+    int error;
+    struct stat st;
+    tMAPS_PROTO_STORE_HEADER header;
+    tMAPS_PROTO_STORE_WRITER *writer;
+
+    if (!path || !block_rows)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((writer = (tMAPS_PROTO_STORE_WRITER *)calloc(1,sizeof(tMAPS_PROTO_STORE_WRITER))) == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    writer->fd         = -1;
+    writer->block_rows = block_rows;
+
+    for (uint8_t c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++) {
+        if ((writer->columns[c] = (uint8_t *)calloc(block_rows,columns[c].size)) == NULL)
+        {
+            MapsProtoStoreClose(writer);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    if ((writer->fd = open(path,O_CREAT | O_RDWR | O_APPEND | O_CLOEXEC,0644)) < 0 || fstat(writer->fd,&st))
+        goto STORE_ERROR_EXEC;
+
+    if (st.st_size == 0)
+    {
+        memset(&header,0,sizeof(tMAPS_PROTO_STORE_HEADER));
+        memcpy(header.magic,K_MAPS_PROTO_STORE_MAGIC,4);
+        header.version    = K_MAPS_PROTO_STORE_VERSION;
+        header.columns    = K_MAPS_PROTO_STORE_COLUMNS;
+        header.block_rows = block_rows;
+
+        if (write(writer->fd,&header,sizeof(tMAPS_PROTO_STORE_HEADER)) != sizeof(tMAPS_PROTO_STORE_HEADER))
+            goto STORE_ERROR_EXEC;
+    }
+    else if (pread(writer->fd,&header,sizeof(tMAPS_PROTO_STORE_HEADER),0) != sizeof(tMAPS_PROTO_STORE_HEADER) ||
+             memcmp(header.magic,K_MAPS_PROTO_STORE_MAGIC,4) || header.version != K_MAPS_PROTO_STORE_VERSION ||
+             header.columns != K_MAPS_PROTO_STORE_COLUMNS || header.block_rows != block_rows)
+    {
+        errno = ENOEXEC;
+        goto STORE_ERROR_EXEC;
+    }
+
+    return writer;
+
+    STORE_ERROR_EXEC:
+
+    error = errno;
+    MapsProtoStoreClose(writer);
+    errno = error;
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStoreAppend(tMAPS_PROTO_STORE_WRITER *writer, const tMAPS_PROTO_VEHICLE *vehicle)
+{
+    uint64_t value;
+    uint32_t row;
+
+    if (!writer || !vehicle)
+        store_error(EINVAL);
+
+    if (writer->block.rows == writer->block_rows && MapsProtoStoreFlush(writer))
+        return -1;
+
+    row = writer->block.rows++;
+
+    for (uint8_t c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++)
+    {
+        value = MapsProtoStoreGetValue((const uint8_t *) vehicle + columns[c].offset,columns[c].size);
+        MapsProtoStoreSetValue(&writer->columns[c][row * columns[c].size],columns[c].size,value);
+
+        if (!row || value < writer->block.min[c])
+            writer->block.min[c] = value;
+        if (!row || value > writer->block.max[c])
+            writer->block.max[c] = value;
+    }
+
+    if (writer->block.rows == writer->block_rows)
+        return MapsProtoStoreFlush(writer);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStoreFlush(tMAPS_PROTO_STORE_WRITER *writer)
+{
+    ssize_t total, written;
+    size_t size, padding;
+    struct iovec iov[1 + (2 * K_MAPS_PROTO_STORE_COLUMNS)];
+    static const uint8_t zeros[8];
+    uint8_t iovcnt = 1;
+
+    if (!writer)
+        store_error(EINVAL);
+
+    if (!writer->block.rows)
+        return 0;
+
+    iov[0].iov_base = &writer->block;
+    iov[0].iov_len  = sizeof(tMAPS_PROTO_STORE_BLOCK);
+    total = sizeof(tMAPS_PROTO_STORE_BLOCK);
+
+    for (uint8_t c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++)
+    {
+        size    = (size_t) writer->block.rows * columns[c].size;
+        padding = store_pad(size) - size;
+        total  += size + padding;
+
+        iov[iovcnt].iov_base   = writer->columns[c];
+        iov[iovcnt++].iov_len  = size;
+
+        if (padding)
+        {
+            iov[iovcnt].iov_base  = (void *) zeros;
+            iov[iovcnt++].iov_len = padding;
+        }
+    }
+
+    if ((written = writev(writer->fd,iov,iovcnt)) != total)  // A single call, so the readers never see a block without its header
+    {
+        if (written >= 0)
+            errno = EIO;
+
+        return -1;
+    }
+
+    memset(&writer->block,0,sizeof(tMAPS_PROTO_STORE_BLOCK));
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStoreClose(tMAPS_PROTO_STORE_WRITER *writer)
+{
+    int rc = 0, error = 0;
+
+    if (!writer)
+        return 0;
+
+    if (writer->fd >= 0)
+    {
+        if ((rc = MapsProtoStoreFlush(writer)))
+            error = errno;
+
+        close(writer->fd);
+    }
+
+    for (uint8_t c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++)
+        free(writer->columns[c]);
+
+    free(writer);
+
+    if (rc)
+        errno = error;
+
+    return rc;
+}
+//-----------------------------------------------------------------------------
+
+tMAPS_PROTO_STORE_READER * MapsProtoStoreOpen(const char *path)
+{
+    int fd, error;
+    struct stat st;
+    tMAPS_PROTO_STORE_HEADER *header;
+    tMAPS_PROTO_STORE_READER *reader;
+
+    if (!path)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((fd = open(path,O_RDONLY | O_CLOEXEC)) < 0)
+        return NULL;
+
+    if (fstat(fd,&st))
+        goto STORE_ERROR_EXEC;
+
+    if ((size_t) st.st_size < sizeof(tMAPS_PROTO_STORE_HEADER))
+    {
+        errno = ENOEXEC;
+        goto STORE_ERROR_EXEC;
+    }
+
+    if ((reader = (tMAPS_PROTO_STORE_READER *)calloc(1,sizeof(tMAPS_PROTO_STORE_READER))) == NULL)
+    {
+        errno = ENOMEM;
+        goto STORE_ERROR_EXEC;
+    }
+
+    if ((reader->map = (uint8_t *)mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED)
+    {
+        free(reader);
+        goto STORE_ERROR_EXEC;
+    }
+
+    close(fd);
+    reader->size = st.st_size;
+    header = (tMAPS_PROTO_STORE_HEADER *) reader->map;
+
+    if (memcmp(header->magic,K_MAPS_PROTO_STORE_MAGIC,4) || header->version != K_MAPS_PROTO_STORE_VERSION ||
+        header->columns != K_MAPS_PROTO_STORE_COLUMNS)
+    {
+        MapsProtoStoreFree(reader);
+        errno = ENOEXEC;
+        return NULL;
+    }
+
+    madvise(reader->map,reader->size,MADV_SEQUENTIAL);
+    MapsProtoStoreReset(reader);
+
+    return reader;
+
+    STORE_ERROR_EXEC:
+
+    error = errno;
+    close(fd);
+    errno = error;
+
+    return NULL;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStoreFilter(tMAPS_PROTO_STORE_READER *reader, uint8_t column, uint64_t min, uint64_t max)
+{
+    if (!reader || column >= K_MAPS_PROTO_STORE_COLUMNS || min > max)
+        store_error(EINVAL);
+    if (reader->filters_num == K_MAPS_PROTO_STORE_MAX_FILTERS)
+        store_error(ENOSPC);
+
+    reader->filters[reader->filters_num].column = column;
+    reader->filters[reader->filters_num].min    = min;
+    reader->filters[reader->filters_num++].max  = max;
+
+    memset(&reader->scan,0,sizeof(tMAPS_PROTO_STORE_SCAN));
+    reader->offset = sizeof(tMAPS_PROTO_STORE_HEADER);
+    reader->block  = NULL;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStoreReset(tMAPS_PROTO_STORE_READER *reader)
+{
+    if (reader)
+    {
+        memset(&reader->scan,0,sizeof(tMAPS_PROTO_STORE_SCAN));
+        reader->filters_num = 0;
+        reader->offset      = sizeof(tMAPS_PROTO_STORE_HEADER);
+        reader->block       = NULL;
+    }
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStoreNext(tMAPS_PROTO_STORE_READER *reader, tMAPS_PROTO_VEHICLE *vehicle)
+{
+    uint8_t i, c;
+    uint32_t row;
+    uint64_t value;
+
+    if (!reader || !vehicle)
+        store_error(EINVAL);
+
+    for (;;)
+    {
+        if (!reader->block || reader->row == reader->block->rows)
+        {
+            reader->block = NULL;
+
+            if (!MapsProtoStoreNextBlock(reader))
+                return 0;
+        }
+
+        row = reader->row++;
+        reader->scan.rows++;
+
+        for (i = 0; i < reader->filters_num; i++)  // Only the filtered columns are read before know if the row match
+        {
+            c = reader->filters[i].column;
+            value = MapsProtoStoreGetValue(&reader->columns[c][row * columns[c].size],columns[c].size);
+
+            if (value < reader->filters[i].min || value > reader->filters[i].max)
+                break;
+        }
+
+        if (i == reader->filters_num)
+            break;
+    }
+
+    memset(vehicle,0,sizeof(tMAPS_PROTO_VEHICLE));
+
+    for (c = 0; c < K_MAPS_PROTO_STORE_COLUMNS; c++)
+    {
+        value = MapsProtoStoreGetValue(&reader->columns[c][row * columns[c].size],columns[c].size);
+        MapsProtoStoreSetValue((uint8_t *) vehicle + columns[c].offset,columns[c].size,value);
+    }
+
+    reader->scan.matches++;
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoStoreGetScan(tMAPS_PROTO_STORE_READER *reader, tMAPS_PROTO_STORE_SCAN *scan)
+{
+    if (!reader || !scan)
+        store_error(EINVAL);
+
+    memcpy(scan,&reader->scan,sizeof(tMAPS_PROTO_STORE_SCAN));
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+void MapsProtoStoreFree(tMAPS_PROTO_STORE_READER *reader)
+{
+    if (reader)
+    {
+        munmap(reader->map,reader->size);
+        free(reader);
+    }
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,223 @@
+#ifndef MAPS_STORE_H
+#define MAPS_STORE_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_store.h
+ *  @brief Function prototypes for assemble the vehicles from the parsed
+ *         frames and store them in a columnar file.
+ *
+ *  The file is append only. The vehicles are grouped in blocks of a fixed
+ *  number of rows (the last block of each writer session can have less
+ *  rows). Each block stores every column (member of tMAPS_PROTO_VEHICLE)
+ *  together and starts with the min and max values of each column.
+ *
+ *  The reader maps the file and skips the blocks where the min/max values
+ *  of a filtered column are out of the filter range, so the scans by time
+ *  range, lane or class only read the blocks that can have vehicles.
+ *
+ *  File format (host byte order, all sizes multiple of 8):
+ *
+ *      HEADER:  "MPST", version (uint16), columns (uint16), block_rows (uint32), reserved (uint32)
+ *      BLOCK:   rows (uint32), reserved (uint32), min (uint64 x columns), max (uint64 x columns)
+ *               Column data: rows values of the column size. Padded to 8 bytes.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+#define K_MAPS_PROTO_STORE_VERSION      1     ///< The current version of the file format.
+#define K_MAPS_PROTO_STORE_MAX_FILTERS  8     ///< Max filters in a reader.
+
+#define K_MAPS_PROTO_STORE_COL_START    0     ///< Vehicle start time.
+#define K_MAPS_PROTO_STORE_COL_END      1     ///< Vehicle end time.
+#define K_MAPS_PROTO_STORE_COL_LANE     2     ///< Lane.
+#define K_MAPS_PROTO_STORE_COL_PAXES    3     ///< Positive axes.
+#define K_MAPS_PROTO_STORE_COL_NAXES    4     ///< Negative axes.
+#define K_MAPS_PROTO_STORE_COL_VCLASS   5     ///< Classification byte.
+#define K_MAPS_PROTO_STORE_COL_HEIGHT   6     ///< Height on the first axle.
+#define K_MAPS_PROTO_STORE_COL_VMAX     7     ///< Maximum height.
+#define K_MAPS_PROTO_STORE_COL_HMIN     8     ///< Minimum height of the top.
+#define K_MAPS_PROTO_STORE_COL_LMAX     9     ///< Maximum height of the underbody.
+#define K_MAPS_PROTO_STORE_COL_SPEED    10    ///< Speed.
+#define K_MAPS_PROTO_STORE_COLUMNS      11    ///< Number of columns.
+//-----------------------------------------------------------------------------
+
+typedef struct sMAPS_PROTO_STORE_WRITER tMAPS_PROTO_STORE_WRITER;
+typedef struct sMAPS_PROTO_STORE_READER tMAPS_PROTO_STORE_READER;
+
+/**
+ *
+ * @struct tMAPS_PROTO_VEHICLE
+ * @brief  A vehicle assembled from the frames of a lane. Each member is a column of the store.
+ *
+ *         The values not sent by the barrier are 0.
+ *
+ */
+typedef struct
+{
+    uint64_t start;       ///< Time of the first frame of the vehicle. Assigned by the application. i.e. Milliseconds.
+    uint64_t end;         ///< Time of the FA SPONTANEOUS, FR or FP frame.
+    uint16_t lane;        ///< The lane (barrier) of the vehicle. Assigned by the application.
+    uint8_t paxes;        ///< Positive axes. From FA SPONTANEOUS/FR or the last EJ.
+    uint8_t naxes;        ///< Negative axes. From FA SPONTANEOUS/FR or the last EJ.
+    char vclass;          ///< Classification byte. From FA SPONTANEOUS/FR.
+    uint8_t height;       ///< Height on the first axle. From AP (vheight or axis_height) or EA (imax_height).
+    uint8_t vmax_height;  ///< Maximum height. From AP (vmax_height) or EA (umax_height).
+    uint8_t hmin_height;  ///< Minimum height of the top. From AP (hmin_height) or EA (umin_height).
+    uint8_t lmax_height;  ///< Maximum height of the underbody. From AP or EA (lmax_height).
+    uint8_t speed;        ///< Maximum speed in Km/h. From IA (CF-220) and EJ.
+}tMAPS_PROTO_VEHICLE;
+
+/**
+ *
+ * @struct tMAPS_PROTO_STORE_SCAN
+ * @brief  The statistics of a scan.
+ *
+ */
+typedef struct
+{
+    uint32_t blocks;      ///< Blocks in the file.
+    uint32_t skipped;     ///< Blocks not read because the min/max values are out of the filters.
+    uint64_t rows;        ///< Rows read.
+    uint64_t matches;     ///< Rows returned.
+}tMAPS_PROTO_STORE_SCAN;
+
+/** @brief Add a frame to the vehicle of a lane.
+ *
+ *  The IP and IA frames start a new vehicle. The AP, EA response, EJ and IA
+ *  data update the heights, axes and speed. The FA SPONTANEOUS, FR and FP
+ *  frames complete the vehicle. After a completed vehicle the next frame
+ *  starts a new one. Use a tMAPS_PROTO_VEHICLE for each lane initialized
+ *  with zeros.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The vehicle or parsed params are NULL.
+ *
+ * @param  vehicle   The vehicle of the lane.
+ * @param  parsed    The frame received from the lane.
+ * @param  lane      The lane.
+ * @param  timestamp The time of the frame.
+ * @return 1 when the vehicle is completed, 0 if not or -1 on error and errno is set.
+ */
+int MapsProtoStoreAssemble(tMAPS_PROTO_VEHICLE *vehicle, const tMAPS_PROTO_PARSED_FRAME *parsed, uint16_t lane, uint64_t timestamp);
+
+/** @brief Opens a store file for append vehicles. The file is created if not exists.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The path is NULL or block_rows is 0.
+ *      ENOEXEC: The file is not a store, have other version or other block_rows.
+ *
+ *  Or any errno value of open, read or fstat.
+ *
+ * @param  path       The path of the file.
+ * @param  block_rows The rows of each block. i.e. 4096.
+ * @return NULL on error and Errno is set or on sucess the writer.
+ */
+tMAPS_PROTO_STORE_WRITER * MapsProtoStoreCreate(const char *path, uint32_t block_rows);
+
+/** @brief Append a vehicle. The block is written to the file when is full.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The writer or vehicle params are NULL.
+ *
+ *  Or any errno value of writev.
+ *
+ * @param  writer  The writer.
+ * @param  vehicle The vehicle to append.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoStoreAppend(tMAPS_PROTO_STORE_WRITER *writer, const tMAPS_PROTO_VEHICLE *vehicle);
+
+/** @brief Write the vehicles not yet written as a block with less rows.
+ *
+ *  The errno values are the same as MapsProtoStoreAppend.
+ *
+ * @param  writer The writer.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoStoreFlush(tMAPS_PROTO_STORE_WRITER *writer);
+
+/** @brief Flush and close a writer.
+ *
+ * @param  writer The writer.
+ * @return 0 on success or -1 if the flush fails and errno is set. The writer is always freed.
+ */
+int MapsProtoStoreClose(tMAPS_PROTO_STORE_WRITER *writer);
+
+/** @brief Opens a store file for read.
+ *
+ *  Only the blocks written before the open are read. An incomplete block at
+ *  the end of the file (a writer is appending it) is ignored.
+ *
+ *  The errno values are:
+ *
+ *      ENOMEM: Couldn't allocate memory
+ *      EINVAL: The path is NULL.
+ *      ENOEXEC: The file is not a store or have other version.
+ *
+ *  Or any errno value of open, fstat or mmap.
+ *
+ * @param  path The path of the file.
+ * @return NULL on error and Errno is set or on sucess the reader.
+ */
+tMAPS_PROTO_STORE_READER * MapsProtoStoreOpen(const char *path);
+
+/** @brief Add a filter to the reader. The vehicles must have the column value between min and max (both included).
+ *
+ *  The scan is restarted.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The reader is NULL, invalid column or min is bigger than max.
+ *      ENOSPC: The reader already have K_MAPS_PROTO_STORE_MAX_FILTERS filters.
+ *
+ * @param  reader The reader.
+ * @param  column The column. One of K_MAPS_PROTO_STORE_COL_* values.
+ * @param  min    The minimum value.
+ * @param  max    The maximum value.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoStoreFilter(tMAPS_PROTO_STORE_READER *reader, uint8_t column, uint64_t min, uint64_t max);
+
+/** @brief Remove the filters and restart the scan.
+ *
+ * @param  reader The reader.
+ */
+void MapsProtoStoreReset(tMAPS_PROTO_STORE_READER *reader);
+
+/** @brief Get the next vehicle that pass the filters.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The reader or vehicle params are NULL.
+ *
+ * @param  reader  The reader.
+ * @param  vehicle The structure where the vehicle is stored.
+ * @return 1 when there is a vehicle, 0 at the end of the file or -1 on error and errno is set.
+ */
+int MapsProtoStoreNext(tMAPS_PROTO_STORE_READER *reader, tMAPS_PROTO_VEHICLE *vehicle);
+
+/** @brief Get the statistics of the current scan.
+ *
+ *  The errno values are:
+ *
+ *      EINVAL: The reader or scan params are NULL.
+ *
+ * @param  reader The reader.
+ * @param  scan   The structure where the statistics are stored.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoStoreGetScan(tMAPS_PROTO_STORE_READER *reader, tMAPS_PROTO_STORE_SCAN *scan);
+
+/** @brief Close a reader.
+ *
+ * @param  reader The reader.
+ */
+void MapsProtoStoreFree(tMAPS_PROTO_STORE_READER *reader);
+
+//-----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,59 @@
+#ifndef MAPS_TRACE_H
+#define MAPS_TRACE_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_trace.h
+ *  @brief The static tracepoints (USDT) of maps_proto.c.
+ *
+ *  The tracepoints are compiled only with MAPS_PROTO_TRACE defined and
+ *  sys/sdt.h installed (systemtap-sdt-dev or systemtap-sdt-devel). Each
+ *  tracepoint is a nop instruction until a tracer is attached, so they can
+ *  stay in production builds. Without MAPS_PROTO_TRACE the macros are empty.
+ *
+ *  The provider is maps_proto. i.e. List them and trace the parse time:
+ *
+ *      bpftrace -l 'usdt:./app:maps_proto:*'
+ *      bpftrace -e 'usdt:./app:maps_proto:parse_entry { @s[tid] = nsecs; }
+ *                   usdt:./app:maps_proto:parse_return /@s[tid]/ { @ns[arg0] = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+ *
+ *  The tracepoints and its arguments are:
+ *
+ *      parse_entry    (frame, size)                     MapsProtoParseFrame, MapsProtoStatusValidate and MapsProtoStatusParse.
+ *      parse_return   (cmd_id, size, status)            The same functions. status is a tMAPS_PROTO_STATUS.
+ *      lrc            (size, calculated, received)      After the LRC of a framed message is calculated.
+ *      prepare_entry  (cmd_id, type, size)              Before the MapsProtoPrepare* callback of the command.
+ *      prepare_return (cmd_id, type, code)              After the callback. code 0 ok, 1 no memory, 2 invalid data.
+ *      create_entry   (type, num, data_size)            MapsProtoCreateFrame.
+ *      create_return  (cmd_id, size, status)            MapsProtoCreateFrame. size is 0 on error.
+ */
+
+#if defined(MAPS_PROTO_TRACE) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define K_MAPS_PROTO_TRACE_ENABLED 1
+#else
+#warning "sys/sdt.h not found. The MAPS tracepoints are disabled"
+#endif
+#endif
+//-----------------------------------------------------------------------------
+
+#ifdef K_MAPS_PROTO_TRACE_ENABLED
+#define trace_parse_entry(f,n)       DTRACE_PROBE2(maps_proto,parse_entry,f,n)
+#define trace_parse_return(c,n,s)    DTRACE_PROBE3(maps_proto,parse_return,c,n,s)
+#define trace_lrc(n,c,r)             DTRACE_PROBE3(maps_proto,lrc,n,c,r)
+#define trace_prepare_entry(c,t,n)   DTRACE_PROBE3(maps_proto,prepare_entry,c,t,n)
+#define trace_prepare_return(c,t,r)  DTRACE_PROBE3(maps_proto,prepare_return,c,t,r)
+#define trace_create_entry(t,m,n)    DTRACE_PROBE3(maps_proto,create_entry,t,m,n)
+#define trace_create_return(c,n,s)   DTRACE_PROBE3(maps_proto,create_return,c,n,s)
+#else
+#define trace_parse_entry(f,n)
+#define trace_parse_return(c,n,s)
+#define trace_lrc(n,c,r)
+#define trace_prepare_entry(c,t,n)
+#define trace_prepare_return(c,t,r)
+#define trace_create_entry(t,m,n)
+#define trace_create_return(c,n,s)
+#endif
+
+//-----------------------------------------------------------------------------
+#endif
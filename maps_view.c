@@ -0,0 +1,218 @@
+
+#include <stddef.h>
+
+#include "maps_view.h"
+//-----------------------------------------------------------------------------
+
+#define view_error(e) do { errno = e; return -1; } while (0)
+#define map_error(e)  do { errno = e; return NULL; } while (0)
+//-----------------------------------------------------------------------------
+
+static int MapsProtoViewDigits(const tMAPS_PROTO_VIEW *view, uint8_t pos);
+static int MapsProtoViewIsCmd (const tMAPS_PROTO_VIEW *view, uint8_t type, uint8_t cmd1, uint8_t cmd2);
+static int MapsProtoViewStatus(const tMAPS_PROTO_VIEW *view);
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewDigits(const tMAPS_PROTO_VIEW *view, uint8_t pos)
+{
+    return ((view->frame[pos] - 48) * 10) + (view->frame[pos+1] - 48);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewIsCmd(const tMAPS_PROTO_VIEW *view, uint8_t type, uint8_t cmd1, uint8_t cmd2)
+{
+    if (view == NULL)
+        view_error(EINVAL);
+    if (view->header.type != type || (view->header.cmd_id != cmd1 && view->header.cmd_id != cmd2))
+        view_error(EPERM);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewStatus(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,1,K_MAPS_PROTO_CMD_DE,K_MAPS_PROTO_CMD_DE) &&
+        MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_EM,K_MAPS_PROTO_CMD_SM))
+        return -1;
+
+    return view->header.data_pos;
+}
+//-----------------------------------------------------------------------------
+//############################# PUBLIC  FUNCTIONS #############################
+
+int MapsProtoViewInit(tMAPS_PROTO_VIEW *view, const uint8_t *frame, uint16_t size)
+{
+    if (view == NULL)
+        view_error(EINVAL);
+    if (MapsProtoValidateFrame(frame,size,&view->header))
+        return -1;
+
+    view->frame = frame;
+    view->size  = size;
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+const uint8_t * MapsProtoViewData(const tMAPS_PROTO_VIEW *view, uint16_t *size)
+{
+    if (view == NULL)
+        map_error(EINVAL);
+    if (size)
+        *size = view->header.data_size;
+
+    return &view->frame[view->header.data_pos];
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewValue(const tMAPS_PROTO_VIEW *view)
+{
+    if (view == NULL)
+        view_error(EINVAL);
+
+    switch (view->header.cmd_id)
+    {
+        case K_MAPS_PROTO_CMD_BR:
+        case K_MAPS_PROTO_CMD_CB:
+        case K_MAPS_PROTO_CMD_ER:
+        case K_MAPS_PROTO_CMD_IA:
+        case K_MAPS_PROTO_CMD_PR:
+        case K_MAPS_PROTO_CMD_RM:
+        case K_MAPS_PROTO_CMD_SR:
+                if (view->header.type == 2)
+                    break;
+                if (view->header.data_size == 1)  // One ASCII digit
+                    return view->frame[view->header.data_pos] - 48;
+                if (view->header.data_size == 2)  // Two ASCII digits
+                    return MapsProtoViewDigits(view,view->header.data_pos);
+        break;
+    }
+
+    view_error(EPERM);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewEndVehiclePaxes(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_FAS,K_MAPS_PROTO_CMD_FR))
+        return -1;
+
+    return MapsProtoViewDigits(view,4);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewEndVehicleNaxes(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_FAS,K_MAPS_PROTO_CMD_FR))
+        return -1;
+
+    return MapsProtoViewDigits(view,6);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewEndVehicleClass(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_FAS,K_MAPS_PROTO_CMD_FR))
+        return -1;
+
+    // The class is the last data byte of the variants of 12 and 24 bytes
+    switch (view->size)
+    {
+        case 12: return view->frame[8];
+        case 24: return view->frame[20];
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewEJPaxes(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_EJ,K_MAPS_PROTO_CMD_EJ))
+        return -1;
+
+    return MapsProtoViewDigits(view,4);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewEJNaxes(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_EJ,K_MAPS_PROTO_CMD_EJ))
+        return -1;
+
+    return MapsProtoViewDigits(view,6);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewEJSpeed(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_EJ,K_MAPS_PROTO_CMD_EJ))
+        return -1;
+
+    return MapsProtoViewDigits(view,8);
+}
+//-----------------------------------------------------------------------------
+
+const char * MapsProtoViewTTEmitterMap(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,1,K_MAPS_PROTO_CMD_TT,K_MAPS_PROTO_CMD_TT))
+        return NULL;
+
+    return (const char *) &view->frame[7];
+}
+//-----------------------------------------------------------------------------
+
+const char * MapsProtoViewTTReceiverMap(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,1,K_MAPS_PROTO_CMD_TT,K_MAPS_PROTO_CMD_TT))
+        return NULL;
+
+    return (const char *) &view->frame[8+K_MAPS_PROTO_EMITTERS_MAP_SIZE];
+}
+//-----------------------------------------------------------------------------
+
+const char * MapsProtoViewAdjustMap8(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_AJ,K_MAPS_PROTO_CMD_PAS))
+        return NULL;
+
+    return (const char *) &view->frame[view->header.data_pos];
+}
+//-----------------------------------------------------------------------------
+
+const char * MapsProtoViewAdjustMap3(const tMAPS_PROTO_VIEW *view)
+{
+    if (MapsProtoViewIsCmd(view,0,K_MAPS_PROTO_CMD_AJ,K_MAPS_PROTO_CMD_PAS))
+        return NULL;
+
+    return (const char *) &view->frame[view->header.data_pos+K_MAPS_PROTO_RECEIVE_GROUP8];
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewDEWorkMode(const tMAPS_PROTO_VIEW *view)
+{
+    int pos = MapsProtoViewStatus(view);
+
+    return (pos < 0) ? -1 : (view->frame[pos] - 48);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewDEAxisSpeed(const tMAPS_PROTO_VIEW *view)
+{
+    int pos = MapsProtoViewStatus(view);
+
+    if (pos < 0)
+        return -1;
+
+    return (view->frame[pos+1] < 58) ? (view->frame[pos+1] - 48) : (view->frame[pos+1] - 55);
+}
+//-----------------------------------------------------------------------------
+
+int MapsProtoViewDEAxisHeight(const tMAPS_PROTO_VIEW *view)
+{
+    int pos = MapsProtoViewStatus(view);
+
+    return (pos < 0) ? -1 : (view->frame[pos+2] - 48);
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,177 @@
+#ifndef MAPS_VIEW_H
+#define MAPS_VIEW_H
+//-----------------------------------------------------------------------------
+
+/** @file maps_view.h
+ *  @brief Function prototypes for read the fields of a MAPS frame without
+ *         parse it.
+ *
+ *  A view points to a frame in the buffer of the caller. The frame is
+ *  validated once with MapsProtoValidateFrame and each getter decodes the
+ *  ASCII of its field when is called. Nothing is allocated or copied and
+ *  the frame is never written, so a view can be used over a read only
+ *  mapped capture. The buffer must be valid while the view is used.
+ *
+ *  The getters of numeric fields return the same value that have the member
+ *  of the data structure of MapsProtoParseFrame or -1 on error. The getters
+ *  of maps return a pointer to the map in the frame.
+ *
+ *  The errno values of the getters are:
+ *
+ *      EINVAL: The view param is NULL.
+ *       EPERM: The command or the variant of the frame not have the field.
+ */
+
+#include "maps_proto.h"
+//-----------------------------------------------------------------------------
+
+/**
+ *
+ * @struct tMAPS_PROTO_VIEW
+ * @brief  A validated frame in the buffer of the caller.
+ *
+ */
+typedef struct
+{
+    const uint8_t *frame;             ///< The frame. Points to the buffer of the caller.
+    uint16_t size;                    ///< The size of the frame.
+    tMAPS_PROTO_FRAME_HEADER header;  ///< The header of the frame.
+}tMAPS_PROTO_VIEW;
+
+/** @brief Validate a frame and initialize a view of it.
+ *
+ *  The errno values are the same as MapsProtoValidateFrame. EINVAL also when
+ *  the view param is NULL.
+ *
+ * @param  view  The view to initialize.
+ * @param  frame The MAPS frame. Is not copied.
+ * @param  size  The size of the frame.
+ * @return 0 on success or -1 on error and errno is set.
+ */
+int MapsProtoViewInit(tMAPS_PROTO_VIEW *view, const uint8_t *frame, uint16_t size);
+
+/** @brief Get the data section of the frame.
+ *
+ * @param  view The view.
+ * @param  size Where the size of the data section is stored. Can be NULL.
+ * @return A pointer to the data in the frame or NULL on error and errno is set.
+ */
+const uint8_t * MapsProtoViewData(const tMAPS_PROTO_VIEW *view, uint16_t *size);
+
+/** @brief Get the value of a command with 1 byte of data.
+ *
+ *  The commands are BR, CB, ER, IA, PR, RM and SR. The same as the first
+ *  byte of the data of the parsed frame.
+ *
+ * @param  view The view.
+ * @return The value or -1 on error and errno is set.
+ */
+int MapsProtoViewValue(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the axes in positive direction of a FAS or FR frame.
+ *
+ * @param  view The view.
+ * @return The axes or -1 on error and errno is set.
+ */
+int MapsProtoViewEndVehiclePaxes(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the axes in negative direction of a FAS or FR frame.
+ *
+ * @param  view The view.
+ * @return The axes or -1 on error and errno is set.
+ */
+int MapsProtoViewEndVehicleNaxes(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the vehicle class of a FAS or FR frame.
+ *
+ * @param  view The view.
+ * @return The class ('A' to 'F', 'M' or 'X'), 0 when the frame not have it or -1 on error and errno is set.
+ */
+int MapsProtoViewEndVehicleClass(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the axes in positive direction of an EJ frame.
+ *
+ * @param  view The view.
+ * @return The axes or -1 on error and errno is set.
+ */
+int MapsProtoViewEJPaxes(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the axes in negative direction of an EJ frame.
+ *
+ * @param  view The view.
+ * @return The axes or -1 on error and errno is set.
+ */
+int MapsProtoViewEJNaxes(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the speed of the axes of an EJ frame.
+ *
+ * @param  view The view.
+ * @return The speed or -1 on error and errno is set.
+ */
+int MapsProtoViewEJSpeed(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the emitters map of a TT response.
+ *
+ *  The map has K_MAPS_PROTO_EMITTERS_MAP_SIZE hex chars. Is not NULL terminated.
+ *
+ * @param  view The view.
+ * @return A pointer to the map in the frame or NULL on error and errno is set.
+ */
+const char * MapsProtoViewTTEmitterMap(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the receivers map of a TT response.
+ *
+ *  The map has K_MAPS_PROTO_RECEIVERS_MAP_SIZE hex chars. Is not NULL terminated.
+ *
+ * @param  view The view.
+ * @return A pointer to the map in the frame or NULL on error and errno is set.
+ */
+const char * MapsProtoViewTTReceiverMap(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the receive map of the 8 groups of an AJ or PAS frame.
+ *
+ *  The map has K_MAPS_PROTO_RECEIVE_GROUP8 chars. Is not NULL terminated.
+ *
+ * @param  view The view.
+ * @return A pointer to the map in the frame or NULL on error and errno is set.
+ */
+const char * MapsProtoViewAdjustMap8(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the receive map of the 3 groups of an AJ or PAS frame.
+ *
+ *  The map has K_MAPS_PROTO_RECEIVE_GROUP3 chars. Is not NULL terminated.
+ *
+ * @param  view The view.
+ * @return A pointer to the map in the frame or NULL on error and errno is set.
+ */
+const char * MapsProtoViewAdjustMap3(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the work mode of a DE response.
+ *
+ *  Also valid for the EM and SM requests that start with the same fields.
+ *
+ * @param  view The view.
+ * @return The work mode (0 to 3) or -1 on error and errno is set.
+ */
+int MapsProtoViewDEWorkMode(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the axes speed sensor of a DE response.
+ *
+ *  Also valid for the EM and SM requests that start with the same fields.
+ *
+ * @param  view The view.
+ * @return The sensor (0 to 15) or -1 on error and errno is set.
+ */
+int MapsProtoViewDEAxisSpeed(const tMAPS_PROTO_VIEW *view);
+
+/** @brief Get the heights of a DE response.
+ *
+ *  Also valid for the EM and SM requests that start with the same fields.
+ *
+ * @param  view The view.
+ * @return The heights (0 to 2) or -1 on error and errno is set.
+ */
+int MapsProtoViewDEAxisHeight(const tMAPS_PROTO_VIEW *view);
+
+//-----------------------------------------------------------------------------
+#endif